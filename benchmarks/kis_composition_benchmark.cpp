@@ -44,11 +44,19 @@
 #include <KoCompositeOp.h>
 #include <KoColorSpaceRegistry.h>
 
+#include <KoColorModelStandardIds.h>
 #include <KoColorSpaceTraits.h>
 #include <KoCompositeOpAlphaDarken.h>
 #include <KoCompositeOpOver.h>
 #include "KoOptimizedCompositeOpFactory.h"
 
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
 // for posix_memalign()
 #include <stdlib.h>
 
@@ -217,11 +225,9 @@ struct Tile {
     quint8 *mask;
 };
 #include <stdint.h>
-QVector<Tile> generateTiles(int size,
+QVector<Tile> allocateTiles(int size,
                             const int srcAlignmentShift,
                             const int dstAlignmentShift,
-                            AlphaRange srcAlphaRange,
-                            AlphaRange dstAlphaRange,
                             const quint32 pixelSize)
 {
     QVector<Tile> tiles(size);
@@ -252,7 +258,21 @@ QVector<Tile> generateTiles(int size,
             qFatal("posix_memalign failed: %d", error);
         }
         tiles[i].mask = (quint8*)ptr;
+    }
+
+    return tiles;
+}
 
+QVector<Tile> generateTiles(int size,
+                            const int srcAlignmentShift,
+                            const int dstAlignmentShift,
+                            AlphaRange srcAlphaRange,
+                            AlphaRange dstAlphaRange,
+                            const quint32 pixelSize)
+{
+    QVector<Tile> tiles = allocateTiles(size, srcAlignmentShift, dstAlignmentShift, pixelSize);
+
+    for (int i = 0; i < size; i++) {
         if (pixelSize == 4) {
             generateDataLine<quint8>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else if (pixelSize == 16) {
@@ -330,8 +350,8 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, ALPHA_RANDOM, op1->colorSpace()->pixelSize());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -409,11 +429,12 @@ void benchmarkCompositeOp(const KoCompositeOp *op,
     QVector<Tile> tiles =
         generateTiles(numTiles, srcAlignmentShift, dstAlignmentShift, srcAlphaRange, dstAlphaRange, op->colorSpace()->pixelSize());
 
-    const int tileOffset = 4 * (processRect.y() * rowStride + processRect.x());
+    const int pixelSize = op->colorSpace()->pixelSize();
+    const int tileOffset = pixelSize * (processRect.y() * rowStride + processRect.x());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
@@ -464,6 +485,176 @@ void benchmarkCompositeOp(const KoCompositeOp *op, const QString &postfix)
     benchmarkCompositeOp(op, false, 1.0, 1.0, 0, 0, ALPHA_UNIT, ALPHA_UNIT);
 }
 
+/**
+ * The composite ops matrix measures every composite op registered in
+ * the RGBA color spaces of all the bit depths. The results are written
+ * into CSV and JSON files, so that the runs on different machines or
+ * different revisions can be compared by a script.
+ */
+
+const int numMatrixTiles = 128;
+
+struct MatrixVariant {
+    const char *name;
+    bool haveMask;
+    qreal opacity;
+    bool useChannelFlags;
+};
+
+const MatrixVariant matrixVariants[] = {
+    {"NoMask",              false, 1.0, false},
+    {"Mask",                true,  1.0, false},
+    {"NoMask_Opacity05",    false, 0.5, false},
+    {"Mask_Opacity05",      true,  0.5, false},
+    {"NoMask_ChannelFlags", false, 1.0, true}
+};
+
+struct MatrixResult {
+    QString colorSpace;
+    QString compositeOp;
+    QString variant;
+    qint64 pixels;
+    qint64 nsecs;
+};
+
+struct MatrixData {
+    QVector<quint8> src;
+    QVector<quint8> dst;
+    QVector<quint8> mask;
+};
+
+/**
+ * The pixels are generated from normalized channel values, so the
+ * floating point color spaces don't get NaNs and infinities the
+ * random bytes would give
+ */
+MatrixData generateMatrixData(const KoColorSpace *cs)
+{
+    const int pixelSize = cs->pixelSize();
+    const int channelCount = cs->channelCount();
+
+    MatrixData data;
+    data.src.resize(numPixels * pixelSize);
+    data.dst.resize(numPixels * pixelSize);
+    data.mask.resize(numPixels);
+
+    RandomGenerator<float> rnd(1);
+    RandomGenerator<quint8> maskRnd(2);
+    QVector<float> channels(channelCount);
+
+    for (int i = 0; i < numPixels; i++) {
+        for (int j = 0; j < channelCount; j++) {
+            channels[j] = rnd();
+        }
+        cs->fromNormalisedChannelsValue(data.src.data() + i * pixelSize, channels);
+
+        for (int j = 0; j < channelCount; j++) {
+            channels[j] = rnd();
+        }
+        cs->fromNormalisedChannelsValue(data.dst.data() + i * pixelSize, channels);
+
+        data.mask[i] = maskRnd();
+    }
+
+    return data;
+}
+
+qint64 benchmarkMatrixCase(const KoCompositeOp *op,
+                           const MatrixVariant &variant,
+                           const MatrixData &data,
+                           const QVector<Tile> &tiles)
+{
+    const KoColorSpace *cs = op->colorSpace();
+    const int pixelSize = cs->pixelSize();
+
+    // every case starts with the same destination
+    Q_FOREACH (const Tile &tile, tiles) {
+        memcpy(tile.src, data.src.constData(), data.src.size());
+        memcpy(tile.dst, data.dst.constData(), data.dst.size());
+        memcpy(tile.mask, data.mask.constData(), data.mask.size());
+    }
+
+    QBitArray channelFlags;
+    if (variant.useChannelFlags) {
+        channelFlags = QBitArray(cs->channelCount(), true);
+
+        // the first channel is a color one in all the RGBA color spaces
+        channelFlags.clearBit(0);
+    }
+
+    KoCompositeOp::ParameterInfo params;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
+    params.maskRowStride = rowStride;
+    params.rows          = processRect.height();
+    params.cols          = processRect.width();
+    params.opacity       = variant.opacity;
+    params.flow          = 1.0;
+    params.channelFlags  = channelFlags;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Q_FOREACH (const Tile &tile, tiles) {
+        params.dstRowStart   = tile.dst;
+        params.srcRowStart   = tile.src;
+        params.maskRowStart  = variant.haveMask ? tile.mask : 0;
+        op->composite(params);
+    }
+
+    return timer.nsecsElapsed();
+}
+
+qreal megapixelsPerSecond(const MatrixResult &result)
+{
+    return result.nsecs > 0 ? 1000.0 * result.pixels / result.nsecs : 0.0;
+}
+
+void writeMatrixResults(const QVector<MatrixResult> &results, const QString &baseName)
+{
+    QFile csvFile(baseName + ".csv");
+    if (csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QTextStream stream(&csvFile);
+        stream << "colorspace,compositeop,variant,pixels,nsecs,mpix_per_sec\n";
+
+        Q_FOREACH (const MatrixResult &result, results) {
+            stream << result.colorSpace << ","
+                   << result.compositeOp << ","
+                   << result.variant << ","
+                   << result.pixels << ","
+                   << result.nsecs << ","
+                   << megapixelsPerSecond(result) << "\n";
+        }
+    } else {
+        warnKrita << "Failed to write" << csvFile.fileName();
+    }
+
+    QJsonArray array;
+    Q_FOREACH (const MatrixResult &result, results) {
+        QJsonObject object;
+        object["colorspace"] = result.colorSpace;
+        object["compositeop"] = result.compositeOp;
+        object["variant"] = result.variant;
+        object["pixels"] = result.pixels;
+        object["nsecs"] = result.nsecs;
+        object["mpix_per_sec"] = megapixelsPerSecond(result);
+        array.append(object);
+    }
+
+    QJsonObject root;
+    root["tileWidth"] = processRect.width();
+    root["tileHeight"] = processRect.height();
+    root["tiles"] = numMatrixTiles;
+    root["results"] = array;
+
+    QFile jsonFile(baseName + ".json");
+    if (jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        jsonFile.write(QJsonDocument(root).toJson());
+    } else {
+        warnKrita << "Failed to write" << jsonFile.fileName();
+    }
+}
+
 #ifdef HAVE_VC
 
 template<class Compositor>
@@ -795,6 +986,57 @@ void KisCompositionBenchmark::testRgb8CompositeCopyLegacy()
     benchmarkCompositeOp(op, "Copy");
 }
 
+void KisCompositionBenchmark::benchmarkCompositeOpsMatrix()
+{
+    const QList<KoID> depths = {
+        Integer8BitsColorDepthID,
+        Integer16BitsColorDepthID,
+        Float16BitsColorDepthID,
+        Float32BitsColorDepthID
+    };
+
+    QVector<MatrixResult> results;
+
+    Q_FOREACH (const KoID &depth, depths) {
+        const KoColorSpace *cs =
+            KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth.id(), 0);
+
+        if (!cs) {
+            // e.g. F16 is not available without OpenEXR
+            dbgKrita << "Skipping unavailable color space:" << depth.id();
+            continue;
+        }
+
+        const MatrixData data = generateMatrixData(cs);
+        QVector<Tile> tiles = allocateTiles(numMatrixTiles, 0, 0, cs->pixelSize());
+
+        Q_FOREACH (const KoCompositeOp *op, cs->compositeOps()) {
+            for (const MatrixVariant &variant : matrixVariants) {
+                MatrixResult result;
+                result.colorSpace = cs->id();
+                result.compositeOp = op->id();
+                result.variant = variant.name;
+                result.pixels = qint64(numMatrixTiles) * processRect.width() * processRect.height();
+                result.nsecs = benchmarkMatrixCase(op, variant, data, tiles);
+
+                dbgKrita << result.colorSpace << result.compositeOp << result.variant
+                         << "RESULT:" << megapixelsPerSecond(result) << "Mpix/sec";
+
+                results.append(result);
+            }
+        }
+
+        freeTiles(tiles, 0, 0);
+    }
+
+    const QString baseName =
+        qEnvironmentVariableIsSet("KRITA_COMPOSITION_BENCHMARK_OUTPUT") ?
+        QString::fromLocal8Bit(qgetenv("KRITA_COMPOSITION_BENCHMARK_OUTPUT")) :
+        QString("composite_ops_matrix");
+
+    writeMatrixResults(results, baseName);
+}
+
 void KisCompositionBenchmark::benchmarkMemcpy()
 {
     QVector<Tile> tiles =
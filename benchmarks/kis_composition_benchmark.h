@@ -63,6 +63,8 @@ private Q_SLOTS:
 
     void testRgb8CompositeCopyLegacy();
 
+    void benchmarkCompositeOpsMatrix();
+
     void benchmarkMemcpy();
 
     void benchmarkUintFloat();
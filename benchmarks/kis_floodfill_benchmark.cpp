@@ -32,6 +32,8 @@
 #include "kis_floodfill_benchmark.h"
 
 #include <kis_fill_painter.h>
+#include <kis_pixel_selection.h>
+#include <floodfill/kis_scanline_fill.h>
 
 #include <KoCompositeOps.h>
 
@@ -104,6 +106,71 @@ void KisFloodFillBenchmark::benchmarkFlood()
     //out.save("fill_output.png");
 }
 
+/**
+ * The size of the canvas for the benchmarks of the large regions
+ */
+static const int LARGE_IMAGE_SIZE = 8192;
+
+void KisFloodFillBenchmark::benchmarkFloodLargeOpen()
+{
+    const QRect imageRect(0, 0, LARGE_IMAGE_SIZE, LARGE_IMAGE_SIZE);
+
+    KisPaintDeviceSP device = new KisPaintDevice(m_colorSpace);
+    device->fill(imageRect, KoColor(Qt::white, m_colorSpace));
+
+    // a few obstacles, the region stays a single open area
+    KisPainter painter(device);
+    painter.setFillStyle(KisPainter::FillStyleForegroundColor);
+    painter.setPaintColor(KoColor(Qt::black, m_colorSpace));
+
+    for (int i = 0; i < 20; i++) {
+        painter.paintEllipse(rand() % LARGE_IMAGE_SIZE, rand() % LARGE_IMAGE_SIZE, 300, 200);
+    }
+
+    QBENCHMARK
+    {
+        KisPixelSelectionSP selection = new KisPixelSelection();
+
+        KisScanlineFill fill(device, QPoint(1, 1), imageRect);
+        fill.setThreshold(15);
+        fill.fillSelection(selection);
+    }
+}
+
+void KisFloodFillBenchmark::benchmarkFloodLargeFragmented()
+{
+    const QRect imageRect(0, 0, LARGE_IMAGE_SIZE, LARGE_IMAGE_SIZE);
+
+    KisPaintDeviceSP device = new KisPaintDevice(m_colorSpace);
+    device->fill(imageRect, KoColor(Qt::white, m_colorSpace));
+
+    /**
+     * A dense grid of walls with random gaps, so the filled region
+     * is a maze of narrow corridors reaching most of the image
+     */
+    const int cellSize = 16;
+    const KoColor wallColor(Qt::black, m_colorSpace);
+
+    for (int y = 0; y < LARGE_IMAGE_SIZE; y += cellSize) {
+        for (int x = 0; x < LARGE_IMAGE_SIZE; x += cellSize) {
+            if (rand() % 3) {
+                device->fill(QRect(x, y, cellSize - 2, 2), wallColor);
+            }
+            if (rand() % 3) {
+                device->fill(QRect(x, y, 2, cellSize - 2), wallColor);
+            }
+        }
+    }
+
+    QBENCHMARK
+    {
+        KisPixelSelectionSP selection = new KisPixelSelection();
+
+        KisScanlineFill fill(device, QPoint(LARGE_IMAGE_SIZE / 2 + 8, LARGE_IMAGE_SIZE / 2 + 8), imageRect);
+        fill.setThreshold(15);
+        fill.fillSelection(selection);
+    }
+}
 
 void KisFloodFillBenchmark::cleanupTestCase()
 {
@@ -42,6 +42,8 @@ private Q_SLOTS:
     void cleanupTestCase();
     
     void benchmarkFlood();
+    void benchmarkFloodLargeOpen();
+    void benchmarkFloodLargeFragmented();
     
     
     
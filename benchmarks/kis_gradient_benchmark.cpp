@@ -33,6 +33,8 @@
 #include "kis_gradient_benchmark.h"
 
 #include <kis_gradient_painter.h>
+#include <kis_selection.h>
+#include <kis_pixel_selection.h>
 
 #include <KoCompositeOps.h>
 #include <resources/KoStopGradient.h>
@@ -47,39 +49,95 @@ void KisGradientBenchmark::initTestCase()
     m_device->fill( 0,0,GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT,m_color.data() );
 }
 
-void KisGradientBenchmark::benchmarkGradient()
+void KisGradientBenchmark::benchmarkShape(KisGradientPainter::enumGradientShape shape,
+                                          KisSelectionSP selection)
 {
-    KoColor fg(m_colorSpace);
-    KoColor bg(m_colorSpace);
-    fg.fromQColor(Qt::blue);
-    bg.fromQColor(Qt::black);
-    
+    QLinearGradient grad;
+    grad.setColorAt(0, Qt::white);
+    grad.setColorAt(1.0, Qt::red);
+    QScopedPointer<KoAbstractGradient> kograd(KoStopGradient::fromQGradient(&grad));
+    Q_ASSERT(kograd);
+
     QBENCHMARK
     {
-        QLinearGradient grad;
-        grad.setColorAt(0, Qt::white);
-        grad.setColorAt(1.0, Qt::red);
-        KoAbstractGradient* kograd = KoStopGradient::fromQGradient(&grad);
-        Q_ASSERT(kograd);
-        KisGradientPainter fillPainter(m_device);
-        //setupPainter(&fillPainter);
-        fillPainter.setGradient(kograd);
+        KisGradientPainter fillPainter(m_device, selection);
+        fillPainter.setGradient(kograd.data());
 
         fillPainter.beginTransaction(kundo2_noi18n("Gradient Fill"));
 
-        //fillPainter.setProgress(updater->startSubtask());
         fillPainter.setOpacity(OPACITY_OPAQUE_U8);
         // default
         fillPainter.setCompositeOp(COMPOSITE_OVER);
-        fillPainter.setGradientShape(KisGradientPainter::GradientShapeBiLinear);
-        fillPainter.paintGradient(QPointF(0,0), QPointF(3000,3000), KisGradientPainter::GradientRepeatNone, true, false, 0, 0, GMP_IMAGE_WIDTH,GMP_IMAGE_HEIGHT);
+        fillPainter.setGradientShape(shape);
+        fillPainter.paintGradient(QPointF(GMP_IMAGE_WIDTH / 2, GMP_IMAGE_HEIGHT / 2),
+                                  QPointF(GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT),
+                                  KisGradientPainter::GradientRepeatNone, true, false,
+                                  0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
 
         fillPainter.deleteTransaction();
     }
-    
+
     // uncomment this to see the output
-    QImage out = m_device->convertToQImage(m_colorSpace->profile(),0,0,GMP_IMAGE_WIDTH,GMP_IMAGE_HEIGHT);
-    out.save("fill_output.png");
+    //QImage out = m_device->convertToQImage(m_colorSpace->profile(),0,0,GMP_IMAGE_WIDTH,GMP_IMAGE_HEIGHT);
+    //out.save(QString("fill_output_%1.png").arg(QTest::currentTestFunction()));
+}
+
+void KisGradientBenchmark::benchmarkLinear()
+{
+    benchmarkShape(KisGradientPainter::GradientShapeLinear);
+}
+
+void KisGradientBenchmark::benchmarkBiLinear()
+{
+    benchmarkShape(KisGradientPainter::GradientShapeBiLinear);
+}
+
+void KisGradientBenchmark::benchmarkRadial()
+{
+    benchmarkShape(KisGradientPainter::GradientShapeRadial);
+}
+
+void KisGradientBenchmark::benchmarkSquare()
+{
+    benchmarkShape(KisGradientPainter::GradientShapeSquare);
+}
+
+void KisGradientBenchmark::benchmarkConical()
+{
+    benchmarkShape(KisGradientPainter::GradientShapeConical);
+}
+
+void KisGradientBenchmark::benchmarkConicalSymetric()
+{
+    benchmarkShape(KisGradientPainter::GradientShapeConicalSymetric);
+}
+
+void KisGradientBenchmark::benchmarkPolygonal()
+{
+    /**
+     * The shaped gradient needs a selection to take the outline
+     * from, otherwise it would be painted over the infinite bounds
+     * of the device
+     */
+    QPolygonF polygon;
+    polygon << QPointF(0.1 * GMP_IMAGE_WIDTH, 0.1 * GMP_IMAGE_HEIGHT);
+    polygon << QPointF(0.9 * GMP_IMAGE_WIDTH, 0.2 * GMP_IMAGE_HEIGHT);
+    polygon << QPointF(0.8 * GMP_IMAGE_WIDTH, 0.9 * GMP_IMAGE_HEIGHT);
+    polygon << QPointF(0.5 * GMP_IMAGE_WIDTH, 0.6 * GMP_IMAGE_HEIGHT);
+    polygon << QPointF(0.2 * GMP_IMAGE_WIDTH, 0.8 * GMP_IMAGE_HEIGHT);
+
+    KisSelectionSP selection = new KisSelection();
+    KisPixelSelectionSP pixelSelection = selection->pixelSelection();
+
+    KisPainter selPainter(pixelSelection);
+    selPainter.setFillStyle(KisPainter::FillStyleForegroundColor);
+    selPainter.setPaintColor(KoColor(Qt::white, pixelSelection->colorSpace()));
+    selPainter.paintPolygon(polygon);
+    selPainter.end();
+
+    pixelSelection->invalidateOutlineCache();
+
+    benchmarkShape(KisGradientPainter::GradientShapePolygonal, selection);
 }
 
 
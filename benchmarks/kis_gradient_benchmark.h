@@ -24,6 +24,7 @@
 #include <kis_types.h>
 #include <QtTest>
 #include <kis_paint_device.h>
+#include <kis_gradient_painter.h>
 
 class KoColor;
 
@@ -36,12 +37,21 @@ private:
     KisPaintDeviceSP m_device;        
     int m_startX;
     int m_startY;
-    
+
+    void benchmarkShape(KisGradientPainter::enumGradientShape shape,
+                        KisSelectionSP selection = 0);
+
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
     
-    void benchmarkGradient();
+    void benchmarkLinear();
+    void benchmarkBiLinear();
+    void benchmarkRadial();
+    void benchmarkSquare();
+    void benchmarkConical();
+    void benchmarkConicalSymetric();
+    void benchmarkPolygonal();
     
     
     
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_png_export_benchmark.h"
+#include "kis_benchmark_values.h"
+
+#include <QTest>
+#include <QBuffer>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColor.h>
+
+#include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "kis_png_converter.h"
+
+#include <cmath>
+
+
+void KisPNGExportBenchmark::benchmarkExport_data()
+{
+    QTest::addColumn<QString>("colorDepth");
+    QTest::addColumn<int>("compression");
+    QTest::addColumn<bool>("interlace");
+
+    QTest::newRow("rgba8-c6") << Integer8BitsColorDepthID.id() << 6 << false;
+    QTest::newRow("rgba8-c9") << Integer8BitsColorDepthID.id() << 9 << false;
+    QTest::newRow("rgba16-c6") << Integer16BitsColorDepthID.id() << 6 << false;
+    QTest::newRow("rgba16-c9") << Integer16BitsColorDepthID.id() << 9 << false;
+
+    // interlaced images are still encoded by libpng on a single thread
+    QTest::newRow("rgba16-c9-interlaced") << Integer16BitsColorDepthID.id() << 9 << true;
+}
+
+void KisPNGExportBenchmark::benchmarkExport()
+{
+    QFETCH(QString, colorDepth);
+    QFETCH(int, compression);
+    QFETCH(bool, interlace);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepth, "");
+
+    const QRect rc(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(Qt::white, cs));
+
+    KisPainter painter(dev);
+    painter.setPaintColor(KoColor(Qt::darkBlue, cs));
+
+    const qreal radius = qMin(rc.width(), rc.height());
+    for (int i = 0; i < 90; i += 5) {
+        const qreal angle = i * M_PI / 180.0;
+        painter.drawThickLine(QPointF(0, 0), QPointF(radius * std::sin(angle), radius * std::cos(angle)), 1, 30);
+    }
+    painter.end();
+
+    KisPNGOptions options;
+    options.compression = compression;
+    options.interlace = interlace;
+    options.tryToSaveAsIndexed = false;
+
+    vKisAnnotationSP annotations;
+
+    QBENCHMARK {
+        QBuffer buffer;
+        KisPNGConverter converter(0);
+        converter.buildFile(&buffer, rc, 1.0, 1.0, dev,
+                            annotations.begin(), annotations.end(),
+                            options, 0);
+    }
+}
+
+QTEST_MAIN(KisPNGExportBenchmark)
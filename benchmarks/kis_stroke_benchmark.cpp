@@ -324,6 +324,48 @@ void KisStrokeBenchmark::colorsmudge()
 void KisStrokeBenchmark::colorsmudgeRL()
 {
     QString presetFileName = "colorsmudge.kpp";
+    benchmarkRandomLines(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeSmearing()
+{
+    QString presetFileName = "colorsmudge-smearing-70px.kpp";
+    benchmarkStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeSmearingRL()
+{
+    QString presetFileName = "colorsmudge-smearing-70px.kpp";
+    benchmarkRandomLines(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeDulling()
+{
+    QString presetFileName = "colorsmudge-dulling-70px.kpp";
+    benchmarkStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeDullingRL()
+{
+    QString presetFileName = "colorsmudge-dulling-70px.kpp";
+    benchmarkRandomLines(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeOverlay()
+{
+    QString presetFileName = "colorsmudge-overlay-70px.kpp";
+    benchmarkStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeOverlayRL()
+{
+    QString presetFileName = "colorsmudge-overlay-70px.kpp";
+    benchmarkRandomLines(presetFileName);
+}
+
+void KisStrokeBenchmark::colorsmudgeSmearing300px()
+{
+    QString presetFileName = "colorsmudge-smearing-300px.kpp";
     benchmarkStroke(presetFileName);
 }
 
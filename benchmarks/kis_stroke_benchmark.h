@@ -120,6 +120,18 @@ private Q_SLOTS:
 
     void colorsmudge();
     void colorsmudgeRL();
+
+    // Color smudge brush benchmarks
+    void colorsmudgeSmearing();
+    void colorsmudgeSmearingRL();
+
+    void colorsmudgeDulling();
+    void colorsmudgeDullingRL();
+
+    void colorsmudgeOverlay();
+    void colorsmudgeOverlayRL();
+
+    void colorsmudgeSmearing300px();
 /*
     void predefinedBrush();
     void predefinedBrushRL();
@@ -0,0 +1,305 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_stroke_replay_benchmark.h"
+
+#include <QTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+
+#include <KoCanvasResourceManager.h>
+
+#include <kis_image.h>
+#include <kis_canvas_resource_provider.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <kis_resources_snapshot.h>
+#include <strokes/freehand_stroke.h>
+#include <kis_freehand_stroke_record.h>
+
+#include "stroke_testing_utils.h"
+#include "kis_debug.h"
+
+
+const QString DEFAULT_PRESET_FILE_NAME = "autobrush_300px.kpp";
+const QSize DEFAULT_IMAGE_SIZE(4000, 3000);
+
+#ifdef Q_OS_WIN
+const QChar PATH_LIST_SEPARATOR = ';';
+#else
+const QChar PATH_LIST_SEPARATOR = ':';
+#endif
+
+/**
+ * Measures the time spent on every paint job of the stroke. The jobs
+ * of the freehand stroke are sequential, so the lock is never contended.
+ */
+class TimedFreehandStrokeStrategy : public FreehandStrokeStrategy
+{
+public:
+    TimedFreehandStrokeStrategy(KisResourcesSnapshotSP resources,
+                                QVector<PainterInfo*> painterInfos,
+                                QVector<qint64> *jobTimes)
+        : FreehandStrokeStrategy(resources->needsIndirectPainting(),
+                                 resources->indirectPaintingCompositeOp(),
+                                 resources, painterInfos,
+                                 kundo2_noi18n("Replayed Stroke")),
+          m_jobTimes(jobTimes)
+    {
+    }
+
+    void doStrokeCallback(KisStrokeJobData *data) override {
+        QElapsedTimer timer;
+        timer.start();
+
+        FreehandStrokeStrategy::doStrokeCallback(data);
+
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        QMutexLocker l(&m_lock);
+        m_jobTimes->append(elapsed);
+    }
+
+private:
+    QVector<qint64> *m_jobTimes;
+    QMutex m_lock;
+};
+
+/**
+ * A stroke resembling the real one: a wavy line with varying pressure
+ * and tilt, sampled at 200Hz. Used when no recorded strokes are given.
+ */
+KisFreehandStrokeRecord createSyntheticStroke(const QSize &imageSize)
+{
+    KisFreehandStrokeRecord record;
+    record.setImageSize(imageSize);
+
+    const int numSamples = 2000;
+    const int sampleInterval = 5;
+
+    KisPaintInformation prevPi;
+
+    for (int i = 0; i < numSamples; i++) {
+        const qreal t = qreal(i) / (numSamples - 1);
+        const int time = i * sampleInterval;
+
+        const QPointF pos(imageSize.width() * (0.05 + 0.9 * t),
+                          imageSize.height() * (0.5 + 0.3 * std::sin(12.0 * M_PI * t)));
+
+        const qreal pressure = 0.2 + 0.8 * std::abs(std::sin(3.0 * M_PI * t));
+        const qreal xTilt = 30.0 * std::cos(2.0 * M_PI * t);
+        const qreal yTilt = 30.0 * std::sin(2.0 * M_PI * t);
+
+        KisPaintInformation pi(pos, pressure, xTilt, yTilt, 0.0, 0.0, 1.0, time, 0.0);
+
+        if (i > 0) {
+            record.addLine(time, 0, prevPi, pi);
+        }
+
+        prevPi = pi;
+    }
+
+    return record;
+}
+
+QStringList collectStrokeFiles()
+{
+    QStringList files;
+
+    const QStringList paths =
+        QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_FILES"))
+        .split(PATH_LIST_SEPARATOR, QString::SkipEmptyParts);
+
+    Q_FOREACH (const QString &path, paths) {
+        QFileInfo info(path);
+
+        if (info.isDir()) {
+            QDir dir(path);
+            Q_FOREACH (const QString &fileName,
+                       dir.entryList(QStringList() << "*.xml", QDir::Files, QDir::Name)) {
+                files << dir.filePath(fileName);
+            }
+        } else {
+            files << path;
+        }
+    }
+
+    return files;
+}
+
+KisPaintOpPresetSP loadPreset()
+{
+    QString fileName = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_PRESET"));
+    if (fileName.isEmpty()) {
+        fileName = DEFAULT_PRESET_FILE_NAME;
+    }
+
+    if (!QFileInfo(fileName).isAbsolute()) {
+        fileName = QString(FILES_DATA_DIR) + QDir::separator() + fileName;
+    }
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(fileName);
+    if (!preset->load()) {
+        warnKrita << "Failed to load the preset" << fileName;
+        return 0;
+    }
+
+    return preset;
+}
+
+QSize replayImageSize(const KisFreehandStrokeRecord &record)
+{
+    const QStringList parts =
+        QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_IMAGE_SIZE")).split('x');
+
+    if (parts.size() == 2) {
+        const QSize size(parts[0].toInt(), parts[1].toInt());
+        if (!size.isEmpty()) return size;
+    }
+
+    return !record.imageSize().isEmpty() ? record.imageSize() : DEFAULT_IMAGE_SIZE;
+}
+
+qreal percentile(const QVector<qint64> &sortedValues, qreal portion)
+{
+    if (sortedValues.isEmpty()) return 0.0;
+
+    const int index = qBound(0, int(portion * sortedValues.size()), sortedValues.size() - 1);
+    return sortedValues[index];
+}
+
+void replayStroke(const KisFreehandStrokeRecord &record, KisPaintOpPresetSP preset)
+{
+    KisImageSP image = utils::createImage(0, replayImageSize(record));
+    QScopedPointer<KoCanvasResourceManager> manager(
+        utils::createResourceManager(image, 0, QString()));
+
+    QVariant v;
+    v.setValue(preset);
+    manager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, v);
+
+    KisResourcesSnapshotSP resources =
+        new KisResourcesSnapshot(image,
+                                 image->rootLayer()->firstChild(),
+                                 manager.data());
+
+    const QVector<KisFreehandStrokeRecord::Job> &jobs = record.jobs();
+
+    /**
+     * Every painter starts at the first point it paints, the same
+     * way KisToolFreehandHelper::createPainters() does
+     */
+    QVector<FreehandStrokeStrategy::PainterInfo*> painterInfos;
+    for (int i = 0; i < record.numPainters(); i++) {
+        auto it = std::find_if(jobs.begin(), jobs.end(),
+                               [i] (const KisFreehandStrokeRecord::Job &job) {
+                                   return job.painterInfoId == i;
+                               });
+
+        painterInfos << (it != jobs.end() ?
+                         new FreehandStrokeStrategy::PainterInfo(it->pi1.pos(), it->pi1.currentTime()) :
+                         new FreehandStrokeStrategy::PainterInfo());
+    }
+
+    QVector<qint64> jobTimes;
+    jobTimes.reserve(jobs.size());
+
+    KisNodeSP node = resources->currentNode();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    KisStrokeId strokeId =
+        image->startStroke(new TimedFreehandStrokeStrategy(resources, painterInfos, &jobTimes));
+
+    Q_FOREACH (const KisFreehandStrokeRecord::Job &job, jobs) {
+        FreehandStrokeStrategy::Data *data = 0;
+
+        switch (job.type) {
+        case KisFreehandStrokeRecord::POINT:
+            data = new FreehandStrokeStrategy::Data(node, job.painterInfoId, job.pi1);
+            break;
+        case KisFreehandStrokeRecord::LINE:
+            data = new FreehandStrokeStrategy::Data(node, job.painterInfoId, job.pi1, job.pi2);
+            break;
+        case KisFreehandStrokeRecord::CURVE:
+            data = new FreehandStrokeStrategy::Data(node, job.painterInfoId,
+                                                    job.pi1, job.control1, job.control2, job.pi2);
+            break;
+        }
+
+        image->addJob(strokeId, data);
+    }
+
+    image->endStroke(strokeId);
+    image->waitForDone();
+
+    const qint64 totalTime = timer.nsecsElapsed();
+
+    std::sort(jobTimes.begin(), jobTimes.end());
+
+    qInfo() << "Replayed" << jobs.size() << "jobs on" << image->size()
+             << "with" << preset->name();
+    qInfo() << "    total:" << totalTime / 1000000.0 << "msec";
+    qInfo() << "    job time, usec:"
+             << "p50" << percentile(jobTimes, 0.50) / 1000.0
+             << "p90" << percentile(jobTimes, 0.90) / 1000.0
+             << "p99" << percentile(jobTimes, 0.99) / 1000.0
+             << "max" << percentile(jobTimes, 1.00) / 1000.0;
+}
+
+void KisStrokeReplayBenchmark::benchmarkReplay_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    const QStringList files = collectStrokeFiles();
+
+    if (files.isEmpty()) {
+        QTest::newRow("synthetic") << QString();
+    }
+
+    Q_FOREACH (const QString &fileName, files) {
+        QTest::newRow(QFileInfo(fileName).fileName().toLatin1()) << fileName;
+    }
+}
+
+void KisStrokeReplayBenchmark::benchmarkReplay()
+{
+    QFETCH(QString, fileName);
+
+    KisFreehandStrokeRecord record;
+
+    if (fileName.isEmpty()) {
+        record = createSyntheticStroke(DEFAULT_IMAGE_SIZE);
+    } else if (!record.load(fileName)) {
+        QFAIL(QString("Failed to load the stroke: %1").arg(fileName).toLatin1());
+    }
+
+    KisPaintOpPresetSP preset = loadPreset();
+    QVERIFY(preset);
+
+    QBENCHMARK_ONCE {
+        replayStroke(record, preset);
+    }
+}
+
+QTEST_MAIN(KisStrokeReplayBenchmark)
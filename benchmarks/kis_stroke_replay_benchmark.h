@@ -0,0 +1,49 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_STROKE_REPLAY_BENCHMARK_H
+#define __KIS_STROKE_REPLAY_BENCHMARK_H
+
+#include <QtTest>
+
+/**
+ * Replays the strokes recorded by KisToolFreehandHelper (see
+ * KisFreehandStrokeRecord) through FreehandStrokeStrategy at full
+ * speed and reports the total time of the stroke and the percentiles
+ * of the time spent on every paint job.
+ *
+ * The benchmark is configured with the environment variables:
+ *
+ * KRITA_STROKE_REPLAY_FILES      the recorded stroke files or directories
+ *                                containing them, separated by the
+ *                                platform list separator. When not set,
+ *                                a synthetic stroke is replayed.
+ * KRITA_STROKE_REPLAY_PRESET     the preset file to paint with, either an
+ *                                absolute path or a file from the data dir
+ * KRITA_STROKE_REPLAY_IMAGE_SIZE the size of the document, e.g. "4000x3000";
+ *                                by default the recorded size is used
+ */
+class KisStrokeReplayBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchmarkReplay_data();
+    void benchmarkReplay();
+};
+
+#endif /* __KIS_STROKE_REPLAY_BENCHMARK_H */
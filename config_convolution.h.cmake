@@ -2,3 +2,6 @@
 /* Defines if your system has the FFTW3 library */
 #cmakedefine HAVE_FFTW3 1
 
+
+/* Defines if your system has the single precision FFTW3 library */
+#cmakedefine HAVE_FFTW3F 1
@@ -0,0 +1,241 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_alpha_mask_pyramid.h"
+
+#include <cstring>
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QImage>
+#include <QTransform>
+
+#include <KoColorSpaceMaths.h>
+
+#include "kis_qimage_pyramid.h"
+#include "kis_assert.h"
+
+/**
+ * The limits of the cache of the generated masks. The rotation
+ * dynamics rarely repeats the angle exactly, so the cache is kept
+ * small and is mostly useful for the strokes without dynamics painted
+ * by several dab caches at once.
+ */
+static const int MAX_CACHED_MASKS = 16;
+static const int MAX_CACHE_BYTES = 4 * 1024 * 1024;
+
+
+struct KisAlphaMaskPyramid::Private
+{
+    struct Level {
+        int width;
+        int height;
+
+        /// the width of the transparent border around the level
+        int border;
+
+        QVector<quint8> data;
+    };
+
+    struct CacheEntry {
+        qreal scaleX;
+        qreal scaleY;
+        qreal rotation;
+        qreal subPixelX;
+        qreal subPixelY;
+
+        Mask mask;
+    };
+
+    QSharedPointer<const KisQImagePyramid> pyramid;
+    QVector<Level> levels;
+    bool hasColor;
+
+    QMutex cacheLock;
+    QList<CacheEntry> cache;
+    int cacheBytes;
+
+    bool fetchFromCache(KisDabShape const& shape, qreal subPixelX, qreal subPixelY, Mask *mask);
+    void putToCache(KisDabShape const& shape, qreal subPixelX, qreal subPixelY, const Mask &mask);
+
+    static void copyLevel(const Level &level, Mask *mask);
+    static void convertImage(const QImage &image, bool hasColor, Mask *mask);
+};
+
+KisAlphaMaskPyramid::KisAlphaMaskPyramid(QSharedPointer<const KisQImagePyramid> pyramid, bool hasColor)
+    : m_d(new Private)
+{
+    m_d->pyramid = pyramid;
+    m_d->hasColor = hasColor;
+    m_d->cacheBytes = 0;
+
+    Q_FOREACH (const KisQImagePyramid::PyramidLevel &srcLevel, pyramid->m_levels) {
+        const QImage &image = srcLevel.image;
+        KIS_SAFE_ASSERT_RECOVER(image.format() == QImage::Format_ARGB32) { continue; }
+
+        Mask levelMask;
+        Private::convertImage(image, hasColor, &levelMask);
+
+        Private::Level level;
+        level.width = image.width();
+        level.height = image.height();
+        level.border = (image.width() - srcLevel.size.width()) / 2;
+        level.data = levelMask.data;
+
+        m_d->levels.append(level);
+    }
+}
+
+KisAlphaMaskPyramid::~KisAlphaMaskPyramid()
+{
+}
+
+KisAlphaMaskPyramid::Mask
+KisAlphaMaskPyramid::createMask(KisDabShape const& shape,
+                                qreal subPixelX, qreal subPixelY) const
+{
+    Mask mask;
+
+    if (m_d->fetchFromCache(shape, subPixelX, subPixelY, &mask)) {
+        return mask;
+    }
+
+    qreal baseScale = -1.0;
+    const int levelIndex = m_d->pyramid->findNearestLevel(shape.scale(), &baseScale);
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(levelIndex < m_d->levels.size(), mask);
+
+    const Private::Level &level = m_d->levels[levelIndex];
+
+    QTransform transform;
+    KisQImagePyramid::calculateParams(shape, subPixelX, subPixelY,
+                                      m_d->pyramid->m_originalSize, baseScale,
+                                      m_d->pyramid->m_levels[levelIndex].size,
+                                      &transform, &mask.size);
+
+    if (transform.isIdentity()) {
+        Private::copyLevel(level, &mask);
+    } else {
+        /**
+         * The bilinear filtering of QPainter rounds differently in
+         * every code path, so the transformed masks are still
+         * generated by it to keep the output of the brushes exactly
+         * the same
+         */
+        const QImage image = m_d->pyramid->createImage(shape, subPixelX, subPixelY);
+        Private::convertImage(image, m_d->hasColor, &mask);
+    }
+
+    m_d->putToCache(shape, subPixelX, subPixelY, mask);
+
+    return mask;
+}
+
+void KisAlphaMaskPyramid::Private::copyLevel(const Level &level, Mask *mask)
+{
+    const int width = level.width - 2 * level.border;
+    const int height = level.height - 2 * level.border;
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(mask->size == QSize(width, height));
+    mask->size = QSize(width, height);
+    mask->data.resize(width * height);
+
+    const quint8 *src = level.data.constData() + level.border * level.width + level.border;
+    quint8 *dst = mask->data.data();
+
+    for (int y = 0; y < height; y++) {
+        memcpy(dst, src, width);
+        src += level.width;
+        dst += width;
+    }
+}
+
+void KisAlphaMaskPyramid::Private::convertImage(const QImage &image, bool hasColor, Mask *mask)
+{
+    mask->size = image.size();
+    mask->data.resize(image.width() * image.height());
+
+    quint8 *dst = mask->data.data();
+
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+        if (hasColor) {
+            for (int x = 0; x < image.width(); x++) {
+                *dst++ = KoColorSpaceMaths<quint8>::multiply(255 - qGray(src[x]), qAlpha(src[x]));
+            }
+        } else {
+            for (int x = 0; x < image.width(); x++) {
+                *dst++ = KoColorSpaceMaths<quint8>::multiply(255 - qBlue(src[x]), qAlpha(src[x]));
+            }
+        }
+    }
+}
+
+bool KisAlphaMaskPyramid::Private::fetchFromCache(KisDabShape const& shape,
+                                                  qreal subPixelX, qreal subPixelY,
+                                                  Mask *mask)
+{
+    QMutexLocker l(&cacheLock);
+
+    for (int i = 0; i < cache.size(); i++) {
+        const CacheEntry &entry = cache[i];
+
+        if (entry.scaleX == shape.scaleX() &&
+            entry.scaleY == shape.scaleY() &&
+            entry.rotation == shape.rotation() &&
+            entry.subPixelX == subPixelX &&
+            entry.subPixelY == subPixelY) {
+
+            *mask = entry.mask;
+
+            // move the entry to the front of the LRU list
+            cache.move(i, 0);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void KisAlphaMaskPyramid::Private::putToCache(KisDabShape const& shape,
+                                              qreal subPixelX, qreal subPixelY,
+                                              const Mask &mask)
+{
+    const int maskBytes = mask.data.size();
+    if (maskBytes > MAX_CACHE_BYTES / 4) return;
+
+    QMutexLocker l(&cacheLock);
+
+    CacheEntry entry;
+    entry.scaleX = shape.scaleX();
+    entry.scaleY = shape.scaleY();
+    entry.rotation = shape.rotation();
+    entry.subPixelX = subPixelX;
+    entry.subPixelY = subPixelY;
+    entry.mask = mask;
+
+    cache.prepend(entry);
+    cacheBytes += maskBytes;
+
+    while (cache.size() > MAX_CACHED_MASKS || cacheBytes > MAX_CACHE_BYTES) {
+        cacheBytes -= cache.last().mask.data.size();
+        cache.removeLast();
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_ALPHA_MASK_PYRAMID_H
+#define __KIS_ALPHA_MASK_PYRAMID_H
+
+#include <QSize>
+#include <QVector>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <kis_dab_shape.h>
+#include <kritabrush_export.h>
+
+class KisQImagePyramid;
+
+
+/**
+ * KisAlphaMaskPyramid keeps the levels of a KisQImagePyramid as
+ * plain 8-bit alpha planes, so that the mask of a predefined brush
+ * can be copied straight into the alpha values without going
+ * through QPainter and a temporary ARGB32 QImage.
+ *
+ * The alpha value of every source pixel is calculated exactly the
+ * same way KisBrush did it for the QImage (darkness multiplied by
+ * opacity), so the identity transform gives exactly the same mask.
+ * Other transforms are still rendered by QPainter, because its
+ * bilinear filtering cannot be reproduced exactly, and only the
+ * conversion into alpha values is done here.
+ *
+ * The pyramid also keeps a small LRU cache of the recently generated
+ * masks. The pyramid is shared by all the clones of the brush, so the
+ * cache is shared by all the dab caches painting with it (e.g. the
+ * workers of the dab rendering queue or the multihand tool).
+ *
+ * All the methods are thread-safe.
+ */
+class BRUSH_EXPORT KisAlphaMaskPyramid
+{
+public:
+    struct Mask {
+        QSize size;
+
+        /// alpha values of the mask, row by row, without any padding
+        QVector<quint8> data;
+    };
+
+public:
+    /**
+     * @param pyramid the pyramid the levels are taken from
+     * @param hasColor defines how the darkness of the pixels is
+     *        calculated: as the gray value of the color or as the
+     *        value of the blue channel of a grayscale image
+     */
+    KisAlphaMaskPyramid(QSharedPointer<const KisQImagePyramid> pyramid, bool hasColor);
+    ~KisAlphaMaskPyramid();
+
+    /**
+     * Generate the mask the same way KisQImagePyramid::createImage()
+     * generates the image
+     */
+    Mask createMask(KisDabShape const& shape,
+                    qreal subPixelX, qreal subPixelY) const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_ALPHA_MASK_PYRAMID_H */
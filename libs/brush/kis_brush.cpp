@@ -28,6 +28,8 @@
 #include <QPoint>
 #include <QFileInfo>
 #include <QBuffer>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <kis_debug.h>
 #include <klocalizedstring.h>
@@ -46,6 +48,7 @@
 #include <brushengine/kis_paint_information.h>
 #include <kis_fixed_paint_device.h>
 #include <kis_qimage_pyramid.h>
+#include <kis_alpha_mask_pyramid.h>
 #include <brushengine/kis_paintop_lod_limitations.h>
 
 
@@ -108,6 +111,7 @@ struct KisBrush::Private {
         , brushType(INVALID)
         , autoSpacingActive(false)
         , autoSpacingCoeff(1.0)
+        , pyramids(new PyramidHolder)
     {}
 
     ~Private() {
@@ -125,12 +129,27 @@ struct KisBrush::Private {
     double spacing;
     QPointF hotSpot;
 
-    mutable QSharedPointer<const KisQImagePyramid> brushPyramid;
-
     QImage brushTipImage;
 
     bool autoSpacingActive;
     qreal autoSpacingCoeff;
+
+    /**
+     * The pyramids are created lazily, but the holder is shared by
+     * all the clones of the brush from the very beginning, so the
+     * pyramids (and the cache of the generated masks) are shared
+     * even by the clones made before the first dab was painted.
+     *
+     * Changing the tip or the way the darkness is calculated gives
+     * the brush a new empty holder, the other clones are not touched.
+     */
+    struct PyramidHolder {
+        QMutex lock;
+        QSharedPointer<const KisQImagePyramid> brushPyramid;
+        QSharedPointer<const KisAlphaMaskPyramid> maskPyramid;
+    };
+
+    QSharedPointer<PyramidHolder> pyramids;
 };
 
 KisBrush::KisBrush()
@@ -168,14 +187,13 @@ KisBrush::KisBrush(const KisBrush& rhs)
      * therefore you cannot change it, only recreate! That i sthe
      * reason why it is defined as const!
      */
-    d->brushPyramid = rhs.d->brushPyramid;
+    d->pyramids = rhs.d->pyramids;
 
     // don't copy the boundary, it will be regenerated -- see bug 291910
 }
 
 KisBrush::~KisBrush()
 {
-    clearBrushPyramid();
     delete d;
 }
 
@@ -259,6 +277,9 @@ bool KisBrush::hasColor() const
 void KisBrush::setHasColor(bool hasColor)
 {
     d->hasColor = hasColor;
+
+    // the mask levels depend on the way the darkness is calculated
+    clearBrushPyramid();
 }
 
 bool KisBrush::isPiercedApprox() const
@@ -437,14 +458,16 @@ void KisBrush::notifyCachedDabPainted(const KisPaintInformation& info)
 
 void KisBrush::prepareBrushPyramid() const
 {
-    if (!d->brushPyramid) {
-        d->brushPyramid = toQShared(new KisQImagePyramid(brushTipImage()));
+    QMutexLocker l(&d->pyramids->lock);
+
+    if (!d->pyramids->brushPyramid) {
+        d->pyramids->brushPyramid = toQShared(new KisQImagePyramid(brushTipImage()));
     }
 }
 
 void KisBrush::clearBrushPyramid()
 {
-    d->brushPyramid.clear();
+    d->pyramids = toQShared(new Private::PyramidHolder());
 }
 
 void KisBrush::mask(KisFixedPaintDeviceSP dst, KisDabShape const& shape, const KisPaintInformation& info , double subPixelX, double subPixelY, qreal softnessFactor) const
@@ -476,13 +499,28 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     Q_UNUSED(softnessFactor);
 
     prepareBrushPyramid();
-    QImage outputImage = d->brushPyramid->createImage(KisDabShape(
+
+    QSharedPointer<const KisAlphaMaskPyramid> maskPyramid;
+    {
+        QMutexLocker l(&d->pyramids->lock);
+
+        if (!d->pyramids->maskPyramid) {
+            d->pyramids->maskPyramid = toQShared(new KisAlphaMaskPyramid(d->pyramids->brushPyramid, hasColor()));
+        }
+        maskPyramid = d->pyramids->maskPyramid;
+    }
+
+    /**
+     * The mask is resampled directly into the alpha values, there is
+     * no need to go through a QImage here
+     */
+    const KisAlphaMaskPyramid::Mask mask = maskPyramid->createMask(KisDabShape(
             shape.scale() * d->scale, shape.ratio(),
             -normalizeAngle(shape.rotation() + d->angle)),
         subPixelX, subPixelY);
 
-    qint32 maskWidth = outputImage.width();
-    qint32 maskHeight = outputImage.height();
+    qint32 maskWidth = mask.size.width();
+    qint32 maskHeight = mask.size.height();
 
     dst->setRect(QRect(0, 0, maskWidth, maskHeight));
     dst->initialize();
@@ -499,11 +537,9 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     qint32 pixelSize = cs->pixelSize();
     quint8 *dabPointer = dst->data();
     quint8 *rowPointer = dabPointer;
-    quint8 *alphaArray = new quint8[maskWidth];
-    bool hasColor = this->hasColor();
+    const quint8 *maskPointer = mask.data.constData();
 
     for (int y = 0; y < maskHeight; y++) {
-        const quint8* maskPointer = outputImage.constScanLine(y);
         if (coloringInformation) {
             for (int x = 0; x < maskWidth; x++) {
                 if (color) {
@@ -517,39 +553,15 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
             }
         }
 
-        if (hasColor) {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
-
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - qGray(*c), qAlpha(*c));
-                src += 4;
-                dst++;
-            }
-        }
-        else {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
-
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - *src, qAlpha(*c));
-                src += 4;
-                dst++;
-            }
-        }
-
-        cs->applyAlphaU8Mask(rowPointer, alphaArray, maskWidth);
+        cs->applyAlphaU8Mask(rowPointer, maskPointer, maskWidth);
         rowPointer += maskWidth * pixelSize;
         dabPointer = rowPointer;
+        maskPointer += maskWidth;
 
         if (!color && coloringInformation) {
             coloringInformation->nextRow();
         }
     }
-
-    delete[] alphaArray;
 }
 
 KisFixedPaintDeviceSP KisBrush::paintDevice(const KoColorSpace * colorSpace,
@@ -563,7 +575,7 @@ KisFixedPaintDeviceSP KisBrush::paintDevice(const KoColorSpace * colorSpace,
     double scale = shape.scale() * d->scale;
 
     prepareBrushPyramid();
-    QImage outputImage = d->brushPyramid->createImage(
+    QImage outputImage = d->pyramids->brushPyramid->createImage(
         KisDabShape(scale, shape.ratio(), -angle), subPixelX, subPixelY);
 
     KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(colorSpace);
@@ -42,6 +42,7 @@ public:
 
 private:
     friend class KisGbrBrushTest;
+    friend class KisAlphaMaskPyramid;
     int findNearestLevel(qreal scale, qreal *baseScale) const;
     void appendPyramidLevel(const QImage &image);
 
@@ -24,6 +24,7 @@
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorSpaceMaths.h>
 #include "testutil.h"
 #include "../kis_gbr_brush.h"
 #include "kis_types.h"
@@ -31,6 +32,7 @@
 #include "brushengine/kis_paint_information.h"
 #include <kis_fixed_paint_device.h>
 #include "kis_qimage_pyramid.h"
+#include "kis_alpha_mask_pyramid.h"
 
 void KisGbrBrushTest::testMaskGenerationNoColor()
 {
@@ -258,6 +260,25 @@ void KisGbrBrushTest::benchmarkMaskScaling()
     }
 }
 
+void KisGbrBrushTest::benchmarkMaskRotation()
+{
+    KisGbrBrush* brush = new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr");
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+    brush->prepareBrushPyramid();
+    qsrand(1);
+
+    const KoColorSpace* cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintInformation info(QPointF(100.0, 100.0), 0.5);
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+
+    QBENCHMARK {
+        KoColor c(Qt::black, cs);
+        qreal rotation = qreal(qrand()) / RAND_MAX * 2 * M_PI;
+        brush->mask(dab, c, KisDabShape(1.0, 1.0, rotation), info, 0.0, 0.0, 1.0);
+    }
+}
+
 void KisGbrBrushTest::testPyramidLevelRounding()
 {
     QSize imageSize(41, 41);
@@ -310,6 +331,65 @@ void KisGbrBrushTest::testPyramidDabTransform()
     QCOMPARE(dabTransformHelper(KisDabShape(1.0, 0.5, M_PI / 4)), QSize(160, 160));
 }
 
+void KisGbrBrushTest::testAlphaMaskPyramid()
+{
+    QImage image(40, 30, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+
+    {
+        QPainter gc(&image);
+        gc.setRenderHints(QPainter::Antialiasing);
+        gc.setPen(Qt::NoPen);
+        gc.setBrush(Qt::black);
+        gc.drawEllipse(QRectF(5.5, 3.5, 28, 20));
+    }
+
+    QSharedPointer<const KisQImagePyramid> pyramid(new KisQImagePyramid(image));
+    KisAlphaMaskPyramid maskPyramid(pyramid, true);
+
+    QList<KisDabShape> shapes;
+    shapes << KisDabShape(1.0, 1.0, 0.0)
+           << KisDabShape(0.7, 1.0, 0.0)
+           << KisDabShape(1.7, 0.5, 0.0)
+           << KisDabShape(1.0, 1.0, M_PI / 6)
+           << KisDabShape(0.35, 1.0, 1.3 * M_PI)
+           << KisDabShape(2.5, 0.7, 0.4);
+
+    Q_FOREACH (const KisDabShape &shape, shapes) {
+        for (int i = 0; i < 3; i++) {
+            const qreal subPixelX = 0.25 * i;
+            const qreal subPixelY = 0.3 * i;
+
+            const QImage reference = pyramid->createImage(shape, subPixelX, subPixelY);
+            const KisAlphaMaskPyramid::Mask mask = maskPyramid.createMask(shape, subPixelX, subPixelY);
+
+            QCOMPARE(mask.size, reference.size());
+            QCOMPARE(mask.data.size(), mask.size.width() * mask.size.height());
+
+            const quint8 *maskPtr = mask.data.constData();
+            for (int y = 0; y < reference.height(); y++) {
+                const QRgb *refPtr = reinterpret_cast<const QRgb*>(reference.constScanLine(y));
+                for (int x = 0; x < reference.width(); x++) {
+                    const quint8 expected = KoColorSpaceMaths<quint8>::multiply(255 - qGray(refPtr[x]), qAlpha(refPtr[x]));
+
+                    if (expected != *maskPtr) {
+                        qDebug() << ppVar(shape.scale()) << ppVar(shape.ratio()) << ppVar(shape.rotation())
+                                 << ppVar(x) << ppVar(y) << ppVar(expected) << ppVar(*maskPtr);
+                        QFAIL("The mask differs from the image generated with QPainter");
+                    }
+
+                    maskPtr++;
+                }
+            }
+
+            // the second request is served from the cache
+            const KisAlphaMaskPyramid::Mask cachedMask = maskPyramid.createMask(shape, subPixelX, subPixelY);
+            QCOMPARE(cachedMask.size, mask.size);
+            QCOMPARE(cachedMask.data, mask.data);
+        }
+    }
+}
+
 // see comment in KisQImagePyramid::appendPyramidLevel
 void KisGbrBrushTest::testQPainterTransformationBorder()
 {
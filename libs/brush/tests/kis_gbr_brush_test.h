@@ -39,9 +39,11 @@ private Q_SLOTS:
     void benchmarkScaling();
     void benchmarkRotation();
     void benchmarkMaskScaling();
+    void benchmarkMaskRotation();
 
     void testPyramidLevelRounding();
     void testPyramidDabTransform();
+    void testAlphaMaskPyramid();
 
     void testQPainterTransformationBorder();
 };
@@ -0,0 +1,11 @@
+/* config-trace-points.h.  Generated by cmake from config-trace-points.h.cmake */
+
+#ifndef CONFIG_TRACE_POINTS_H_
+#define CONFIG_TRACE_POINTS_H_
+
+#ifndef HAVE_TRACE_POINTS
+#cmakedefine HAVE_TRACE_POINTS @HAVE_TRACE_POINTS@
+#endif
+
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <QCoreApplication>
+
+#include "kis_debug.h"
+
+/**
+ * The recording stops after this number of events to keep the memory
+ * consumption sane if someone forgets the tracing switched on
+ */
+static const int MAX_EVENTS = 4 * 1024 * 1024;
+
+struct KisTraceRecorder::Private
+{
+    struct Event {
+        const char *name;
+        const char *category;
+        qint64 start;
+        qint64 duration;
+        Qt::HANDLE thread;
+        bool isGuiThread;
+        QString detail;
+    };
+
+    QElapsedTimer timer;
+    QString fileName;
+
+    mutable QMutex lock;
+    QVector<Event> events;
+    bool overflowReported = false;
+};
+
+Q_GLOBAL_STATIC(KisTraceRecorder, s_instance)
+
+/**
+ * Called from the destructor of QCoreApplication, while Qt is still
+ * fully functional. The destructors of the global statics run too late
+ * for writing files and in an undefined order.
+ */
+static void saveTraceAtShutdown()
+{
+    KisTraceRecorder *recorder = KisTraceRecorder::instance();
+    if (recorder) {
+        recorder->saveTrace();
+    }
+}
+
+KisTraceRecorder::KisTraceRecorder()
+    : m_d(new Private),
+      m_enabled(false)
+{
+    m_d->fileName = QString::fromLocal8Bit(qgetenv("KRITA_TRACE_FILE"));
+    m_enabled = !m_d->fileName.isEmpty();
+    m_d->timer.start();
+
+    if (m_enabled) {
+        qAddPostRoutine(saveTraceAtShutdown);
+    }
+}
+
+KisTraceRecorder::~KisTraceRecorder()
+{
+}
+
+KisTraceRecorder* KisTraceRecorder::instance()
+{
+    return s_instance.isDestroyed() ? 0 : s_instance;
+}
+
+void KisTraceRecorder::saveTrace()
+{
+    if (!m_enabled) return;
+
+    m_enabled = false;
+    save(m_d->fileName);
+}
+
+qint64 KisTraceRecorder::currentTime() const
+{
+    return m_d->timer.nsecsElapsed() / 1000;
+}
+
+void KisTraceRecorder::addEvent(const char *name, const char *category,
+                                qint64 start, qint64 duration,
+                                const QString &detail)
+{
+    Private::Event event;
+    event.name = name;
+    event.category = category;
+    event.start = start;
+    event.duration = duration;
+    event.thread = QThread::currentThreadId();
+    event.isGuiThread =
+        QCoreApplication::instance() &&
+        QThread::currentThread() == QCoreApplication::instance()->thread();
+    event.detail = detail;
+
+    QMutexLocker l(&m_d->lock);
+
+    if (m_d->events.size() >= MAX_EVENTS) {
+        if (!m_d->overflowReported) {
+            warnKrita << "KisTraceRecorder: too many events, the recording has been stopped";
+            m_d->overflowReported = true;
+        }
+        return;
+    }
+
+    m_d->events.append(event);
+}
+
+namespace {
+
+QString escapeJsonString(const QString &str)
+{
+    QString result;
+    result.reserve(str.size());
+
+    Q_FOREACH (const QChar &c, str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (c.unicode() < 0x20) {
+            result += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+        } else {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+}
+
+bool KisTraceRecorder::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        warnKrita << "KisTraceRecorder: failed to open" << fileName;
+        return false;
+    }
+
+    QMutexLocker l(&m_d->lock);
+
+    /**
+     * The thread handles are huge numbers, the viewer shows them
+     * better as small indexes
+     */
+    QHash<Qt::HANDLE, int> threadIds;
+    int guiThreadId = -1;
+
+    QTextStream stream(&file);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+
+    Q_FOREACH (const Private::Event &event, m_d->events) {
+        int tid = threadIds.value(event.thread, -1);
+        if (tid < 0) {
+            tid = threadIds.size() + 1;
+            threadIds.insert(event.thread, tid);
+        }
+
+        if (event.isGuiThread) {
+            guiThreadId = tid;
+        }
+
+        if (!first) {
+            stream << ",\n";
+        }
+        first = false;
+
+        stream << "{\"name\":\"" << event.name << "\""
+               << ",\"cat\":\"" << event.category << "\""
+               << ",\"ph\":\"X\""
+               << ",\"pid\":1"
+               << ",\"tid\":" << tid
+               << ",\"ts\":" << event.start
+               << ",\"dur\":" << event.duration;
+
+        if (!event.detail.isEmpty()) {
+            stream << ",\"args\":{\"detail\":\"" << escapeJsonString(event.detail) << "\"}";
+        }
+
+        stream << "}";
+    }
+
+    for (auto it = threadIds.constBegin(); it != threadIds.constEnd(); ++it) {
+        const QString threadName =
+            it.value() == guiThreadId ? "GUI thread" : QString("Worker %1").arg(it.value());
+
+        if (!first) {
+            stream << ",\n";
+        }
+        first = false;
+
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1"
+               << ",\"tid\":" << it.value()
+               << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+    }
+
+    stream << "\n]}\n";
+
+    return stream.status() == QTextStream::Ok;
+}
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TRACE_H
+#define __KIS_TRACE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QScopedPointer>
+
+#include <kritaglobal_export.h>
+
+#include <config-trace-points.h>
+
+
+/**
+ * KisTraceRecorder collects the timings of the trace points placed
+ * into the hot paths of Krita (update jobs, merges, stroke callbacks,
+ * swapping of the tiles, canvas updates) and saves them in the Chrome
+ * trace event format. The saved file can be opened in
+ * chrome://tracing or in Perfetto UI and shows a timeline of what every
+ * thread was doing.
+ *
+ * The trace points are compiled in only when Krita is configured with
+ * -DHAVE_TRACE_POINTS=ON, otherwise KIS_TRACE_SCOPE() expands to nothing.
+ * Even when compiled in, nothing is recorded unless KRITA_TRACE_FILE
+ * environment variable is set. The trace is written into that file
+ * when QApplication is destroyed, the events recorded after that are
+ * dropped.
+ */
+class KRITAGLOBAL_EXPORT KisTraceRecorder
+{
+public:
+    KisTraceRecorder();
+    ~KisTraceRecorder();
+
+    /**
+     * \return the recorder or null if it has already been destroyed
+     *         on the exit of the application
+     */
+    static KisTraceRecorder* instance();
+
+    inline bool isEnabled() const {
+        return m_enabled;
+    }
+
+    /**
+     * Time since the creation of the recorder in microseconds
+     */
+    qint64 currentTime() const;
+
+    /**
+     * Add a complete event. \p name and \p category must be string
+     * literals, they are not copied.
+     */
+    void addEvent(const char *name, const char *category,
+                  qint64 start, qint64 duration,
+                  const QString &detail = QString());
+
+    bool save(const QString &fileName) const;
+
+    /**
+     * Save the events into the file passed in KRITA_TRACE_FILE and
+     * stop the recording. It is called automatically on the
+     * destruction of QCoreApplication.
+     */
+    void saveTrace();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+    bool m_enabled;
+};
+
+/**
+ * Records the time spent in a scope. Use it through KIS_TRACE_SCOPE()
+ * macros, so that it is compiled out when the tracing is disabled.
+ */
+class KisTraceScope
+{
+public:
+    inline KisTraceScope(const char *name, const char *category)
+        : m_name(name),
+          m_category(category),
+          m_start(-1)
+    {
+        KisTraceRecorder *recorder = KisTraceRecorder::instance();
+        if (recorder && recorder->isEnabled()) {
+            m_start = recorder->currentTime();
+        }
+    }
+
+    /**
+     * \p detailFunctor is called only when the recording is active,
+     * so building the detail string costs nothing otherwise
+     */
+    template <typename DetailFunctor>
+    inline KisTraceScope(const char *name, const char *category,
+                         DetailFunctor detailFunctor)
+        : KisTraceScope(name, category)
+    {
+        if (m_start >= 0) {
+            m_detail = detailFunctor();
+        }
+    }
+
+    inline ~KisTraceScope() {
+        if (m_start < 0) return;
+
+        KisTraceRecorder *recorder = KisTraceRecorder::instance();
+        if (recorder) {
+            recorder->addEvent(m_name, m_category,
+                               m_start, recorder->currentTime() - m_start,
+                               m_detail);
+        }
+    }
+
+    inline bool isActive() const {
+        return m_start >= 0;
+    }
+
+    inline void setDetail(const QString &detail) {
+        m_detail = detail;
+    }
+
+private:
+    Q_DISABLE_COPY(KisTraceScope)
+
+    const char *m_name;
+    const char *m_category;
+    qint64 m_start;
+    QString m_detail;
+};
+
+#define KIS_TRACE_CONCAT_IMPL(a, b) a##b
+#define KIS_TRACE_CONCAT(a, b) KIS_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef HAVE_TRACE_POINTS
+
+/**
+ * Trace the time spent in the current scope
+ */
+#define KIS_TRACE_SCOPE(name, category) \
+    KisTraceScope KIS_TRACE_CONCAT(__kisTraceScope, __LINE__)(name, category)
+
+/**
+ * Trace the time spent in the current scope and attach a string to
+ * the event. The \p detail expression is evaluated only when the
+ * recording is active.
+ */
+#define KIS_TRACE_SCOPE_DETAILED(name, category, detail) \
+    KisTraceScope KIS_TRACE_CONCAT(__kisTraceScope, __LINE__)( \
+        name, category, [&]() { return QString(detail); })
+
+#else
+
+#define KIS_TRACE_SCOPE(name, category)
+#define KIS_TRACE_SCOPE_DETAILED(name, category, detail)
+
+#endif
+
+#endif /* __KIS_TRACE_H */
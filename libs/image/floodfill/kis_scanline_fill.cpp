@@ -21,6 +21,10 @@
 #include <KoAlwaysInline.h>
 
 #include <QStack>
+#include <QBitArray>
+#include <QHash>
+#include <QSharedPointer>
+#include <QtConcurrentMap>
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoCompositeOpRegistry.h>
@@ -53,9 +57,26 @@ public:
         *m_it->rawData() = opacity;
     }
 
+    void beginTile(const QRect &rc) {
+        m_tileBuffer.resize(rc.width() * rc.height());
+        m_pixelSelection->readBytes(m_tileBuffer.data(), rc);
+    }
+
+    ALWAYS_INLINE void fillTilePixel(quint8 *srcPtr, quint8 opacity, int index) {
+        Q_UNUSED(srcPtr);
+        m_tileBuffer[index] = opacity;
+    }
+
+    void endTile(KisPaintDeviceSP device, const quint8 *srcBuffer, const QRect &rc) {
+        Q_UNUSED(device);
+        Q_UNUSED(srcBuffer);
+        m_pixelSelection->writeBytes(m_tileBuffer.constData(), rc);
+    }
+
 private:
     KisPaintDeviceSP m_pixelSelection;
     KisRandomAccessorSP m_it;
+    QVector<quint8> m_tileBuffer;
 };
 
 template <class BaseClass>
@@ -86,6 +107,22 @@ public:
         }
     }
 
+    void beginTile(const QRect &rc) {
+        Q_UNUSED(rc);
+    }
+
+    ALWAYS_INLINE void fillTilePixel(quint8 *srcPtr, quint8 opacity, int index) {
+        Q_UNUSED(index);
+
+        if (opacity == MAX_SELECTED) {
+            memcpy(srcPtr, m_data, m_pixelSize);
+        }
+    }
+
+    void endTile(KisPaintDeviceSP device, const quint8 *srcBuffer, const QRect &rc) {
+        device->writeBytes(srcBuffer, rc);
+    }
+
 private:
     KoColor m_sourceColor;
     const quint8 *m_data;
@@ -123,9 +160,29 @@ public:
         }
     }
 
+    void beginTile(const QRect &rc) {
+        m_tileBuffer.resize(rc.width() * rc.height() * m_pixelSize);
+        m_externalDevice->readBytes(m_tileBuffer.data(), rc);
+    }
+
+    ALWAYS_INLINE void fillTilePixel(quint8 *srcPtr, quint8 opacity, int index) {
+        Q_UNUSED(srcPtr);
+
+        if (opacity == MAX_SELECTED) {
+            memcpy(m_tileBuffer.data() + index * m_pixelSize, m_data, m_pixelSize);
+        }
+    }
+
+    void endTile(KisPaintDeviceSP device, const quint8 *srcBuffer, const QRect &rc) {
+        Q_UNUSED(device);
+        Q_UNUSED(srcBuffer);
+        m_externalDevice->writeBytes(m_tileBuffer.constData(), rc);
+    }
+
 private:
     KisPaintDeviceSP m_externalDevice;
     KisRandomAccessorSP m_it;
+    QVector<quint8> m_tileBuffer;
 
     KoColor m_sourceColor;
     const quint8 *m_data;
@@ -262,6 +319,36 @@ public:
     }
 };
 
+/**
+ * The parallel fill floods every tile of the device separately. The
+ * pixels of a tile are processed by one job at a time, the jobs for
+ * different tiles run concurrently. When the filled area reaches the
+ * border of a tile, the job passes the boundary interval to the
+ * neighbouring tile as a seed, and the tile is flooded from it in the
+ * next round.
+ */
+static const int FILL_TILE_SIZE = 64;
+static const int FILL_TILE_SHIFT = 6;
+
+struct KisScanlineFill::FillTile
+{
+    QRect rect;
+
+    /**
+     * The pixels that have already been checked, both the filled and
+     * the rejected ones. The fill may change the source pixels, so they
+     * must never be checked twice.
+     */
+    QBitArray visited;
+};
+
+struct KisScanlineFill::FillTileJob
+{
+    FillTile *tile;
+    QVector<KisFillInterval> seeds;
+    QVector<KisFillInterval> outgoingSeeds;
+};
+
 struct Q_DECL_HIDDEN KisScanlineFill::Private
 {
     KisPaintDeviceSP device;
@@ -269,6 +356,7 @@ struct Q_DECL_HIDDEN KisScanlineFill::Private
     QPoint startPoint;
     QRect boundingRect;
     int threshold;
+    bool useParallelFill;
 
     int rowIncrement;
     KisFillIntervalMap backwardMap;
@@ -298,6 +386,7 @@ KisScanlineFill::KisScanlineFill(KisPaintDeviceSP device, const QPoint &startPoi
     m_d->rowIncrement = 1;
 
     m_d->threshold = 0;
+    m_d->useParallelFill = true;
 }
 
 KisScanlineFill::~KisScanlineFill()
@@ -428,9 +517,191 @@ void KisScanlineFill::processLine(KisFillInterval interval, const int rowIncreme
     }
 }
 
+template <class T>
+void KisScanlineFill::processTile(FillTileJob *job, const T &policyPrototype)
+{
+    FillTile *tile = job->tile;
+    const QRect &rc = tile->rect;
+    const int tileWidth = rc.width();
+    const int pixelSize = m_d->device->pixelSize();
+
+    if (tile->visited.isEmpty()) {
+        tile->visited.resize(tileWidth * rc.height());
+    }
+
+    QBitArray &visited = tile->visited;
+
+    /**
+     * Most of the seeds coming back from the neighbours point to the
+     * pixels filled in the previous rounds, so check them before
+     * reading the tile
+     */
+    QVector<KisFillInterval> stack;
+
+    Q_FOREACH (KisFillInterval seed, job->seeds) {
+        seed.start = qMax(seed.start, rc.left());
+        seed.end = qMin(seed.end, rc.right());
+
+        const int rowOffset = (seed.row - rc.top()) * tileWidth - rc.left();
+
+        for (int x = seed.start; x <= seed.end; x++) {
+            if (!visited.testBit(rowOffset + x)) {
+                stack.append(seed);
+                break;
+            }
+        }
+    }
+
+    if (stack.isEmpty()) return;
+
+    T policy(policyPrototype);
+
+    QVector<quint8> srcBuffer(tileWidth * rc.height() * pixelSize);
+    m_d->device->readBytes(srcBuffer.data(), rc);
+    quint8 *srcPtr = srcBuffer.data();
+
+    policy.beginTile(rc);
+    bool tileChanged = false;
+
+    while (!stack.isEmpty()) {
+        const KisFillInterval interval = stack.takeLast();
+        const int row = interval.row;
+        const int rowOffset = (row - rc.top()) * tileWidth - rc.left();
+
+        auto tryFillPixel = [&] (int x) -> bool {
+            const int index = rowOffset + x;
+            if (visited.testBit(index)) return false;
+            visited.setBit(index);
+
+            quint8 *pixelPtr = srcPtr + index * pixelSize;
+            const quint8 opacity = policy.calculateOpacity(pixelPtr);
+            if (!opacity) return false;
+
+            policy.fillTilePixel(pixelPtr, opacity, index);
+            tileChanged = true;
+            return true;
+        };
+
+        int x = interval.start;
+
+        while (x <= interval.end) {
+            if (!tryFillPixel(x)) {
+                x++;
+                continue;
+            }
+
+            int left = x;
+            while (left > rc.left() && tryFillPixel(left - 1)) {
+                left--;
+            }
+
+            int right = x;
+            while (right < rc.right() && tryFillPixel(right + 1)) {
+                right++;
+            }
+
+            for (int nextRow = row - 1; nextRow <= row + 1; nextRow += 2) {
+                const KisFillInterval nextInterval(left, right, nextRow);
+
+                if (nextRow >= rc.top() && nextRow <= rc.bottom()) {
+                    stack.append(nextInterval);
+                } else if (nextRow >= m_d->boundingRect.top() &&
+                           nextRow <= m_d->boundingRect.bottom()) {
+                    job->outgoingSeeds.append(nextInterval);
+                }
+            }
+
+            if (left == rc.left() && left > m_d->boundingRect.left()) {
+                job->outgoingSeeds.append(KisFillInterval(left - 1, left - 1, row));
+            }
+
+            if (right == rc.right() && right < m_d->boundingRect.right()) {
+                job->outgoingSeeds.append(KisFillInterval(right + 1, right + 1, row));
+            }
+
+            x = right + 1;
+        }
+    }
+
+    if (tileChanged) {
+        policy.endTile(m_d->device, srcPtr, rc);
+    }
+}
+
+template <class T>
+void KisScanlineFill::runImplParallel(T &pixelPolicy)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_d->boundingRect.contains(m_d->startPoint));
+
+    /**
+     * The tiles are aligned with the tiles of the source device, so
+     * the jobs never write into the same tile of it
+     */
+    const QPoint tileOrigin(m_d->device->x(), m_d->device->y());
+
+    auto tileKey = [tileOrigin] (int x, int y) {
+        const int column = (x - tileOrigin.x()) >> FILL_TILE_SHIFT;
+        const int row = (y - tileOrigin.y()) >> FILL_TILE_SHIFT;
+        return quint64(quint32(row)) << 32 | quint32(column);
+    };
+
+    auto tileRect = [tileOrigin] (int x, int y) {
+        const int column = (x - tileOrigin.x()) >> FILL_TILE_SHIFT;
+        const int row = (y - tileOrigin.y()) >> FILL_TILE_SHIFT;
+        return QRect(tileOrigin.x() + column * FILL_TILE_SIZE,
+                     tileOrigin.y() + row * FILL_TILE_SIZE,
+                     FILL_TILE_SIZE, FILL_TILE_SIZE);
+    };
+
+    QHash<quint64, QSharedPointer<FillTile> > tiles;
+    QHash<quint64, QVector<KisFillInterval> > pendingSeeds;
+
+    pendingSeeds[tileKey(m_d->startPoint.x(), m_d->startPoint.y())]
+        << KisFillInterval(m_d->startPoint.x(), m_d->startPoint.x(), m_d->startPoint.y());
+
+    while (!pendingSeeds.isEmpty()) {
+        QVector<FillTileJob> jobs;
+        jobs.reserve(pendingSeeds.size());
+
+        for (auto it = pendingSeeds.begin(); it != pendingSeeds.end(); ++it) {
+            QSharedPointer<FillTile> &tile = tiles[it.key()];
+
+            if (!tile) {
+                const KisFillInterval &seed = it.value().first();
+
+                tile.reset(new FillTile());
+                tile->rect = tileRect(seed.start, seed.row) & m_d->boundingRect;
+            }
+
+            FillTileJob job;
+            job.tile = tile.data();
+            job.seeds = it.value();
+            jobs.append(job);
+        }
+
+        pendingSeeds.clear();
+
+        QtConcurrent::blockingMap(jobs,
+            [this, &pixelPolicy] (FillTileJob &job) {
+                processTile(&job, pixelPolicy);
+            });
+
+        Q_FOREACH (const FillTileJob &job, jobs) {
+            Q_FOREACH (const KisFillInterval &seed, job.outgoingSeeds) {
+                pendingSeeds[tileKey(seed.start, seed.row)].append(seed);
+            }
+        }
+    }
+}
+
 template <class T>
 void KisScanlineFill::runImpl(T &pixelPolicy)
 {
+    if (m_d->useParallelFill) {
+        runImplParallel(pixelPolicy);
+        return;
+    }
+
     KIS_ASSERT_RECOVER_RETURN(m_d->forwardStack.isEmpty());
 
     KisFillInterval startInterval(m_d->startPoint.x(), m_d->startPoint.x(), m_d->startPoint.y());
@@ -622,6 +893,11 @@ void KisScanlineFill::testingProcessLine(const KisFillInterval &processInterval)
     processLine(processInterval, 1, policy);
 }
 
+void KisScanlineFill::testingSetUseParallelFill(bool value)
+{
+    m_d->useParallelFill = value;
+}
+
 QVector<KisFillInterval> KisScanlineFill::testingGetForwardIntervals() const
 {
     return QVector<KisFillInterval>(m_d->forwardStack);
@@ -68,6 +68,9 @@ private:
     friend class KisScanlineFillTest;
     Q_DISABLE_COPY(KisScanlineFill)
 
+    struct FillTile;
+    struct FillTileJob;
+
     template <class T>
     void processLine(KisFillInterval interval, const int rowIncrement, T &pixelPolicy);
 
@@ -78,8 +81,15 @@ private:
     template <class T>
     void runImpl(T &pixelPolicy);
 
+    template <class T>
+    void processTile(FillTileJob *job, const T &policyPrototype);
+
+    template <class T>
+    void runImplParallel(T &pixelPolicy);
+
 private:
     void testingProcessLine(const KisFillInterval &processInterval);
+    void testingSetUseParallelFill(bool value);
     QVector<KisFillInterval> testingGetForwardIntervals() const;
     KisFillIntervalMap* testingGetBackwardIntervals() const;
 private:
@@ -38,6 +38,7 @@
 #include "filter/kis_filter_registry.h"
 #include "kis_selection.h"
 #include "kis_clone_layer.h"
+#include "kis_trace.h"
 #include "kis_processing_information.h"
 #include "kis_busy_progress_indicator.h"
 
@@ -208,6 +209,11 @@ private:
 /*********************************************************************/
 
 void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
+    KIS_TRACE_SCOPE_DETAILED("KisAsyncMerger::startMerge", "merge",
+                             QString("%1,%2 %3x%4")
+                             .arg(walker.changeRect().x()).arg(walker.changeRect().y())
+                             .arg(walker.changeRect().width()).arg(walker.changeRect().height()));
+
     KisMergeWalker::LeafStack &leafStack = walker.leafStack();
 
     const bool useTempProjections = walker.needRectVaries();
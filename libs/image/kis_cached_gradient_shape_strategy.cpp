@@ -99,3 +99,17 @@ double KisCachedGradientShapeStrategy::valueAt(double x, double y) const
     QPointF pt = KisAlgebra2D::ensureInRect(QPointF(x, y), m_d->rc);
     return m_d->spline->value(pt.x(), pt.y());
 }
+
+void KisCachedGradientShapeStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    // the same clamping as KisAlgebra2D::ensureInRect() does in valueAt()
+    const QRectF bounds(m_d->rc);
+    const qreal clampedY = qBound(bounds.top(), y, bounds.bottom());
+    const qreal left = bounds.left();
+    const qreal right = bounds.right();
+
+    for (int i = 0; i < count; i++) {
+        const qreal clampedX = qBound(left, x + i, right);
+        values[i] = m_d->spline->value(clampedX, clampedY);
+    }
+}
@@ -34,6 +34,7 @@ public:
     ~KisCachedGradientShapeStrategy();
 
     double valueAt(double x, double y) const;
+    void valuesAt(double x, double y, int count, double *values) const;
 
 private:
     struct Private;
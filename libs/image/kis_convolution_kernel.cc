@@ -20,6 +20,7 @@
 #include "kis_convolution_kernel.h"
 
 #include <math.h>
+#include <cmath>
 
 #include <QImage>
 #include <kis_mask_generator.h>
@@ -27,6 +28,7 @@
 struct Q_DECL_HIDDEN KisConvolutionKernel::Private {
     qreal offset;
     qreal factor;
+    qreal gaussianSigma;
     Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> data;
 };
 
@@ -34,6 +36,7 @@ KisConvolutionKernel::KisConvolutionKernel(quint32 _width, quint32 _height, qrea
 {
     d->offset = _offset;
     d->factor = _factor;
+    d->gaussianSigma = 0.0;
     setSize(_width, _height);
 }
 
@@ -73,6 +76,16 @@ void KisConvolutionKernel::setFactor(qreal factor)
     d->factor = factor;
 }
 
+qreal KisConvolutionKernel::gaussianSigma() const
+{
+    return d->gaussianSigma;
+}
+
+void KisConvolutionKernel::setGaussianSigma(qreal sigma)
+{
+    d->gaussianSigma = sigma;
+}
+
 Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic>& KisConvolutionKernel::data()
 {
     return d->data;
@@ -146,6 +159,51 @@ KisConvolutionKernelSP KisConvolutionKernel::fromMatrix(Eigen::Matrix<qreal, Eig
     return kernel;
 }
 
+bool KisConvolutionKernel::separate(const KisConvolutionKernelSP kernel,
+                                    KisConvolutionKernelSP *horizontal,
+                                    KisConvolutionKernelSP *vertical)
+{
+    const int width = kernel->width();
+    const int height = kernel->height();
+
+    if (width < 2 || height < 2) return false;
+
+    const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> &data = *kernel->data();
+
+    // the biggest coefficient gives the most precise decomposition
+    int pivotRow = 0;
+    int pivotColumn = 0;
+    const qreal maxValue = data.cwiseAbs().maxCoeff(&pivotRow, &pivotColumn);
+
+    if (maxValue == 0.0) return false;
+
+    const qreal pivot = data(pivotRow, pivotColumn);
+    const qreal eps = 1e-9 * maxValue;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const qreal value = data(y, pivotColumn) * data(pivotRow, x) / pivot;
+            if (std::abs(value - data(y, x)) > eps) return false;
+        }
+    }
+
+    if (horizontal) {
+        *horizontal = new KisConvolutionKernel(width, 1, 0, 1);
+        for (int x = 0; x < width; x++) {
+            (*horizontal)->data()(0, x) = data(pivotRow, x) / pivot;
+        }
+    }
+
+    if (vertical) {
+        *vertical = new KisConvolutionKernel(1, height, kernel->offset(), kernel->factor());
+        for (int y = 0; y < height; y++) {
+            (*vertical)->data()(y, 0) = data(y, pivotColumn);
+        }
+    }
+
+    return true;
+}
+
 
 
 
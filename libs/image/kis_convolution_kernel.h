@@ -44,12 +44,33 @@ public:
     qreal offset() const;
     qreal factor() const;
     void setFactor(qreal);
+
+    /**
+     * The sigma of the Gaussian the kernel samples, or zero if the
+     * kernel is not a Gaussian one. Convolution painter uses it to
+     * apply large Gaussian kernels with a recursive filter, whose
+     * cost does not depend on the size of the kernel.
+     */
+    qreal gaussianSigma() const;
+    void setGaussianSigma(qreal sigma);
+
     Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic>& data();
     const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> * data() const;
 
     static KisConvolutionKernelSP fromQImage(const QImage& image);
     static KisConvolutionKernelSP fromMaskGenerator(KisMaskGenerator *, qreal angle = 0.0);
     static KisConvolutionKernelSP fromMatrix(Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> matrix, qreal offset, qreal factor);
+
+    /**
+     * Splits a two-dimensional kernel of rank one into a row
+     * (\p horizontal) and a column (\p vertical) kernel, whose outer
+     * product is equal to \p kernel. The offset and the factor of
+     * \p kernel go to the vertical kernel. Returns false if the kernel
+     * is not separable or is one-dimensional already.
+     */
+    static bool separate(const KisConvolutionKernelSP kernel,
+                         KisConvolutionKernelSP *horizontal,
+                         KisConvolutionKernelSP *vertical);
 private:
     struct Private;
     Private* const d;
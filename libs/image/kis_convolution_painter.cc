@@ -47,9 +47,12 @@
 #include "kis_types.h"
 
 #include "kis_selection.h"
+#include "kis_image_config.h"
 
 #include "kis_convolution_worker.h"
 #include "kis_convolution_worker_spatial.h"
+#include "kis_convolution_worker_iir.h"
+#include "kis_convolution_worker_separable.h"
 
 #include "config_convolution.h"
 
@@ -65,18 +68,35 @@ KisConvolutionWorker<factory>* KisConvolutionPainter::createWorker(const KisConv
 {
     KisConvolutionWorker<factory> *worker;
 
+    if (useRecursiveFilter(kernel)) {
+        return new KisConvolutionWorkerIIR<factory>(painter, progress);
+    }
+
+    /**
+     * The separable worker rounds the results differently from the
+     * other engines, so applyMatrix() uses it only when explicitly
+     * asked to. See applySeparableMatrix().
+     */
+    if (m_enginePreference == SEPARABLE &&
+        KisConvolutionKernel::separate(kernel, 0, 0)) {
+
+        return new KisConvolutionWorkerSeparable<factory>(painter, progress);
+    }
+
 #ifdef HAVE_FFTW3
     #define THRESHOLD_SIZE 5
 
     if(m_enginePreference == SPATIAL ||
        (m_enginePreference != FFTW &&
+        m_enginePreference != FFTW_DOUBLE_PRECISION &&
         kernel->width() <= THRESHOLD_SIZE &&
         kernel->height() <= THRESHOLD_SIZE)) {
 
         worker = new KisConvolutionWorkerSpatial<factory>(painter, progress);
     }
     else {
-        worker = new KisConvolutionWorkerFFT<factory>(painter, progress);
+        worker = new KisConvolutionWorkerFFT<factory>(painter, progress,
+                                                      m_enginePreference == FFTW_DOUBLE_PRECISION);
     }
 #else
     Q_UNUSED(kernel);
@@ -87,6 +107,29 @@ KisConvolutionWorker<factory>* KisConvolutionPainter::createWorker(const KisConv
 }
 
 
+bool KisConvolutionPainter::useRecursiveFilter(const KisConvolutionKernelSP kernel) const
+{
+    /**
+     * The recursive filter only approximates the Gaussian (the error
+     * reaches a few levels of 8-bit channels on sharp edges), so it
+     * changes the results of the existing filters and layer styles.
+     * That is why it is used for large Gaussian kernels only when the
+     * user opted in for it in the performance settings. Its cost does
+     * not depend on the size of the kernel.
+     *
+     * The option is read once, like the other advanced performance
+     * options it needs restarting Krita.
+     */
+    const qreal IIR_THRESHOLD_SIGMA = 3.0;
+    static const bool useRecursiveGaussianBlur = KisImageConfig(true).useRecursiveGaussianBlur();
+
+    return KisConvolutionWorkerIIR<StandardIteratorFactory>::canConvolve(kernel) &&
+        (m_enginePreference == IIR ||
+         (m_enginePreference == NONE &&
+          kernel->gaussianSigma() >= IIR_THRESHOLD_SIGMA &&
+          useRecursiveGaussianBlur));
+}
+
 KisConvolutionPainter::KisConvolutionPainter()
     : KisPainter(),
       m_enginePreference(NONE)
@@ -156,3 +199,57 @@ void KisConvolutionPainter::applyMatrix(const KisConvolutionKernelSP kernel, con
     }
     }
 }
+
+void KisConvolutionPainter::applySeparableMatrix(const KisConvolutionKernelSP horizontalKernel, const KisConvolutionKernelSP verticalKernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, KisConvolutionBorderOp borderOp)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(horizontalKernel->height() == 1 &&
+                                   verticalKernel->width() == 1);
+
+    /**
+     * When another engine is requested, apply the kernels one by one
+     * through an intermediate device
+     */
+    if ((m_enginePreference != NONE && m_enginePreference != SEPARABLE) ||
+        useRecursiveFilter(horizontalKernel) ||
+        useRecursiveFilter(verticalKernel)) {
+
+        const int verticalMargin = (verticalKernel->height() + 1) / 2;
+        const QPoint margin(0, verticalMargin);
+        const QSize marginSize(0, 2 * verticalMargin);
+
+        KisPaintDeviceSP interm = new KisPaintDevice(src->colorSpace());
+
+        KisConvolutionPainter horizPainter(interm, m_enginePreference);
+        horizPainter.setChannelFlags(channelFlags());
+        horizPainter.setProgress(progressUpdater());
+        horizPainter.applyMatrix(horizontalKernel, src,
+                                 srcPos - margin, srcPos - margin,
+                                 areaSize + marginSize, borderOp);
+
+        applyMatrix(verticalKernel, interm, srcPos, dstPos, areaSize, borderOp);
+        return;
+    }
+
+    if (src->defaultBounds()->wrapAroundMode()) {
+        borderOp = BORDER_IGNORE;
+    }
+
+    switch (borderOp) {
+    case BORDER_REPEAT: {
+        const QRect dataRect = QRect(srcPos, areaSize) | src->exactBounds();
+
+        if(dataRect.isValid()) {
+            KisConvolutionWorkerSeparable<RepeatIteratorFactory> worker(this, progressUpdater(),
+                                                                        horizontalKernel, verticalKernel);
+            worker.execute(horizontalKernel, src, srcPos, dstPos, areaSize, dataRect);
+        }
+        break;
+    }
+    case BORDER_IGNORE:
+    default: {
+        KisConvolutionWorkerSeparable<StandardIteratorFactory> worker(this, progressUpdater(),
+                                                                      horizontalKernel, verticalKernel);
+        worker.execute(horizontalKernel, src, srcPos, dstPos, areaSize, QRect());
+    }
+    }
+}
@@ -67,12 +67,31 @@ public:
     void applyMatrix(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
                      KisConvolutionBorderOp borderOp = BORDER_REPEAT);
 
+    /**
+     * Convolve \p src with the kernel that is the outer product of
+     * \p verticalKernel (a column) and \p horizontalKernel (a row).
+     * Both passes are done at once and the intermediate result is not
+     * rounded, so it is faster and more precise than two calls to
+     * applyMatrix(). The offsets of the kernels are summed and the
+     * factors are multiplied.
+     *
+     * Use KisConvolutionKernel::separate() to split a two-dimensional
+     * kernel into such a pair.
+     */
+    void applySeparableMatrix(const KisConvolutionKernelSP horizontalKernel,
+                              const KisConvolutionKernelSP verticalKernel,
+                              const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize,
+                              KisConvolutionBorderOp borderOp = BORDER_REPEAT);
+
 protected:
     friend class KisConvolutionPainterTest;
     enum TestingEnginePreference {
         NONE,
         SPATIAL,
-        FFTW
+        FFTW,
+        FFTW_DOUBLE_PRECISION,
+        IIR,
+        SEPARABLE
     };
 
 
@@ -80,6 +99,8 @@ protected:
 
 
 private:
+    bool useRecursiveFilter(const KisConvolutionKernelSP kernel) const;
+
     template<class factory>
         KisConvolutionWorker<factory>* createWorker(const KisConvolutionKernelSP kernel,
                                                     KisPainter *painter,
@@ -26,34 +26,30 @@
 
 #include "kis_convolution_worker.h"
 #include "kis_math_toolbox.h"
+#include "kis_fftw_plan_cache.h"
 
 #include <QMutex>
 #include <QVector>
 #include <QTextStream>
 #include <QFile>
 #include <QDir>
+#include <QtConcurrentMap>
 
 #include <fftw3.h>
 
-template<class _IteratorFactory_> class KisConvolutionWorkerFFT;
-class KisConvolutionWorkerFFTLock
-{
-private:
-    static QMutex fftwMutex;
-    template<class _IteratorFactory_> friend class KisConvolutionWorkerFFT;
-};
-
-QMutex KisConvolutionWorkerFFTLock::fftwMutex;
-
 
 template<class _IteratorFactory_>
 class KisConvolutionWorkerFFT : public KisConvolutionWorker<_IteratorFactory_>
 {
 public:
-    KisConvolutionWorkerFFT(KisPainter *painter, KoUpdater *progress)
+    /**
+     * \p forceDoublePrecision disables the single precision transforms
+     * of the integer channels. It is used by the unittests only.
+     */
+    KisConvolutionWorkerFFT(KisPainter *painter, KoUpdater *progress, bool forceDoublePrecision = false)
         : KisConvolutionWorker<_IteratorFactory_>(painter, progress),
           m_currentProgress(0),
-          m_kernelFFT(0)
+          m_forceDoublePrecision(forceDoublePrecision)
     {
     }
 
@@ -76,6 +72,49 @@ public:
         if (areaSize.width() == 0 || areaSize.height() == 0)
             return;
 
+        // find out which channels need convolving
+        QList<KoChannelInfo*> convChannelList = this->convolvableChannelList(src);
+
+#ifdef HAVE_FFTW3F
+        if (!m_forceDoublePrecision && canUseSinglePrecision(convChannelList)) {
+            executeImpl<float>(kernel, src, srcPos, dstPos, areaSize, dataRect, convChannelList);
+            return;
+        }
+#endif
+
+        executeImpl<double>(kernel, src, srcPos, dstPos, areaSize, dataRect, convChannelList);
+    }
+
+    /**
+     * The rounding error of the single precision transform is much
+     * smaller than the quantization step of the integer channels, so
+     * they can be convolved with twice less memory and bandwidth. The
+     * floating point channels may have a much wider dynamic range, so
+     * they are still convolved in double precision.
+     */
+    static bool canUseSinglePrecision(const QList<KoChannelInfo*> &convChannelList) {
+        Q_FOREACH (KoChannelInfo *channel, convChannelList) {
+            const KoChannelInfo::enumChannelValueType type = channel->channelValueType();
+
+            if (type != KoChannelInfo::UINT8 && type != KoChannelInfo::UINT16 &&
+                type != KoChannelInfo::INT8 && type != KoChannelInfo::INT16) {
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    void executeImpl(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src,
+                     QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect,
+                     const QList<KoChannelInfo*> &convChannelList)
+    {
+        typedef KisFFTWPlanCache<T> PlanCache;
+        typedef typename PlanCache::Traits Traits;
+        typedef typename Traits::complex_type complex_type;
+
         addToProgress(0);
         if (isInterrupted()) return;
 
@@ -95,17 +134,16 @@ public:
         m_fftLength = m_fftHeight * (m_fftWidth / 2 + 1);
         m_extraMem = (m_fftWidth % 2) ? 1 : 2;
 
-        // create and fill kernel
-        m_kernelFFT = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
-        memset(m_kernelFFT, 0, sizeof(fftw_complex) * m_fftLength);
-        fftFillKernelMatrix(kernel, m_kernelFFT);
+        FFTBuffers<T> buffers;
 
-        // find out which channels need convolving
-        QList<KoChannelInfo*> convChannelList = this->convolvableChannelList(src);
+        // create and fill kernel
+        buffers.kernel = Traits::allocate(m_fftLength);
+        memset(buffers.kernel, 0, sizeof(complex_type) * m_fftLength);
+        fftFillKernelMatrix(kernel, (T*)buffers.kernel);
 
-        m_channelFFT.resize(convChannelList.count());
-        for (auto i = m_channelFFT.begin(); i != m_channelFFT.end(); ++i) {
-            *i = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
+        buffers.channels.resize(convChannelList.count());
+        for (auto i = buffers.channels.begin(); i != buffers.channels.end(); ++i) {
+            *i = Traits::allocate(m_fftLength);
         }
 
         const double kernelFactor = kernel->factor() ? kernel->factor() : 1;
@@ -120,51 +158,41 @@ public:
                                   m_fftWidth,
                                   m_fftHeight),
                             cacheRowStride,
-                            info, dataRect);
+                            info, dataRect, buffers.realChannels());
 
         addToProgress(10);
         if (isInterrupted()) return;
 
-        // calculate number off fft operations required for progress reporting
-        const float progressPerFFT = (100 - 30) / (double)(convChannelList.count() * 2 + 1);
-
         // perform FFT
-        fftw_plan fftwPlanForward, fftwPlanBackward;
-
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftwPlanForward = fftw_plan_dft_r2c_2d(m_fftHeight, m_fftWidth, (double*)m_kernelFFT, m_kernelFFT, FFTW_ESTIMATE);
-        fftwPlanBackward = fftw_plan_dft_c2r_2d(m_fftHeight, m_fftWidth, m_kernelFFT, (double*)m_kernelFFT, FFTW_ESTIMATE);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
+        typename PlanCache::PlansSP plans = PlanCache::instance()->plans(m_fftWidth, m_fftHeight);
 
-        fftw_execute(fftwPlanForward);
-        addToProgress(progressPerFFT);
+        Traits::executeForward(plans->forward, buffers.kernel);
+        addToProgress(10);
         if (isInterrupted()) return;
 
-        for (auto k = m_channelFFT.begin(); k != m_channelFFT.end(); ++k)
-        {
-            fftw_execute_dft_r2c(fftwPlanForward, (double*)(*k), *k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
-
-            fftMultiply(*k, m_kernelFFT);
+        /**
+         * The channels are independent from each other and executing
+         * the plans is thread-safe, so transform them all at once
+         */
+        complex_type *kernelFFT = buffers.kernel;
 
-            fftw_execute_dft_c2r(fftwPlanBackward, *k, (double*)*k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
-        }
+        QtConcurrent::blockingMap(buffers.channels,
+            [this, plans, kernelFFT] (complex_type *channel) {
+                if (this->m_progress && this->m_progress->interrupted()) return;
 
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftw_destroy_plan(fftwPlanForward);
-        fftw_destroy_plan(fftwPlanBackward);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
+                Traits::executeForward(plans->forward, channel);
+                fftMultiply(channel, kernelFFT);
+                Traits::executeBackward(plans->backward, channel);
+            });
 
+        addToProgress(50);
+        if (isInterrupted()) return;
 
         writeResultToDevice(QRect(dstPos.x(), dstPos.y(), areaSize.width(), areaSize.height()),
                             cacheRowStride, halfKernelWidth, halfKernelHeight,
-                            info, dataRect);
+                            info, dataRect, buffers.realChannels());
 
-        addToProgress(20);
-        cleanUp();
+        addToProgress(30);
     }
 
     struct FFTInfo {
@@ -218,11 +246,83 @@ public:
         int alphaRealPos;
     };
 
+    /**
+     * Owns the buffers of the transform, so that they are freed on
+     * every exit path, including the interruption of the job
+     */
+    template <typename T>
+    struct FFTBuffers {
+        typedef typename KisFFTWTraits<T>::complex_type complex_type;
+
+        FFTBuffers() : kernel(0) {}
+
+        ~FFTBuffers() {
+            if (kernel) {
+                KisFFTWTraits<T>::free(kernel);
+            }
+
+            Q_FOREACH (complex_type *channel, channels) {
+                KisFFTWTraits<T>::free(channel);
+            }
+        }
+
+        QVector<T*> realChannels() const {
+            QVector<T*> result;
+            Q_FOREACH (complex_type *channel, channels) {
+                result.append((T*)channel);
+            }
+            return result;
+        }
+
+        complex_type *kernel;
+        QVector<complex_type*> channels;
+    };
+
+    /**
+     * Split the rows of \p rect into strips aligned to the tile grid
+     * of the device with offset \p gridY, so that the strips can be
+     * written in parallel without touching the same tile
+     */
+    static QVector<QRect> tileRowStrips(const QRect &rect, int gridY) {
+        const int tileSize = 64;
+        QVector<QRect> strips;
+
+        for (int y = rect.top(); y <= rect.bottom();) {
+            int nextY = y - (((y - gridY) % tileSize + tileSize) % tileSize) + tileSize;
+            nextY = qMin(nextY, rect.bottom() + 1);
+
+            strips.append(QRect(rect.x(), y, rect.width(), nextY - y));
+            y = nextY;
+        }
+
+        return strips;
+    }
+
+    template <typename T>
     void fillCacheFromDevice(KisPaintDeviceSP src,
                              const QRect &rect,
                              const int cacheRowStride,
                              const FFTInfo &info,
-                             const QRect &dataRect) {
+                             const QRect &dataRect,
+                             const QVector<T*> &channels) {
+
+        QVector<QRect> strips = tileRowStrips(rect, src->y());
+
+        QtConcurrent::blockingMap(strips,
+            [&] (const QRect &strip) {
+                fillCacheStrip(src, strip, strip.y() - rect.y(),
+                               cacheRowStride, info, dataRect, channels);
+            });
+    }
+
+    template <typename T>
+    void fillCacheStrip(KisPaintDeviceSP src,
+                        const QRect &rect,
+                        const int cacheRowOffset,
+                        const int cacheRowStride,
+                        const FFTInfo &info,
+                        const QRect &dataRect,
+                        const QVector<T*> &channels) {
 
         typename _IteratorFactory_::HLineConstIterator hitSrc =
             _IteratorFactory_::createHLineConstIterator(src,
@@ -230,22 +330,22 @@ public:
                                                         dataRect);
 
         const int channelCount = info.numChannels();
-        QVector<double*> channelPtr(channelCount);
+        QVector<T*> channelPtr(channelCount);
         const auto channelPtrBegin = channelPtr.begin();
         const auto channelPtrEnd = channelPtr.end();
 
-        auto iFFt = m_channelFFT.constBegin();
+        auto iFFt = channels.constBegin();
         for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iFFt) {
-            *i = (double*)*iFFt;
+            *i = *iFFt + cacheRowOffset * cacheRowStride;
         }
 
         // prepare cache, reused in all loops
-        QVector<double*> cacheRowStart(channelCount);
+        QVector<T*> cacheRowStart(channelCount);
         const auto cacheRowStartBegin = cacheRowStart.begin();
 
         for (int y = 0; y < rect.height(); ++y) {
             // cache current channelPtr in cacheRowStart
-            memcpy(cacheRowStart.data(), channelPtr.data(), channelCount * sizeof(double*));
+            memcpy(cacheRowStart.data(), channelPtr.data(), channelCount * sizeof(T*));
 
             for (int x = 0; x < rect.width(); ++x) {
                 const quint8 *data = hitSrc->oldRawData();
@@ -287,11 +387,11 @@ public:
         }
     }
 
-    template <bool additionalMultiplierActive>
+    template <bool additionalMultiplierActive, typename T>
     inline qreal writeOneChannelFromCache(quint8* dstPtr,
                                           const quint32 channel,
                                           const FFTInfo &info,
-                                          double* channelValuePtr,
+                                          T* channelValuePtr,
                                           const qreal additionalMultiplier = 0.0) {
         qreal channelPixelValue;
 
@@ -308,37 +408,57 @@ public:
         return channelPixelValue;
     }
 
+    template <typename T>
     void writeResultToDevice(const QRect &rect,
                              const int cacheRowStride,
                              const int halfKernelWidth,
                              const int halfKernelHeight,
                              const FFTInfo &info,
-                             const QRect &dataRect) {
+                             const QRect &dataRect,
+                             const QVector<T*> &channels) {
+
+        QVector<QRect> strips = tileRowStrips(rect, this->m_painter->device()->y());
+
+        QtConcurrent::blockingMap(strips,
+            [&] (const QRect &strip) {
+                const int initialOffset =
+                    cacheRowStride * (halfKernelHeight + strip.y() - rect.y()) + halfKernelWidth;
+
+                writeResultStrip(strip, cacheRowStride, initialOffset,
+                                 info, dataRect, channels);
+            });
+    }
+
+    template <typename T>
+    void writeResultStrip(const QRect &rect,
+                          const int cacheRowStride,
+                          const int initialOffset,
+                          const FFTInfo &info,
+                          const QRect &dataRect,
+                          const QVector<T*> &channels) {
 
         typename _IteratorFactory_::HLineIterator hitDst =
             _IteratorFactory_::createHLineIterator(this->m_painter->device(),
                                                    rect.x(), rect.y(), rect.width(),
                                                    dataRect);
 
-        int initialOffset = cacheRowStride * halfKernelHeight + halfKernelWidth;
-
         const int channelCount = info.numChannels();
-        QVector<double*> channelPtr(channelCount);
+        QVector<T*> channelPtr(channelCount);
         const auto channelPtrBegin = channelPtr.begin();
         const auto channelPtrEnd = channelPtr.end();
 
-        auto iFFt = m_channelFFT.constBegin();
+        auto iFFt = channels.constBegin();
         for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iFFt) {
-            *i = (double*)*iFFt + initialOffset;
+            *i = *iFFt + initialOffset;
         }
 
         // prepare cache, reused in all loops
-        QVector<double*> cacheRowStart(channelCount);
+        QVector<T*> cacheRowStart(channelCount);
         const auto cacheRowStartBegin = cacheRowStart.begin();
 
         for (int y = 0; y < rect.height(); ++y) {
             // cache current channelPtr in cacheRowStart
-            memcpy(cacheRowStart.data(), channelPtr.data(), channelCount * sizeof(double*));
+            memcpy(cacheRowStart.data(), channelPtr.data(), channelCount * sizeof(T*));
 
             for (int x = 0; x < rect.width(); ++x) {
                 quint8 *dstPtr = hitDst->rawData();
@@ -400,7 +520,8 @@ public:
     }
 
 private:
-    void fftFillKernelMatrix(const KisConvolutionKernelSP kernel, fftw_complex *m_kernelFFT)
+    template <typename T>
+    void fftFillKernelMatrix(const KisConvolutionKernelSP kernel, T *kernelData)
     {
         // find central item
         QPoint offset((kernel->width() - 1) / 2, (kernel->height() - 1) / 2);
@@ -422,18 +543,19 @@ private:
                 if (absXpos >= m_fftWidth)
                     absXpos -= m_fftWidth;
 
-                ((double*)m_kernelFFT)[(m_fftWidth + m_extraMem) * absYpos + absXpos] = kernel->data()->coeff(y, x);
+                kernelData[(m_fftWidth + m_extraMem) * absYpos + absXpos] = kernel->data()->coeff(y, x);
             }
         }
     }
 
-    void fftMultiply(fftw_complex* channel, fftw_complex* kernel)
+    template <typename complex_type>
+    void fftMultiply(complex_type* channel, const complex_type* kernel) const
     {
         // perform complex multiplication
-        fftw_complex *channelPtr = channel;
-        fftw_complex *kernelPtr = kernel;
+        complex_type *channelPtr = channel;
+        const complex_type *kernelPtr = kernel;
 
-        fftw_complex tmp;
+        complex_type tmp;
 
         for (quint32 pixelPos = 0; pixelPos < m_fftLength; ++pixelPos)
         {
@@ -470,7 +592,8 @@ private:
         }
     }
 
-    void fftLogMatrix(double* channel, const QString &f)
+    template <typename T>
+    void fftLogMatrix(T* channel, const QString &f)
     {
         KisConvolutionWorkerFFTLock::fftwMutex.lock();
         QString filename(QDir::homePath() + "/log_" + f + ".txt");
@@ -510,32 +633,13 @@ private:
 
     bool isInterrupted()
     {
-        if (this->m_progress && this->m_progress->interrupted()) {
-            cleanUp();
-            return true;
-        }
-
-        return false;
+        return this->m_progress && this->m_progress->interrupted();
     }
 
-    void cleanUp()
-    {
-        // free kernel fft data
-        if (m_kernelFFT) {
-            fftw_free(m_kernelFFT);
-        }
-
-        Q_FOREACH (fftw_complex *channel, m_channelFFT) {
-            fftw_free(channel);
-        }
-        m_channelFFT.clear();
-    }
 private:
     quint32 m_fftWidth, m_fftHeight, m_fftLength, m_extraMem;
     float m_currentProgress;
-
-    fftw_complex* m_kernelFFT;
-    QVector<fftw_complex*> m_channelFFT;
+    bool m_forceDoublePrecision;
 };
 
 #endif
@@ -0,0 +1,383 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_CONVOLUTION_WORKER_IIR_H
+#define KIS_CONVOLUTION_WORKER_IIR_H
+
+#include <cmath>
+#include <limits>
+
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <KoChannelInfo.h>
+
+#include "kis_convolution_worker.h"
+#include "kis_convolution_kernel.h"
+#include "kis_math_toolbox.h"
+
+
+/**
+ * KisConvolutionWorkerIIR applies a one-dimensional Gaussian kernel
+ * (the ones created by KisGaussianKernel) using the recursive filter
+ * by Young and van Vliet ("Recursive implementation of the Gaussian
+ * filter", Signal Processing 44, 1995). The filter runs one causal and
+ * one anti-causal third-order pass over every line, so the cost per
+ * pixel does not depend on the radius of the blur.
+ *
+ * The lines are independent from each other, so they are split into
+ * strips aligned to the tiles of the destination device and the
+ * strips are processed in parallel.
+ */
+template<class _IteratorFactory_>
+class KisConvolutionWorkerIIR : public KisConvolutionWorker<_IteratorFactory_>
+{
+public:
+    KisConvolutionWorkerIIR(KisPainter *painter, KoUpdater *progress)
+        : KisConvolutionWorker<_IteratorFactory_>(painter, progress)
+    {
+    }
+
+    /**
+     * The worker can apply only the one-dimensional Gaussian kernels,
+     * the filter is not defined for sigma less than 0.5
+     */
+    static bool canConvolve(const KisConvolutionKernelSP kernel) {
+        return kernel->gaussianSigma() >= 0.5 &&
+            (kernel->width() == 1 || kernel->height() == 1);
+    }
+
+    virtual void execute(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect)
+    {
+        KIS_SAFE_ASSERT_RECOVER_RETURN(canConvolve(kernel));
+
+        // Make the area we cover as small as possible
+        if (this->m_painter->selection())
+        {
+            QRect r = this->m_painter->selection()->selectedRect().intersect(QRect(srcPos, areaSize));
+            dstPos += r.topLeft() - srcPos;
+            srcPos = r.topLeft();
+            areaSize = r.size();
+        }
+
+        if (areaSize.width() == 0 || areaSize.height() == 0)
+            return;
+
+        if (this->m_progress) {
+            this->m_progress->setProgress(0);
+        }
+
+        const bool horizontal = kernel->height() == 1;
+
+        Parameters params(kernel, this->convolvableChannelList(src));
+        params.horizontal = horizontal;
+        params.margin = ((horizontal ? kernel->width() : kernel->height()) - 1) / 2;
+        params.srcPos = srcPos;
+        params.dstPos = dstPos;
+        params.areaSize = areaSize;
+        params.dataRect = dataRect;
+
+        /**
+         * The strips go across the lines, so every strip covers whole
+         * tiles of the destination device and no tile is written by
+         * two threads at once
+         */
+        KisPaintDeviceSP dst = this->m_painter->device();
+        const int tileSize = 64;
+        const int start = horizontal ? dstPos.y() : dstPos.x();
+        const int end = start + (horizontal ? areaSize.height() : areaSize.width());
+        const int gridOffset = horizontal ? dst->y() : dst->x();
+
+        QVector<Strip> strips;
+        for (int pos = start; pos < end;) {
+            int nextPos = pos - (((pos - gridOffset) % tileSize + tileSize) % tileSize) + tileSize;
+            nextPos = qMin(nextPos, end);
+
+            Strip strip;
+            strip.offset = pos - start;
+            strip.size = nextPos - pos;
+            strips.append(strip);
+
+            pos = nextPos;
+        }
+
+        QtConcurrent::blockingMap(strips,
+            [this, &params, src, dst] (Strip &strip) {
+                if (this->m_progress && this->m_progress->interrupted()) return;
+                processStrip(strip, params, src, dst);
+            });
+
+        if (this->m_progress) {
+            this->m_progress->setProgress(100);
+        }
+    }
+
+private:
+    struct Strip {
+        int offset;
+        int size;
+    };
+
+    struct Parameters {
+        Parameters(const KisConvolutionKernelSP kernel,
+                   const QList<KoChannelInfo*> &_convChannelList)
+            : convChannelList(_convChannelList),
+              alphaCachePos(-1),
+              alphaRealPos(-1)
+        {
+            KisMathToolbox mathToolbox;
+
+            for (int i = 0; i < convChannelList.count(); ++i) {
+                minClamp.append(mathToolbox.minChannelValue(convChannelList[i]));
+                maxClamp.append(mathToolbox.maxChannelValue(convChannelList[i]));
+                absoluteOffset.append((maxClamp[i] - minClamp[i]) * kernel->offset());
+
+                if (convChannelList[i]->channelType() == KoChannelInfo::ALPHA) {
+                    alphaCachePos = i;
+                    alphaRealPos = convChannelList[i]->pos();
+                }
+            }
+
+            toDoubleFuncPtr.resize(convChannelList.count());
+            fromDoubleFuncPtr.resize(convChannelList.count());
+
+            bool result = mathToolbox.getToDoubleChannelPtr(convChannelList, toDoubleFuncPtr);
+            result &= mathToolbox.getFromDoubleChannelPtr(convChannelList, fromDoubleFuncPtr);
+
+            KIS_ASSERT(result);
+
+            /**
+             * The recursive filter has unit gain, while the explicit
+             * kernel is divided by its factor
+             */
+            const qreal factor = kernel->factor() ? kernel->factor() : 1.0;
+            gain = kernel->data()->sum() / factor;
+
+            calculateCoefficients(kernel->gaussianSigma());
+        }
+
+        void calculateCoefficients(qreal sigma) {
+            const qreal q = sigma >= 2.5 ?
+                0.98711 * sigma - 0.96330 :
+                3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+
+            const qreal q2 = q * q;
+            const qreal q3 = q2 * q;
+
+            const qreal b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+
+            b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+            b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+            b3 = (0.422205 * q3) / b0;
+            B = 1.0 - (b1 + b2 + b3);
+        }
+
+        inline int numChannels() const {
+            return convChannelList.size();
+        }
+
+        QList<KoChannelInfo*> convChannelList;
+
+        QVector<qreal> minClamp;
+        QVector<qreal> maxClamp;
+        QVector<qreal> absoluteOffset;
+
+        QVector<PtrToDouble> toDoubleFuncPtr;
+        QVector<PtrFromDouble> fromDoubleFuncPtr;
+
+        int alphaCachePos;
+        int alphaRealPos;
+
+        qreal gain;
+        double B;
+        double b1;
+        double b2;
+        double b3;
+
+        bool horizontal;
+        int margin;
+        QPoint srcPos;
+        QPoint dstPos;
+        QSize areaSize;
+        QRect dataRect;
+    };
+
+    /**
+     * Filter the line in place. The steady state of the filter for a
+     * constant signal is the signal itself, so the initial state is
+     * taken from the first (last) value of the line, which is the
+     * same as extending the line with its border pixels.
+     */
+    static void filterLine(double *data, int length, const Parameters &p) {
+        double w1 = data[0];
+        double w2 = w1;
+        double w3 = w1;
+
+        for (int i = 0; i < length; i++) {
+            const double w = p.B * data[i] + p.b1 * w1 + p.b2 * w2 + p.b3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+            data[i] = w;
+        }
+
+        w1 = data[length - 1];
+        w2 = w1;
+        w3 = w1;
+
+        for (int i = length - 1; i >= 0; i--) {
+            const double w = p.B * data[i] + p.b1 * w1 + p.b2 * w2 + p.b3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = w;
+            data[i] = w;
+        }
+    }
+
+    static inline void readPixel(const quint8 *data, double *const *channels, int index, const Parameters &p) {
+        // no alpha is a rare case, so just multiply by 1.0 in that case
+        const double alphaValue = p.alphaRealPos >= 0 ?
+            p.toDoubleFuncPtr[p.alphaCachePos](data, p.alphaRealPos) : 1.0;
+
+        for (int k = 0; k < p.numChannels(); k++) {
+            if (k != p.alphaCachePos) {
+                const quint32 channelPos = p.convChannelList[k]->pos();
+                channels[k][index] = p.toDoubleFuncPtr[k](data, channelPos) * alphaValue;
+            } else {
+                channels[k][index] = alphaValue;
+            }
+        }
+    }
+
+    static inline qreal writeChannel(quint8 *dstPtr, int channel, double value, qreal multiplier, const Parameters &p) {
+        qreal channelPixelValue = (value * p.gain + p.absoluteOffset[channel]) * multiplier;
+
+        if (channelPixelValue > p.maxClamp[channel]) {
+            channelPixelValue = p.maxClamp[channel];
+        } else if (!(channelPixelValue >= p.minClamp[channel])) { // value < lowBound or value == NaN
+            channelPixelValue = p.minClamp[channel];
+        }
+
+        p.fromDoubleFuncPtr[channel](dstPtr, p.convChannelList[channel]->pos(), channelPixelValue);
+        return channelPixelValue;
+    }
+
+    static inline void writePixel(quint8 *dstPtr, double *const *channels, int index, const Parameters &p) {
+        if (p.alphaCachePos >= 0) {
+            const qreal alphaValue = writeChannel(dstPtr, p.alphaCachePos, channels[p.alphaCachePos][index], 1.0, p);
+
+            if (alphaValue > std::numeric_limits<qreal>::epsilon()) {
+                const qreal alphaValueInv = 1.0 / alphaValue;
+
+                for (int k = 0; k < p.numChannels(); k++) {
+                    if (k != p.alphaCachePos) {
+                        writeChannel(dstPtr, k, channels[k][index], alphaValueInv, p);
+                    }
+                }
+            } else {
+                for (int k = 0; k < p.numChannels(); k++) {
+                    if (k != p.alphaCachePos) {
+                        p.fromDoubleFuncPtr[k](dstPtr, p.convChannelList[k]->pos(), 0.0);
+                    }
+                }
+            }
+        } else {
+            for (int k = 0; k < p.numChannels(); k++) {
+                writeChannel(dstPtr, k, channels[k][index], 1.0, p);
+            }
+        }
+    }
+
+    void processStrip(const Strip &strip, const Parameters &p,
+                      KisPaintDeviceSP src, KisPaintDeviceSP dst) {
+
+        const int lineLength = (p.horizontal ? p.areaSize.width() : p.areaSize.height()) + 2 * p.margin;
+        const int dstLength = p.horizontal ? p.areaSize.width() : p.areaSize.height();
+
+        QVector<double> buffer(lineLength * p.numChannels());
+        QVector<double*> channels(p.numChannels());
+        for (int k = 0; k < p.numChannels(); k++) {
+            channels[k] = buffer.data() + k * lineLength;
+        }
+
+        if (p.horizontal) {
+            typename _IteratorFactory_::HLineConstIterator srcIt =
+                _IteratorFactory_::createHLineConstIterator(src,
+                                                            p.srcPos.x() - p.margin,
+                                                            p.srcPos.y() + strip.offset,
+                                                            lineLength, p.dataRect);
+
+            typename _IteratorFactory_::HLineIterator dstIt =
+                _IteratorFactory_::createHLineIterator(dst,
+                                                       p.dstPos.x(),
+                                                       p.dstPos.y() + strip.offset,
+                                                       dstLength, p.dataRect);
+
+            for (int line = 0; line < strip.size; line++) {
+                processLine(srcIt, dstIt, channels.data(), lineLength, dstLength, p);
+                srcIt->nextRow();
+                dstIt->nextRow();
+            }
+        } else {
+            typename _IteratorFactory_::VLineConstIterator srcIt =
+                _IteratorFactory_::createVLineConstIterator(src,
+                                                            p.srcPos.x() + strip.offset,
+                                                            p.srcPos.y() - p.margin,
+                                                            lineLength, p.dataRect);
+
+            typename _IteratorFactory_::VLineIterator dstIt =
+                _IteratorFactory_::createVLineIterator(dst,
+                                                       p.dstPos.x() + strip.offset,
+                                                       p.dstPos.y(),
+                                                       dstLength, p.dataRect);
+
+            for (int line = 0; line < strip.size; line++) {
+                processLine(srcIt, dstIt, channels.data(), lineLength, dstLength, p);
+                srcIt->nextColumn();
+                dstIt->nextColumn();
+            }
+        }
+    }
+
+    template <class SrcIterator, class DstIterator>
+    static inline void processLine(SrcIterator &srcIt, DstIterator &dstIt,
+                                   double *const *channels,
+                                   int lineLength, int dstLength,
+                                   const Parameters &p) {
+
+        /**
+         * The whole line is read before writing anything, so the
+         * source and the destination may be the same device
+         */
+        for (int i = 0; i < lineLength; i++) {
+            readPixel(srcIt->oldRawData(), channels, i, p);
+            srcIt->nextPixel();
+        }
+
+        for (int k = 0; k < p.numChannels(); k++) {
+            filterLine(channels[k], lineLength, p);
+        }
+
+        for (int i = 0; i < dstLength; i++) {
+            writePixel(dstIt->rawData(), channels, p.margin + i, p);
+            dstIt->nextPixel();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,424 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_CONVOLUTION_WORKER_SEPARABLE_H
+#define KIS_CONVOLUTION_WORKER_SEPARABLE_H
+
+#include <algorithm>
+
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <KoChannelInfo.h>
+
+#include "kis_convolution_worker.h"
+#include "kis_convolution_kernel.h"
+#include "kis_paint_device.h"
+#include "kis_math_toolbox.h"
+
+
+/**
+ * KisConvolutionWorkerSeparable applies a convolution kernel that is
+ * an outer product of a row and a column kernel as a horizontal pass
+ * followed by a vertical one, so the cost per pixel is O(w + h)
+ * instead of O(w * h) of the spatial worker. The intermediate result
+ * is kept in floating point, so applying a pair of one-dimensional
+ * kernels (e.g. the Gaussian ones) is also more precise than running
+ * two separate passes over an 8-bit paint device.
+ *
+ * The pair of kernels is either passed to the constructor, or split
+ * out of the two-dimensional kernel passed to execute(). The worker
+ * is never picked automatically for applyMatrix(), because the
+ * result differs from the one of the other engines by the rounding
+ * errors. Use KisConvolutionPainter::applySeparableMatrix() instead.
+ *
+ * The area is split into blocks aligned to the tiles of the
+ * destination device and the blocks are processed in parallel. Both
+ * passes run over planar buffers of every channel, so that the inner
+ * loops are simple enough to be vectorized by the compiler.
+ */
+template<class _IteratorFactory_>
+class KisConvolutionWorkerSeparable : public KisConvolutionWorker<_IteratorFactory_>
+{
+public:
+    KisConvolutionWorkerSeparable(KisPainter *painter, KoUpdater *progress)
+        : KisConvolutionWorker<_IteratorFactory_>(painter, progress)
+    {
+    }
+
+    KisConvolutionWorkerSeparable(KisPainter *painter, KoUpdater *progress,
+                                  const KisConvolutionKernelSP horizontalKernel,
+                                  const KisConvolutionKernelSP verticalKernel)
+        : KisConvolutionWorker<_IteratorFactory_>(painter, progress),
+          m_horizontalKernel(horizontalKernel),
+          m_verticalKernel(verticalKernel)
+    {
+    }
+
+    /**
+     * The kernel is ignored if the pair of kernels has been passed to
+     * the constructor
+     */
+    virtual void execute(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect)
+    {
+        KisConvolutionKernelSP horizontalKernel = m_horizontalKernel;
+        KisConvolutionKernelSP verticalKernel = m_verticalKernel;
+
+        if (!horizontalKernel || !verticalKernel) {
+            KIS_SAFE_ASSERT_RECOVER_RETURN(
+                KisConvolutionKernel::separate(kernel, &horizontalKernel, &verticalKernel));
+        }
+
+        KIS_SAFE_ASSERT_RECOVER_RETURN(horizontalKernel->height() == 1 &&
+                                       verticalKernel->width() == 1);
+
+        Parameters params(horizontalKernel, verticalKernel, this->convolvableChannelList(src));
+
+        // Make the area we cover as small as possible
+        if (this->m_painter->selection())
+        {
+            QRect r = this->m_painter->selection()->selectedRect().intersect(QRect(srcPos, areaSize));
+            dstPos += r.topLeft() - srcPos;
+            srcPos = r.topLeft();
+            areaSize = r.size();
+        }
+
+        if (areaSize.width() == 0 || areaSize.height() == 0)
+            return;
+
+        if (this->m_progress) {
+            this->m_progress->setProgress(0);
+        }
+
+        KisPaintDeviceSP dst = this->m_painter->device();
+
+        /**
+         * The source is read with oldRawData(), like the spatial
+         * worker does. When the device is filtered in place, the
+         * blocks might read the pixels their neighbours have already
+         * written, so the result is rendered into a temporary device
+         * and copied back in the end.
+         */
+        params.src = src;
+        KisPaintDeviceSP target = src == dst ? new KisPaintDevice(dst->colorSpace()) : dst;
+
+        params.halfWidth = (horizontalKernel->width() - 1) / 2;
+        params.halfHeight = (verticalKernel->height() - 1) / 2;
+        params.offset = srcPos - dstPos;
+        params.dataRect = dataRect;
+
+        /**
+         * The spatial worker flips the kernel, do the same to get the
+         * same result for the asymmetric kernels
+         */
+        std::reverse(params.column.begin(), params.column.end());
+        std::reverse(params.row.begin(), params.row.end());
+
+        const QRect dstRect(dstPos, areaSize);
+        QVector<QRect> blocks = splitIntoBlocks(dstRect, target->x(), target->y());
+
+        QtConcurrent::blockingMap(blocks,
+            [this, &params, target] (const QRect &block) {
+                if (this->m_progress && this->m_progress->interrupted()) return;
+                processBlock(block, params, target);
+            });
+
+        if (this->m_progress && this->m_progress->interrupted()) return;
+
+        if (target != dst) {
+            KisPainter::copyAreaOptimized(dstRect.topLeft(), target, dst, dstRect);
+        }
+
+        if (this->m_progress) {
+            this->m_progress->setProgress(100);
+        }
+    }
+
+private:
+    struct Parameters {
+        Parameters(const KisConvolutionKernelSP horizontalKernel,
+                   const KisConvolutionKernelSP verticalKernel,
+                   const QList<KoChannelInfo*> &_convChannelList)
+            : convChannelList(_convChannelList),
+              alphaCachePos(-1),
+              alphaRealPos(-1)
+        {
+            KisMathToolbox mathToolbox;
+
+            for (int i = 0; i < convChannelList.count(); ++i) {
+                minClamp.append(mathToolbox.minChannelValue(convChannelList[i]));
+                maxClamp.append(mathToolbox.maxChannelValue(convChannelList[i]));
+                absoluteOffset.append((maxClamp[i] - minClamp[i]) *
+                                      (horizontalKernel->offset() + verticalKernel->offset()));
+
+                if (convChannelList[i]->channelType() == KoChannelInfo::ALPHA) {
+                    alphaCachePos = i;
+                    alphaRealPos = convChannelList[i]->pos();
+                }
+            }
+
+            toDoubleFuncPtr.resize(convChannelList.count());
+            fromDoubleFuncPtr.resize(convChannelList.count());
+
+            bool result = mathToolbox.getToDoubleChannelPtr(convChannelList, toDoubleFuncPtr);
+            result &= mathToolbox.getFromDoubleChannelPtr(convChannelList, fromDoubleFuncPtr);
+
+            KIS_ASSERT(result);
+
+            kernelFactor =
+                (horizontalKernel->factor() ? 1.0 / horizontalKernel->factor() : 1) *
+                (verticalKernel->factor() ? 1.0 / verticalKernel->factor() : 1);
+
+            row.resize(horizontalKernel->width());
+            for (int x = 0; x < row.size(); x++) {
+                row[x] = (*horizontalKernel->data())(0, x);
+            }
+
+            column.resize(verticalKernel->height());
+            for (int y = 0; y < column.size(); y++) {
+                column[y] = (*verticalKernel->data())(y, 0);
+            }
+        }
+
+        inline int numChannels() const {
+            return convChannelList.size();
+        }
+
+        QList<KoChannelInfo*> convChannelList;
+
+        QVector<qreal> minClamp;
+        QVector<qreal> maxClamp;
+        QVector<qreal> absoluteOffset;
+
+        QVector<PtrToDouble> toDoubleFuncPtr;
+        QVector<PtrFromDouble> fromDoubleFuncPtr;
+
+        int alphaCachePos;
+        int alphaRealPos;
+
+        qreal kernelFactor;
+        QVector<qreal> column;
+        QVector<qreal> row;
+
+        KisPaintDeviceSP src;
+        int halfWidth;
+        int halfHeight;
+        QPoint offset;
+        QRect dataRect;
+    };
+
+    /**
+     * The blocks are aligned to the tiles of the destination device,
+     * so no two blocks write into the same tile. They are several
+     * tiles wide to keep the overhead of reading the margins low.
+     */
+    static QVector<QRect> splitIntoBlocks(const QRect &rect, int gridX, int gridY) {
+        const int tileSize = 64;
+        const int blockWidth = 8 * tileSize;
+
+        auto alignDown = [] (int value, int grid, int size) {
+            return value - ((value - grid) % size + size) % size;
+        };
+
+        QVector<QRect> blocks;
+
+        for (int y = alignDown(rect.top(), gridY, tileSize); y <= rect.bottom(); y += tileSize) {
+            for (int x = alignDown(rect.left(), gridX, blockWidth); x <= rect.right(); x += blockWidth) {
+                blocks.append(rect & QRect(x, y, blockWidth, tileSize));
+            }
+        }
+
+        return blocks;
+    }
+
+    static inline void limitValue(qreal *value, qreal lowBound, qreal highBound) {
+        if (*value > highBound) {
+            *value = highBound;
+        } else if (!(*value >= lowBound)) {  // value < lowBound or value == NaN
+            // IEEE compliant comparisons with NaN are always false
+            *value = lowBound;
+        }
+    }
+
+    static inline qreal writeChannel(quint8 *dstPtr, int channel, qreal value, const Parameters &p) {
+        limitValue(&value, p.minClamp[channel], p.maxClamp[channel]);
+        p.fromDoubleFuncPtr[channel](dstPtr, p.convChannelList[channel]->pos(), value);
+        return value;
+    }
+
+    void processBlock(const QRect &block, const Parameters &p, KisPaintDeviceSP dst) {
+        const int numChannels = p.numChannels();
+
+        const int kw = p.row.size();
+        const int kh = p.column.size();
+
+        const int width = block.width();
+        const int height = block.height();
+        const int srcWidth = width + kw - 1;
+        const int srcHeight = height + kh - 1;
+
+        QVector<qreal> srcBuffer(numChannels * srcWidth * srcHeight);
+        QVector<qreal> tmpBuffer(numChannels * width * srcHeight);
+        QVector<qreal> dstBuffer(numChannels * width * height);
+
+        const QPoint srcTopLeft = block.topLeft() + p.offset - QPoint(p.halfWidth, p.halfHeight);
+
+        // read the block with its margins, premultiplied by alpha
+        {
+            typename _IteratorFactory_::HLineConstIterator srcIt =
+                _IteratorFactory_::createHLineConstIterator(p.src,
+                                                            srcTopLeft.x(), srcTopLeft.y(),
+                                                            srcWidth, p.dataRect);
+
+            for (int y = 0; y < srcHeight; y++) {
+                qreal *rowPtr = srcBuffer.data() + y * srcWidth;
+
+                for (int x = 0; x < srcWidth; x++) {
+                    const quint8 *data = srcIt->oldRawData();
+
+                    // no alpha is rare case, so just multiply by 1.0 in that case
+                    const qreal alphaValue = p.alphaRealPos >= 0 ?
+                        p.toDoubleFuncPtr[p.alphaCachePos](data, p.alphaRealPos) : 1.0;
+
+                    for (int k = 0; k < numChannels; k++) {
+                        qreal *channelPtr = rowPtr + k * srcWidth * srcHeight;
+
+                        if (k != p.alphaCachePos) {
+                            const quint32 channelPos = p.convChannelList[k]->pos();
+                            channelPtr[x] = p.toDoubleFuncPtr[k](data, channelPos) * alphaValue;
+                        } else {
+                            channelPtr[x] = alphaValue;
+                        }
+                    }
+
+                    srcIt->nextPixel();
+                }
+
+                srcIt->nextRow();
+            }
+        }
+
+        const qreal *rowKernel = p.row.constData();
+        const qreal *columnKernel = p.column.constData();
+
+        for (int k = 0; k < numChannels; k++) {
+            const qreal *srcPlane = srcBuffer.constData() + k * srcWidth * srcHeight;
+            qreal *tmpPlane = tmpBuffer.data() + k * width * srcHeight;
+            qreal *dstPlane = dstBuffer.data() + k * width * height;
+
+            // horizontal pass
+            for (int y = 0; y < srcHeight; y++) {
+                const qreal *srcRow = srcPlane + y * srcWidth;
+                qreal *tmpRow = tmpPlane + y * width;
+
+                std::fill(tmpRow, tmpRow + width, 0.0);
+
+                for (int i = 0; i < kw; i++) {
+                    const qreal coeff = rowKernel[i];
+                    const qreal *srcPtr = srcRow + i;
+
+                    for (int x = 0; x < width; x++) {
+                        tmpRow[x] += coeff * srcPtr[x];
+                    }
+                }
+            }
+
+            // vertical pass
+            for (int y = 0; y < height; y++) {
+                qreal *dstRow = dstPlane + y * width;
+
+                std::fill(dstRow, dstRow + width, 0.0);
+
+                for (int i = 0; i < kh; i++) {
+                    const qreal coeff = columnKernel[i];
+                    const qreal *tmpRow = tmpPlane + (y + i) * width;
+
+                    for (int x = 0; x < width; x++) {
+                        dstRow[x] += coeff * tmpRow[x];
+                    }
+                }
+            }
+        }
+
+        // write the result, the channels that are not convolved are copied from the source
+        typename _IteratorFactory_::HLineConstIterator srcIt =
+            _IteratorFactory_::createHLineConstIterator(p.src,
+                                                        block.x() + p.offset.x(),
+                                                        block.y() + p.offset.y(),
+                                                        width, p.dataRect);
+
+        typename _IteratorFactory_::HLineIterator dstIt =
+            _IteratorFactory_::createHLineIterator(dst,
+                                                   block.x(), block.y(),
+                                                   width, p.dataRect);
+
+        const int pixelSize = dst->pixelSize();
+        const int planeSize = width * height;
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                quint8 *dstPtr = dstIt->rawData();
+                memcpy(dstPtr, srcIt->oldRawData(), pixelSize);
+
+                const qreal *values = dstBuffer.constData() + y * width + x;
+
+                if (p.alphaCachePos >= 0) {
+                    const qreal alphaValue =
+                        writeChannel(dstPtr, p.alphaCachePos,
+                                     values[p.alphaCachePos * planeSize] * p.kernelFactor +
+                                     p.absoluteOffset[p.alphaCachePos], p);
+
+                    if (alphaValue != 0.0) {
+                        const qreal alphaValueInv = 1.0 / alphaValue;
+
+                        for (int k = 0; k < numChannels; k++) {
+                            if (k == p.alphaCachePos) continue;
+
+                            writeChannel(dstPtr, k,
+                                         values[k * planeSize] * p.kernelFactor * alphaValueInv +
+                                         p.absoluteOffset[k], p);
+                        }
+                    } else {
+                        for (int k = 0; k < numChannels; k++) {
+                            if (k == p.alphaCachePos) continue;
+                            p.fromDoubleFuncPtr[k](dstPtr, p.convChannelList[k]->pos(), 0.0);
+                        }
+                    }
+                } else {
+                    for (int k = 0; k < numChannels; k++) {
+                        writeChannel(dstPtr, k,
+                                     values[k * planeSize] * p.kernelFactor +
+                                     p.absoluteOffset[k], p);
+                    }
+                }
+
+                srcIt->nextPixel();
+                dstIt->nextPixel();
+            }
+
+            srcIt->nextRow();
+            dstIt->nextRow();
+        }
+    }
+
+private:
+    KisConvolutionKernelSP m_horizontalKernel;
+    KisConvolutionKernelSP m_verticalKernel;
+};
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_distance_transform.h"
+
+#include <limits>
+
+#include <QtConcurrentMap>
+
+#include "kis_assert.h"
+
+namespace {
+
+/**
+ * The size of the chunks of columns/rows processed by one job. The
+ * columns are scanned row by row, so a chunk should cover at least a
+ * few cache lines.
+ */
+const int CHUNK_SIZE = 64;
+
+struct Range {
+    int start;
+    int end;
+};
+
+QVector<Range> splitIntoRanges(int size)
+{
+    QVector<Range> ranges;
+
+    for (int start = 0; start < size; start += CHUNK_SIZE) {
+        Range range;
+        range.start = start;
+        range.end = qMin(start + CHUNK_SIZE, size);
+        ranges.append(range);
+    }
+
+    return ranges;
+}
+
+/**
+ * The first pass: for every pixel find the nearest feature in its
+ * column. For the binary features it is just two linear scans.
+ */
+void findNearestInColumns(const quint8 *features, int width, int height,
+                          const Range &columns, int *nearestY)
+{
+    const int numColumns = columns.end - columns.start;
+    QVector<int> last(numColumns, -1);
+
+    for (int y = 0; y < height; y++) {
+        const quint8 *src = features + y * width + columns.start;
+        int *dst = nearestY + y * width + columns.start;
+
+        for (int i = 0; i < numColumns; i++) {
+            if (src[i]) {
+                last[i] = y;
+            }
+            dst[i] = last[i];
+        }
+    }
+
+    last.fill(-1);
+
+    for (int y = height - 1; y >= 0; y--) {
+        const quint8 *src = features + y * width + columns.start;
+        int *dst = nearestY + y * width + columns.start;
+
+        for (int i = 0; i < numColumns; i++) {
+            if (src[i]) {
+                last[i] = y;
+            }
+
+            if (last[i] >= 0 &&
+                (dst[i] < 0 || last[i] - y < y - dst[i])) {
+
+                dst[i] = last[i];
+            }
+        }
+    }
+}
+
+/**
+ * The lower envelope of the parabolas weightX * (x - q)^2 + f[q] for
+ * all the finite f[q]. Stores the index q of the lowest parabola for
+ * every x into \p nearestX. Returns false if all f[q] are infinite.
+ */
+bool computeEnvelope(const qreal *f, int width, qreal weightX,
+                     int *v, qreal *z, float *distanceRow, int *nearestX)
+{
+    const qreal inf = std::numeric_limits<qreal>::infinity();
+
+    int k = -1;
+    for (int q = 0; q < width; q++) {
+        if (f[q] == inf) continue;
+
+        qreal s = 0;
+        while (k >= 0) {
+            const int p = v[k];
+            s = ((f[q] + weightX * q * q) - (f[p] + weightX * p * p)) /
+                (2.0 * weightX * (q - p));
+
+            if (s > z[k]) break;
+            k--;
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = k > 0 ? s : -inf;
+        z[k + 1] = inf;
+    }
+
+    if (k < 0) {
+        for (int x = 0; x < width; x++) {
+            distanceRow[x] = std::numeric_limits<float>::infinity();
+        }
+        return false;
+    }
+
+    k = 0;
+    for (int x = 0; x < width; x++) {
+        while (z[k + 1] < x) k++;
+
+        const int q = v[k];
+        distanceRow[x] = weightX * qreal(x - q) * (x - q) + f[q];
+        nearestX[x] = q;
+    }
+
+    return true;
+}
+
+/**
+ * The second pass: the distance to the nearest feature is the lower
+ * envelope of the parabolas rooted at the pixels of the row, with the
+ * heights equal to the distances found in the first pass.
+ */
+void computeRows(int width, int height, qreal weightX, qreal weightY,
+                 const Range &rows, int *nearestY,
+                 float *distances, bool storeNearest)
+{
+    Q_UNUSED(height);
+
+    const qreal inf = std::numeric_limits<qreal>::infinity();
+
+    QVector<qreal> f(width);
+    QVector<int> rowNearestY(width);
+    QVector<int> nearestX(width);
+    QVector<int> v(width);
+    QVector<qreal> z(width + 1);
+
+    for (int y = rows.start; y < rows.end; y++) {
+        int *nearestRow = nearestY + y * width;
+        float *distanceRow = distances + y * width;
+
+        for (int x = 0; x < width; x++) {
+            const int ny = nearestRow[x];
+            rowNearestY[x] = ny;
+            f[x] = ny >= 0 ? weightY * qreal(y - ny) * (y - ny) : inf;
+        }
+
+        const bool found = computeEnvelope(f.constData(), width, weightX,
+                                           v.data(), z.data(), distanceRow,
+                                           nearestX.data());
+
+        if (storeNearest) {
+            for (int x = 0; x < width; x++) {
+                nearestRow[x] = found ? rowNearestY[nearestX[x]] * width + nearestX[x] : -1;
+            }
+        }
+    }
+}
+
+}
+
+void KisDistanceTransform::compute(const QVector<quint8> &features,
+                                   int width, int height,
+                                   qreal weightX, qreal weightY,
+                                   QVector<float> *distances,
+                                   QVector<int> *nearest)
+{
+    /**
+     * The indexes of the pixels are stored as int, so the grid must
+     * be small enough for them. The selection filters do the column
+     * pass themselves and use computeRow() for that.
+     */
+    KIS_SAFE_ASSERT_RECOVER_RETURN(qint64(width) * height <= std::numeric_limits<int>::max());
+    KIS_SAFE_ASSERT_RECOVER_RETURN(features.size() == width * height);
+    KIS_SAFE_ASSERT_RECOVER_RETURN(weightX > 0 && weightY > 0);
+
+    distances->resize(width * height);
+
+    QVector<int> localNearest;
+    QVector<int> *nearestY = nearest ? nearest : &localNearest;
+    nearestY->resize(width * height);
+
+    if (!width || !height) return;
+
+    const quint8 *featuresPtr = features.constData();
+    int *nearestYPtr = nearestY->data();
+    float *distancesPtr = distances->data();
+    const bool storeNearest = nearest;
+
+    QVector<Range> columns = splitIntoRanges(width);
+    QtConcurrent::blockingMap(columns,
+        [=] (const Range &range) {
+            findNearestInColumns(featuresPtr, width, height, range, nearestYPtr);
+        });
+
+    QVector<Range> rows = splitIntoRanges(height);
+    QtConcurrent::blockingMap(rows,
+        [=] (const Range &range) {
+            computeRows(width, height, weightX, weightY, range,
+                        nearestYPtr, distancesPtr, storeNearest);
+        });
+}
+
+void KisDistanceTransform::computeRow(const QVector<qreal> &heights,
+                                      qreal weightX,
+                                      QVector<float> *distances)
+{
+    const int width = heights.size();
+    distances->resize(width);
+
+    if (!width) return;
+
+    QVector<int> nearestX(width);
+    QVector<int> v(width);
+    QVector<qreal> z(width + 1);
+
+    computeEnvelope(heights.constData(), width, weightX,
+                    v.data(), z.data(), distances->data(), nearestX.data());
+}
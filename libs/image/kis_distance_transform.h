@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_DISTANCE_TRANSFORM_H
+#define __KIS_DISTANCE_TRANSFORM_H
+
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+
+/**
+ * Exact Euclidean distance transform of a two-dimensional grid
+ * (P. Felzenszwalb, D. Huttenlocher, "Distance Transforms of Sampled
+ * Functions", 2012).
+ *
+ * For every pixel of the grid the transform finds the squared distance
+ * to the nearest feature pixel, and optionally the feature pixel
+ * itself. The cost per pixel does not depend on the distances, so the
+ * selection filters can grow or shrink by any radius in the same time.
+ *
+ * The distance may be weighted separately along the axes:
+ *
+ *     d = weightX * dx^2 + weightY * dy^2
+ *
+ * which lets the callers use elliptic neighbourhoods with the radius
+ * of the ellipse normalized to 1.0.
+ *
+ * The columns are processed in parallel in the first pass and the rows
+ * in the second one.
+ */
+namespace KisDistanceTransform
+{
+    /**
+     * @param features the grid of \p width x \p height values stored row
+     *        by row; the pixels with non-zero value are the features
+     * @param distances [out] the squared weighted distance to the nearest
+     *        feature, or infinity if there are no features at all
+     * @param nearest [out] if non-null, the index of the nearest feature
+     *        pixel in \p features, or -1 if there are no features
+     */
+    KRITAIMAGE_EXPORT void compute(const QVector<quint8> &features,
+                                   int width, int height,
+                                   qreal weightX, qreal weightY,
+                                   QVector<float> *distances,
+                                   QVector<int> *nearest = 0);
+
+    /**
+     * The second pass of the transform for a single row: for every x
+     * finds the minimum of weightX * (x - i)^2 + heights[i] over all
+     * i. The infinite heights are skipped. Lets the callers compute
+     * the first pass themselves, e.g. streaming the rows of a paint
+     * device.
+     */
+    KRITAIMAGE_EXPORT void computeRow(const QVector<qreal> &heights,
+                                      qreal weightX,
+                                      QVector<float> *distances);
+}
+
+#endif /* __KIS_DISTANCE_TRANSFORM_H */
@@ -0,0 +1,207 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FFTW_PLAN_CACHE_H
+#define __KIS_FFTW_PLAN_CACHE_H
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+
+#include <fftw3.h>
+
+#include "config_convolution.h"
+
+
+template<class _IteratorFactory_> class KisConvolutionWorkerFFT;
+template<typename T> class KisFFTWPlanCache;
+
+/**
+ * The planner of FFTW is not thread-safe, so all the planning and
+ * destruction of the plans must be serialized. Executing the plans
+ * is thread-safe.
+ */
+class KisConvolutionWorkerFFTLock
+{
+private:
+    static QMutex fftwMutex;
+    template<class _IteratorFactory_> friend class KisConvolutionWorkerFFT;
+    template<typename T> friend class KisFFTWPlanCache;
+};
+
+QMutex KisConvolutionWorkerFFTLock::fftwMutex;
+
+
+/**
+ * Wraps the functions of the double (fftw_*) and single precision
+ * (fftwf_*) versions of the library, so that the convolution code
+ * can be written once for both of them.
+ */
+template<typename T>
+struct KisFFTWTraits;
+
+template<>
+struct KisFFTWTraits<double>
+{
+    typedef fftw_complex complex_type;
+    typedef fftw_plan plan_type;
+
+    static complex_type* allocate(size_t size) {
+        return (complex_type*)fftw_malloc(sizeof(complex_type) * size);
+    }
+    static void free(complex_type *ptr) { fftw_free(ptr); }
+
+    static plan_type planForward(int height, int width, complex_type *data) {
+        return fftw_plan_dft_r2c_2d(height, width, (double*)data, data, FFTW_ESTIMATE);
+    }
+    static plan_type planBackward(int height, int width, complex_type *data) {
+        return fftw_plan_dft_c2r_2d(height, width, data, (double*)data, FFTW_ESTIMATE);
+    }
+    static void destroyPlan(plan_type plan) { fftw_destroy_plan(plan); }
+
+    static void executeForward(plan_type plan, complex_type *data) {
+        fftw_execute_dft_r2c(plan, (double*)data, data);
+    }
+    static void executeBackward(plan_type plan, complex_type *data) {
+        fftw_execute_dft_c2r(plan, data, (double*)data);
+    }
+};
+
+#ifdef HAVE_FFTW3F
+template<>
+struct KisFFTWTraits<float>
+{
+    typedef fftwf_complex complex_type;
+    typedef fftwf_plan plan_type;
+
+    static complex_type* allocate(size_t size) {
+        return (complex_type*)fftwf_malloc(sizeof(complex_type) * size);
+    }
+    static void free(complex_type *ptr) { fftwf_free(ptr); }
+
+    static plan_type planForward(int height, int width, complex_type *data) {
+        return fftwf_plan_dft_r2c_2d(height, width, (float*)data, data, FFTW_ESTIMATE);
+    }
+    static plan_type planBackward(int height, int width, complex_type *data) {
+        return fftwf_plan_dft_c2r_2d(height, width, data, (float*)data, FFTW_ESTIMATE);
+    }
+    static void destroyPlan(plan_type plan) { fftwf_destroy_plan(plan); }
+
+    static void executeForward(plan_type plan, complex_type *data) {
+        fftwf_execute_dft_r2c(plan, (float*)data, data);
+    }
+    static void executeBackward(plan_type plan, complex_type *data) {
+        fftwf_execute_dft_c2r(plan, data, (float*)data);
+    }
+};
+#endif /* HAVE_FFTW3F */
+
+
+/**
+ * KisFFTWPlanCache keeps the recently used pairs of the in-place
+ * forward and backward plans, so that repeated convolutions of the
+ * same size (e.g. the updates of a filter preview or of a layer
+ * style) do not go through the planner again.
+ *
+ * The plans are created with FFTW_ESTIMATE, so there is no wisdom
+ * worth saving between the sessions.
+ *
+ * The plans are shared, so an evicted plan stays valid until the last
+ * worker executing it is done.
+ */
+template<typename T>
+class KisFFTWPlanCache
+{
+public:
+    typedef KisFFTWTraits<T> Traits;
+    typedef typename Traits::complex_type complex_type;
+    typedef typename Traits::plan_type plan_type;
+
+    struct Plans {
+        Plans(int _width, int _height)
+            : width(_width),
+              height(_height)
+        {
+            const size_t length = size_t(height) * (width / 2 + 1);
+
+            /**
+             * The plans must be created for arrays with the same
+             * alignment as the ones they will be executed on, so let
+             * the library allocate them
+             */
+            complex_type *data = Traits::allocate(length);
+
+            QMutexLocker l(&KisConvolutionWorkerFFTLock::fftwMutex);
+            forward = Traits::planForward(height, width, data);
+            backward = Traits::planBackward(height, width, data);
+            Traits::free(data);
+        }
+
+        ~Plans() {
+            QMutexLocker l(&KisConvolutionWorkerFFTLock::fftwMutex);
+            Traits::destroyPlan(forward);
+            Traits::destroyPlan(backward);
+        }
+
+        int width;
+        int height;
+        plan_type forward;
+        plan_type backward;
+    };
+
+    typedef QSharedPointer<Plans> PlansSP;
+
+public:
+    static KisFFTWPlanCache* instance() {
+        static KisFFTWPlanCache cache;
+        return &cache;
+    }
+
+    PlansSP plans(int width, int height) {
+        PlansSP evicted;
+        QMutexLocker l(&m_lock);
+
+        for (int i = 0; i < m_plans.size(); i++) {
+            if (m_plans[i]->width == width && m_plans[i]->height == height) {
+                m_plans.move(i, 0);
+                return m_plans.first();
+            }
+        }
+
+        PlansSP plans(new Plans(width, height));
+        m_plans.prepend(plans);
+
+        if (m_plans.size() > MAX_CACHED_PLANS) {
+            evicted = m_plans.takeLast();
+        }
+
+        return plans;
+    }
+
+private:
+    KisFFTWPlanCache() {}
+
+private:
+    static const int MAX_CACHED_PLANS = 16;
+
+    QMutex m_lock;
+    QList<PlansSP> m_plans;
+};
+
+#endif /* __KIS_FFTW_PLAN_CACHE_H */
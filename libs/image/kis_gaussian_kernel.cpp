@@ -89,14 +89,18 @@ KisConvolutionKernelSP
 KisGaussianKernel::createHorizontalKernel(qreal radius)
 {
     Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> matrix = createHorizontalMatrix(radius);
-    return KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+    KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+    kernel->setGaussianSigma(sigmaFromRadius(radius));
+    return kernel;
 }
 
 KisConvolutionKernelSP
 KisGaussianKernel::createVerticalKernel(qreal radius)
 {
     Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> matrix = createVerticalMatrix(radius);
-    return KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+    KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+    kernel->setGaussianSigma(sigmaFromRadius(radius));
+    return kernel;
 }
 
 void KisGaussianKernel::applyGaussian(KisPaintDeviceSP device,
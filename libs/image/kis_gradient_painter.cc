@@ -18,8 +18,11 @@
 
 #include "kis_gradient_painter.h"
 
+#include <algorithm>
 #include <cfloat>
 
+#include <QtConcurrentMap>
+
 #include <KoColorSpace.h>
 #include <resources/KoAbstractGradient.h>
 #include <KoUpdater.h>
@@ -49,13 +52,23 @@ public:
         m_subject = gradient;
         m_max = steps - 1;
         m_colorSpace = cs;
+        m_pixelSize = cs->pixelSize();
 
         m_black = KoColor(cs);
 
+        /**
+         * The colors are stored in a single plain table, so that the
+         * lookup is just an offset calculation, without going
+         * through a separate KoColor for every entry
+         */
+        m_colors.resize(steps * m_pixelSize);
+        quint8 *dst = m_colors.data();
+
         KoColor tmpColor(m_colorSpace);
         for(qint32 i = 0; i < steps; i++) {
             m_subject->colorAt(tmpColor, qreal(i) / m_max);
-            m_colors << tmpColor;
+            memcpy(dst, tmpColor.data(), m_pixelSize);
+            dst += m_pixelSize;
         }
     }
 
@@ -79,8 +92,8 @@ public:
     const quint8 *cachedAt(qreal t) const
     {
         qint32 tInt = t * m_max + 0.5;
-        if (m_colors.size() > tInt) {
-            return m_colors[tInt].data();
+        if (tInt >= 0 && tInt <= m_max) {
+            return m_colors.constData() + tInt * m_pixelSize;
         }
         else {
             return m_black.data();
@@ -96,7 +109,8 @@ private:
     const KoAbstractGradient *m_subject;
     const KoColorSpace *m_colorSpace;
     qint32 m_max;
-    QVector<KoColor> m_colors;
+    qint32 m_pixelSize;
+    QVector<quint8> m_colors;
     KoColor m_black;
 };
 
@@ -110,6 +124,7 @@ public:
     LinearGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_normalisedVectorX;
@@ -152,6 +167,21 @@ double LinearGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void LinearGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    if (m_vectorLength < DBL_EPSILON) {
+        std::fill(values, values + count, 0.0);
+        return;
+    }
+
+    const double rowOffset = (y - m_gradientVectorStart.y()) * m_normalisedVectorY;
+
+    for (int i = 0; i < count; i++) {
+        const double vx = (x + i) - m_gradientVectorStart.x();
+        values[i] = (vx * m_normalisedVectorX + rowOffset) / m_vectorLength;
+    }
+}
+
 
 class BiLinearGradientStrategy : public LinearGradientStrategy
 {
@@ -160,6 +190,7 @@ public:
     BiLinearGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 };
 
 BiLinearGradientStrategy::BiLinearGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd)
@@ -179,6 +210,17 @@ double BiLinearGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void BiLinearGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    LinearGradientStrategy::valuesAt(x, y, count, values);
+
+    for (int i = 0; i < count; i++) {
+        if (values[i] < -DBL_EPSILON) {
+            values[i] = -values[i];
+        }
+    }
+}
+
 
 class RadialGradientStrategy : public KisGradientShapeStrategy
 {
@@ -187,6 +229,7 @@ public:
     RadialGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_radius;
@@ -219,6 +262,22 @@ double RadialGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void RadialGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    if (m_radius < DBL_EPSILON) {
+        std::fill(values, values + count, 0.0);
+        return;
+    }
+
+    const double dy = y - m_gradientVectorStart.y();
+    const double dy2 = dy * dy;
+
+    for (int i = 0; i < count; i++) {
+        const double dx = (x + i) - m_gradientVectorStart.x();
+        values[i] = sqrt((dx * dx) + dy2) / m_radius;
+    }
+}
+
 
 class SquareGradientStrategy : public KisGradientShapeStrategy
 {
@@ -227,6 +286,7 @@ public:
     SquareGradientStrategy(const QPointF& gradientVectorStart, const QPointF& gradientVectorEnd);
 
     double valueAt(double x, double y) const override;
+    void valuesAt(double x, double y, int count, double *values) const override;
 
 protected:
     double m_normalisedVectorX;
@@ -279,6 +339,27 @@ double SquareGradientStrategy::valueAt(double x, double y) const
     return t;
 }
 
+void SquareGradientStrategy::valuesAt(double x, double y, int count, double *values) const
+{
+    if (m_vectorLength <= DBL_EPSILON) {
+        KisGradientShapeStrategy::valuesAt(x, y, count, values);
+        return;
+    }
+
+    const double py = y - m_gradientVectorStart.y();
+    const double rowOffset1 = m_normalisedVectorX * py;
+    const double rowOffset2 = -m_normalisedVectorY * -py;
+
+    for (int i = 0; i < count; i++) {
+        const double px = (x + i) - m_gradientVectorStart.x();
+
+        const double distance1 = fabs(-m_normalisedVectorY * px + rowOffset1);
+        const double distance2 = fabs(rowOffset2 + m_normalisedVectorX * px);
+
+        values[i] = qMax(distance1, distance2) / m_vectorLength;
+    }
+}
+
 
 class ConicalGradientStrategy : public KisGradientShapeStrategy
 {
@@ -499,6 +580,49 @@ double GradientRepeatAlternateStrategy::valueAt(double t) const
 
     return value;
 }
+
+
+/**
+ * The size of the patches the gradient is rendered in. It is equal
+ * to the size of the tiles of the paint device, so the patches can
+ * be rendered in parallel without touching each other's tiles.
+ */
+const int GRADIENT_TILE_SIZE = 64;
+const int GRADIENT_TILE_SHIFT = 6;
+
+void renderGradientPatch(KisPaintDeviceSP dev,
+                         const QRect &rc,
+                         const KisGradientShapeStrategy *shapeStrategy,
+                         const GradientRepeatStrategy *repeatStrategy,
+                         bool reverseGradient,
+                         const CachedGradient &cachedGradient)
+{
+    if (rc.isEmpty()) return;
+
+    const int pixelSize = dev->pixelSize();
+    const int width = rc.width();
+
+    QVector<double> values(width);
+    QVector<quint8> buffer(width * rc.height() * pixelSize);
+    quint8 *dst = buffer.data();
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        shapeStrategy->valuesAt(rc.left(), y, width, values.data());
+
+        for (int i = 0; i < width; i++) {
+            double t = repeatStrategy->valueAt(values[i]);
+
+            if (reverseGradient) {
+                t = 1 - t;
+            }
+
+            memcpy(dst, cachedGradient.cachedAt(t), pixelSize);
+            dst += pixelSize;
+        }
+    }
+
+    dev->writeBytes(buffer.constData(), rc);
+}
 }
 
 struct Q_DECL_HIDDEN KisGradientPainter::Private
@@ -704,32 +828,48 @@ bool KisGradientPainter::paintGradient(const QPointF& gradientVectorStart,
     KisPaintDeviceSP dev = device()->createCompositionSourceDevice();
 
     const KoColorSpace * colorSpace = dev->colorSpace();
-    const qint32 pixelSize = colorSpace->pixelSize();
+    const QPoint tileOrigin(dev->x(), dev->y());
 
     Q_FOREACH (const Private::ProcessRegion &r, m_d->processRegions) {
-        QRect processRect = r.processRect;
-        QSharedPointer<KisGradientShapeStrategy> shapeStrategy = r.precalculatedShapeStrategy;
+        const QRect processRect = r.processRect;
+        if (processRect.isEmpty()) continue;
+
+        const KisGradientShapeStrategy *shapeStrategy = r.precalculatedShapeStrategy.data();
 
         CachedGradient cachedGradient(gradient(), qMax(processRect.width(), processRect.height()), colorSpace);
 
-        KisSequentialIterator it(dev, processRect);
-        const int rightCol = processRect.right();
-        KisProgressUpdateHelper progressHelper(progressUpdater(), 100, processRect.height());
+        const int firstColumn = (processRect.left() - tileOrigin.x()) >> GRADIENT_TILE_SHIFT;
+        const int lastColumn = (processRect.right() - tileOrigin.x()) >> GRADIENT_TILE_SHIFT;
+        const int firstRow = (processRect.top() - tileOrigin.y()) >> GRADIENT_TILE_SHIFT;
+        const int lastRow = (processRect.bottom() - tileOrigin.y()) >> GRADIENT_TILE_SHIFT;
 
-        do {
-            double t = shapeStrategy->valueAt(it.x(), it.y());
-            t = repeatStrategy->valueAt(t);
+        KisProgressUpdateHelper progressHelper(progressUpdater(), 100, lastRow - firstRow + 1);
 
-            if (reverseGradient) {
-                t = 1 - t;
-            }
+        /**
+         * The patches of every row of tiles are rendered in parallel,
+         * the progress is reported after every row
+         */
+        QVector<QRect> patches;
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            patches.resize(0);
 
-            memcpy(it.rawData(), cachedGradient.cachedAt(t), pixelSize);
+            for (int column = firstColumn; column <= lastColumn; column++) {
+                const QRect tileRect(tileOrigin.x() + column * GRADIENT_TILE_SIZE,
+                                     tileOrigin.y() + row * GRADIENT_TILE_SIZE,
+                                     GRADIENT_TILE_SIZE, GRADIENT_TILE_SIZE);
 
-            if (it.x() == rightCol) {
-                progressHelper.step();
+                patches << (tileRect & processRect);
             }
-        } while (it.nextPixel());
+
+            QtConcurrent::blockingMap(patches,
+                [&] (const QRect &rc) {
+                    renderGradientPatch(dev, rc, shapeStrategy, repeatStrategy,
+                                        reverseGradient, cachedGradient);
+                });
+
+            progressHelper.step();
+        }
 
         bitBlt(processRect.topLeft(), dev, processRect);
     }
@@ -31,6 +31,17 @@ public:
 
     virtual double valueAt(double x, double y) const = 0;
 
+    /**
+     * Calculate the values of \p count consecutive pixels of the row
+     * \p y starting at \p x. The default implementation just calls
+     * valueAt() for every pixel, the strategies override it to hoist
+     * the per-row calculations out of the loop and let the compiler
+     * vectorize it.
+     *
+     * The method may be called from several threads at once.
+     */
+    virtual void valuesAt(double x, double y, int count, double *values) const;
+
 protected:
     QPointF m_gradientVectorStart;
     QPointF m_gradientVectorEnd;
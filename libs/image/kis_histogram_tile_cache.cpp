@@ -0,0 +1,330 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "kis_histogram_tile_cache.h"
+
+#include <QtConcurrentMap>
+#include <QVector>
+
+#include <KoChannelInfo.h>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceMaths.h>
+
+#include "kis_paint_device.h"
+#include "kis_sequential_iterator.h"
+
+/**
+ * The size of the cells the histograms are kept for. A histogram of an
+ * RGBA cell takes 4 KiB, so a cell covers 4x4 tiles to keep the cache
+ * of a 16k image within 16 MiB.
+ */
+static const int CELL_SIZE = 256;
+static const int CELL_SHIFT = 8;
+static const int NUM_BINS = 256;
+
+
+namespace {
+
+enum ChannelsType {
+    GENERIC_CHANNELS,
+    U8_CHANNELS,
+    U16_CHANNELS
+};
+
+inline quint8 scaleToBin(quint8 value)
+{
+    return value;
+}
+
+inline quint8 scaleToBin(quint16 value)
+{
+    return KoColorSpaceMaths<quint16, quint8>::scaleToA(value);
+}
+
+template <typename channel_type>
+inline void countPixel(const channel_type *pixel, int channelCount, int alphaIndex, quint32 *bins)
+{
+    if (alphaIndex >= 0 && !scaleToBin(pixel[alphaIndex])) return;
+
+    for (int i = 0; i < channelCount; i++) {
+        bins[i * NUM_BINS + scaleToBin(pixel[i])]++;
+    }
+}
+
+/**
+ * Count the pixels of an integer color space directly, without calling
+ * KoColorSpace::scaleToU8() for every channel.
+ *
+ * Neighbouring pixels usually have the same color, and incrementing the
+ * same counter twice in a row has to wait for the previous store, so
+ * the even and odd pixels are counted into separate tables.
+ */
+template <typename channel_type>
+void countPixels(const quint8 *pixels, int numPixels,
+                 int channelCount, int alphaIndex,
+                 quint32 *evenBins, quint32 *oddBins)
+{
+    const channel_type *src = reinterpret_cast<const channel_type*>(pixels);
+
+    int i = 0;
+    for (; i + 1 < numPixels; i += 2) {
+        countPixel(src, channelCount, alphaIndex, evenBins);
+        countPixel(src + channelCount, channelCount, alphaIndex, oddBins);
+        src += 2 * channelCount;
+    }
+
+    if (i < numPixels) {
+        countPixel(src, channelCount, alphaIndex, evenBins);
+    }
+}
+
+void countPixelsGeneric(const quint8 *pixels, int numPixels,
+                        const KoColorSpace *cs, quint32 *bins)
+{
+    const int pixelSize = cs->pixelSize();
+    const int channelCount = cs->channelCount();
+
+    for (int i = 0; i < numPixels; i++) {
+        if (cs->opacityU8(pixels) != OPACITY_TRANSPARENT_U8) {
+            for (int channel = 0; channel < channelCount; channel++) {
+                bins[channel * NUM_BINS + cs->scaleToU8(pixels, channel)]++;
+            }
+        }
+        pixels += pixelSize;
+    }
+}
+
+struct CellJob {
+    int index;
+    QRect rect;
+    QVector<quint32> bins;
+};
+
+}
+
+
+struct KisHistogramTileCache::Private
+{
+    Private() : colorSpace(0), channelCount(0), channelsType(GENERIC_CHANNELS), alphaIndex(-1), numColumns(0) {}
+
+    const KoColorSpace *colorSpace;
+    int channelCount;
+    ChannelsType channelsType;
+    int alphaIndex;
+
+    QRect bounds;
+    QPoint firstCell;
+    int numColumns;
+
+    QVector<QVector<quint32> > cells;
+    QVector<bool> dirtyCells;
+    QVector<quint32> total;
+
+    void reset(const KoColorSpace *cs, const QRect &newBounds);
+    QRect cellRect(int index) const;
+    void calculateCell(KisPaintDeviceSP dev, CellJob *job) const;
+};
+
+void KisHistogramTileCache::Private::reset(const KoColorSpace *cs, const QRect &newBounds)
+{
+    colorSpace = cs;
+    channelCount = cs->channelCount();
+    bounds = newBounds;
+
+    channelsType = GENERIC_CHANNELS;
+    alphaIndex = -1;
+
+    const QList<KoChannelInfo*> channels = cs->channels();
+
+    bool allU8 = true;
+    bool allU16 = true;
+    int alphaPos = -1;
+
+    Q_FOREACH (const KoChannelInfo *channel, channels) {
+        allU8 &= channel->channelValueType() == KoChannelInfo::UINT8;
+        allU16 &= channel->channelValueType() == KoChannelInfo::UINT16;
+
+        if (channel->channelType() == KoChannelInfo::ALPHA) {
+            alphaPos = channel->pos();
+        }
+    }
+
+    if (allU8 && int(cs->pixelSize()) == channelCount) {
+        channelsType = U8_CHANNELS;
+        alphaIndex = alphaPos;
+    } else if (allU16 && int(cs->pixelSize()) == 2 * channelCount) {
+        channelsType = U16_CHANNELS;
+        alphaIndex = alphaPos >= 0 ? alphaPos / 2 : -1;
+    }
+
+    cells.clear();
+    dirtyCells.clear();
+    total.fill(0, channelCount * NUM_BINS);
+
+    if (bounds.isEmpty()) {
+        numColumns = 0;
+        return;
+    }
+
+    firstCell = QPoint(bounds.left() >> CELL_SHIFT, bounds.top() >> CELL_SHIFT);
+    numColumns = (bounds.right() >> CELL_SHIFT) - firstCell.x() + 1;
+    const int numRows = (bounds.bottom() >> CELL_SHIFT) - firstCell.y() + 1;
+
+    cells.resize(numColumns * numRows);
+    dirtyCells.fill(true, numColumns * numRows);
+}
+
+QRect KisHistogramTileCache::Private::cellRect(int index) const
+{
+    const int column = firstCell.x() + index % numColumns;
+    const int row = firstCell.y() + index / numColumns;
+
+    return bounds & QRect(column * CELL_SIZE, row * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+}
+
+void KisHistogramTileCache::Private::calculateCell(KisPaintDeviceSP dev, CellJob *job) const
+{
+    job->bins.fill(0, channelCount * NUM_BINS);
+
+    const KoColor defaultPixel = dev->defaultPixel();
+    if (!dev->extent().intersects(job->rect) &&
+        colorSpace->opacityU8(defaultPixel.data()) == OPACITY_TRANSPARENT_U8) {
+
+        return;
+    }
+
+    QVector<quint32> oddBins;
+    if (channelsType != GENERIC_CHANNELS) {
+        oddBins.fill(0, channelCount * NUM_BINS);
+    }
+
+    quint32 *evenBinsPtr = job->bins.data();
+    quint32 *oddBinsPtr = oddBins.data();
+
+    KisSequentialConstIterator it(dev, job->rect);
+
+    int numPixels;
+    do {
+        numPixels = it.nConseqPixels();
+        const quint8 *pixels = it.rawDataConst();
+
+        switch (channelsType) {
+        case U8_CHANNELS:
+            countPixels<quint8>(pixels, numPixels, channelCount, alphaIndex,
+                                evenBinsPtr, oddBinsPtr);
+            break;
+        case U16_CHANNELS:
+            countPixels<quint16>(pixels, numPixels, channelCount, alphaIndex,
+                                 evenBinsPtr, oddBinsPtr);
+            break;
+        case GENERIC_CHANNELS:
+            countPixelsGeneric(pixels, numPixels, colorSpace, evenBinsPtr);
+            break;
+        }
+    } while (it.nextPixels(numPixels));
+
+    for (int i = 0; i < oddBins.size(); i++) {
+        evenBinsPtr[i] += oddBinsPtr[i];
+    }
+}
+
+KisHistogramTileCache::KisHistogramTileCache()
+    : m_d(new Private)
+{
+}
+
+KisHistogramTileCache::~KisHistogramTileCache()
+{
+}
+
+void KisHistogramTileCache::setDirty(const QRect &rc)
+{
+    const QRect dirtyRect = rc & m_d->bounds;
+    if (dirtyRect.isEmpty() || !m_d->numColumns) return;
+
+    const int firstColumn = (dirtyRect.left() >> CELL_SHIFT) - m_d->firstCell.x();
+    const int lastColumn = (dirtyRect.right() >> CELL_SHIFT) - m_d->firstCell.x();
+    const int firstRow = (dirtyRect.top() >> CELL_SHIFT) - m_d->firstCell.y();
+    const int lastRow = (dirtyRect.bottom() >> CELL_SHIFT) - m_d->firstCell.y();
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            m_d->dirtyCells[row * m_d->numColumns + column] = true;
+        }
+    }
+}
+
+void KisHistogramTileCache::invalidate()
+{
+    m_d->colorSpace = 0;
+}
+
+KisHistogramTileCache::Histogram KisHistogramTileCache::update(KisPaintDeviceSP dev, const QRect &bounds)
+{
+    if (!m_d->colorSpace ||
+        *m_d->colorSpace != *dev->colorSpace() ||
+        m_d->bounds != bounds) {
+
+        m_d->reset(dev->colorSpace(), bounds);
+    }
+
+    QVector<CellJob> jobs;
+
+    for (int i = 0; i < m_d->dirtyCells.size(); i++) {
+        if (m_d->dirtyCells[i]) {
+            CellJob job;
+            job.index = i;
+            job.rect = m_d->cellRect(i);
+            jobs.append(job);
+        }
+    }
+
+    const Private *d = m_d.data();
+    QtConcurrent::blockingMap(jobs,
+        [d, dev] (CellJob &job) {
+            d->calculateCell(dev, &job);
+        });
+
+    quint32 *total = m_d->total.data();
+
+    Q_FOREACH (const CellJob &job, jobs) {
+        QVector<quint32> &cell = m_d->cells[job.index];
+
+        for (int i = 0; i < cell.size(); i++) {
+            total[i] -= cell[i];
+        }
+
+        for (int i = 0; i < job.bins.size(); i++) {
+            total[i] += job.bins[i];
+        }
+
+        cell = job.bins;
+        m_d->dirtyCells[job.index] = false;
+    }
+
+    Histogram histogram(m_d->channelCount);
+
+    for (int channel = 0; channel < m_d->channelCount; channel++) {
+        histogram[channel].assign(total + channel * NUM_BINS,
+                                  total + (channel + 1) * NUM_BINS);
+    }
+
+    return histogram;
+}
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_HISTOGRAM_TILE_CACHE_H
+#define __KIS_HISTOGRAM_TILE_CACHE_H
+
+#include <vector>
+
+#include <QRect>
+#include <QScopedPointer>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+
+/**
+ * KisHistogramTileCache keeps the histograms of the parts of a paint
+ * device, so that after a change of the device only the changed parts
+ * are rescanned and the histogram of the whole device is updated
+ * incrementally.
+ *
+ * The device is split into cells aligned with the tiles (4x4 tiles
+ * each). The owner reports the changed areas with setDirty() and calls
+ * update() with a snapshot of the device taken after the changes. Only
+ * the dirty cells are recalculated (in parallel), and the differences
+ * of their histograms are applied to the total one.
+ *
+ * The histogram has 256 bins for every channel of the device, the
+ * values are scaled the same way KoColorSpace::scaleToU8() does it.
+ * Fully transparent pixels are not counted.
+ *
+ * The cache is not thread-safe, the owner should not call its methods
+ * from different threads at the same time.
+ */
+class KRITAIMAGE_EXPORT KisHistogramTileCache
+{
+public:
+    typedef std::vector<std::vector<quint32> > Histogram;
+
+public:
+    KisHistogramTileCache();
+    ~KisHistogramTileCache();
+
+    /**
+     * Mark the area as changed. The area will be rescanned on the next
+     * call to update()
+     */
+    void setDirty(const QRect &rc);
+
+    /**
+     * Drop all the cached histograms
+     */
+    void invalidate();
+
+    /**
+     * Rescan the dirty areas of \p dev inside \p bounds and return the
+     * histogram of the whole \p bounds. A change of the color space of
+     * the device or of the bounds drops the cache.
+     */
+    Histogram update(KisPaintDeviceSP dev, const QRect &bounds);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_HISTOGRAM_TILE_CACHE_H */
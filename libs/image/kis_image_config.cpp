@@ -453,3 +453,25 @@ void KisImageConfig::setUseLodForColorizeMask(bool value)
 {
     m_config.writeEntry("useLodForColorizeMask", value);
 }
+
+bool KisImageConfig::useCoarseToFineForColorizeMask(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useCoarseToFineForColorizeMask", true) : true;
+}
+
+void KisImageConfig::setUseCoarseToFineForColorizeMask(bool value)
+{
+    m_config.writeEntry("useCoarseToFineForColorizeMask", value);
+}
+
+bool KisImageConfig::useRecursiveGaussianBlur(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("useRecursiveGaussianBlur", false) : false;
+}
+
+void KisImageConfig::setUseRecursiveGaussianBlur(bool value)
+{
+    m_config.writeEntry("useRecursiveGaussianBlur", value);
+}
@@ -111,6 +111,12 @@ public:
     bool useLodForColorizeMask(bool requestDefault = false) const;
     void setUseLodForColorizeMask(bool value);
 
+    bool useCoarseToFineForColorizeMask(bool requestDefault = false) const;
+    void setUseCoarseToFineForColorizeMask(bool value);
+
+    bool useRecursiveGaussianBlur(bool requestDefault = false) const;
+    void setUseRecursiveGaussianBlur(bool value);
+
 
 private:
     Q_DISABLE_COPY(KisImageConfig)
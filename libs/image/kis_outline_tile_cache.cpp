@@ -0,0 +1,425 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_outline_tile_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QHash>
+#include <QPair>
+#include <QtConcurrentMap>
+
+#include <KoColor.h>
+
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+#include "kis_assert.h"
+
+/**
+ * The size of the cells the segments are kept for. It is equal to the
+ * size of the tiles of the paint device, so that a cell changed by a
+ * stroke does not make its untouched neighbours be traced again. The
+ * same shift converts the coordinates into the tile ones.
+ */
+static const int CELL_SIZE = 64;
+static const int CELL_SHIFT = 6;
+
+
+namespace {
+
+/**
+ * A straight axis-aligned piece of the outline. The selected pixels
+ * are always on the right side of the segment (in the coordinate
+ * system with the Y axis pointing down).
+ */
+struct Segment {
+    QPoint start;
+    QPoint end;
+};
+
+typedef QVector<Segment> Segments;
+
+struct Cell {
+    Segments segments;
+
+    /// the revisions of the tiles the segments were traced from
+    QVector<quint64> tileRevisions;
+};
+
+struct CellJob {
+    quint64 key;
+    QRect rect;
+    const Cell *cached;
+    bool changed;
+    Cell cell;
+};
+
+inline quint64 cellKey(int column, int row)
+{
+    return quint64(quint32(row)) << 32 | quint32(column);
+}
+
+inline quint64 pointKey(const QPoint &pt)
+{
+    return quint64(quint32(pt.y())) << 32 | quint32(pt.x());
+}
+
+inline QPoint direction(const Segment &segment)
+{
+    const QPoint diff = segment.end - segment.start;
+    return QPoint(qBound(-1, diff.x(), 1), qBound(-1, diff.y(), 1));
+}
+
+/**
+ * Extract the boundary edges of the selected pixels of \p rect.
+ * \p buffer covers \p rect plus a one pixel wide ring around it.
+ *
+ * The edges are detected with plain byte-wise logic over whole rows,
+ * which the compiler vectorizes, and only the rows having any edges
+ * are scanned for the runs.
+ */
+void traceCell(const quint8 *buffer, const QRect &rect, Segments *segments)
+{
+    const int width = rect.width();
+    const int height = rect.height();
+    const int stride = width + 2;
+
+    QVector<quint8> mask(stride * (height + 2));
+    quint8 *maskPtr = mask.data();
+
+    for (int i = 0; i < mask.size(); i++) {
+        maskPtr[i] = buffer[i] ? 0xff : 0;
+    }
+
+    QVector<quint8> edges(4 * width);
+    quint8 *top = edges.data();
+    quint8 *bottom = top + width;
+    quint8 *left = bottom + width;
+    quint8 *right = left + width;
+
+    // the rows the open vertical runs started at, relative to the cell
+    QVector<int> leftStart(width, -1);
+    QVector<int> rightStart(width, -1);
+    int numOpenRuns = 0;
+
+    for (int y = 0; y <= height; y++) {
+        const int absY = rect.y() + y;
+
+        if (y < height) {
+            const quint8 *up = maskPtr + y * stride + 1;
+            const quint8 *cur = up + stride;
+            const quint8 *down = cur + stride;
+
+            quint8 anyEdges = 0;
+
+            for (int x = 0; x < width; x++) {
+                top[x] = cur[x] & ~up[x];
+                bottom[x] = cur[x] & ~down[x];
+                left[x] = cur[x] & ~cur[x - 1];
+                right[x] = cur[x] & ~cur[x + 1];
+
+                anyEdges |= top[x] | bottom[x] | left[x] | right[x];
+            }
+
+            if (!anyEdges && !numOpenRuns) continue;
+        } else {
+            // the bottom of the cell closes all the vertical runs
+            if (!numOpenRuns) break;
+
+            memset(top, 0, 2 * width);
+            memset(left, 0, 2 * width);
+        }
+
+        for (int x = 0; x < width; x++) {
+            const int absX = rect.x() + x;
+
+            if (top[x] && (!x || !top[x - 1])) {
+                int end = x + 1;
+                while (end < width && top[end]) end++;
+
+                segments->append({QPoint(absX, absY), QPoint(rect.x() + end, absY)});
+            }
+
+            if (bottom[x] && (!x || !bottom[x - 1])) {
+                int end = x + 1;
+                while (end < width && bottom[end]) end++;
+
+                segments->append({QPoint(rect.x() + end, absY + 1), QPoint(absX, absY + 1)});
+            }
+
+            if (left[x] && leftStart[x] < 0) {
+                leftStart[x] = y;
+                numOpenRuns++;
+            } else if (!left[x] && leftStart[x] >= 0) {
+                segments->append({QPoint(absX, absY), QPoint(absX, rect.y() + leftStart[x])});
+                leftStart[x] = -1;
+                numOpenRuns--;
+            }
+
+            if (right[x] && rightStart[x] < 0) {
+                rightStart[x] = y;
+                numOpenRuns++;
+            } else if (!right[x] && rightStart[x] >= 0) {
+                segments->append({QPoint(absX + 1, rect.y() + rightStart[x]), QPoint(absX + 1, absY)});
+                rightStart[x] = -1;
+                numOpenRuns--;
+            }
+        }
+    }
+}
+
+/**
+ * Collect the revisions of the tiles covering \p rect. If none of them
+ * has changed, the pixels of \p rect have not changed either.
+ */
+QVector<quint64> tileRevisions(const KisPaintDevice &dev, const QRect &rect)
+{
+    KisDataManagerSP dataManager = dev.dataManager();
+    const QRect dataRect = rect.translated(-dev.x(), -dev.y());
+
+    const int firstColumn = dataRect.left() >> CELL_SHIFT;
+    const int lastColumn = dataRect.right() >> CELL_SHIFT;
+    const int firstRow = dataRect.top() >> CELL_SHIFT;
+    const int lastRow = dataRect.bottom() >> CELL_SHIFT;
+
+    QVector<quint64> revisions;
+    revisions.reserve((lastColumn - firstColumn + 1) * (lastRow - firstRow + 1));
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            revisions.append(dataManager->tileRevision(column, row));
+        }
+    }
+
+    return revisions;
+}
+
+void processCell(const KisPaintDevice &dev, const QRect &clipRect, CellJob *job)
+{
+    const QRect readRect = job->rect.adjusted(-1, -1, 1, 1);
+
+    job->cell.tileRevisions = tileRevisions(dev, readRect);
+
+    if (job->cached && job->cached->tileRevisions == job->cell.tileRevisions) {
+        job->changed = false;
+        return;
+    }
+
+    job->changed = true;
+
+    QVector<quint8> buffer(readRect.width() * readRect.height());
+    dev.readBytes(buffer.data(), readRect);
+
+    if (!clipRect.isEmpty() && !clipRect.contains(readRect)) {
+        quint8 *ptr = buffer.data();
+
+        for (int y = readRect.top(); y <= readRect.bottom(); y++) {
+            for (int x = readRect.left(); x <= readRect.right(); x++, ptr++) {
+                if (!clipRect.contains(x, y)) {
+                    *ptr = 0;
+                }
+            }
+        }
+    }
+
+    traceCell(buffer.constData(), job->rect, &job->cell.segments);
+}
+
+/**
+ * Chain the segments into closed polygons. Every segment starts where
+ * another one ends, so the chaining is a lookup of the segment
+ * starting at the end of the current one. Two segments start at the
+ * same point only where two selected pixels touch diagonally, any of
+ * them can be taken, since the outline is filled with the odd-even
+ * rule anyway.
+ */
+QVector<QPolygon> stitchSegments(const Segments &segments)
+{
+    const int numSegments = segments.size();
+
+    QVector<QPair<quint64, int> > starts(numSegments);
+    for (int i = 0; i < numSegments; i++) {
+        starts[i] = qMakePair(pointKey(segments[i].start), i);
+    }
+    std::sort(starts.begin(), starts.end());
+
+    QVector<bool> used(numSegments, false);
+
+    auto findNext = [&] (const QPoint &pt) {
+        const quint64 key = pointKey(pt);
+
+        auto it = std::lower_bound(starts.constBegin(), starts.constEnd(),
+                                   qMakePair(key, 0));
+
+        for (; it != starts.constEnd() && it->first == key; ++it) {
+            if (!used[it->second]) return it->second;
+        }
+
+        return -1;
+    };
+
+    QVector<QPolygon> polygons;
+
+    for (int i = 0; i < numSegments; i++) {
+        if (used[i]) continue;
+
+        const QPoint firstPoint = segments[i].start;
+        const QPoint firstDirection = direction(segments[i]);
+
+        QPolygon polygon;
+        polygon << firstPoint;
+
+        int current = i;
+
+        while (true) {
+            used[current] = true;
+
+            const Segment &segment = segments[current];
+            const QPoint currentDirection = direction(segment);
+
+            if (segment.end == firstPoint) {
+                // the first point may lie in the middle of a straight line
+                if (currentDirection == firstDirection && polygon.size() > 1) {
+                    polygon.remove(0);
+                }
+                break;
+            }
+
+            const int next = findNext(segment.end);
+            KIS_SAFE_ASSERT_RECOVER(next >= 0) { break; }
+
+            // the cells split the straight lines, merge them back
+            if (direction(segments[next]) != currentDirection) {
+                polygon << segment.end;
+            }
+
+            current = next;
+        }
+
+        polygons.append(polygon);
+    }
+
+    return polygons;
+}
+
+}
+
+struct KisOutlineTileCache::Private
+{
+    Private() : defaultPixel(0) {}
+
+    QRect clipRect;
+    QPoint offset;
+    quint8 defaultPixel;
+    QHash<quint64, Cell> cells;
+};
+
+KisOutlineTileCache::KisOutlineTileCache()
+    : m_d(new Private)
+{
+}
+
+KisOutlineTileCache::~KisOutlineTileCache()
+{
+}
+
+void KisOutlineTileCache::invalidate()
+{
+    m_d->cells.clear();
+}
+
+QVector<QPolygon> KisOutlineTileCache::outline(const KisPaintDevice &dev, const QRect &extent, const QRect &clipRect)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(dev.pixelSize() == 1, QVector<QPolygon>());
+
+    /**
+     * The revisions of the tiles do not cover the default pixel and
+     * the position of the tiles, so their changes drop the cache
+     */
+    const QPoint offset(dev.x(), dev.y());
+    const quint8 defaultPixel = *dev.defaultPixel().data();
+
+    if (m_d->clipRect != clipRect ||
+        m_d->offset != offset ||
+        m_d->defaultPixel != defaultPixel) {
+
+        invalidate();
+        m_d->clipRect = clipRect;
+        m_d->offset = offset;
+        m_d->defaultPixel = defaultPixel;
+    }
+
+    QVector<CellJob> jobs;
+
+    if (!extent.isEmpty()) {
+        const int firstColumn = extent.left() >> CELL_SHIFT;
+        const int lastColumn = extent.right() >> CELL_SHIFT;
+        const int firstRow = extent.top() >> CELL_SHIFT;
+        const int lastRow = extent.bottom() >> CELL_SHIFT;
+
+        jobs.reserve((lastColumn - firstColumn + 1) * (lastRow - firstRow + 1));
+
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int column = firstColumn; column <= lastColumn; column++) {
+                CellJob job;
+                job.key = cellKey(column, row);
+                job.rect = QRect(column * CELL_SIZE, row * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+
+                auto it = m_d->cells.constFind(job.key);
+                job.cached = it != m_d->cells.constEnd() ? &it.value() : 0;
+
+                job.changed = true;
+                jobs.append(job);
+            }
+        }
+    }
+
+    const KisPaintDevice *device = &dev;
+    QtConcurrent::blockingMap(jobs,
+        [device, clipRect] (CellJob &job) {
+            processCell(*device, clipRect, &job);
+        });
+
+    /**
+     * The cells outside the extent have no selected pixels anymore,
+     * so they are just dropped
+     */
+    QHash<quint64, Cell> cells;
+    cells.reserve(jobs.size());
+
+    int numSegments = 0;
+
+    Q_FOREACH (const CellJob &job, jobs) {
+        const Cell &cell = job.changed ? job.cell : *job.cached;
+
+        cells.insert(job.key, cell);
+        numSegments += cell.segments.size();
+    }
+
+    m_d->cells.swap(cells);
+
+    Segments allSegments;
+    allSegments.reserve(numSegments);
+
+    for (auto it = m_d->cells.constBegin(); it != m_d->cells.constEnd(); ++it) {
+        allSegments += it.value().segments;
+    }
+
+    return stitchSegments(allSegments);
+}
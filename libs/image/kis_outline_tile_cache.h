@@ -0,0 +1,90 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_OUTLINE_TILE_CACHE_H
+#define __KIS_OUTLINE_TILE_CACHE_H
+
+#include <QPolygon>
+#include <QRect>
+#include <QScopedPointer>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+class KisPaintDevice;
+
+
+/**
+ * KisOutlineTileCache generates the outline of the non-transparent
+ * pixels of an 8-bit selection device and keeps the intermediate
+ * results, so that after a change of the selection only the changed
+ * parts of it are traced again.
+ *
+ * The device is split into cells of the size of a tile. The boundary
+ * edges of the selected pixels of every cell are extracted separately
+ * (in parallel) and merged into straight axis-aligned segments. The
+ * segments of all the cells are then stitched into closed polygons.
+ *
+ * The owner does not need to report the changed areas: the cache keeps
+ * the revisions of the tiles every cell was traced from (including the
+ * tiles of the one pixel wide ring around the cell, the edges depend on
+ * it). On the next update only the cells with any of those tiles
+ * locked for writing since then are traced again, the pixels of the
+ * other cells are not even read.
+ *
+ * The polygons follow the pixel boundaries. Outer boundaries go
+ * clockwise and the holes go counterclockwise, every boundary edge is
+ * included into exactly one polygon, so the outline should be filled
+ * with Qt::OddEvenFill. The polygons are not closed explicitly, i.e.
+ * the first point is not repeated in the end.
+ *
+ * The cache is not thread-safe, the owner should not call its methods
+ * from different threads at the same time. The device should not be
+ * changed while the outline is being generated.
+ */
+class KRITAIMAGE_EXPORT KisOutlineTileCache
+{
+public:
+    KisOutlineTileCache();
+    ~KisOutlineTileCache();
+
+    /**
+     * Drop all the cached segments
+     */
+    void invalidate();
+
+    /**
+     * Update the cache and return the outline of the non-zero pixels
+     * of \p dev. The pixel size of the device must be 1. A change of
+     * the default pixel or the offset of the device drops the cache.
+     *
+     * @param extent the area containing all the selected pixels of
+     *        \p dev, usually its exact bounds
+     * @param clipRect the pixels outside this rect are considered to
+     *        be unselected. An empty rect means no clipping, it should
+     *        be used when the default pixel of the device is zero.
+     *        A change of the clip rect drops the cache.
+     */
+    QVector<QPolygon> outline(const KisPaintDevice &dev, const QRect &extent, const QRect &clipRect);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_OUTLINE_TILE_CACHE_H */
@@ -37,6 +37,8 @@
 #include <QRect>
 #include <QString>
 #include <QStringList>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <kundo2command.h>
 
 #include <kis_debug.h>
@@ -64,6 +66,7 @@
 #include "kis_paintop_registry.h"
 #include "kis_perspective_math.h"
 #include "tiles3/kis_random_accessor.h"
+#include "tiles3/kis_tile_data.h"
 #include <kis_distance_information.h>
 #include <KoColorSpaceMaths.h>
 #include "kis_lod_transform.h"
@@ -132,8 +135,76 @@ struct Q_DECL_HIDDEN KisPainter::Private {
                              qint32 *dstY);
 
     void fillPainterPathImpl(const QPainterPath& path, const QRect &requestedRect);
+
+    /**
+     * Calls \p func for parts of \p dstRect. Big rects are split into
+     * stripes aligned to the rows of tiles, which are processed
+     * concurrently. Small rects are passed to \p func as they are.
+     *
+     * Only reading and compositing actually run in parallel:
+     * writeBytes() takes the QWriteLocker of the data manager, so
+     * the stripes are written back one after another.
+     */
+    template <class Func>
+    void processInStripes(const QRect &dstRect, Func func);
+
+    void bltFixedImpl(const QRect &dstRect,
+                      const KisFixedPaintDeviceSP srcDev,
+                      qint32 srcX, qint32 srcY);
+
+    void bltFixedWithFixedSelectionImpl(const QRect &dstRect,
+                                        const KisFixedPaintDeviceSP srcDev,
+                                        const KisFixedPaintDeviceSP selection,
+                                        qint32 selX, qint32 selY,
+                                        qint32 srcX, qint32 srcY);
+
+    void bitBltWithFixedSelectionImpl(const QRect &dstRect,
+                                      const KisPaintDeviceSP srcDev,
+                                      const KisFixedPaintDeviceSP selection,
+                                      qint32 selX, qint32 selY,
+                                      qint32 srcX, qint32 srcY);
 };
 
+/**
+ * The blits of the dabs smaller than this number of pixels are
+ * not split into stripes
+ */
+static const qint64 PARALLEL_BLIT_THRESHOLD = 512 * 512;
+
+template <class Func>
+void KisPainter::Private::processInStripes(const QRect &dstRect, Func func)
+{
+    const int tileHeight = KisTileData::HEIGHT;
+    const int numThreads = QThread::idealThreadCount();
+
+    if (qint64(dstRect.width()) * dstRect.height() < PARALLEL_BLIT_THRESHOLD ||
+        dstRect.height() <= tileHeight || numThreads <= 1) {
+
+        func(dstRect);
+        return;
+    }
+
+    int stripeHeight = dstRect.height() / (2 * numThreads);
+    stripeHeight = qMax(tileHeight, (stripeHeight + tileHeight - 1) / tileHeight * tileHeight);
+
+    /**
+     * Round the top of the first stripe down to the tile border,
+     * so that every tile belongs to a single stripe and the
+     * concurrent reads don't contend for the same tiles
+     */
+    int stripeTop = dstRect.top() - dstRect.top() % tileHeight;
+    if (dstRect.top() % tileHeight < 0) {
+        stripeTop -= tileHeight;
+    }
+
+    QVector<QRect> stripes;
+    for (; stripeTop <= dstRect.bottom(); stripeTop += stripeHeight) {
+        stripes << (dstRect & QRect(dstRect.left(), stripeTop, dstRect.width(), stripeHeight));
+    }
+
+    QtConcurrent::blockingMap(stripes, func);
+}
+
 KisPainter::KisPainter()
     : d(new Private(this))
 {
@@ -506,24 +577,55 @@ void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
                                &srcWidth, &srcHeight,
                                &dstX, &dstY)) return;
 
+    const QRect dstRect(dstX, dstY, srcWidth, srcHeight);
+
+    d->processInStripes(dstRect,
+        [&] (const QRect &rc) {
+            const int offset = rc.y() - dstY;
+            d->bitBltWithFixedSelectionImpl(rc, srcDev, selection,
+                                            selX, selY + offset,
+                                            srcX, srcY + offset);
+        });
+
+    addDirtyRect(dstRect);
+}
+
+void KisPainter::Private::bitBltWithFixedSelectionImpl(const QRect &dstRect,
+                                                       const KisPaintDeviceSP srcDev,
+                                                       const KisFixedPaintDeviceSP selection,
+                                                       qint32 selX, qint32 selY,
+                                                       qint32 srcX, qint32 srcY)
+{
+    const qint32 dstX = dstRect.x();
+    const qint32 dstY = dstRect.y();
+    const qint32 srcWidth = dstRect.width();
+    const qint32 srcHeight = dstRect.height();
+
+    /**
+     * The blit may be split into several stripes running
+     * concurrently, so use a local copy of the parameters
+     */
+    KoCompositeOp::ParameterInfo paramInfo(this->paramInfo);
+
     /* Create an intermediate byte array to hold information before it is written
-    to the current paint device (d->device) */
+    to the current paint device (device) */
     quint8* dstBytes = 0;
     try {
-        dstBytes = new quint8[srcWidth * srcHeight * d->device->pixelSize()];
+        dstBytes = new quint8[srcWidth * srcHeight * device->pixelSize()];
     } catch (std::bad_alloc) {
-        warnKrita << "KisPainter::bitBltWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << d->device->pixelSize() << "dst bytes";
+        warnKrita << "KisPainter::bitBltWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << device->pixelSize() << "dst bytes";
         return;
     }
 
-    d->device->readBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
+    device->readBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
 
     // Copy the relevant bytes of raw data from srcDev
     quint8* srcBytes = 0;
     try {
         srcBytes = new quint8[srcWidth * srcHeight * srcDev->pixelSize()];
     } catch (std::bad_alloc) {
-        warnKrita << "KisPainter::bitBltWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << d->device->pixelSize() << "src bytes";
+        warnKrita << "KisPainter::bitBltWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << device->pixelSize() << "src bytes";
+        delete[] dstBytes;
         return;
     }
 
@@ -536,61 +638,61 @@ void KisPainter::bitBltWithFixedSelection(qint32 dstX, qint32 dstY,
     /*
      * This checks whether there is nothing selected.
      */
-    if (!d->selection) {
+    if (!this->selection) {
         /* As there's nothing selected, blit to dstBytes (intermediary bit array),
-          ignoring d->selection (the user selection)*/
-        d->paramInfo.dstRowStart   = dstBytes;
-        d->paramInfo.dstRowStride  = srcWidth * d->device->pixelSize();
-        d->paramInfo.srcRowStart   = srcBytes;
-        d->paramInfo.srcRowStride  = srcWidth * srcDev->pixelSize();
-        d->paramInfo.maskRowStart  = selRowStart;
-        d->paramInfo.maskRowStride = selBounds.width() * selection->pixelSize();
-        d->paramInfo.rows          = srcHeight;
-        d->paramInfo.cols          = srcWidth;
-        d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+          ignoring this->selection (the user selection)*/
+        paramInfo.dstRowStart   = dstBytes;
+        paramInfo.dstRowStride  = srcWidth * device->pixelSize();
+        paramInfo.srcRowStart   = srcBytes;
+        paramInfo.srcRowStride  = srcWidth * srcDev->pixelSize();
+        paramInfo.maskRowStart  = selRowStart;
+        paramInfo.maskRowStride = selBounds.width() * selection->pixelSize();
+        paramInfo.rows          = srcHeight;
+        paramInfo.cols          = srcWidth;
+        colorSpace->bitBlt(srcDev->colorSpace(), paramInfo, compositeOp, renderingIntent, conversionFlags);
     }
     else {
-        /* Read the user selection (d->selection) bytes into an array, ready
+        /* Read the user selection (this->selection) bytes into an array, ready
         to merge in the next block*/
         quint32 totalBytes = srcWidth * srcHeight * selection->pixelSize();
         quint8* mergedSelectionBytes = 0;
         try {
             mergedSelectionBytes = new quint8[ totalBytes ];
         } catch (std::bad_alloc) {
-            warnKrita << "KisPainter::bitBltWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << d->device->pixelSize() << "total bytes";
+            warnKrita << "KisPainter::bitBltWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << device->pixelSize() << "total bytes";
+            delete[] dstBytes;
+            delete[] srcBytes;
             return;
         }
 
-        d->selection->projection()->readBytes(mergedSelectionBytes, dstX, dstY, srcWidth, srcHeight);
+        this->selection->projection()->readBytes(mergedSelectionBytes, dstX, dstY, srcWidth, srcHeight);
 
         // Merge selections here by multiplying them - compositeOP(COMPOSITE_MULT)
-        d->paramInfo.dstRowStart   = mergedSelectionBytes;
-        d->paramInfo.dstRowStride  = srcWidth * selection->pixelSize();
-        d->paramInfo.srcRowStart   = selRowStart;
-        d->paramInfo.srcRowStride  = selBounds.width() * selection->pixelSize();
-        d->paramInfo.maskRowStart  = 0;
-        d->paramInfo.maskRowStride = 0;
-        d->paramInfo.rows          = srcHeight;
-        d->paramInfo.cols          = srcWidth;
-        KoColorSpaceRegistry::instance()->alpha8()->compositeOp(COMPOSITE_MULT)->composite(d->paramInfo);
+        paramInfo.dstRowStart   = mergedSelectionBytes;
+        paramInfo.dstRowStride  = srcWidth * selection->pixelSize();
+        paramInfo.srcRowStart   = selRowStart;
+        paramInfo.srcRowStride  = selBounds.width() * selection->pixelSize();
+        paramInfo.maskRowStart  = 0;
+        paramInfo.maskRowStride = 0;
+        paramInfo.rows          = srcHeight;
+        paramInfo.cols          = srcWidth;
+        KoColorSpaceRegistry::instance()->alpha8()->compositeOp(COMPOSITE_MULT)->composite(paramInfo);
 
         // Blit to dstBytes (intermediary bit array)
-        d->paramInfo.dstRowStart   = dstBytes;
-        d->paramInfo.dstRowStride  = srcWidth * d->device->pixelSize();
-        d->paramInfo.srcRowStart   = srcBytes;
-        d->paramInfo.srcRowStride  = srcWidth * srcDev->pixelSize();
-        d->paramInfo.maskRowStart  = mergedSelectionBytes;
-        d->paramInfo.maskRowStride = srcWidth * selection->pixelSize();
-        d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+        paramInfo.dstRowStart   = dstBytes;
+        paramInfo.dstRowStride  = srcWidth * device->pixelSize();
+        paramInfo.srcRowStart   = srcBytes;
+        paramInfo.srcRowStride  = srcWidth * srcDev->pixelSize();
+        paramInfo.maskRowStart  = mergedSelectionBytes;
+        paramInfo.maskRowStride = srcWidth * selection->pixelSize();
+        colorSpace->bitBlt(srcDev->colorSpace(), paramInfo, compositeOp, renderingIntent, conversionFlags);
         delete[] mergedSelectionBytes;
     }
 
-    d->device->writeBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
+    device->writeBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
 
     delete[] dstBytes;
     delete[] srcBytes;
-
-    addDirtyRect(QRect(dstX, dstY, srcWidth, srcHeight));
 }
 
 
@@ -908,33 +1010,59 @@ void KisPainter::bltFixed(qint32 dstX, qint32 dstY,
     Q_ASSERT(srcBounds.contains(srcRect));
     Q_UNUSED(srcRect); // only used in above assertion
 
+    const QRect dstRect(dstX, dstY, srcWidth, srcHeight);
+
+    d->processInStripes(dstRect,
+        [&] (const QRect &rc) {
+            d->bltFixedImpl(rc, srcDev, srcX, srcY + rc.y() - dstY);
+        });
+
+    addDirtyRect(dstRect);
+}
+
+void KisPainter::Private::bltFixedImpl(const QRect &dstRect,
+                                       const KisFixedPaintDeviceSP srcDev,
+                                       qint32 srcX, qint32 srcY)
+{
+    const qint32 dstX = dstRect.x();
+    const qint32 dstY = dstRect.y();
+    const qint32 srcWidth = dstRect.width();
+    const qint32 srcHeight = dstRect.height();
+    const QRect srcBounds = srcDev->bounds();
+
+    /**
+     * The blit may be split into several stripes running
+     * concurrently, so use a local copy of the parameters
+     */
+    KoCompositeOp::ParameterInfo paramInfo(this->paramInfo);
+
     /* Create an intermediate byte array to hold information before it is written
-    to the current paint device (aka: d->device) */
+    to the current paint device (aka: device) */
     quint8* dstBytes = 0;
     try {
-         dstBytes = new quint8[srcWidth * srcHeight * d->device->pixelSize()];
+         dstBytes = new quint8[srcWidth * srcHeight * device->pixelSize()];
     } catch (std::bad_alloc) {
-        warnKrita << "KisPainter::bltFixed std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << d->device->pixelSize() << "total bytes";
+        warnKrita << "KisPainter::bltFixed std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << device->pixelSize() << "total bytes";
         return;
     }
-    d->device->readBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
+    device->readBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
 
     const quint8 *srcRowStart = srcDev->data() +
         (srcBounds.width() * (srcY - srcBounds.top()) + (srcX - srcBounds.left())) * srcDev->pixelSize();
 
-    d->paramInfo.dstRowStart   = dstBytes;
-    d->paramInfo.dstRowStride  = srcWidth * d->device->pixelSize();
-    d->paramInfo.srcRowStart   = srcRowStart;
-    d->paramInfo.srcRowStride  = srcBounds.width() * srcDev->pixelSize();
-    d->paramInfo.maskRowStart  = 0;
-    d->paramInfo.maskRowStride = 0;
-    d->paramInfo.rows          = srcHeight;
-    d->paramInfo.cols          = srcWidth;
-
-    if (d->selection) {
-        /* d->selection is a KisPaintDevice, so first a readBytes is performed to
+    paramInfo.dstRowStart   = dstBytes;
+    paramInfo.dstRowStride  = srcWidth * device->pixelSize();
+    paramInfo.srcRowStart   = srcRowStart;
+    paramInfo.srcRowStride  = srcBounds.width() * srcDev->pixelSize();
+    paramInfo.maskRowStart  = 0;
+    paramInfo.maskRowStride = 0;
+    paramInfo.rows          = srcHeight;
+    paramInfo.cols          = srcWidth;
+
+    if (selection) {
+        /* selection is a KisPaintDevice, so first a readBytes is performed to
         get the area of interest... */
-        KisPaintDeviceSP selectionProjection = d->selection->projection();
+        KisPaintDeviceSP selectionProjection = selection->projection();
         quint8* selBytes = 0;
         try {
             selBytes = new quint8[srcWidth * srcHeight * selectionProjection->pixelSize()];
@@ -945,18 +1073,16 @@ void KisPainter::bltFixed(qint32 dstX, qint32 dstY,
         }
 
         selectionProjection->readBytes(selBytes, dstX, dstY, srcWidth, srcHeight);
-        d->paramInfo.maskRowStart = selBytes;
-        d->paramInfo.maskRowStride = srcWidth * selectionProjection->pixelSize();
+        paramInfo.maskRowStart = selBytes;
+        paramInfo.maskRowStride = srcWidth * selectionProjection->pixelSize();
     }
 
     // ...and then blit.
-    d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
-    d->device->writeBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
+    colorSpace->bitBlt(srcDev->colorSpace(), paramInfo, compositeOp, renderingIntent, conversionFlags);
+    device->writeBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
 
-    delete[] d->paramInfo.maskRowStart;
+    delete[] paramInfo.maskRowStart;
     delete[] dstBytes;
-
-    addDirtyRect(QRect(dstX, dstY, srcWidth, srcHeight));
 }
 
 void KisPainter::bltFixed(const QPoint & pos, const KisFixedPaintDeviceSP srcDev, const QRect & srcRect)
@@ -995,37 +1121,69 @@ void KisPainter::bltFixedWithFixedSelection(qint32 dstX, qint32 dstY,
     Q_ASSERT(selBounds.contains(selRect));
     Q_UNUSED(selRect); // only used in above assertion
 
+    const QRect dstRect(dstX, dstY, srcWidth, srcHeight);
+
+    d->processInStripes(dstRect,
+        [&] (const QRect &rc) {
+            const int offset = rc.y() - dstY;
+            d->bltFixedWithFixedSelectionImpl(rc, srcDev, selection,
+                                              selX, selY + offset,
+                                              srcX, srcY + offset);
+        });
+
+    addDirtyRect(dstRect);
+}
+
+void KisPainter::Private::bltFixedWithFixedSelectionImpl(const QRect &dstRect,
+                                                         const KisFixedPaintDeviceSP srcDev,
+                                                         const KisFixedPaintDeviceSP selection,
+                                                         qint32 selX, qint32 selY,
+                                                         qint32 srcX, qint32 srcY)
+{
+    const qint32 dstX = dstRect.x();
+    const qint32 dstY = dstRect.y();
+    const qint32 srcWidth = dstRect.width();
+    const qint32 srcHeight = dstRect.height();
+    const QRect srcBounds = srcDev->bounds();
+    const QRect selBounds = selection->bounds();
+
+    /**
+     * The blit may be split into several stripes running
+     * concurrently, so use a local copy of the parameters
+     */
+    KoCompositeOp::ParameterInfo paramInfo(this->paramInfo);
+
     /* Create an intermediate byte array to hold information before it is written
-    to the current paint device (aka: d->device) */
+    to the current paint device (aka: device) */
     quint8* dstBytes = 0;
     try {
-        dstBytes = new quint8[srcWidth * srcHeight * d->device->pixelSize()];
+        dstBytes = new quint8[srcWidth * srcHeight * device->pixelSize()];
     } catch (std::bad_alloc) {
-        warnKrita << "KisPainter::bltFixedWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << d->device->pixelSize() << "total bytes";
+        warnKrita << "KisPainter::bltFixedWithFixedSelection std::bad_alloc for " << srcWidth << " * " << srcHeight << " * " << device->pixelSize() << "total bytes";
         return;
     }
-    d->device->readBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
+    device->readBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
 
     const quint8 *srcRowStart = srcDev->data() +
         (srcBounds.width() * (srcY - srcBounds.top()) + (srcX - srcBounds.left())) * srcDev->pixelSize();
     const quint8 *selRowStart = selection->data() +
         (selBounds.width() * (selY - selBounds.top()) + (selX - selBounds.left())) * selection->pixelSize();
 
-    if (!d->selection) {
+    if (!this->selection) {
         /* As there's nothing selected, blit to dstBytes (intermediary bit array),
-          ignoring d->selection (the user selection)*/
-        d->paramInfo.dstRowStart   = dstBytes;
-        d->paramInfo.dstRowStride  = srcWidth * d->device->pixelSize();
-        d->paramInfo.srcRowStart   = srcRowStart;
-        d->paramInfo.srcRowStride  = srcBounds.width() * srcDev->pixelSize();
-        d->paramInfo.maskRowStart  = selRowStart;
-        d->paramInfo.maskRowStride = selBounds.width() * selection->pixelSize();
-        d->paramInfo.rows          = srcHeight;
-        d->paramInfo.cols          = srcWidth;
-        d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+          ignoring this->selection (the user selection)*/
+        paramInfo.dstRowStart   = dstBytes;
+        paramInfo.dstRowStride  = srcWidth * device->pixelSize();
+        paramInfo.srcRowStart   = srcRowStart;
+        paramInfo.srcRowStride  = srcBounds.width() * srcDev->pixelSize();
+        paramInfo.maskRowStart  = selRowStart;
+        paramInfo.maskRowStride = selBounds.width() * selection->pixelSize();
+        paramInfo.rows          = srcHeight;
+        paramInfo.cols          = srcWidth;
+        colorSpace->bitBlt(srcDev->colorSpace(), paramInfo, compositeOp, renderingIntent, conversionFlags);
     }
     else {
-        /* Read the user selection (d->selection) bytes into an array, ready
+        /* Read the user selection (this->selection) bytes into an array, ready
         to merge in the next block*/
         quint32 totalBytes = srcWidth * srcHeight * selection->pixelSize();
         quint8 * mergedSelectionBytes = 0;
@@ -1036,36 +1194,34 @@ void KisPainter::bltFixedWithFixedSelection(qint32 dstX, qint32 dstY,
             delete[] dstBytes;
             return;
         }
-        d->selection->projection()->readBytes(mergedSelectionBytes, dstX, dstY, srcWidth, srcHeight);
+        this->selection->projection()->readBytes(mergedSelectionBytes, dstX, dstY, srcWidth, srcHeight);
 
         // Merge selections here by multiplying them - compositeOp(COMPOSITE_MULT)
-        d->paramInfo.dstRowStart   = mergedSelectionBytes;
-        d->paramInfo.dstRowStride  = srcWidth * selection->pixelSize();
-        d->paramInfo.srcRowStart   = selRowStart;
-        d->paramInfo.srcRowStride  = selBounds.width() * selection->pixelSize();
-        d->paramInfo.maskRowStart  = 0;
-        d->paramInfo.maskRowStride = 0;
-        d->paramInfo.rows          = srcHeight;
-        d->paramInfo.cols          = srcWidth;
-        KoColorSpaceRegistry::instance()->alpha8()->compositeOp(COMPOSITE_MULT)->composite(d->paramInfo);
+        paramInfo.dstRowStart   = mergedSelectionBytes;
+        paramInfo.dstRowStride  = srcWidth * selection->pixelSize();
+        paramInfo.srcRowStart   = selRowStart;
+        paramInfo.srcRowStride  = selBounds.width() * selection->pixelSize();
+        paramInfo.maskRowStart  = 0;
+        paramInfo.maskRowStride = 0;
+        paramInfo.rows          = srcHeight;
+        paramInfo.cols          = srcWidth;
+        KoColorSpaceRegistry::instance()->alpha8()->compositeOp(COMPOSITE_MULT)->composite(paramInfo);
 
         // Blit to dstBytes (intermediary bit array)
-        d->paramInfo.dstRowStart   = dstBytes;
-        d->paramInfo.dstRowStride  = srcWidth * d->device->pixelSize();
-        d->paramInfo.srcRowStart   = srcRowStart;
-        d->paramInfo.srcRowStride  = srcBounds.width() * srcDev->pixelSize();
-        d->paramInfo.maskRowStart  = mergedSelectionBytes;
-        d->paramInfo.maskRowStride = srcWidth * selection->pixelSize();
-        d->colorSpace->bitBlt(srcDev->colorSpace(), d->paramInfo, d->compositeOp, d->renderingIntent, d->conversionFlags);
+        paramInfo.dstRowStart   = dstBytes;
+        paramInfo.dstRowStride  = srcWidth * device->pixelSize();
+        paramInfo.srcRowStart   = srcRowStart;
+        paramInfo.srcRowStride  = srcBounds.width() * srcDev->pixelSize();
+        paramInfo.maskRowStart  = mergedSelectionBytes;
+        paramInfo.maskRowStride = srcWidth * selection->pixelSize();
+        colorSpace->bitBlt(srcDev->colorSpace(), paramInfo, compositeOp, renderingIntent, conversionFlags);
 
         delete[] mergedSelectionBytes;
     }
 
-    d->device->writeBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
+    device->writeBytes(dstBytes, dstX, dstY, srcWidth, srcHeight);
 
     delete[] dstBytes;
-
-    addDirtyRect(QRect(dstX, dstY, srcWidth, srcHeight));
 }
 
 void KisPainter::bltFixedWithFixedSelection(qint32 dstX, qint32 dstY,
@@ -2734,6 +2890,17 @@ void KisPainter::renderMirrorMaskSafe(QRect rc, KisPaintDeviceSP dab, int sx, in
     renderMirrorMask(rc, dab, sx, sy, maskToProcess);
 }
 
+void KisPainter::renderMirrorMaskSafe(QRect rc, KisFixedPaintDeviceSP dab, KisFixedPaintDeviceSP mask, bool preserveMask)
+{
+    if (!d->mirrorHorizontally && !d->mirrorVertically) return;
+
+    KisFixedPaintDeviceSP maskToProcess = mask;
+    if (preserveMask) {
+        maskToProcess = new KisFixedPaintDevice(*mask);
+    }
+    renderMirrorMask(rc, dab, maskToProcess);
+}
+
 void KisPainter::renderMirrorMask(QRect rc, KisFixedPaintDeviceSP dab)
 {
     int x = rc.topLeft().x();
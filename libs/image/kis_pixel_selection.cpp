@@ -38,6 +38,7 @@
 #include "kis_image.h"
 #include "kis_fill_painter.h"
 #include "kis_outline_generator.h"
+#include "kis_outline_tile_cache.h"
 #include <kis_iterator_ng.h>
 #include "kis_lod_transform.h"
 
@@ -49,6 +50,9 @@ struct Q_DECL_HIDDEN KisPixelSelection::Private {
     bool outlineCacheValid;
     QMutex outlineCacheMutex;
 
+    /// not shared with the copies, it keeps a snapshot of this device
+    KisOutlineTileCache outlineTileCache;
+
     bool thumbnailImageValid;
     QImage thumbnailImage;
     QTransform thumbnailImageTransform;
@@ -430,15 +434,32 @@ void KisPixelSelection::recalculateOutlineCache()
 
     m_d->outlineCache = QPainterPath();
 
-    Q_FOREACH (const QPolygon &polygon, outline()) {
+    QRect selectionExtent = selectedExactRect();
+    QRect clipRect;
+
+    /**
+     * The same limitation as in outline(): the area outside the image
+     * is not traced when the default pixel is selected
+     */
+    if (*defaultPixel().data() != MIN_SELECTED) {
+        selectionExtent &= defaultBounds()->bounds();
+        clipRect = selectionExtent;
+    }
+
+    /**
+     * The tile cache traces again only the tiles changed since the
+     * previous recalculation, so there is no need to track the dirty
+     * areas of the selection here.
+     */
+    const QVector<QPolygon> polygons =
+        m_d->outlineTileCache.outline(*this, selectionExtent, clipRect);
+
+    Q_FOREACH (const QPolygon &polygon, polygons) {
         m_d->outlineCache.addPolygon(polygon);
 
         /**
-         * The outline generation algorithm has a small bug, which
-         * results in the starting point be repeated twice in the
-         * beginning of the path, instead of being put to the
-         * end. Here we just explicitly close the path to workaround
-         * it.
+         * The polygons don't repeat the starting point in the end, so
+         * close the path explicitly.
          *
          * \see KisSelectionTest::testOutlineGeneration()
          */
@@ -19,17 +19,209 @@
 
 #include "kis_selection_filters.h"
 
+#include <algorithm>
+#include <limits>
+
+#include <QVector>
+#include <QtConcurrentMap>
+
 #include <klocalizedstring.h>
 
 #include <KoColorSpace.h>
 #include "kis_convolution_painter.h"
 #include "kis_convolution_kernel.h"
+#include "kis_global.h"
 #include "kis_pixel_selection.h"
+#include "kis_sequential_iterator.h"
+#include "kis_distance_transform.h"
+#include "kis_assert.h"
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define RINT(x) floor ((x) + 0.5)
 
+namespace {
+
+/**
+ * The vertical distances of the binary selections are stored as
+ * 16-bit values, so the larger radii are handled by the scanline code
+ */
+const qint32 MAX_BINARY_RADIUS = 0xfffe;
+
+/**
+ * The size of the chunks of rows processed by one job
+ */
+const int ROWS_CHUNK_SIZE = 64;
+
+/**
+ * The distance transform can be used only when every pixel is either
+ * fully selected or unselected. The soft selections need the maximum
+ * (minimum) of the neighbourhood, which the scanline code computes.
+ */
+bool isBinarySelection(KisPaintDeviceSP device, const QRect &rect)
+{
+    KisSequentialConstIterator it(device, rect);
+
+    int numPixels;
+    do {
+        numPixels = it.nConseqPixels();
+        const quint8 *pixels = it.rawDataConst();
+
+        for (int i = 0; i < numPixels; i++) {
+            if (pixels[i] != MIN_SELECTED && pixels[i] != MAX_SELECTED) {
+                return false;
+            }
+        }
+    } while (it.nextPixels(numPixels));
+
+    return true;
+}
+
+/**
+ * Grow the selected area of the binary selection, or shrink it if
+ * \p invert is true (which is the same as growing the unselected
+ * area). The result is the same as the one of the scanline code.
+ *
+ * The pixels outside the rect do not take part in growing, which is
+ * the same as repeating the edge pixels, because the edge pixels are
+ * always closer. If \p unselectedFrame is true, the selection is
+ * shrunk from the outside of the rect as well.
+ *
+ * The distance to the nearest selected pixel in every column is found
+ * in two linear scans over the whole rect, clamped by the vertical
+ * radius. Then every row is processed separately: the row pass of the
+ * distance transform (with the ellipse normalized to the unit circle)
+ * decides most of the pixels, all the points closer than
+ * innerThreshold belong to the neighbourhood, and all the points of
+ * the neighbourhood are closer than outerThreshold. Only the pixels
+ * in between are checked against the neighbourhood itself. Nothing
+ * here depends on the radius, except that check of the border pixels.
+ */
+void growBinarySelection(KisPixelSelectionSP pixelSelection, const QRect &rect,
+                         qint32 xRadius, qint32 yRadius, const qint32 *circ,
+                         bool invert, bool unselectedFrame)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(yRadius <= MAX_BINARY_RADIUS);
+
+    const int frame = unselectedFrame ? 1 : 0;
+    const int width = rect.width() + 2 * frame;
+    const int height = rect.height();
+
+    const quint16 noSelectedPixels = yRadius + 1;
+    const quint16 frameDistance = unselectedFrame ? 0 : noSelectedPixels;
+
+    // the vertical distance to the nearest selected pixel in the column
+    QVector<quint16> columnDistances(width * height);
+    quint16 *columnPtr = columnDistances.data();
+
+    {
+        QVector<quint8> row(rect.width());
+        QVector<quint16> prevRow(width, frameDistance);
+
+        for (int y = 0; y < height; y++) {
+            pixelSelection->readBytes(row.data(), rect.x(), rect.y() + y, rect.width(), 1);
+
+            quint16 *dst = columnPtr + y * width;
+
+            for (int x = 0; x < width; x++) {
+                const int srcX = x - frame;
+                const bool selected =
+                    srcX < 0 || srcX >= rect.width() ||
+                    (invert ? row[srcX] == MIN_SELECTED : row[srcX] == MAX_SELECTED);
+
+                dst[x] = selected ? 0 : qMin(prevRow[x] + 1, int(noSelectedPixels));
+            }
+
+            std::copy(dst, dst + width, prevRow.begin());
+        }
+
+        QVector<quint16> &nextRow = prevRow;
+        nextRow.fill(frameDistance);
+
+        for (int y = height - 1; y >= 0; y--) {
+            quint16 *dst = columnPtr + y * width;
+
+            for (int x = 0; x < width; x++) {
+                dst[x] = qMin(int(dst[x]), qMin(nextRow[x] + 1, int(noSelectedPixels)));
+            }
+
+            std::copy(dst, dst + width, nextRow.begin());
+        }
+    }
+
+    const qreal weightX = 1.0 / pow2(xRadius + 0.5);
+    const qreal weightY = 1.0 / pow2(yRadius + 0.5);
+
+    qreal innerThreshold = weightX * pow2(xRadius + 1);
+    qreal outerThreshold = 0.0;
+
+    for (int i = 0; i <= xRadius; i++) {
+        innerThreshold = qMin(innerThreshold, weightX * pow2(i) + weightY * pow2(circ[i] + 1));
+        outerThreshold = qMax(outerThreshold, weightX * pow2(i) + weightY * pow2(circ[i]));
+    }
+
+    // the distances are stored as floats
+    const qreal eps = 1e-4;
+    innerThreshold -= eps;
+    outerThreshold += eps;
+
+    QVector<quint8> result(rect.width() * height);
+    quint8 *resultPtr = result.data();
+
+    QVector<int> chunks;
+    for (int y = 0; y < height; y += ROWS_CHUNK_SIZE) {
+        chunks.append(y);
+    }
+
+    QtConcurrent::blockingMap(chunks,
+        [=] (int chunkTop) {
+            const qreal inf = std::numeric_limits<qreal>::infinity();
+
+            QVector<qreal> heights(width);
+            QVector<float> distances;
+
+            const int chunkBottom = qMin(chunkTop + ROWS_CHUNK_SIZE, height);
+
+            for (int y = chunkTop; y < chunkBottom; y++) {
+                const quint16 *rowPtr = columnPtr + y * width;
+
+                /**
+                 * The clamped distances are farther than any point
+                 * of the neighbourhood, so they are just skipped
+                 */
+                for (int x = 0; x < width; x++) {
+                    heights[x] = rowPtr[x] < noSelectedPixels ? weightY * pow2(qreal(rowPtr[x])) : inf;
+                }
+
+                KisDistanceTransform::computeRow(heights, weightX, &distances);
+
+                quint8 *dstPtr = resultPtr + y * rect.width();
+
+                for (int x = frame; x < width - frame; x++) {
+                    const float distance = distances[x];
+                    bool selected = false;
+
+                    if (distance < innerThreshold) {
+                        selected = true;
+                    } else if (distance <= outerThreshold) {
+                        const int left = qMax(x - xRadius, 0);
+                        const int right = qMin(x + xRadius, width - 1);
+
+                        for (int i = left; i <= right && !selected; i++) {
+                            selected = rowPtr[i] <= circ[qAbs(i - x)];
+                        }
+                    }
+
+                    dstPtr[x - frame] = selected != invert ? MAX_SELECTED : MIN_SELECTED;
+                }
+            }
+        });
+
+    pixelSelection->writeBytes(result.constData(), rect);
+}
+
+}
+
 KisSelectionFilter::~KisSelectionFilter()
 {
 }
@@ -529,6 +721,15 @@ void KisGrowSelectionFilter::process(KisPixelSelectionSP pixelSelection, const Q
 {
     if (m_xRadius <= 0 || m_yRadius <= 0) return;
 
+    if (m_yRadius <= MAX_BINARY_RADIUS && isBinarySelection(pixelSelection, rect)) {
+        QVector<qint32> circ(2 * m_xRadius + 1);
+        computeBorder(circ.data(), m_xRadius, m_yRadius);
+
+        growBinarySelection(pixelSelection, rect, m_xRadius, m_yRadius,
+                            circ.constData() + m_xRadius, false, false);
+        return;
+    }
+
     /**
         * Much code resembles Shrink filter, so please fix bugs
         * in both filters
@@ -656,6 +857,15 @@ void KisShrinkSelectionFilter::process(KisPixelSelectionSP pixelSelection, const
 {
     if (m_xRadius <= 0 || m_yRadius <= 0) return;
 
+    if (m_yRadius <= MAX_BINARY_RADIUS && isBinarySelection(pixelSelection, rect)) {
+        QVector<qint32> circ(2 * m_xRadius + 1);
+        computeBorder(circ.data(), m_xRadius, m_yRadius);
+
+        growBinarySelection(pixelSelection, rect, m_xRadius, m_yRadius,
+                            circ.constData() + m_xRadius, true, !m_edgeLock);
+        return;
+    }
+
     /*
         pretty much the same as fatten_region only different
         blame all bugs in this function on jaycox@gimp.org
@@ -18,6 +18,8 @@
 
 #include "kis_simple_stroke_strategy.h"
 
+#include "kis_trace.h"
+
 
 /***************************************************************/
 /*         private class: SimpleStrokeJobStrategy              */
@@ -34,6 +36,8 @@ public:
     }
 
     void run(KisStrokeJobData *data) override {
+        KIS_TRACE_SCOPE_DETAILED(jobTypeName(m_type), "stroke", m_parentStroke->id());
+
         switch(m_type) {
         case KisSimpleStrokeStrategy::JOB_INIT:
             Q_UNUSED(data);
@@ -61,6 +65,26 @@ public:
         }
     }
 
+private:
+    static const char* jobTypeName(KisSimpleStrokeStrategy::JobType type) {
+        switch(type) {
+        case KisSimpleStrokeStrategy::JOB_INIT:
+            return "initStrokeCallback";
+        case KisSimpleStrokeStrategy::JOB_FINISH:
+            return "finishStrokeCallback";
+        case KisSimpleStrokeStrategy::JOB_CANCEL:
+            return "cancelStrokeCallback";
+        case KisSimpleStrokeStrategy::JOB_DOSTROKE:
+            return "doStrokeCallback";
+        case KisSimpleStrokeStrategy::JOB_SUSPEND:
+            return "suspendStrokeCallback";
+        case KisSimpleStrokeStrategy::JOB_RESUME:
+            return "resumeStrokeCallback";
+        default:
+            return "unknown stroke job";
+        }
+    }
+
 private:
     KisSimpleStrokeStrategy::JobType m_type;
     KisSimpleStrokeStrategy *m_parentStroke;
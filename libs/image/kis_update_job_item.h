@@ -26,6 +26,7 @@
 #include "kis_spontaneous_job.h"
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
+#include "kis_trace.h"
 
 
 class KisUpdateJobItem :  public QObject, public QRunnable
@@ -63,6 +64,7 @@ public:
             runMergeJob();
         } else {
             Q_ASSERT(m_type == STROKE || m_type == SPONTANEOUS);
+            KIS_TRACE_SCOPE(m_type == STROKE ? "stroke job" : "spontaneous job", "updater");
             m_runnableJob->run();
             delete m_runnableJob;
             m_runnableJob = 0;
@@ -78,6 +80,7 @@ public:
 
     inline void runMergeJob() {
         Q_ASSERT(m_type == MERGE);
+        KIS_TRACE_SCOPE("merge job", "updater");
         // dbgKrita << "Executing merge job" << m_walker->changeRect()
         //          << "on thread" << QThread::currentThreadId();
         m_merger.startMerge(*m_walker);
@@ -59,6 +59,17 @@ public:
      */
     virtual QRect changedRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const = 0;
 
+    /**
+     * \return true if the result of the filter depends on the alpha
+     * channel of the source device only (and on the style itself), so
+     * the projection plane may keep the result and reuse it until the
+     * alpha channel changes. A change of the alpha must influence only
+     * the area returned by changedRect(), so the filters that depend on
+     * the bounds of the whole layer are not cacheable. Disabled effects have nothing to cache and
+     * return false. The default implementation returns false.
+     */
+    virtual bool isCacheable(KisPSDLayerStyleSP style) const;
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
@@ -26,6 +26,10 @@
 #include "kis_psd_layer_style.h"
 
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegion>
+
 #include "kis_painter.h"
 #include "kis_multiple_projection.h"
 
@@ -39,6 +43,16 @@ struct KisLayerStyleFilterProjectionPlane::Private
     QScopedPointer<KisLayerStyleFilterEnvironment> environment;
 
     KisMultipleProjection projection;
+
+    /**
+     * The area of the projection that is up-to-date with the alpha
+     * channel of the source. The snapshot of the alpha channel is
+     * shared by all the planes of the style, so it is kept by
+     * KisLayerStyleProjectionPlane, which reports the changes with
+     * invalidateCache() and resetCache().
+     */
+    QMutex cacheLock;
+    QRegion validRegion;
 };
 
 KisLayerStyleFilterProjectionPlane::
@@ -58,6 +72,8 @@ void KisLayerStyleFilterProjectionPlane::setStyle(KisLayerStyleFilter *filter, K
 {
     m_d->filter.reset(filter);
     m_d->style = style;
+
+    resetCache();
 }
 
 QRect KisLayerStyleFilterProjectionPlane::recalculate(const QRect& rect, KisNodeSP filthyNode)
@@ -69,15 +85,67 @@ QRect KisLayerStyleFilterProjectionPlane::recalculate(const QRect& rect, KisNode
         return QRect();
     }
 
-    m_d->projection.clear(rect);
-    m_d->filter->processDirectly(m_d->sourceLayer->projection(),
-                                 &m_d->projection,
-                                 rect,
-                                 m_d->style,
-                                 m_d->environment.data());
+    KisPaintDeviceSP src = m_d->sourceLayer->projection();
+
+    /**
+     * The cache is used for the full-size image only, the
+     * updates of the level of detail are cheap enough
+     */
+    if (m_d->environment->currentLevelOfDetail() > 0 || !isCacheable()) {
+        resetCache();
+
+        m_d->projection.clear(rect);
+        m_d->filter->processDirectly(src,
+                                     &m_d->projection,
+                                     rect,
+                                     m_d->style,
+                                     m_d->environment.data());
+        return rect;
+    }
+
+    QRegion dirtyRegion;
+
+    {
+        QMutexLocker l(&m_d->cacheLock);
+        dirtyRegion = QRegion(rect) - m_d->validRegion;
+        m_d->validRegion += dirtyRegion;
+    }
+
+    Q_FOREACH (const QRect &rc, dirtyRegion.rects()) {
+        m_d->projection.clear(rc);
+        m_d->filter->processDirectly(src,
+                                     &m_d->projection,
+                                     rc,
+                                     m_d->style,
+                                     m_d->environment.data());
+    }
+
     return rect;
 }
 
+bool KisLayerStyleFilterProjectionPlane::isCacheable() const
+{
+    return m_d->filter && m_d->filter->isCacheable(m_d->style);
+}
+
+void KisLayerStyleFilterProjectionPlane::invalidateCache(const QRegion &alphaChangedRegion)
+{
+    if (!isCacheable()) return;
+
+    QMutexLocker l(&m_d->cacheLock);
+
+    Q_FOREACH (const QRect &rc, alphaChangedRegion.rects()) {
+        m_d->validRegion -=
+            m_d->filter->changedRect(rc, m_d->style, m_d->environment.data());
+    }
+}
+
+void KisLayerStyleFilterProjectionPlane::resetCache()
+{
+    QMutexLocker l(&m_d->cacheLock);
+    m_d->validRegion = QRegion();
+}
+
 void KisLayerStyleFilterProjectionPlane::apply(KisPainter *painter, const QRect &rect)
 {
     m_d->projection.apply(painter->device(), rect);
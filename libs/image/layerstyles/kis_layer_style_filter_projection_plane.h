@@ -25,6 +25,8 @@
 
 #include "kis_types.h"
 
+class QRegion;
+
 
 class KisLayerStyleFilterProjectionPlane : public KisAbstractProjectionPlane
 {
@@ -43,6 +45,24 @@ public:
 
     KisPaintDeviceList getLodCapableDevices() const;
 
+    /**
+     * \return true if the plane keeps the results of the filter between
+     * the updates, see KisLayerStyleFilter::isCacheable()
+     */
+    bool isCacheable() const;
+
+    /**
+     * Drops the cached results that depend on the alpha channel of the
+     * source in \p alphaChangedRegion. The owner of the plane must report
+     * every change of the alpha before calling recalculate().
+     */
+    void invalidateCache(const QRegion &alphaChangedRegion);
+
+    /**
+     * Drops all the cached results of the filter
+     */
+    void resetCache();
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
@@ -18,7 +18,17 @@
 
 #include "kis_layer_style_projection_plane.h"
 
+#include <cstring>
+
+#include <QBitArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegion>
+
+#include <KoColorSpace.h>
+
 #include "kis_global.h"
+#include "kis_pixel_selection.h"
 #include "kis_layer_style_filter_projection_plane.h"
 #include "kis_psd_layer_style.h"
 
@@ -31,110 +41,237 @@
 
 struct Q_DECL_HIDDEN KisLayerStyleProjectionPlane::Private
 {
+    Private() : sourceLayer(0), layerOpacity(0) {}
+
     KisAbstractProjectionPlaneWSP sourceProjectionPlane;
 
     QVector<KisAbstractProjectionPlaneSP> stylesBefore;
     QVector<KisAbstractProjectionPlaneSP> stylesAfter;
 
     KisPSDLayerStyleSP style;
+
+    KisLayer *sourceLayer;
+    QVector<KisLayerStyleFilterProjectionPlane*> filterPlanes;
+
+    /**
+     * The snapshot of the alpha channel of the source the cached
+     * results of the filter planes are based on. It is shared by all
+     * the planes, so the source is compared with it only once per
+     * update. The rest of the parameters the filters depend on are
+     * stored as well; a change of any of them drops all the caches.
+     * Changing the style recreates the plane, so the style is not
+     * tracked.
+     *
+     * The filters read the alpha of the whole need rect of the area
+     * they process, but the snapshot records only the rects passed to
+     * recalculate(). \p recordedRegion is the part of the snapshot that
+     * holds the real alpha, the rest of it is considered to be changed.
+     */
+    QMutex cacheLock;
+    KisPixelSelectionSP alphaSnapshot;
+    QRegion recordedRegion;
+    QRect imageBounds;
+    quint8 layerOpacity;
+    QBitArray layerChannelFlags;
+
+    void addFilterPlane(QVector<KisAbstractProjectionPlaneSP> &styles, KisLayerStyleFilter *filter);
+    void resetCaches();
+    void updateCaches(const QRect &rect);
+    QRegion updateAlphaSnapshot(KisPaintDeviceSP src, const QRect &rect);
 };
 
-KisLayerStyleProjectionPlane::KisLayerStyleProjectionPlane(KisLayer *sourceLayer)
-    : m_d(new Private)
-{
-    KisPSDLayerStyleSP style = sourceLayer->layerStyle();
+/**
+ * The alpha channel of the source is compared with the snapshot in
+ * patches of the size of a tile
+ */
+static const int PATCH_SIZE = 64;
+static const int PATCH_SHIFT = 6;
 
-    KIS_ASSERT_RECOVER(style) {
-        style = toQShared(new KisPSDLayerStyle());
-    }
+void KisLayerStyleProjectionPlane::Private::addFilterPlane(QVector<KisAbstractProjectionPlaneSP> &styles, KisLayerStyleFilter *filter)
+{
+    KisLayerStyleFilterProjectionPlane *plane =
+        new KisLayerStyleFilterProjectionPlane(sourceLayer);
+    plane->setStyle(filter, style);
 
-    init(sourceLayer, style);
+    styles << toQShared(plane);
+    filterPlanes << plane;
 }
 
-// for testing purposes only!
-KisLayerStyleProjectionPlane::KisLayerStyleProjectionPlane(KisLayer *sourceLayer, KisPSDLayerStyleSP layerStyle)
-    : m_d(new Private)
+void KisLayerStyleProjectionPlane::Private::resetCaches()
 {
-    init(sourceLayer, layerStyle);
+    alphaSnapshot = 0;
+    recordedRegion = QRegion();
+
+    Q_FOREACH (KisLayerStyleFilterProjectionPlane *plane, filterPlanes) {
+        plane->resetCache();
+    }
 }
 
-void KisLayerStyleProjectionPlane::init(KisLayer *sourceLayer, KisPSDLayerStyleSP style)
+void KisLayerStyleProjectionPlane::Private::updateCaches(const QRect &rect)
 {
-    Q_ASSERT(sourceLayer);
-    m_d->sourceProjectionPlane = sourceLayer->internalProjectionPlane();
-    m_d->style = style;
+    KisPaintDeviceSP src = sourceLayer->projection();
 
-    {
-        KisLayerStyleFilterProjectionPlane *dropShadow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        dropShadow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow), style);
-        m_d->stylesBefore << toQShared(dropShadow);
-    }
+    QMutexLocker l(&cacheLock);
 
-    {
-        KisLayerStyleFilterProjectionPlane *innerShadow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        innerShadow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::InnerShadow), style);
-        m_d->stylesAfter << toQShared(innerShadow);
+    bool hasCacheablePlanes = false;
+    Q_FOREACH (KisLayerStyleFilterProjectionPlane *plane, filterPlanes) {
+        hasCacheablePlanes |= plane->isCacheable();
     }
 
-    {
-        KisLayerStyleFilterProjectionPlane *outerGlow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        outerGlow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::OuterGlow), style);
-        m_d->stylesAfter << toQShared(outerGlow);
-    }
+    /**
+     * The cache is used for the full-size image only, the
+     * updates of the level of detail are cheap enough
+     */
+    if (!hasCacheablePlanes ||
+        src->defaultBounds()->currentLevelOfDetail() > 0) {
 
-    {
-        KisLayerStyleFilterProjectionPlane *innerGlow =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        innerGlow->setStyle(new KisLsDropShadowFilter(KisLsDropShadowFilter::InnerGlow), style);
-        m_d->stylesAfter << toQShared(innerGlow);
+        if (alphaSnapshot) {
+            resetCaches();
+        }
+        return;
     }
 
-    {
-        KisLayerStyleFilterProjectionPlane *satin =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        satin->setStyle(new KisLsSatinFilter(), style);
-        m_d->stylesAfter << toQShared(satin);
-    }
+    const QRect newImageBounds = src->defaultBounds()->bounds();
+    const quint8 newLayerOpacity = sourceLayer->opacity();
+    const QBitArray &newLayerChannelFlags = sourceLayer->channelFlags();
+
+    if (!alphaSnapshot ||
+        imageBounds != newImageBounds ||
+        layerOpacity != newLayerOpacity ||
+        layerChannelFlags != newLayerChannelFlags) {
 
-    {
-        KisLayerStyleFilterProjectionPlane *colorOverlay =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        colorOverlay->setStyle(new KisLsOverlayFilter(KisLsOverlayFilter::Color), style);
-        m_d->stylesAfter << toQShared(colorOverlay);
+        resetCaches();
+        alphaSnapshot = new KisPixelSelection();
+        imageBounds = newImageBounds;
+        layerOpacity = newLayerOpacity;
+        layerChannelFlags = newLayerChannelFlags;
     }
 
-    {
-        KisLayerStyleFilterProjectionPlane *gradientOverlay =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        gradientOverlay->setStyle(new KisLsOverlayFilter(KisLsOverlayFilter::Gradient), style);
-        m_d->stylesAfter << toQShared(gradientOverlay);
+    /**
+     * Painting with color only does not change the alpha channel, so
+     * the results of the filters stay valid. The alpha of the source
+     * may change only inside the rect being updated, so only that rect
+     * is compared with the snapshot. Every patch where the alpha has
+     * changed invalidates the area it influences in every plane.
+     */
+    const QRegion changedAlpha = updateAlphaSnapshot(src, rect);
+
+    if (!changedAlpha.isEmpty()) {
+        Q_FOREACH (KisLayerStyleFilterProjectionPlane *plane, filterPlanes) {
+            plane->invalidateCache(changedAlpha);
+        }
     }
+}
+
+QRegion KisLayerStyleProjectionPlane::Private::updateAlphaSnapshot(KisPaintDeviceSP src, const QRect &rect)
+{
+    const KoColorSpace *cs = src->colorSpace();
+    const int pixelSize = cs->pixelSize();
+
+    QVector<quint8> srcBuffer(PATCH_SIZE * PATCH_SIZE * pixelSize);
+    QVector<quint8> alphaBuffer(PATCH_SIZE * PATCH_SIZE);
+    QVector<quint8> cachedBuffer(PATCH_SIZE * PATCH_SIZE);
+
+    QRegion changedRegion;
+
+    const int firstCol = rect.left() >> PATCH_SHIFT;
+    const int lastCol = rect.right() >> PATCH_SHIFT;
+    const int firstRow = rect.top() >> PATCH_SHIFT;
+    const int lastRow = rect.bottom() >> PATCH_SHIFT;
+
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int col = firstCol; col <= lastCol; col++) {
+            const QRect patchRect =
+                rect & QRect(col * PATCH_SIZE, row * PATCH_SIZE, PATCH_SIZE, PATCH_SIZE);
+
+            const int numPixels = patchRect.width() * patchRect.height();
+
+            src->readBytes(srcBuffer.data(), patchRect);
 
-    {
-        KisLayerStyleFilterProjectionPlane *patternOverlay =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        patternOverlay->setStyle(new KisLsOverlayFilter(KisLsOverlayFilter::Pattern), style);
-        m_d->stylesAfter << toQShared(patternOverlay);
+            const quint8 *srcPtr = srcBuffer.constData();
+            quint8 *alphaPtr = alphaBuffer.data();
+
+            for (int i = 0; i < numPixels; i++) {
+                *alphaPtr++ = cs->opacityU8(srcPtr);
+                srcPtr += pixelSize;
+            }
+
+            /**
+             * The filters might have used the alpha of a patch that has
+             * never been recorded, so its old value is unknown
+             */
+            bool changed = !(QRegion(patchRect) - recordedRegion).isEmpty();
+
+            if (!changed) {
+                alphaSnapshot->readBytes(cachedBuffer.data(), patchRect);
+                changed = memcmp(alphaBuffer.constData(), cachedBuffer.constData(), numPixels);
+            }
+
+            if (changed) {
+                alphaSnapshot->writeBytes(alphaBuffer.constData(), patchRect);
+                changedRegion += patchRect;
+            }
+        }
     }
 
-    {
-        KisLayerStyleFilterProjectionPlane *stroke =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        stroke->setStyle(new KisLsStrokeFilter(), style);
-        m_d->stylesAfter << toQShared(stroke);
+    recordedRegion += rect;
+
+    return changedRegion;
+}
+
+KisLayerStyleProjectionPlane::KisLayerStyleProjectionPlane(KisLayer *sourceLayer)
+    : m_d(new Private)
+{
+    KisPSDLayerStyleSP style = sourceLayer->layerStyle();
+
+    KIS_ASSERT_RECOVER(style) {
+        style = toQShared(new KisPSDLayerStyle());
     }
 
-    {
-        KisLayerStyleFilterProjectionPlane *bevelEmboss =
-            new KisLayerStyleFilterProjectionPlane(sourceLayer);
-        bevelEmboss->setStyle(new KisLsBevelEmbossFilter(), style);
-        m_d->stylesAfter << toQShared(bevelEmboss);
+    init(sourceLayer, style);
+}
+
+// for testing purposes only!
+KisLayerStyleProjectionPlane::KisLayerStyleProjectionPlane(KisLayer *sourceLayer, KisPSDLayerStyleSP layerStyle)
+    : m_d(new Private)
+{
+    init(sourceLayer, layerStyle);
+}
+
+// for testing purposes only!
+KisLayerStyleProjectionPlane::KisLayerStyleProjectionPlane(KisLayer *sourceLayer, KisPSDLayerStyleSP layerStyle,
+                                                           const QList<KisLayerStyleFilter*> &filters)
+    : m_d(new Private)
+{
+    Q_ASSERT(sourceLayer);
+    m_d->sourceProjectionPlane = sourceLayer->internalProjectionPlane();
+    m_d->style = layerStyle;
+    m_d->sourceLayer = sourceLayer;
+
+    Q_FOREACH (KisLayerStyleFilter *filter, filters) {
+        m_d->addFilterPlane(m_d->stylesAfter, filter);
     }
 }
 
+void KisLayerStyleProjectionPlane::init(KisLayer *sourceLayer, KisPSDLayerStyleSP style)
+{
+    Q_ASSERT(sourceLayer);
+    m_d->sourceProjectionPlane = sourceLayer->internalProjectionPlane();
+    m_d->style = style;
+    m_d->sourceLayer = sourceLayer;
+
+    m_d->addFilterPlane(m_d->stylesBefore, new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsDropShadowFilter(KisLsDropShadowFilter::InnerShadow));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsDropShadowFilter(KisLsDropShadowFilter::OuterGlow));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsDropShadowFilter(KisLsDropShadowFilter::InnerGlow));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsSatinFilter());
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsOverlayFilter(KisLsOverlayFilter::Color));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsOverlayFilter(KisLsOverlayFilter::Gradient));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsOverlayFilter(KisLsOverlayFilter::Pattern));
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsStrokeFilter());
+    m_d->addFilterPlane(m_d->stylesAfter, new KisLsBevelEmbossFilter());
+}
+
 KisLayerStyleProjectionPlane::~KisLayerStyleProjectionPlane()
 {
 }
@@ -150,6 +287,8 @@ QRect KisLayerStyleProjectionPlane::recalculate(const QRect& rect, KisNodeSP fil
     KisAbstractProjectionPlaneSP sourcePlane = m_d->sourceProjectionPlane.toStrongRef();
     QRect result = sourcePlane->recalculate(rect, filthyNode);
 
+    m_d->updateCaches(rect);
+
     Q_FOREACH (const KisAbstractProjectionPlaneSP plane, m_d->stylesBefore) {
         plane->recalculate(rect, filthyNode);
     }
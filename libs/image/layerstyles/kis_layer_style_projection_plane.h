@@ -21,12 +21,15 @@
 
 #include "kis_abstract_projection_plane.h"
 
+#include <QList>
 #include <QScopedPointer>
 
 #include "kis_types.h"
 
 #include <kritaimage_export.h>
 
+class KisLayerStyleFilter;
+
 
 class KRITAIMAGE_EXPORT KisLayerStyleProjectionPlane : public KisAbstractProjectionPlane
 {
@@ -50,6 +53,8 @@ public:
 private:
     friend class KisLayerStyleProjectionPlaneTest;
     KisLayerStyleProjectionPlane(KisLayer *sourceLayer, KisPSDLayerStyleSP style);
+    KisLayerStyleProjectionPlane(KisLayer *sourceLayer, KisPSDLayerStyleSP style,
+                                 const QList<KisLayerStyleFilter*> &filters);
 
     void init(KisLayer *sourceLayer, KisPSDLayerStyleSP layerStyle);
 
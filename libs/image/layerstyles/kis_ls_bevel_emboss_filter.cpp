@@ -491,3 +491,15 @@ QRect KisLsBevelEmbossFilter::changedRect(const QRect &rect, KisPSDLayerStyleSP
     BevelEmbossRectCalculator d(rect, w.config);
     return d.totalChangeRect(rect, w.config);
 }
+
+bool KisLsBevelEmbossFilter::isCacheable(KisPSDLayerStyleSP style) const
+{
+    const psd_layer_effects_bevel_emboss *config = style->bevelAndEmboss();
+
+    /**
+     * A texture aligned with the layer depends on the bounds of the
+     * whole layer, not only on the nearby alpha
+     */
+    return config->effectEnabled() &&
+        (!config->textureEnabled() || !config->textureAlignWithLayer());
+}
@@ -282,3 +282,8 @@ QRect KisLsDropShadowFilter::changedRect(const QRect &rect, KisPSDLayerStyleSP s
     return style->context()->keep_original ?
         d.finalChangeRect() : rect | d.finalChangeRect();
 }
+
+bool KisLsDropShadowFilter::isCacheable(KisPSDLayerStyleSP style) const
+{
+    return getShadowStruct(style)->effectEnabled();
+}
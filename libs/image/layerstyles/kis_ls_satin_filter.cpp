@@ -230,3 +230,8 @@ QRect KisLsSatinFilter::changedRect(const QRect &rect, KisPSDLayerStyleSP style,
     return style->context()->keep_original ?
         d.finalChangeRect() : rect | d.finalChangeRect();
 }
+
+bool KisLsSatinFilter::isCacheable(KisPSDLayerStyleSP style) const
+{
+    return style->satin()->effectEnabled();
+}
@@ -39,6 +39,8 @@ public:
 
     QRect neededRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const;
     QRect changedRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const;
+
+    bool isCacheable(KisPSDLayerStyleSP style) const;
 };
 
 #endif
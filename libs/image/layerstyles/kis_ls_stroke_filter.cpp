@@ -154,3 +154,15 @@ QRect KisLsStrokeFilter::changedRect(const QRect &rect, KisPSDLayerStyleSP style
     const int borderSize = w.config->size() + 1;
     return kisGrowRect(rect, borderSize);
 }
+
+bool KisLsStrokeFilter::isCacheable(KisPSDLayerStyleSP style) const
+{
+    const psd_layer_effects_stroke *config = style->stroke();
+
+    /**
+     * A pattern or gradient aligned with the layer depends on the
+     * bounds of the whole layer, not only on the nearby alpha
+     */
+    return config->effectEnabled() &&
+        (config->fillType() == psd_fill_solid_color || !config->alignWithLayer());
+}
@@ -60,7 +60,8 @@ struct KisColorizeMask::Private
           showColoring(true),
           needsUpdate(true),
           originalSequenceNumber(-1),
-          updateCompressor(1, KisSignalCompressor::POSTPONE)
+          updateCompressor(1, KisSignalCompressor::POSTPONE),
+          refinementCache(KisMultiwayCut::createRefinementCache())
     {
     }
 
@@ -74,7 +75,8 @@ struct KisColorizeMask::Private
           needsUpdate(false),
           originalSequenceNumber(-1),
           updateCompressor(1000, KisSignalCompressor::POSTPONE),
-          offset(rhs.offset)
+          offset(rhs.offset),
+          refinementCache(KisMultiwayCut::createRefinementCache())
     {
         Q_FOREACH (const KeyStroke &stroke, rhs.keyStrokes) {
             keyStrokes << KeyStroke(new KisPaintDevice(*stroke.dev), stroke.color, stroke.isTransparent);
@@ -101,6 +103,8 @@ struct KisColorizeMask::Private
 
     KisSignalCompressor updateCompressor;
     QPoint offset;
+
+    KisMultiwayCut::RefinementCacheSP refinementCache;
 };
 
 KisColorizeMask::KisColorizeMask()
@@ -280,6 +284,8 @@ void KisColorizeMask::slotUpdateRegenerateFilling()
             strategy->addKeyStroke(stroke.dev, color);
         }
 
+        strategy->setRefinementCache(m_d->refinementCache);
+
         connect(strategy, SIGNAL(sigFinished()), SLOT(slotRegenerationFinished()));
         KisStrokeId id = image->startStroke(strategy);
         image->endStroke(id);
@@ -32,6 +32,14 @@
 
 using namespace KisLazyFillTools;
 
+/**
+ * The coloring of smaller masks is fast enough without the
+ * approximation. For the larger ones the coarse-to-fine mode is used
+ * by default, its error is checked by the lazy brush tests on an image
+ * of this size.
+ */
+static const int MIN_COARSE_TO_FINE_AREA = 1024 * 1024;
+
 struct KisColorizeStrokeStrategy::Private
 {
     Private() : filteredSourceValid(false) {}
@@ -55,6 +63,12 @@ struct KisColorizeStrokeStrategy::Private
 
     QVector<KeyStroke> keyStrokes;
     KisNodeSP dirtyNode;
+
+    /**
+     * Not copied to the lod clones: they color a scaled down image
+     * and would only evict the patches of the original one
+     */
+    KisMultiwayCut::RefinementCacheSP refinementCache;
 };
 
 KisColorizeStrokeStrategy::KisColorizeStrokeStrategy(KisPaintDeviceSP src,
@@ -95,6 +109,11 @@ void KisColorizeStrokeStrategy::addKeyStroke(KisPaintDeviceSP dev, const KoColor
     m_d->keyStrokes << KeyStroke(dev, convertedColor);
 }
 
+void KisColorizeStrokeStrategy::setRefinementCache(KisMultiwayCut::RefinementCacheSP cache)
+{
+    m_d->refinementCache = cache;
+}
+
 void KisColorizeStrokeStrategy::initStrokeCallback()
 {
     if (!m_d->filteredSourceValid) {
@@ -115,6 +134,14 @@ void KisColorizeStrokeStrategy::initStrokeCallback()
 
     KisMultiwayCut cut(m_d->filteredSource, m_d->dst, m_d->boundingRect);
 
+    KisImageConfig cfg;
+    if (cfg.useCoarseToFineForColorizeMask() &&
+        m_d->boundingRect.width() * m_d->boundingRect.height() >= MIN_COARSE_TO_FINE_AREA) {
+
+        cut.setCoarseToFine(true);
+        cut.setRefinementCache(m_d->refinementCache);
+    }
+
     Q_FOREACH (const KeyStroke &stroke, m_d->keyStrokes) {
         cut.addKeyStroke(new KisPaintDevice(*stroke.dev), stroke.color);
     }
@@ -24,6 +24,7 @@
 
 #include "kis_types.h"
 #include <kis_simple_stroke_strategy.h>
+#include "kis_multiway_cut.h"
 
 class KoColor;
 
@@ -43,6 +44,12 @@ public:
 
     void addKeyStroke(KisPaintDeviceSP dev, const KoColor &color);
 
+    /**
+     * The cache of the refined patches shared between the colorings
+     * of the mask, see KisMultiwayCut::setRefinementCache()
+     */
+    void setRefinementCache(KisMultiwayCut::RefinementCacheSP cache);
+
     void initStrokeCallback();
 
     KisStrokeStrategy *createLodClone(int levelOfDetail);
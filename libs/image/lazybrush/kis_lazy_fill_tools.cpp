@@ -67,21 +67,20 @@ void normalizeAndInvertAlpha8Device(KisPaintDeviceSP dev, const QRect &rect)
                                    });
 }
 
-void cutOneWay(const KoColor &color,
-               KisPaintDeviceSP src,
-               KisPaintDeviceSP colorScribble,
-               KisPaintDeviceSP backgroundScribble,
-               KisPaintDeviceSP resultDevice,
-               KisPaintDeviceSP maskDevice,
-               const QRect &boundingRect)
+QVector<quint8> cutOneWayLabels(KisPaintDeviceSP src,
+                                KisPaintDeviceSP colorScribble,
+                                KisPaintDeviceSP backgroundScribble,
+                                KisPaintDeviceSP maskDevice,
+                                const QRect &boundingRect)
 {
     using namespace boost;
 
-    KIS_ASSERT_RECOVER_RETURN(src->pixelSize() == 1);
-    KIS_ASSERT_RECOVER_RETURN(colorScribble->pixelSize() == 1);
-    KIS_ASSERT_RECOVER_RETURN(backgroundScribble->pixelSize() == 1);
-    KIS_ASSERT_RECOVER_RETURN(maskDevice->pixelSize() == 1);
-    KIS_ASSERT_RECOVER_RETURN(*resultDevice->colorSpace() == *color.colorSpace());
+    QVector<quint8> labels;
+
+    KIS_ASSERT_RECOVER_RETURN_VALUE(src->pixelSize() == 1, labels);
+    KIS_ASSERT_RECOVER_RETURN_VALUE(colorScribble->pixelSize() == 1, labels);
+    KIS_ASSERT_RECOVER_RETURN_VALUE(backgroundScribble->pixelSize() == 1, labels);
+    KIS_ASSERT_RECOVER_RETURN_VALUE(maskDevice->pixelSize() == 1, labels);
 
     KisLazyFillCapacityMap capacityMap(src, colorScribble, backgroundScribble, maskDevice, boundingRect);
     KisLazyFillGraph &graph = capacityMap.graph();
@@ -112,20 +111,50 @@ void cutOneWay(const KoColor &color,
                                    t);
     Q_UNUSED(maxFlow);
 
-    KisSequentialIterator dstIt(resultDevice, graph.rect());
-    KisSequentialIterator mskIt(maskDevice, graph.rect());
+    const QRect rect = graph.rect();
+    labels.resize(rect.width() * rect.height());
+    quint8 *dst = labels.data();
+
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            KisLazyFillGraph::vertex_descriptor v(x, y);
+            long vertex_idx = get(boost::vertex_index, graph, v);
+            default_color_type label = groups[vertex_idx];
+
+            *dst++ = label == black_color ? 10 + (int(label) << 4) : 0;
+        }
+    }
+
+    return labels;
+}
+
+void cutOneWay(const KoColor &color,
+               KisPaintDeviceSP src,
+               KisPaintDeviceSP colorScribble,
+               KisPaintDeviceSP backgroundScribble,
+               KisPaintDeviceSP resultDevice,
+               KisPaintDeviceSP maskDevice,
+               const QRect &boundingRect)
+{
+    KIS_ASSERT_RECOVER_RETURN(*resultDevice->colorSpace() == *color.colorSpace());
+
+    const QVector<quint8> labels =
+        cutOneWayLabels(src, colorScribble, backgroundScribble, maskDevice, boundingRect);
+
+    KIS_ASSERT_RECOVER_RETURN(labels.size() == boundingRect.width() * boundingRect.height());
+
+    KisSequentialIterator dstIt(resultDevice, boundingRect);
+    KisSequentialIterator mskIt(maskDevice, boundingRect);
 
     const int pixelSize = resultDevice->pixelSize();
+    const quint8 *label = labels.constData();
 
     do {
-        KisLazyFillGraph::vertex_descriptor v(dstIt.x(), dstIt.y());
-        long vertex_idx = get(boost::vertex_index, graph, v);
-        default_color_type label = groups[vertex_idx];
-
-        if (label == black_color) {
+        if (*label) {
             memcpy(dstIt.rawData(), color.data(), pixelSize);
-            *mskIt.rawData() = 10 + (int(label) << 4);
+            *mskIt.rawData() = *label;
         }
+        label++;
     } while (dstIt.nextPixel() && mskIt.nextPixel());
 }
 
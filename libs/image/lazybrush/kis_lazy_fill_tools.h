@@ -55,6 +55,23 @@ namespace KisLazyFillTools
                    KisPaintDeviceSP maskDevice,
                    const QRect &boundingRect);
 
+    /**
+     * Runs the same cut as cutOneWay(), but doesn't touch any
+     * device. Instead, it returns the value cutOneWay() would write
+     * into \p maskDevice for every pixel of \p boundingRect, row by
+     * row. The value is non-zero for the pixels belonging to \p
+     * colorScribble and zero for all the other ones.
+     *
+     * The devices are only read, so several cuts may run
+     * concurrently on the same devices.
+     */
+    KRITAIMAGE_EXPORT
+    QVector<quint8> cutOneWayLabels(KisPaintDeviceSP src,
+                                    KisPaintDeviceSP colorScribble,
+                                    KisPaintDeviceSP backgroundScribble,
+                                    KisPaintDeviceSP maskDevice,
+                                    const QRect &boundingRect);
+
     /**
      * Returns one pixel from each connected component of \p src.
      *
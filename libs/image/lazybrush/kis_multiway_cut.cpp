@@ -18,6 +18,15 @@
 
 #include "kis_multiway_cut.h"
 
+#include <numeric>
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrentMap>
+
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 #include <KoColor.h>
@@ -26,13 +35,88 @@
 #include "kis_painter.h"
 #include "kis_lazy_fill_tools.h"
 #include "kis_sequential_iterator.h"
+#include "kis_global.h"
+#include "krita_utils.h"
 #include <floodfill/kis_scanline_fill.h>
 
 
 using namespace KisLazyFillTools;
 
+/**
+ * Parameters of the coarse-to-fine mode. The coarse graph has one
+ * vertex per COARSE_SCALE x COARSE_SCALE cell, the boundaries of the
+ * coarse cut are refined in the bands of BAND_RADIUS cells around
+ * them. The refinement is done in the patches of REFINE_PATCH_SIZE
+ * pixels, every patch is solved together with a REFINE_MARGIN-wide
+ * border of its neighbours.
+ */
+static const int COARSE_SCALE = 4;
+static const int COARSE_SHIFT = 2;
+static const int BAND_RADIUS = 2;
+static const int REFINE_PATCH_SIZE = 128;
+static const int REFINE_MARGIN = 16;
+
+
+struct KisMultiwayCut::RefinementCache
+{
+    RefinementCache() : generation(0) {}
+
+    struct Entry {
+        QVector<quint8> labels;
+        int generation;
+    };
+
+    QMutex lock;
+    QHash<QByteArray, Entry> entries;
+    int generation;
+
+    void beginRun() {
+        QMutexLocker l(&lock);
+        generation++;
+    }
+
+    bool fetch(const QByteArray &key, QVector<quint8> *labels) {
+        QMutexLocker l(&lock);
+
+        auto it = entries.find(key);
+        if (it == entries.end()) return false;
+
+        it->generation = generation;
+        *labels = it->labels;
+        return true;
+    }
+
+    void put(const QByteArray &key, const QVector<quint8> &labels) {
+        QMutexLocker l(&lock);
+
+        Entry entry;
+        entry.labels = labels;
+        entry.generation = generation;
+        entries.insert(key, entry);
+    }
+
+    /**
+     * Drop all the patches not used by the last run, so the cache
+     * never holds more than the bands of a single coloring
+     */
+    void endRun() {
+        QMutexLocker l(&lock);
+
+        auto it = entries.begin();
+        while (it != entries.end()) {
+            if (it->generation != generation) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
 struct KisMultiwayCut::Private
 {
+    Private() : coarseToFine(false), numReusedPatches(0), numSolvedPatches(0) {}
+
     KisPaintDeviceSP src;
     KisPaintDeviceSP dst;
     KisPaintDeviceSP mask;
@@ -40,7 +124,56 @@ struct KisMultiwayCut::Private
 
     QVector<KeyStroke> keyStrokes;
 
+    bool coarseToFine;
+    RefinementCacheSP refinementCache;
+
+    /// the statistics of the last run, the patches are refined concurrently
+    mutable QAtomicInt numReusedPatches;
+    mutable QAtomicInt numSolvedPatches;
+
+    struct CoarseLevel {
+        int width;
+        int height;
+
+        /// the darkest value of the cell, so that thin lines survive
+        QVector<quint8> src;
+        QVector<quint8> colorScribble;
+        QVector<quint8> backgroundScribble;
+        /// the cell is masked out only when all its pixels are
+        QVector<quint8> mask;
+        /// the cell should be refined whatever the coarse cut says
+        QVector<quint8> uncertain;
+    };
+
+    struct RefinementJob {
+        QRect patch;
+        QVector<quint8> labels;
+    };
+
     static void maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice, KisPaintDeviceSP mask, const QRect &boundingRect);
+
+    void cutOneWayCoarseToFine(const KoColor &color,
+                               KisPaintDeviceSP colorScribble,
+                               KisPaintDeviceSP backgroundScribble);
+
+    void downsampleRow(int row,
+                       KisPaintDeviceSP colorScribble,
+                       KisPaintDeviceSP backgroundScribble,
+                       CoarseLevel *level) const;
+
+    void refinePatch(RefinementJob *job,
+                     KisPaintDeviceSP colorScribble,
+                     KisPaintDeviceSP backgroundScribble,
+                     const CoarseLevel &level,
+                     const QVector<quint8> &coarseLabels,
+                     const QVector<quint8> &band) const;
+
+    void applyPatch(const RefinementJob &job, const KoColor &color) const;
+
+    inline int cellIndex(const CoarseLevel &level, int x, int y) const {
+        return ((y - boundingRect.y()) >> COARSE_SHIFT) * level.width +
+            ((x - boundingRect.x()) >> COARSE_SHIFT);
+    }
 };
 
 KisMultiwayCut::KisMultiwayCut(KisPaintDeviceSP src,
@@ -63,6 +196,31 @@ void KisMultiwayCut::addKeyStroke(KisPaintDeviceSP dev, const KoColor &color)
     m_d->keyStrokes << KeyStroke(dev, color);
 }
 
+KisMultiwayCut::RefinementCacheSP KisMultiwayCut::createRefinementCache()
+{
+    return RefinementCacheSP(new RefinementCache());
+}
+
+void KisMultiwayCut::setCoarseToFine(bool value)
+{
+    m_d->coarseToFine = value;
+}
+
+void KisMultiwayCut::setRefinementCache(RefinementCacheSP cache)
+{
+    m_d->refinementCache = cache;
+}
+
+int KisMultiwayCut::numReusedPatches() const
+{
+    return m_d->numReusedPatches.load();
+}
+
+int KisMultiwayCut::numSolvedPatches() const
+{
+    return m_d->numSolvedPatches.load();
+}
+
 
 void KisMultiwayCut::Private::maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice, KisPaintDeviceSP mask, const QRect &boundingRect)
 {
@@ -85,6 +243,327 @@ void KisMultiwayCut::Private::maskOutKeyStroke(KisPaintDeviceSP keyStrokeDevice,
     }
 }
 
+void KisMultiwayCut::Private::downsampleRow(int row,
+                                            KisPaintDeviceSP colorScribble,
+                                            KisPaintDeviceSP backgroundScribble,
+                                            CoarseLevel *level) const
+{
+    const QRect stripRect =
+        QRect(boundingRect.x(), boundingRect.y() + row * COARSE_SCALE,
+              boundingRect.width(), COARSE_SCALE) & boundingRect;
+
+    const int stripSize = stripRect.width() * stripRect.height();
+
+    QVector<quint8> srcStrip(stripSize);
+    QVector<quint8> colorStrip(stripSize);
+    QVector<quint8> backgroundStrip(stripSize);
+    QVector<quint8> maskStrip(stripSize);
+
+    src->readBytes(srcStrip.data(), stripRect);
+    colorScribble->readBytes(colorStrip.data(), stripRect);
+    backgroundScribble->readBytes(backgroundStrip.data(), stripRect);
+    mask->readBytes(maskStrip.data(), stripRect);
+
+    for (int column = 0; column < level->width; column++) {
+        const int left = column * COARSE_SCALE;
+        const int right = qMin(left + COARSE_SCALE, stripRect.width());
+
+        quint8 minSrc = 255;
+        quint8 maxColor = 0;
+        quint8 maxBackground = 0;
+        int numMasked = 0;
+
+        for (int y = 0; y < stripRect.height(); y++) {
+            const int rowOffset = y * stripRect.width();
+
+            for (int x = left; x < right; x++) {
+                const int i = rowOffset + x;
+
+                minSrc = qMin(minSrc, srcStrip[i]);
+                maxColor = qMax(maxColor, colorStrip[i]);
+                maxBackground = qMax(maxBackground, backgroundStrip[i]);
+                numMasked += maskStrip[i] > 0;
+            }
+        }
+
+        const int numPixels = (right - left) * stripRect.height();
+        const int index = row * level->width + column;
+
+        level->src[index] = minSrc;
+        level->colorScribble[index] = maxColor;
+        level->backgroundScribble[index] = maxBackground;
+        level->mask[index] = numMasked == numPixels ? 255 : 0;
+        level->uncertain[index] =
+            (numMasked > 0 && numMasked < numPixels) ||
+            (maxColor > 0 && maxBackground > 0);
+    }
+}
+
+void KisMultiwayCut::Private::refinePatch(RefinementJob *job,
+                                          KisPaintDeviceSP colorScribble,
+                                          KisPaintDeviceSP backgroundScribble,
+                                          const CoarseLevel &level,
+                                          const QVector<quint8> &coarseLabels,
+                                          const QVector<quint8> &band) const
+{
+    const QRect &patch = job->patch;
+    job->labels.resize(patch.width() * patch.height());
+
+    // the patches lie on the coarse grid, so checking one pixel per cell is enough
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!((patch.x() - boundingRect.x()) % COARSE_SCALE));
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!((patch.y() - boundingRect.y()) % COARSE_SCALE));
+
+    bool needsRefinement = false;
+
+    for (int y = patch.top(); y <= patch.bottom() && !needsRefinement; y += COARSE_SCALE) {
+        for (int x = patch.left(); x <= patch.right(); x += COARSE_SCALE) {
+            if (band[cellIndex(level, x, y)]) {
+                needsRefinement = true;
+                break;
+            }
+        }
+    }
+
+    if (!needsRefinement) {
+        quint8 *dst = job->labels.data();
+
+        for (int y = patch.top(); y <= patch.bottom(); y++) {
+            for (int x = patch.left(); x <= patch.right(); x++) {
+                *dst++ = coarseLabels[cellIndex(level, x, y)];
+            }
+        }
+        return;
+    }
+
+    /**
+     * Solve the patch together with a margin around it. All the
+     * pixels outside the band keep the label of the coarse cut: they
+     * are added to the corresponding scribble.
+     */
+    const QRect window = kisGrowRect(patch, REFINE_MARGIN) & boundingRect;
+    const int windowSize = window.width() * window.height();
+
+    QVector<quint8> colorBuf(windowSize);
+    QVector<quint8> backgroundBuf(windowSize);
+
+    colorScribble->readBytes(colorBuf.data(), window);
+    backgroundScribble->readBytes(backgroundBuf.data(), window);
+
+    for (int y = window.top(), i = 0; y <= window.bottom(); y++) {
+        for (int x = window.left(); x <= window.right(); x++, i++) {
+            const int cell = cellIndex(level, x, y);
+            if (band[cell]) continue;
+
+            if (coarseLabels[cell]) {
+                colorBuf[i] = 255;
+            } else {
+                backgroundBuf[i] = 255;
+            }
+        }
+    }
+
+    /**
+     * The result of the patch depends on nothing but the pixels of
+     * the window, so it can be reused by the next coloring if none of
+     * them has changed
+     */
+    QByteArray key;
+
+    if (refinementCache) {
+        QVector<quint8> srcBuf(windowSize);
+        QVector<quint8> maskBuf(windowSize);
+
+        src->readBytes(srcBuf.data(), window);
+        mask->readBytes(maskBuf.data(), window);
+
+        const int geometry[] = {patch.x(), patch.y(), patch.width(), patch.height(),
+                                window.x(), window.y(), window.width(), window.height()};
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(reinterpret_cast<const char*>(geometry), sizeof(geometry));
+        hash.addData(reinterpret_cast<const char*>(srcBuf.constData()), windowSize);
+        hash.addData(reinterpret_cast<const char*>(colorBuf.constData()), windowSize);
+        hash.addData(reinterpret_cast<const char*>(backgroundBuf.constData()), windowSize);
+        hash.addData(reinterpret_cast<const char*>(maskBuf.constData()), windowSize);
+        key = hash.result();
+
+        if (refinementCache->fetch(key, &job->labels)) {
+            numReusedPatches.ref();
+            return;
+        }
+    }
+
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+
+    KisPaintDeviceSP windowColorScribble = new KisPaintDevice(alpha8);
+    windowColorScribble->writeBytes(colorBuf.constData(), window);
+
+    KisPaintDeviceSP windowBackgroundScribble = new KisPaintDevice(alpha8);
+    windowBackgroundScribble->writeBytes(backgroundBuf.constData(), window);
+
+    const QVector<quint8> windowLabels =
+        cutOneWayLabels(src, windowColorScribble, windowBackgroundScribble, mask, window);
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(windowLabels.size() == windowSize);
+
+    numSolvedPatches.ref();
+
+    for (int y = 0; y < patch.height(); y++) {
+        memcpy(job->labels.data() + y * patch.width(),
+               windowLabels.constData() +
+               (patch.y() - window.y() + y) * window.width() +
+               patch.x() - window.x(),
+               patch.width());
+    }
+
+    if (refinementCache) {
+        refinementCache->put(key, job->labels);
+    }
+}
+
+void KisMultiwayCut::Private::applyPatch(const RefinementJob &job, const KoColor &color) const
+{
+    const QRect &patch = job.patch;
+    const int numPixels = patch.width() * patch.height();
+    const int pixelSize = dst->pixelSize();
+
+    QVector<quint8> maskBuf(numPixels);
+    QVector<quint8> dstBuf(numPixels * pixelSize);
+
+    mask->readBytes(maskBuf.data(), patch);
+    dst->readBytes(dstBuf.data(), patch);
+
+    bool changed = false;
+
+    for (int i = 0; i < numPixels; i++) {
+        if (job.labels[i] && !maskBuf[i]) {
+            memcpy(dstBuf.data() + i * pixelSize, color.data(), pixelSize);
+            maskBuf[i] = job.labels[i];
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        mask->writeBytes(maskBuf.constData(), patch);
+        dst->writeBytes(dstBuf.constData(), patch);
+    }
+}
+
+void KisMultiwayCut::Private::cutOneWayCoarseToFine(const KoColor &color,
+                                                    KisPaintDeviceSP colorScribble,
+                                                    KisPaintDeviceSP backgroundScribble)
+{
+    CoarseLevel level;
+    level.width = (boundingRect.width() + COARSE_SCALE - 1) >> COARSE_SHIFT;
+    level.height = (boundingRect.height() + COARSE_SCALE - 1) >> COARSE_SHIFT;
+
+    // the graph needs at least 3x3 vertices, small rects are cheap anyway
+    if (level.width < 3 || level.height < 3) {
+        KisLazyFillTools::cutOneWay(color, src, colorScribble, backgroundScribble,
+                                    dst, mask, boundingRect);
+        return;
+    }
+
+    const int numCells = level.width * level.height;
+    level.src.resize(numCells);
+    level.colorScribble.resize(numCells);
+    level.backgroundScribble.resize(numCells);
+    level.mask.resize(numCells);
+    level.uncertain.resize(numCells);
+
+    QVector<int> rows(level.height);
+    std::iota(rows.begin(), rows.end(), 0);
+
+    QtConcurrent::blockingMap(rows,
+        [&] (int row) {
+            downsampleRow(row, colorScribble, backgroundScribble, &level);
+        });
+
+    /**
+     * Solve the coarse graph
+     */
+    const QRect coarseRect(0, 0, level.width, level.height);
+    const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+
+    KisPaintDeviceSP coarseSrc = new KisPaintDevice(alpha8);
+    coarseSrc->writeBytes(level.src.constData(), coarseRect);
+
+    KisPaintDeviceSP coarseColorScribble = new KisPaintDevice(alpha8);
+    coarseColorScribble->writeBytes(level.colorScribble.constData(), coarseRect);
+
+    KisPaintDeviceSP coarseBackgroundScribble = new KisPaintDevice(alpha8);
+    coarseBackgroundScribble->writeBytes(level.backgroundScribble.constData(), coarseRect);
+
+    KisPaintDeviceSP coarseMask = new KisPaintDevice(alpha8);
+    coarseMask->writeBytes(level.mask.constData(), coarseRect);
+
+    const QVector<quint8> coarseLabels =
+        cutOneWayLabels(coarseSrc, coarseColorScribble, coarseBackgroundScribble,
+                        coarseMask, coarseRect);
+
+    KIS_SAFE_ASSERT_RECOVER_RETURN(coarseLabels.size() == numCells);
+
+    /**
+     * Find the band around the boundaries of the coarse cut
+     */
+    QVector<quint8> band(numCells, 0);
+
+    for (int y = 0; y < level.height; y++) {
+        for (int x = 0; x < level.width; x++) {
+            const int index = y * level.width + x;
+            const bool label = coarseLabels[index];
+
+            bool isBoundary = level.uncertain[index];
+
+            for (int dy = -1; dy <= 1 && !isBoundary; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    const int nx = x + dx;
+                    const int ny = y + dy;
+
+                    if (nx >= 0 && ny >= 0 && nx < level.width && ny < level.height &&
+                        bool(coarseLabels[ny * level.width + nx]) != label) {
+
+                        isBoundary = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!isBoundary) continue;
+
+            for (int by = qMax(0, y - BAND_RADIUS); by <= qMin(level.height - 1, y + BAND_RADIUS); by++) {
+                for (int bx = qMax(0, x - BAND_RADIUS); bx <= qMin(level.width - 1, x + BAND_RADIUS); bx++) {
+                    band[by * level.width + bx] = 1;
+                }
+            }
+        }
+    }
+
+    /**
+     * Refine the band at full resolution. The patches are solved
+     * concurrently, but applied only after all of them are ready,
+     * because the windows of the neighbouring patches overlap.
+     */
+    QVector<RefinementJob> jobs;
+
+    Q_FOREACH (const QRect &rc, KritaUtils::splitRectIntoPatches(boundingRect.translated(-boundingRect.topLeft()),
+                                                                QSize(REFINE_PATCH_SIZE, REFINE_PATCH_SIZE))) {
+        RefinementJob job;
+        job.patch = rc.translated(boundingRect.topLeft());
+        jobs << job;
+    }
+
+    QtConcurrent::blockingMap(jobs,
+        [&] (RefinementJob &job) {
+            refinePatch(&job, colorScribble, backgroundScribble, level, coarseLabels, band);
+        });
+
+    QtConcurrent::blockingMap(jobs,
+        [&] (const RefinementJob &job) {
+            applyPatch(job, color);
+        });
+}
+
 bool keyStrokesOrder(const KeyStroke &a, const KeyStroke &b)
 {
     const bool aTransparent = a.color.opacityU8() == OPACITY_TRANSPARENT_U8;
@@ -118,6 +597,13 @@ void KisMultiwayCut::run()
 
     std::stable_sort(m_d->keyStrokes.begin(), m_d->keyStrokes.end(), keyStrokesOrder);
 
+    m_d->numReusedPatches.store(0);
+    m_d->numSolvedPatches.store(0);
+
+    if (m_d->refinementCache) {
+        m_d->refinementCache->beginRun();
+    }
+
     while (m_d->keyStrokes.size() > 1) {
         KeyStroke current = m_d->keyStrokes.takeFirst();
 
@@ -139,13 +625,17 @@ void KisMultiwayCut::run()
             break;
         }
 
-        KisLazyFillTools::cutOneWay(current.color,
-                                    m_d->src,
-                                    current.dev,
-                                    other,
-                                    m_d->dst,
-                                    m_d->mask,
-                                    m_d->boundingRect);
+        if (m_d->coarseToFine) {
+            m_d->cutOneWayCoarseToFine(current.color, current.dev, other);
+        } else {
+            KisLazyFillTools::cutOneWay(current.color,
+                                        m_d->src,
+                                        current.dev,
+                                        other,
+                                        m_d->dst,
+                                        m_d->mask,
+                                        m_d->boundingRect);
+        }
 
         other->clear();
     }
@@ -165,6 +655,10 @@ void KisMultiwayCut::run()
             fill.fillColor(current.color, m_d->dst);
         }
     }
+
+    if (m_d->refinementCache) {
+        m_d->refinementCache->endRun();
+    }
 }
 
 KisPaintDeviceSP KisMultiwayCut::srcDevice() const
@@ -20,6 +20,7 @@
 #define __KIS_MULTIWAY_CUT_H
 
 #include <QScopedPointer>
+#include <QSharedPointer>
 
 #include "kis_types.h"
 #include "kritaimage_export.h"
@@ -28,6 +29,10 @@ class KoColor;
 
 class KRITAIMAGE_EXPORT KisMultiwayCut
 {
+public:
+    struct RefinementCache;
+    typedef QSharedPointer<RefinementCache> RefinementCacheSP;
+
 public:
     KisMultiwayCut(KisPaintDeviceSP src,
                    KisPaintDeviceSP dst,
@@ -36,6 +41,38 @@ public:
 
     void addKeyStroke(KisPaintDeviceSP dev, const KoColor &color);
 
+    /**
+     * In the coarse-to-fine mode every cut is solved on a graph
+     * downsampled 4 times first. Then only the bands around the
+     * boundaries of the coarse result are solved at full resolution,
+     * in patches, concurrently. All the other pixels get the labels of
+     * the coarse cut. The result is an approximation of the full cut,
+     * the boundaries may differ for the gaps in the lines narrower
+     * than the coarse cells.
+     *
+     * Disabled by default. The colorize mask enables it for the masks
+     * of one megapixel and larger, unless the user switched off
+     * KisImageConfig::useCoarseToFineForColorizeMask().
+     */
+    void setCoarseToFine(bool value);
+
+    /**
+     * The cache keeps the results of the refined patches between the
+     * consequent colorings of the same image, so when only a few key
+     * strokes change,
+     * only the patches around them are solved again. The cache is
+     * used in the coarse-to-fine mode only.
+     */
+    void setRefinementCache(RefinementCacheSP cache);
+    static RefinementCacheSP createRefinementCache();
+
+    /**
+     * The number of the patches of the last run() that were taken from
+     * the refinement cache and that were solved at full resolution
+     */
+    int numReusedPatches() const;
+    int numSolvedPatches() const;
+
     void run();
 
     KisPaintDeviceSP srcDevice() const;
@@ -27,6 +27,7 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpaceTraits.h>
+#include <KoBgrColorSpaceTraits.h>
 
 #include "kis_paint_device.h"
 #include "kis_convolution_painter.h"
@@ -437,4 +438,317 @@ void KisConvolutionPainterTest::testGaussianDetailsFFTW()
     testGaussianDetails(true);
 }
 
+/**
+ * The colors of the almost transparent pixels are not stable: tiny
+ * rounding errors of the alpha channel are amplified when the alpha
+ * is divided out. So compare the premultiplied values, measured in
+ * the units of the channel.
+ */
+template <class Traits>
+qreal maxPremultipliedDifference(KisPaintDeviceSP dev1, KisPaintDeviceSP dev2, const QRect &rc)
+{
+    typedef typename Traits::channels_type channels_type;
+    const qreal unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+
+    const int numPixels = rc.width() * rc.height();
+    QVector<quint8> data1(numPixels * Traits::pixelSize);
+    QVector<quint8> data2(numPixels * Traits::pixelSize);
+
+    dev1->readBytes(data1.data(), rc);
+    dev2->readBytes(data2.data(), rc);
+
+    qreal maxDifference = 0;
+
+    for (int i = 0; i < numPixels; i++) {
+        const channels_type *pixel1 = Traits::nativeArray(data1.constData() + i * Traits::pixelSize);
+        const channels_type *pixel2 = Traits::nativeArray(data2.constData() + i * Traits::pixelSize);
+
+        const qreal alpha1 = pixel1[Traits::alpha_pos];
+        const qreal alpha2 = pixel2[Traits::alpha_pos];
+
+        for (quint32 k = 0; k < Traits::channels_nb; k++) {
+            const qreal difference = int(k) == Traits::alpha_pos ?
+                qAbs(alpha1 - alpha2) :
+                qAbs(pixel1[k] * alpha1 - pixel2[k] * alpha2) / unitValue;
+
+            maxDifference = qMax(maxDifference, difference);
+        }
+    }
+
+    return maxDifference;
+}
+
+/**
+ * The integer channels are transformed in single precision by the
+ * FFT engine, unless the double precision is forced explicitly
+ */
+template <class Traits>
+void testFFTWPrecisionImpl(const KoColorSpace *cs)
+{
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> matrix(11, 15);
+    for (int y = 0; y < matrix.rows(); y++) {
+        for (int x = 0; x < matrix.cols(); x++) {
+            matrix(y, x) = 1 + (7 * x + 3 * y) % 5;
+        }
+    }
+    KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+
+    const QRect applyRect = dev->exactBounds().adjusted(-10, -10, 10, 10);
+
+    KisPaintDeviceSP spatialDev = new KisPaintDevice(cs);
+    KisConvolutionPainter spatialPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+    spatialPainter.applyMatrix(kernel, dev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+    KisPaintDeviceSP singleDev = new KisPaintDevice(cs);
+    KisConvolutionPainter singlePainter(singleDev, KisConvolutionPainter::FFTW);
+    singlePainter.applyMatrix(kernel, dev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+    KisPaintDeviceSP doubleDev = new KisPaintDevice(cs);
+    KisConvolutionPainter doublePainter(doubleDev, KisConvolutionPainter::FFTW_DOUBLE_PRECISION);
+    doublePainter.applyMatrix(kernel, dev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+    /**
+     * Every engine rounds the result to the nearest integer, so the
+     * color and the alpha may differ by one unit each, which gives at
+     * most two units in the premultiplied values. The error of the
+     * single precision transform itself must stay below that.
+     */
+    const qreal singleToDoubleTolerance = 2.0;
+    const qreal fftToSpatialTolerance = 2.0;
+
+    const qreal singleToDouble = maxPremultipliedDifference<Traits>(singleDev, doubleDev, applyRect);
+    QVERIFY2(singleToDouble <= singleToDoubleTolerance,
+             QString("Single and double precision FFT differ by %1").arg(singleToDouble).toLatin1());
+
+    const qreal singleToSpatial = maxPremultipliedDifference<Traits>(singleDev, spatialDev, applyRect);
+    QVERIFY2(singleToSpatial <= fftToSpatialTolerance,
+             QString("Single precision FFT and spatial convolution differ by %1").arg(singleToSpatial).toLatin1());
+
+    const qreal doubleToSpatial = maxPremultipliedDifference<Traits>(doubleDev, spatialDev, applyRect);
+    QVERIFY2(doubleToSpatial <= fftToSpatialTolerance,
+             QString("Double precision FFT and spatial convolution differ by %1").arg(doubleToSpatial).toLatin1());
+}
+
+void KisConvolutionPainterTest::testFFTWPrecisionU8()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    testFFTWPrecisionImpl<KoBgrU8Traits>(cs);
+}
+
+void KisConvolutionPainterTest::testFFTWPrecisionU16()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    testFFTWPrecisionImpl<KoBgrU16Traits>(cs);
+}
+
+void KisConvolutionPainterTest::testGaussianIIR()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    dev->fill(QRect(10, 10, 180, 120), KoColor(Qt::red, cs));
+    dev->fill(QRect(70, 40, 60, 150), KoColor(Qt::blue, cs));
+
+    KoColor c(Qt::green, cs);
+    c.setOpacity(quint8(100));
+    dev->fill(QRect(150, 0, 20, 200), c);
+
+    const QRect applyRect = dev->exactBounds().adjusted(-40, -40, 40, 40);
+
+    for (int radius = 10; radius <= 30; radius += 10) {
+        QList<KisConvolutionKernelSP> kernels;
+        kernels << KisGaussianKernel::createHorizontalKernel(radius);
+        kernels << KisGaussianKernel::createVerticalKernel(radius);
+
+        Q_FOREACH (KisConvolutionKernelSP kernel, kernels) {
+            KisPaintDeviceSP spatialDev = new KisPaintDevice(cs);
+            KisConvolutionPainter spatialPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+            spatialPainter.applyMatrix(kernel, dev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+            KisPaintDeviceSP iirDev = new KisPaintDevice(cs);
+            KisConvolutionPainter iirPainter(iirDev, KisConvolutionPainter::IIR);
+            iirPainter.applyMatrix(kernel, dev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+            const QImage spatialImage = spatialDev->convertToQImage(0, applyRect);
+            const QImage iirImage = iirDev->convertToQImage(0, applyRect);
+
+            /**
+             * Young-van Vliet filter only approximates the Gaussian.
+             * On the sharp edges of this image its error reaches 2%
+             * of the channel range, while on average it stays well
+             * below one level.
+             */
+            const int maxDifference = 5;
+            const qreal maxMeanDifference = 1.0;
+
+            QPoint errorPoint;
+            if (!TestUtil::compareQImages(errorPoint, spatialImage, iirImage, maxDifference, maxDifference)) {
+                spatialImage.save(QString("iir_spatial_%1x%2.png").arg(kernel->width()).arg(kernel->height()));
+                iirImage.save(QString("iir_recursive_%1x%2.png").arg(kernel->width()).arg(kernel->height()));
+                QFAIL(QString("The recursive Gaussian differs from the spatial one at (%1,%2)").arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+            }
+
+            qint64 totalDifference = 0;
+            for (int y = 0; y < spatialImage.height(); y++) {
+                const QRgb *spatialLine = reinterpret_cast<const QRgb*>(spatialImage.constScanLine(y));
+                const QRgb *iirLine = reinterpret_cast<const QRgb*>(iirImage.constScanLine(y));
+
+                for (int x = 0; x < spatialImage.width(); x++) {
+                    totalDifference += qAbs(qRed(spatialLine[x]) - qRed(iirLine[x]));
+                    totalDifference += qAbs(qGreen(spatialLine[x]) - qGreen(iirLine[x]));
+                    totalDifference += qAbs(qBlue(spatialLine[x]) - qBlue(iirLine[x]));
+                    totalDifference += qAbs(qAlpha(spatialLine[x]) - qAlpha(iirLine[x]));
+                }
+            }
+
+            const qreal meanDifference =
+                qreal(totalDifference) / (4 * spatialImage.width() * spatialImage.height());
+
+            QVERIFY2(meanDifference < maxMeanDifference,
+                     QString("Mean difference %1 for kernel %2x%3")
+                     .arg(meanDifference).arg(kernel->width()).arg(kernel->height()).toLatin1());
+        }
+    }
+}
+
+void KisConvolutionPainterTest::testSeparableKernelDetection()
+{
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> sobel(3, 3);
+    sobel << 1, 0, -1,
+             2, 0, -2,
+             1, 0, -1;
+
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> laplacian(3, 3);
+    laplacian << 0, -1, 0,
+                -1, 4, -1,
+                 0, -1, 0;
+
+    KisConvolutionKernelSP horizontal;
+    KisConvolutionKernelSP vertical;
+
+    QVERIFY(KisConvolutionKernel::separate(KisConvolutionKernel::fromMatrix(sobel, 0.5, 2), &horizontal, &vertical));
+    QCOMPARE(horizontal->width(), 3U);
+    QCOMPARE(horizontal->height(), 1U);
+    QCOMPARE(vertical->width(), 1U);
+    QCOMPARE(vertical->height(), 3U);
+
+    QCOMPARE(horizontal->offset() + vertical->offset(), 0.5);
+    QCOMPARE(horizontal->factor() * vertical->factor(), 2.0);
+
+    for (int y = 0; y < 3; y++) {
+        for (int x = 0; x < 3; x++) {
+            QCOMPARE((*vertical->data())(y, 0) * (*horizontal->data())(0, x), sobel(y, x));
+        }
+    }
+
+    QVERIFY(!KisConvolutionKernel::separate(KisConvolutionKernel::fromMatrix(laplacian, 0, 1), 0, 0));
+    QVERIFY(!KisConvolutionKernel::separate(KisGaussianKernel::createHorizontalKernel(5), 0, 0));
+}
+
+void KisConvolutionPainterTest::testSeparable()
+{
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    const QRect applyRect = referenceImage.rect();
+
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> sobel(3, 3);
+    sobel << 1, 0, -1,
+             2, 0, -2,
+             1, 0, -1;
+
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> box(5, 9);
+    box.fill(1.0);
+
+    QList<KisConvolutionKernelSP> kernels;
+    kernels << KisConvolutionKernel::fromMatrix(sobel, 0.5, 1);
+    kernels << KisConvolutionKernel::fromMatrix(box, 0, box.sum());
+
+    Q_FOREACH (KisConvolutionKernelSP kernel, kernels) {
+        KisPaintDeviceSP spatialDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+        spatialDev->convertFromQImage(referenceImage, 0, 0, 0);
+
+        KisConvolutionPainter spatialPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+        spatialPainter.applyMatrix(kernel, spatialDev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+        // the separable worker is also checked for filtering in place
+        KisPaintDeviceSP separableDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+        separableDev->convertFromQImage(referenceImage, 0, 0, 0);
+
+        KisConvolutionPainter separablePainter(separableDev, KisConvolutionPainter::SEPARABLE);
+        separablePainter.applyMatrix(kernel, separableDev, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+
+        const QImage spatialImage = spatialDev->convertToQImage(0, applyRect);
+        const QImage separableImage = separableDev->convertToQImage(0, applyRect);
+
+        QPoint errorPoint;
+        if (!TestUtil::compareQImages(errorPoint, spatialImage, separableImage, 1, 1)) {
+            spatialImage.save(QString("separable_spatial_%1x%2.png").arg(kernel->width()).arg(kernel->height()));
+            separableImage.save(QString("separable_result_%1x%2.png").arg(kernel->width()).arg(kernel->height()));
+            QFAIL(QString("The separable convolution differs from the spatial one at (%1,%2)").arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+        }
+    }
+}
+
+void KisConvolutionPainterTest::testSeparableGaussian()
+{
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    const QRect applyRect = referenceImage.rect();
+    const QRect changedRect(10, 10, 50, 50);
+
+    const qreal radius = 7.0;
+    KisConvolutionKernelSP horizontalKernel = KisGaussianKernel::createHorizontalKernel(radius);
+    KisConvolutionKernelSP verticalKernel = KisGaussianKernel::createVerticalKernel(radius);
+
+    /**
+     * The part of the device is changed inside the transaction, the
+     * convolution should read the original pixels there, like the
+     * spatial worker does
+     */
+    KisPaintDeviceSP spatialDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    spatialDev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    {
+        KisPaintDeviceSP interm = new KisPaintDevice(spatialDev->colorSpace());
+        const QPoint margin(0, (verticalKernel->height() + 1) / 2);
+        const QSize marginSize(0, 2 * margin.y());
+
+        KisConvolutionPainter horizPainter(interm, KisConvolutionPainter::SPATIAL);
+        horizPainter.applyMatrix(horizontalKernel, spatialDev,
+                                 applyRect.topLeft() - margin, applyRect.topLeft() - margin,
+                                 applyRect.size() + marginSize, BORDER_REPEAT);
+
+        KisConvolutionPainter verticalPainter(spatialDev, KisConvolutionPainter::SPATIAL);
+        verticalPainter.beginTransaction();
+        spatialDev->fill(changedRect, KoColor(Qt::green, spatialDev->colorSpace()));
+        verticalPainter.applyMatrix(verticalKernel, interm, applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+        verticalPainter.deleteTransaction();
+    }
+
+    KisPaintDeviceSP separableDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    separableDev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    {
+        KisConvolutionPainter painter(separableDev);
+        painter.beginTransaction();
+        separableDev->fill(changedRect, KoColor(Qt::green, separableDev->colorSpace()));
+        painter.applySeparableMatrix(horizontalKernel, verticalKernel, separableDev,
+                                     applyRect.topLeft(), applyRect.topLeft(), applyRect.size(), BORDER_REPEAT);
+        painter.deleteTransaction();
+    }
+
+    const QImage spatialImage = spatialDev->convertToQImage(0, applyRect);
+    const QImage separableImage = separableDev->convertToQImage(0, applyRect);
+
+    // the two-pass convolution rounds the intermediate result
+    QPoint errorPoint;
+    if (!TestUtil::compareQImages(errorPoint, spatialImage, separableImage, 1, 1)) {
+        spatialImage.save("separable_gaussian_spatial.png");
+        separableImage.save("separable_gaussian_result.png");
+        QFAIL(QString("The separable Gaussian differs from the spatial one at (%1,%2)").arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+    }
+}
+
 QTEST_MAIN(KisConvolutionPainterTest)
@@ -56,6 +56,15 @@ private Q_SLOTS:
 
     void testGaussianDetailsSpatial();
     void testGaussianDetailsFFTW();
+
+    void testFFTWPrecisionU8();
+    void testFFTWPrecisionU16();
+
+    void testGaussianIIR();
+
+    void testSeparableKernelDetection();
+    void testSeparable();
+    void testSeparableGaussian();
 };
 
 #endif
@@ -0,0 +1,379 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_distance_transform_test.h"
+
+#include <QTest>
+#include <cmath>
+#include <limits>
+
+#include "kis_distance_transform.h"
+#include "kis_selection_filters.h"
+#include "kis_pixel_selection.h"
+#include "kis_global.h"
+
+namespace {
+
+QVector<qint32> referenceCirc(qint32 xRadius, qint32 yRadius)
+{
+    QVector<qint32> circ(xRadius + 1);
+
+    for (int i = 0; i <= xRadius; i++) {
+        const qreal tmp = i > 0 ? i - 0.5 : 0.0;
+        circ[i] = qint32(floor(qreal(yRadius) / xRadius * sqrt(pow2(xRadius) - pow2(tmp)) + 0.5));
+    }
+
+    return circ;
+}
+
+/**
+ * Straightforward version of the scanline grow and shrink code, which
+ * computes the maximum (minimum) over the neighbourhood. Grow considers
+ * the rows outside the rect unselected and repeats the edge columns.
+ * Shrink repeats the edge pixels with the edge lock and considers the
+ * outside unselected without it.
+ */
+QVector<quint8> referenceGrowShrink(const QVector<quint8> &data, int width, int height,
+                                    qint32 xRadius, qint32 yRadius, bool grow, bool edgeLock)
+{
+    const QVector<qint32> circ = referenceCirc(xRadius, yRadius);
+    QVector<quint8> result(data.size());
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int value = grow ? MIN_SELECTED : MAX_SELECTED;
+
+            for (int i = -xRadius; i <= xRadius; i++) {
+                for (int dy = -circ[qAbs(i)]; dy <= circ[qAbs(i)]; dy++) {
+                    const int sx = x + i;
+                    const int sy = y + dy;
+                    quint8 pixel;
+
+                    if (grow) {
+                        pixel = sy >= 0 && sy < height ?
+                            data[sy * width + qBound(0, sx, width - 1)] : MIN_SELECTED;
+                    } else if (edgeLock) {
+                        pixel = data[qBound(0, sy, height - 1) * width + qBound(0, sx, width - 1)];
+                    } else {
+                        pixel = sx >= 0 && sx < width && sy >= 0 && sy < height ?
+                            data[sy * width + sx] : MIN_SELECTED;
+                    }
+
+                    value = grow ? qMax(value, int(pixel)) : qMin(value, int(pixel));
+                }
+            }
+
+            result[y * width + x] = value;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Straightforward version of the scanline border code: the density of
+ * the nearest transition pixel of every column of the neighbourhood.
+ * The edges of the rect are not handled, so the selection should not
+ * come to them closer than the radius.
+ */
+QVector<quint8> referenceBorder(const QVector<quint8> &data, int width, int height,
+                                qint32 xRadius, qint32 yRadius)
+{
+    QVector<quint8> transition(data.size());
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (data[y * width + x] < 128) continue;
+
+            for (int sy = qMax(y - 1, 0); sy <= qMin(y + 1, height - 1); sy++) {
+                for (int sx = qMax(x - 1, 0); sx <= qMin(x + 1, width - 1); sx++) {
+                    if (data[sy * width + sx] < 128) {
+                        transition[y * width + x] = MAX_SELECTED;
+                    }
+                }
+            }
+        }
+    }
+
+    QVector<quint8> result(data.size());
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            quint8 value = 0;
+
+            for (int sy = qMax(y - yRadius, 0); sy <= qMin(y + yRadius, height - 1); sy++) {
+                for (int sx = qMax(x - xRadius, 0); sx <= qMin(x + xRadius, width - 1); sx++) {
+                    if (!transition[sy * width + sx]) continue;
+
+                    const int dx = qAbs(sx - x);
+                    const int dy = qAbs(sy - y);
+                    const qreal tmpx = dx > 0 ? dx - 0.5 : 0.0;
+                    const qreal tmpy = dy > 0 ? dy - 0.5 : 0.0;
+                    const qreal dist = pow2(tmpy) / pow2(yRadius) + pow2(tmpx) / pow2(xRadius);
+
+                    if (dist < 1.0) {
+                        value = qMax(value, quint8(255 * (1.0 - sqrt(dist))));
+                    }
+                }
+            }
+
+            result[y * width + x] = value;
+        }
+    }
+
+    return result;
+}
+
+QVector<quint8> randomSelection(int width, int height, int margin, bool binary)
+{
+    const quint8 softValues[] = {0, 0, 0, 37, 128, 200, 255, 255};
+    QVector<quint8> data(width * height);
+
+    qsrand(2);
+
+    for (int y = margin; y < height - margin; y++) {
+        for (int x = margin; x < width - margin; x++) {
+            data[y * width + x] = binary ?
+                (qrand() % 3 ? MIN_SELECTED : MAX_SELECTED) :
+                softValues[qrand() % 8];
+        }
+    }
+
+    return data;
+}
+
+QVector<quint8> applyFilter(KisSelectionFilter *filter, const QVector<quint8> &data, const QRect &rect)
+{
+    KisPixelSelectionSP selection = new KisPixelSelection();
+    selection->writeBytes(data.constData(), rect);
+
+    filter->process(selection, rect);
+
+    QVector<quint8> result(data.size());
+    selection->readBytes(result.data(), rect);
+    return result;
+}
+
+bool compareBuffers(const QVector<quint8> &result, const QVector<quint8> &reference, int width, QString *error)
+{
+    for (int i = 0; i < result.size(); i++) {
+        if (result[i] != reference[i]) {
+            *error = QString("Pixel (%1,%2) is %3, expected %4")
+                .arg(i % width).arg(i / width).arg(result[i]).arg(reference[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+
+void KisDistanceTransformTest::testDistances()
+{
+    const int width = 97;
+    const int height = 71;
+
+    qsrand(1);
+
+    QVector<quint8> features(width * height);
+    QVector<QPoint> points;
+
+    for (int i = 0; i < 20; i++) {
+        QPoint pt(qrand() % width, qrand() % height);
+        features[pt.y() * width + pt.x()] = 1;
+        points << pt;
+    }
+
+    const qreal weightX = 0.25;
+    const qreal weightY = 1.5;
+
+    QVector<float> distances;
+    QVector<int> nearest;
+    KisDistanceTransform::compute(features, width, height, weightX, weightY, &distances, &nearest);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            qreal expected = std::numeric_limits<qreal>::max();
+
+            Q_FOREACH (const QPoint &pt, points) {
+                expected = qMin(expected, weightX * pow2(x - pt.x()) + weightY * pow2(y - pt.y()));
+            }
+
+            // the distances are stored as floats
+            const qreal tolerance = 1e-5 * qMax(1.0, expected);
+
+            const int index = y * width + x;
+            QVERIFY(qAbs(distances[index] - expected) < tolerance);
+
+            const int nx = nearest[index] % width;
+            const int ny = nearest[index] / width;
+            QVERIFY(features[nearest[index]]);
+            QVERIFY(qAbs(weightX * pow2(x - nx) + weightY * pow2(y - ny) - expected) < tolerance);
+        }
+    }
+}
+
+void KisDistanceTransformTest::testNoFeatures()
+{
+    QVector<quint8> features(10 * 10);
+
+    QVector<float> distances;
+    QVector<int> nearest;
+    KisDistanceTransform::compute(features, 10, 10, 1.0, 1.0, &distances, &nearest);
+
+    QCOMPARE(distances[55], std::numeric_limits<float>::infinity());
+    QCOMPARE(nearest[55], -1);
+}
+
+void KisDistanceTransformTest::testRow()
+{
+    const qreal inf = std::numeric_limits<qreal>::infinity();
+    const qreal weightX = 0.3;
+
+    QVector<qreal> heights(40, inf);
+    heights[3] = 2.0;
+    heights[4] = 0.0;
+    heights[20] = 7.5;
+    heights[31] = 1.0;
+
+    QVector<float> distances;
+    KisDistanceTransform::computeRow(heights, weightX, &distances);
+    QCOMPARE(distances.size(), heights.size());
+
+    for (int x = 0; x < heights.size(); x++) {
+        qreal expected = inf;
+        for (int i = 0; i < heights.size(); i++) {
+            expected = qMin(expected, weightX * pow2(x - i) + heights[i]);
+        }
+
+        QVERIFY(qAbs(distances[x] - expected) < 1e-4 * qMax(1.0, expected));
+    }
+
+    KisDistanceTransform::computeRow(QVector<qreal>(10, inf), weightX, &distances);
+    QCOMPARE(distances[5], std::numeric_limits<float>::infinity());
+}
+
+void KisDistanceTransformTest::testGrowShrinkRect()
+{
+    const QRect selectedRect(50, 60, 40, 30);
+    const QRect processRect(0, 0, 200, 200);
+
+    KisPixelSelectionSP selection = new KisPixelSelection();
+    selection->select(selectedRect);
+
+    KisGrowSelectionFilter grow(25, 10);
+    grow.process(selection, processRect);
+
+    // the corners are rounded, but the sides are grown exactly
+    QCOMPARE(selection->selectedExactRect(), selectedRect.adjusted(-25, -10, 25, 10));
+
+    // the closing of a convex shape is the shape itself
+    KisShrinkSelectionFilter shrink(25, 10, false);
+    shrink.process(selection, processRect);
+
+    QCOMPARE(selection->selectedExactRect(), selectedRect);
+
+    QVector<quint8> data(processRect.width() * processRect.height());
+    selection->readBytes(data.data(), processRect);
+
+    for (int y = 0; y < processRect.height(); y++) {
+        for (int x = 0; x < processRect.width(); x++) {
+            const quint8 expected = selectedRect.contains(x, y) ? MAX_SELECTED : MIN_SELECTED;
+            QCOMPARE(data[y * processRect.width() + x], expected);
+        }
+    }
+}
+
+void KisDistanceTransformTest::testGrowShrinkSoftSelection()
+{
+    const QRect rect(10, 20, 70, 60);
+    const QVector<quint8> data = randomSelection(rect.width(), rect.height(), 0, false);
+
+    QVector<QPoint> radii;
+    radii << QPoint(5, 3) << QPoint(2, 7) << QPoint(6, 6);
+
+    Q_FOREACH (const QPoint &radius, radii) {
+        QString error;
+
+        KisGrowSelectionFilter grow(radius.x(), radius.y());
+        QVERIFY2(compareBuffers(applyFilter(&grow, data, rect),
+                                referenceGrowShrink(data, rect.width(), rect.height(), radius.x(), radius.y(), true, false),
+                                rect.width(), &error), error.toLatin1());
+
+        KisShrinkSelectionFilter shrink(radius.x(), radius.y(), false);
+        QVERIFY2(compareBuffers(applyFilter(&shrink, data, rect),
+                                referenceGrowShrink(data, rect.width(), rect.height(), radius.x(), radius.y(), false, false),
+                                rect.width(), &error), error.toLatin1());
+
+        KisShrinkSelectionFilter shrinkEdgeLock(radius.x(), radius.y(), true);
+        QVERIFY2(compareBuffers(applyFilter(&shrinkEdgeLock, data, rect),
+                                referenceGrowShrink(data, rect.width(), rect.height(), radius.x(), radius.y(), false, true),
+                                rect.width(), &error), error.toLatin1());
+    }
+}
+
+void KisDistanceTransformTest::testGrowShrinkBinarySelection()
+{
+    // high enough to be split into several chunks of rows
+    const QRect rect(5, -3, 50, 300);
+    const QVector<quint8> data = randomSelection(rect.width(), rect.height(), 0, true);
+
+    QVector<QPoint> radii;
+    radii << QPoint(1, 1) << QPoint(4, 9) << QPoint(9, 2) << QPoint(3, 140);
+
+    Q_FOREACH (const QPoint &radius, radii) {
+        QString error;
+
+        KisGrowSelectionFilter grow(radius.x(), radius.y());
+        QVERIFY2(compareBuffers(applyFilter(&grow, data, rect),
+                                referenceGrowShrink(data, rect.width(), rect.height(), radius.x(), radius.y(), true, false),
+                                rect.width(), &error), error.toLatin1());
+
+        KisShrinkSelectionFilter shrink(radius.x(), radius.y(), false);
+        QVERIFY2(compareBuffers(applyFilter(&shrink, data, rect),
+                                referenceGrowShrink(data, rect.width(), rect.height(), radius.x(), radius.y(), false, false),
+                                rect.width(), &error), error.toLatin1());
+
+        KisShrinkSelectionFilter shrinkEdgeLock(radius.x(), radius.y(), true);
+        QVERIFY2(compareBuffers(applyFilter(&shrinkEdgeLock, data, rect),
+                                referenceGrowShrink(data, rect.width(), rect.height(), radius.x(), radius.y(), false, true),
+                                rect.width(), &error), error.toLatin1());
+    }
+}
+
+void KisDistanceTransformTest::testBorderSoftSelection()
+{
+    const QRect rect(0, 0, 70, 60);
+    const QVector<quint8> data = randomSelection(rect.width(), rect.height(), 8, false);
+
+    QVector<QPoint> radii;
+    radii << QPoint(4, 3) << QPoint(3, 6) << QPoint(6, 2);
+
+    Q_FOREACH (const QPoint &radius, radii) {
+        QString error;
+
+        KisBorderSelectionFilter border(radius.x(), radius.y());
+        QVERIFY2(compareBuffers(applyFilter(&border, data, rect),
+                                referenceBorder(data, rect.width(), rect.height(), radius.x(), radius.y()),
+                                rect.width(), &error), error.toLatin1());
+    }
+}
+
+QTEST_MAIN(KisDistanceTransformTest)
@@ -271,6 +271,7 @@ void KisGradientPainterTest::testSplitDisjointPaths()
 
 #include "kis_polygonal_gradient_shape_strategy.h"
 #include "kis_cached_gradient_shape_strategy.h"
+#include "kis_global.h"
 
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
@@ -334,4 +335,34 @@ void KisGradientPainterTest::testCachedStrategy()
     QVERIFY(maxError < 2 * maxRelError);
 }
 
+void KisGradientPainterTest::testCachedStrategyRows()
+{
+    QPolygonF selectionPolygon;
+    selectionPolygon << QPointF(100, 100);
+    selectionPolygon << QPointF(200, 120);
+    selectionPolygon << QPointF(170, 140);
+    selectionPolygon << QPointF(200, 180);
+    selectionPolygon << QPointF(30, 220);
+
+    QPainterPath selectionPath;
+    selectionPath.addPolygon(selectionPolygon);
+
+    QRect rc = selectionPolygon.boundingRect().toAlignedRect();
+
+    KisCachedGradientShapeStrategy cached(rc, 4, 4,
+        new KisPolygonalGradientShapeStrategy(selectionPath, 2.0));
+
+    // the rows also cover the area outside the cached rect
+    const QRect testRect = kisGrowRect(rc, 10);
+    QVector<double> values(testRect.width());
+
+    for (int y = testRect.y(); y <= testRect.bottom(); y++) {
+        cached.valuesAt(testRect.x(), y, testRect.width(), values.data());
+
+        for (int x = testRect.x(); x <= testRect.right(); x++) {
+            QCOMPARE(values[x - testRect.x()], cached.valueAt(x, y));
+        }
+    }
+}
+
 QTEST_MAIN(KisGradientPainterTest)
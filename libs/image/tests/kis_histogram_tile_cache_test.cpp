@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "kis_histogram_tile_cache_test.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_histogram_tile_cache.h"
+#include "kis_paint_device.h"
+#include "kis_sequential_iterator.h"
+
+
+static KisHistogramTileCache::Histogram
+calculateReference(KisPaintDeviceSP dev, const QRect &bounds)
+{
+    const KoColorSpace *cs = dev->colorSpace();
+    const int channelCount = cs->channelCount();
+
+    KisHistogramTileCache::Histogram histogram(channelCount, std::vector<quint32>(256));
+
+    KisSequentialConstIterator it(dev, bounds);
+    do {
+        const quint8 *pixel = it.rawDataConst();
+        if (cs->opacityU8(pixel) == OPACITY_TRANSPARENT_U8) continue;
+
+        for (int channel = 0; channel < channelCount; channel++) {
+            histogram[channel][cs->scaleToU8(pixel, channel)]++;
+        }
+    } while (it.nextPixel());
+
+    return histogram;
+}
+
+static void fillRandomly(KisPaintDeviceSP dev, const QRect &rc)
+{
+    const int pixelSize = dev->pixelSize();
+
+    KisSequentialIterator it(dev, rc);
+    do {
+        quint8 *pixel = it.rawData();
+        for (int i = 0; i < pixelSize; i++) {
+            pixel[i] = qrand() & 0xff;
+        }
+    } while (it.nextPixel());
+}
+
+static void testColorSpace(const KoColorSpace *cs)
+{
+    const QRect bounds(0, 0, 700, 500);
+
+    qsrand(1);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    fillRandomly(dev, QRect(50, 30, 400, 300));
+
+    KisHistogramTileCache cache;
+    QVERIFY(cache.update(dev, bounds) == calculateReference(dev, bounds));
+
+    // only the dirty area is rescanned
+    const QRect changedRect(300, 200, 300, 200);
+    fillRandomly(dev, changedRect);
+    cache.setDirty(changedRect);
+    QVERIFY(cache.update(dev, bounds) == calculateReference(dev, bounds));
+
+    // erasing makes the pixels not counted
+    const QRect erasedRect(100, 100, 150, 50);
+    dev->clear(erasedRect);
+    cache.setDirty(erasedRect);
+    QVERIFY(cache.update(dev, bounds) == calculateReference(dev, bounds));
+
+    // changing the bounds drops the cache
+    const QRect newBounds(0, 0, 400, 400);
+    QVERIFY(cache.update(dev, newBounds) == calculateReference(dev, newBounds));
+}
+
+void KisHistogramTileCacheTest::testU8()
+{
+    testColorSpace(KoColorSpaceRegistry::instance()->rgb8());
+}
+
+void KisHistogramTileCacheTest::testU16()
+{
+    testColorSpace(KoColorSpaceRegistry::instance()->rgb16());
+}
+
+void KisHistogramTileCacheTest::testGeneric()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(),
+                                                     Float32BitsColorDepthID.id(), 0);
+
+    if (!cs) {
+        QSKIP("F32 RGBA color space is not available");
+    }
+
+    const QRect bounds(0, 0, 300, 300);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(QRect(10, 10, 100, 100), KoColor(Qt::red, cs));
+    dev->fill(QRect(150, 50, 100, 200), KoColor(Qt::blue, cs));
+
+    KisHistogramTileCache cache;
+    QVERIFY(cache.update(dev, bounds) == calculateReference(dev, bounds));
+}
+
+QTEST_MAIN(KisHistogramTileCacheTest)
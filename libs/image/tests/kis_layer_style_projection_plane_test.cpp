@@ -19,9 +19,11 @@
 #include "kis_layer_style_projection_plane_test.h"
 
 #include <QTest>
+#include <QAtomicInt>
 
 #include "testutil.h"
 
+#include <KoID.h>
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
@@ -34,8 +36,12 @@
 
 #include "kis_selection.h"
 #include "kis_pixel_selection.h"
+#include "kis_global.h"
 
 #include "layerstyles/kis_layer_style_projection_plane.h"
+#include "layerstyles/kis_layer_style_filter.h"
+#include "layerstyles/kis_ls_drop_shadow_filter.h"
+#include "layerstyles/kis_ls_bevel_emboss_filter.h"
 #include "kis_psd_layer_style.h"
 #include "kis_paint_device_debug_utils.h"
 
@@ -496,4 +502,237 @@ void KisLayerStyleProjectionPlaneTest::testBevel()
     style->bevelAndEmboss()->setSoften(3);
     test(style, "bevel_pillow_up_soft");
 }
+
+/**
+ * Runs the wrapped filter and counts how many times it was run
+ */
+class CountingLayerStyleFilter : public KisLayerStyleFilter
+{
+public:
+    CountingLayerStyleFilter(KisLayerStyleFilter *filter)
+        : KisLayerStyleFilter(KoID(filter->id(), filter->id())),
+          numCalls(0),
+          m_filter(filter)
+    {
+    }
+
+    void processDirectly(KisPaintDeviceSP src,
+                         KisMultipleProjection *dst,
+                         const QRect &applyRect,
+                         KisPSDLayerStyleSP style,
+                         KisLayerStyleFilterEnvironment *env) const {
+        numCalls.ref();
+        m_filter->processDirectly(src, dst, applyRect, style, env);
+    }
+
+    QRect neededRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const {
+        return m_filter->neededRect(rect, style, env);
+    }
+
+    QRect changedRect(const QRect & rect, KisPSDLayerStyleSP style, KisLayerStyleFilterEnvironment *env) const {
+        return m_filter->changedRect(rect, style, env);
+    }
+
+    bool isCacheable(KisPSDLayerStyleSP style) const {
+        return m_filter->isCacheable(style);
+    }
+
+    mutable QAtomicInt numCalls;
+
+private:
+    QScopedPointer<KisLayerStyleFilter> m_filter;
+};
+
+static int numCalls(const QList<CountingLayerStyleFilter*> &filters)
+{
+    int result = 0;
+
+    Q_FOREACH (CountingLayerStyleFilter *filter, filters) {
+        result += filter->numCalls.load();
+    }
+
+    return result;
+}
+
+void KisLayerStyleProjectionPlaneTest::testCachedResults()
+{
+    KisPSDLayerStyleSP style(new KisPSDLayerStyle());
+    style->dropShadow()->setSize(15);
+    style->dropShadow()->setDistance(15);
+    style->dropShadow()->setOpacity(70);
+    style->dropShadow()->setEffectEnabled(true);
+
+    style->bevelAndEmboss()->setEffectEnabled(true);
+    style->bevelAndEmboss()->setStyle(psd_bevel_inner_bevel);
+    style->bevelAndEmboss()->setDepth(100);
+
+    const QRect imageRect(0, 0, 200, 200);
+    const QRect fillRect(10, 10, 100, 100);
+    const QRect colorRect(30, 30, 40, 40);
+    const QRect eraseRect(40, 40, 30, 30);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "styles test");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    {
+        KisPainter gc(layer->paintDevice());
+        gc.setPaintColor(KoColor(Qt::red, cs));
+        gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+        gc.paintEllipse(fillRect);
+    }
+
+    auto renderFreshPlane = [layer, style, imageRect] () {
+        QList<KisLayerStyleFilter*> filters;
+        filters << new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow);
+        filters << new KisLsBevelEmbossFilter();
+
+        KisLayerStyleProjectionPlane plane(layer.data(), style, filters);
+        plane.recalculate(imageRect, layer);
+
+        KisPaintDeviceSP projection = new KisPaintDevice(layer->colorSpace());
+        KisPainter painter(projection);
+        plane.apply(&painter, imageRect);
+
+        return projection;
+    };
+
+    QList<CountingLayerStyleFilter*> countingFilters;
+    countingFilters << new CountingLayerStyleFilter(new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow));
+    countingFilters << new CountingLayerStyleFilter(new KisLsBevelEmbossFilter());
+
+    QList<KisLayerStyleFilter*> filters;
+    Q_FOREACH (CountingLayerStyleFilter *filter, countingFilters) {
+        filters << filter;
+    }
+
+    KisLayerStyleProjectionPlane plane(layer.data(), style, filters);
+    plane.recalculate(imageRect, layer);
+
+    QCOMPARE(countingFilters[0]->numCalls.load(), 1);
+    QCOMPARE(countingFilters[1]->numCalls.load(), 1);
+
+    // the same update again, everything is cached
+    plane.recalculate(imageRect, layer);
+    QCOMPARE(numCalls(countingFilters), 2);
+
+    KisPaintDeviceSP projection = new KisPaintDevice(cs);
+
+    // change the color only, the alpha channel is not touched
+    {
+        KisPaintDeviceSP fillDevice = new KisPaintDevice(cs);
+        fillDevice->fill(colorRect, KoColor(Qt::blue, cs));
+
+        KisPainter gc(layer->paintDevice());
+        gc.setChannelFlags(cs->channelFlags(true, false));
+        gc.bitBlt(colorRect.topLeft(), fillDevice, colorRect);
+    }
+
+    {
+        const QRect changeRect = plane.changeRect(colorRect, KisLayer::N_FILTHY);
+        plane.recalculate(changeRect, layer);
+
+        KisPainter painter(projection);
+        plane.apply(&painter, imageRect);
+    }
+
+    QCOMPARE(numCalls(countingFilters), 2);
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, projection,
+                                          renderFreshPlane()));
+
+    // change the alpha channel of a part of the layer
+    layer->paintDevice()->clear(eraseRect);
+
+    {
+        const QRect changeRect = plane.changeRect(eraseRect, KisLayer::N_FILTHY);
+        plane.recalculate(changeRect, layer);
+
+        projection->clear();
+        KisPainter painter(projection);
+        plane.apply(&painter, imageRect);
+    }
+
+    QVERIFY(countingFilters[0]->numCalls.load() > 1);
+    QVERIFY(countingFilters[1]->numCalls.load() > 1);
+
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, projection,
+                                          renderFreshPlane()));
+}
+
+void KisLayerStyleProjectionPlaneTest::testCacheOutsideRecalculatedRect()
+{
+    KisPSDLayerStyleSP style(new KisPSDLayerStyle());
+    style->dropShadow()->setSize(15);
+    style->dropShadow()->setDistance(15);
+    style->dropShadow()->setOpacity(70);
+    style->dropShadow()->setEffectEnabled(true);
+
+    style->bevelAndEmboss()->setEffectEnabled(true);
+    style->bevelAndEmboss()->setStyle(psd_bevel_inner_bevel);
+    style->bevelAndEmboss()->setDepth(100);
+
+    const QRect imageRect(0, 0, 200, 200);
+    const QRect fillRect(10, 10, 100, 100);
+    const QRect updateRect(50, 50, 20, 20);
+    const QRect ringRect = kisGrowRect(updateRect, 10);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "styles test");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    {
+        KisPainter gc(layer->paintDevice());
+        gc.setPaintColor(KoColor(Qt::red, cs));
+        gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+        gc.paintEllipse(fillRect);
+    }
+
+    QList<KisLayerStyleFilter*> filters;
+    filters << new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow);
+    filters << new KisLsBevelEmbossFilter();
+
+    // only the small rect is recalculated, but the filters read the
+    // alpha channel around it
+    KisLayerStyleProjectionPlane plane(layer.data(), style, filters);
+    plane.recalculate(updateRect, layer);
+
+    // erase a ring just outside the recalculated rect
+    KisPaintDeviceSP dev = layer->paintDevice();
+    dev->clear(QRect(ringRect.left(), ringRect.top(), ringRect.width(), updateRect.top() - ringRect.top()));
+    dev->clear(QRect(ringRect.left(), updateRect.bottom() + 1, ringRect.width(), ringRect.bottom() - updateRect.bottom()));
+    dev->clear(QRect(ringRect.left(), updateRect.top(), updateRect.left() - ringRect.left(), updateRect.height()));
+    dev->clear(QRect(updateRect.right() + 1, updateRect.top(), ringRect.right() - updateRect.right(), updateRect.height()));
+
+    const QRect changeRect = plane.changeRect(ringRect, KisLayer::N_FILTHY);
+    plane.recalculate(changeRect, layer);
+
+    KisPaintDeviceSP projection = new KisPaintDevice(cs);
+    {
+        KisPainter painter(projection);
+        plane.apply(&painter, changeRect);
+    }
+
+    QList<KisLayerStyleFilter*> freshFilters;
+    freshFilters << new KisLsDropShadowFilter(KisLsDropShadowFilter::DropShadow);
+    freshFilters << new KisLsBevelEmbossFilter();
+
+    KisLayerStyleProjectionPlane freshPlane(layer.data(), style, freshFilters);
+    freshPlane.recalculate(imageRect, layer);
+
+    KisPaintDeviceSP freshProjection = new KisPaintDevice(cs);
+    {
+        KisPainter painter(freshProjection);
+        freshPlane.apply(&painter, changeRect);
+    }
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, projection, freshProjection));
+}
+
 QTEST_MAIN(KisLayerStyleProjectionPlaneTest)
@@ -46,6 +46,9 @@ private Q_SLOTS:
 
     void testBevel();
 
+    void testCachedResults();
+    void testCacheOutsideRecalculatedRect();
+
 private:
     void test(KisPSDLayerStyleSP style, const QString testName);
 };
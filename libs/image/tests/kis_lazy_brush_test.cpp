@@ -1399,5 +1399,183 @@ void KisLazyBrushTest::multiwayCutBenchmark()
 }
 
 
+#include "kis_sequential_iterator.h"
+
+struct MultiwayCutScene
+{
+    /**
+     * The scene is 512x512 pixels, \p scale makes it larger keeping
+     * the same shapes
+     */
+    MultiwayCutScene(int scale = 1)
+        : rect(0, 0, 512 * scale, 512 * scale)
+    {
+        const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
+        const KoColor fillColor(Qt::black, KoColorSpaceRegistry::instance()->rgb8());
+
+        KisPaintDeviceSP mainDev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+
+        QPainterPath path;
+        path.moveTo(100 * scale, 100 * scale);
+        path.lineTo(400 * scale, 100 * scale);
+        path.lineTo(400 * scale, 400 * scale);
+        path.lineTo(100 * scale, 400 * scale);
+        path.lineTo(100 * scale, 120 * scale);
+
+        KisFillPainter gc(mainDev);
+        gc.setPaintColor(fillColor);
+        gc.drawPainterPath(path, QPen(Qt::white, 10 * scale));
+
+        auto scaled = [scale] (const QRect &rc) {
+            return QRect(rc.topLeft() * scale, rc.size() * scale);
+        };
+
+        gc.fillRect(scaled(QRect(250, 100, 15, 120)), fillColor);
+        gc.fillRect(scaled(QRect(250, 280, 15, 120)), fillColor);
+        gc.fillRect(scaled(QRect(100, 250, 120, 15)), fillColor);
+        gc.fillRect(scaled(QRect(280, 250, 120, 15)), fillColor);
+
+        filteredMainDev = KisPainter::convertToAlphaAsAlpha(mainDev);
+        KisLazyFillTools::normalizeAndInvertAlpha8Device(filteredMainDev, rect);
+
+        const QRect strokeRects[] = {scaled(QRect(110, 110, 30, 30)),
+                                     scaled(QRect(370, 110, 20, 20)),
+                                     scaled(QRect(370, 370, 20, 20)),
+                                     scaled(QRect(110, 370, 20, 20)),
+                                     scaled(QRect(0, 0, 200, 20))};
+
+        const QColor strokeColors[] = {Qt::red, Qt::green, Qt::blue, Qt::yellow, Qt::transparent};
+
+        for (int i = 0; i < 5; i++) {
+            KisPaintDeviceSP dev = new KisPaintDevice(alpha8);
+            dev->fill(strokeRects[i], KoColor(Qt::black, alpha8));
+            strokes << dev;
+            colors << KoColor(strokeColors[i], mainDev->colorSpace());
+        }
+    }
+
+    KisPaintDeviceSP run(bool coarseToFine, KisMultiwayCut::RefinementCacheSP cache = KisMultiwayCut::RefinementCacheSP()) {
+        KisPaintDeviceSP result = new KisPaintDevice(colors.first().colorSpace());
+        numReusedPatches = 0;
+        numSolvedPatches = 0;
+
+        KisMultiwayCut cut(filteredMainDev, result, rect);
+        cut.setCoarseToFine(coarseToFine);
+        cut.setRefinementCache(cache);
+
+        // the cut modifies the key strokes, so pass the copies
+        for (int i = 0; i < strokes.size(); i++) {
+            cut.addKeyStroke(new KisPaintDevice(*strokes[i]), colors[i]);
+        }
+
+        cut.run();
+
+        numReusedPatches = cut.numReusedPatches();
+        numSolvedPatches = cut.numSolvedPatches();
+
+        return result;
+    }
+
+    QRect rect;
+    KisPaintDeviceSP filteredMainDev;
+    QVector<KisPaintDeviceSP> strokes;
+    QVector<KoColor> colors;
+
+    int numReusedPatches;
+    int numSolvedPatches;
+};
+
+int countDifferentPixels(KisPaintDeviceSP dev1, KisPaintDeviceSP dev2, const QRect &rect)
+{
+    KisSequentialConstIterator it1(dev1, rect);
+    KisSequentialConstIterator it2(dev2, rect);
+
+    const int pixelSize = dev1->pixelSize();
+    int numDifferent = 0;
+
+    do {
+        if (memcmp(it1.rawDataConst(), it2.rawDataConst(), pixelSize)) {
+            numDifferent++;
+        }
+    } while (it1.nextPixel() && it2.nextPixel());
+
+    return numDifferent;
+}
+
+void KisLazyBrushTest::testMultiwayCutCoarseToFine()
+{
+    MultiwayCutScene scene;
+
+    KisPaintDeviceSP exactResult = scene.run(false);
+    KisPaintDeviceSP coarseResult = scene.run(true);
+
+    const int numDifferent = countDifferentPixels(exactResult, coarseResult, scene.rect);
+
+    QVERIFY(numDifferent < scene.rect.width() * scene.rect.height() / 100);
+}
+
+void KisLazyBrushTest::testMultiwayCutCoarseToFineLargeImage()
+{
+    // the colorize mask uses the coarse-to-fine mode from one megapixel
+    MultiwayCutScene scene(2);
+    QCOMPARE(scene.rect.width() * scene.rect.height(), 1024 * 1024);
+
+    KisPaintDeviceSP exactResult = scene.run(false);
+    KisPaintDeviceSP coarseResult = scene.run(true);
+
+    const int numDifferent = countDifferentPixels(exactResult, coarseResult, scene.rect);
+
+    QVERIFY(numDifferent < scene.rect.width() * scene.rect.height() / 100);
+
+    // the regions separated by the lines must not leak into each other
+    const QPoint samplePoints[] = {QPoint(300, 300), QPoint(760, 300),
+                                   QPoint(300, 760), QPoint(760, 760),
+                                   QPoint(20, 1000)};
+
+    Q_FOREACH (const QPoint &pt, samplePoints) {
+        KoColor exactColor;
+        KoColor coarseColor;
+
+        exactResult->pixel(pt.x(), pt.y(), &exactColor);
+        coarseResult->pixel(pt.x(), pt.y(), &coarseColor);
+
+        QVERIFY(exactColor == coarseColor);
+    }
+}
+
+void KisLazyBrushTest::testMultiwayCutRefinementCache()
+{
+    MultiwayCutScene scene;
+    KisMultiwayCut::RefinementCacheSP cache = KisMultiwayCut::createRefinementCache();
+
+    KisPaintDeviceSP firstResult = scene.run(true, cache);
+
+    const int numFirstRunPatches = scene.numSolvedPatches + scene.numReusedPatches;
+    QVERIFY(scene.numSolvedPatches > 0);
+
+    // nothing has changed, all the patches come from the cache
+    KisPaintDeviceSP cachedResult = scene.run(true, cache);
+
+    QCOMPARE(scene.numReusedPatches, numFirstRunPatches);
+    QCOMPARE(scene.numSolvedPatches, 0);
+
+    QPoint pt;
+    QVERIFY(TestUtil::comparePaintDevices(pt, firstResult, cachedResult));
+
+    // change one key stroke, the reused patches should not be visible
+    scene.strokes[1]->fill(QRect(300, 150, 20, 20),
+                           KoColor(Qt::black, KoColorSpaceRegistry::instance()->alpha8()));
+
+    KisPaintDeviceSP updatedResult = scene.run(true, cache);
+
+    // only the patches around the changed stroke are solved again
+    QVERIFY(scene.numReusedPatches > 0);
+    QVERIFY(scene.numSolvedPatches > 0);
+
+    KisPaintDeviceSP freshResult = scene.run(true);
+
+    QVERIFY(TestUtil::comparePaintDevices(pt, updatedResult, freshResult));
+}
+
 
 QTEST_MAIN(KisLazyBrushTest)
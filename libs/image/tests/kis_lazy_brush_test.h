@@ -39,6 +39,10 @@ private Q_SLOTS:
 
     void testEstimateTransparentPixels();
 
+    void testMultiwayCutCoarseToFine();
+    void testMultiwayCutCoarseToFineLargeImage();
+    void testMultiwayCutRefinementCache();
+
     void multiwayCutBenchmark();
 };
 
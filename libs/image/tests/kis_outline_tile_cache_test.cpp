@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_outline_tile_cache_test.h"
+
+#include <QTest>
+#include <QPainterPath>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_outline_tile_cache.h"
+#include "kis_pixel_selection.h"
+#include "kis_transaction.h"
+
+
+static QPainterPath toPath(const QVector<QPolygon> &polygons)
+{
+    QPainterPath path;
+
+    Q_FOREACH (const QPolygon &polygon, polygons) {
+        path.addPolygon(polygon);
+        path.closeSubpath();
+    }
+
+    return path;
+}
+
+/**
+ * Check that the center of every pixel of \p rect is inside the
+ * outline if and only if the pixel is selected
+ */
+static bool checkOutline(KisPaintDeviceSP dev, const QVector<QPolygon> &polygons,
+                         const QRect &rect, const QRect &clipRect = QRect())
+{
+    const QPainterPath path = toPath(polygons);
+
+    QVector<quint8> pixels(rect.width() * rect.height());
+    dev->readBytes(pixels.data(), rect);
+
+    const quint8 *ptr = pixels.constData();
+
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++, ptr++) {
+            const bool selected = *ptr && (clipRect.isEmpty() || clipRect.contains(x, y));
+
+            if (path.contains(QPointF(x + 0.5, y + 0.5)) != selected) {
+                qDebug() << "Outline mismatch at" << x << y << "selected:" << selected;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void selectPattern(KisPixelSelectionSP dev)
+{
+    // a frame with a hole, crossing the borders of the tiles
+    dev->select(QRect(20, 30, 150, 100), 200);
+    dev->clear(QRect(60, 60, 50, 40));
+
+    // an island inside the hole
+    dev->select(QRect(75, 70, 10, 10));
+
+    // pixels touching diagonally
+    dev->select(QRect(190, 10, 1, 1));
+    dev->select(QRect(191, 11, 1, 1));
+    dev->select(QRect(192, 10, 1, 1));
+
+    // a checkerboard on the border of the tiles
+    for (int y = 120; y < 136; y++) {
+        for (int x = 184; x < 200; x++) {
+            if ((x + y) & 1) {
+                dev->select(QRect(x, y, 1, 1), 1);
+            }
+        }
+    }
+
+    // pixels in the negative coordinates
+    dev->select(QRect(-70, -10, 40, 5));
+}
+
+void KisOutlineTileCacheTest::testOutline()
+{
+    KisPixelSelectionSP dev = new KisPixelSelection();
+    selectPattern(dev);
+
+    KisOutlineTileCache cache;
+    QVector<QPolygon> polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+
+    QVERIFY(!polygons.isEmpty());
+    QCOMPARE(toPath(polygons).boundingRect(), QRectF(dev->exactBounds()));
+    QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+
+    // all the points are corners, no collinear ones
+    Q_FOREACH (const QPolygon &polygon, polygons) {
+        const int size = polygon.size();
+        QVERIFY(size >= 4);
+
+        for (int i = 0; i < size; i++) {
+            const QPoint prev = polygon[(i + size - 1) % size];
+            const QPoint next = polygon[(i + 1) % size];
+            QVERIFY(prev.x() != next.x() && prev.y() != next.y());
+        }
+    }
+
+    // the generator without the tile cache gives the same shape
+    QCOMPARE(toPath(polygons).boundingRect(), toPath(dev->outline()).boundingRect());
+
+    dev->clear();
+    polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(polygons.isEmpty());
+}
+
+void KisOutlineTileCacheTest::testIncrementalUpdate()
+{
+    KisPixelSelectionSP dev = new KisPixelSelection();
+    selectPattern(dev);
+
+    KisOutlineTileCache cache;
+    cache.outline(*dev, dev->exactBounds(), QRect());
+
+    // change a single tile, and then the pixels of a tile border
+    dev->clear(QRect(130, 35, 20, 20));
+    QVector<QPolygon> polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+
+    dev->select(QRect(64, 20, 1, 20));
+    dev->clear(QRect(127, 64, 2, 2));
+    polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+
+    // extend the selection to the new tiles
+    dev->select(QRect(250, 250, 100, 10));
+    polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+
+    KisOutlineTileCache freshCache;
+    QCOMPARE(toPath(polygons).boundingRect(),
+             toPath(freshCache.outline(*dev, dev->exactBounds(), QRect())).boundingRect());
+
+    // shrink it back
+    dev->clear(QRect(-100, -100, 200, 400));
+    polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(checkOutline(dev, polygons, QRect(-100, -100, 500, 500)));
+}
+
+void KisOutlineTileCacheTest::testClipRect()
+{
+    KisPixelSelectionSP dev = new KisPixelSelection();
+    dev->setDefaultPixel(KoColor(QColor(255, 255, 255), dev->colorSpace()));
+    dev->clear(QRect(40, 40, 30, 30));
+
+    const QRect clipRect(10, 20, 100, 90);
+
+    KisOutlineTileCache cache;
+    QVector<QPolygon> polygons = cache.outline(*dev, clipRect, clipRect);
+
+    QCOMPARE(toPath(polygons).boundingRect(), QRectF(clipRect));
+    QVERIFY(checkOutline(dev, polygons, clipRect.adjusted(-3, -3, 3, 3), clipRect));
+}
+
+void KisOutlineTileCacheTest::testReplacedTiles()
+{
+    KisPixelSelectionSP dev = new KisPixelSelection();
+    selectPattern(dev);
+
+    KisOutlineTileCache cache;
+    const QVector<QPolygon> originalPolygons = cache.outline(*dev, dev->exactBounds(), QRect());
+
+    // undo puts the old tiles back into the data manager
+    {
+        KisTransaction transaction(dev);
+        dev->clear(QRect(0, 0, 128, 128));
+
+        QVector<QPolygon> polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+        QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+
+        transaction.revert();
+    }
+
+    QVector<QPolygon> polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+    QCOMPARE(toPath(polygons).boundingRect(), toPath(originalPolygons).boundingRect());
+
+    // moving the device keeps all the tiles
+    dev->setX(10);
+    dev->setY(-3);
+
+    polygons = cache.outline(*dev, dev->exactBounds(), QRect());
+    QVERIFY(checkOutline(dev, polygons, dev->exactBounds().adjusted(-2, -2, 2, 2)));
+    QCOMPARE(toPath(polygons).boundingRect(), QRectF(dev->exactBounds()));
+}
+
+QTEST_MAIN(KisOutlineTileCacheTest)
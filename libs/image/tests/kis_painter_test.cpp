@@ -479,6 +479,161 @@ void KisPainterTest::testBitBltOldData()
     srcGc.deleteTransaction();
 }
 
+namespace {
+
+KisFixedPaintDeviceSP createRandomFixedDevice(const KoColorSpace *cs, const QRect &rc)
+{
+    KisFixedPaintDeviceSP dev = new KisFixedPaintDevice(cs);
+    dev->setRect(rc);
+    dev->initialize();
+
+    quint8 *data = dev->data();
+    const int numBytes = rc.width() * rc.height() * cs->pixelSize();
+    for (int i = 0; i < numBytes; i++) {
+        data[i] = qrand() % 256;
+    }
+
+    return dev;
+}
+
+KisPaintDeviceSP createRandomPaintDevice(const KoColorSpace *cs, const QRect &rc)
+{
+    KisFixedPaintDeviceSP fixedDev = createRandomFixedDevice(cs, rc);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->writeBytes(fixedDev->data(), rc);
+    return dev;
+}
+
+enum BigBlitType {
+    BltFixed,
+    BltFixedWithFixedSelection,
+    BitBltWithFixedSelection
+};
+
+/**
+ * Blits the whole \p srcRect at once, or in pieces small enough to
+ * be processed serially when \p pieceSize is valid
+ */
+void doBigBlit(KisPainter &gc, BigBlitType type, const QPoint &dstPos,
+               KisFixedPaintDeviceSP fixedSrc, KisPaintDeviceSP src,
+               KisFixedPaintDeviceSP selection,
+               const QRect &srcRect, const QSize &pieceSize)
+{
+    QVector<QRect> pieces;
+
+    if (pieceSize.isValid()) {
+        for (int y = srcRect.top(); y <= srcRect.bottom(); y += pieceSize.height()) {
+            for (int x = srcRect.left(); x <= srcRect.right(); x += pieceSize.width()) {
+                pieces << (srcRect & QRect(QPoint(x, y), pieceSize));
+            }
+        }
+    } else {
+        pieces << srcRect;
+    }
+
+    Q_FOREACH (const QRect &rc, pieces) {
+        const QPoint pos = dstPos + rc.topLeft() - srcRect.topLeft();
+
+        switch (type) {
+        case BltFixed:
+            gc.bltFixed(pos.x(), pos.y(), fixedSrc, rc.x(), rc.y(), rc.width(), rc.height());
+            break;
+        case BltFixedWithFixedSelection:
+            gc.bltFixedWithFixedSelection(pos.x(), pos.y(), fixedSrc, selection,
+                                          rc.x(), rc.y(), rc.x(), rc.y(),
+                                          rc.width(), rc.height());
+            break;
+        case BitBltWithFixedSelection:
+            gc.bitBltWithFixedSelection(pos.x(), pos.y(), src, selection,
+                                        rc.x(), rc.y(), rc.x(), rc.y(),
+                                        rc.width(), rc.height());
+            break;
+        }
+    }
+}
+
+}
+
+void KisPainterTest::testBigBlitInStripes()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColorSpace *alphaCs = KoColorSpaceRegistry::instance()->alpha8();
+
+    /**
+     * The rect is bigger than the threshold of the parallel blit
+     * and isn't aligned to the tiles. The pieces of the reference
+     * blit are small enough to be blitted serially.
+     */
+    const QRect srcRect(0, 0, 700, 650);
+    const QSize pieceSize(350, 325);
+    const QPoint dstPos(-37, 23);
+
+    qsrand(1);
+    KisFixedPaintDeviceSP fixedSrc = createRandomFixedDevice(cs, srcRect);
+    KisPaintDeviceSP src = createRandomPaintDevice(cs, srcRect);
+    KisFixedPaintDeviceSP selection = createRandomFixedDevice(alphaCs, srcRect);
+
+    QList<BigBlitType> types;
+    types << BltFixed << BltFixedWithFixedSelection << BitBltWithFixedSelection;
+
+    Q_FOREACH (BigBlitType type, types) {
+        KoColor background(QColor(10, 200, 30, 100), cs);
+
+        KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+        refDev->fill(QRect(-100, -100, 900, 900), background);
+        KisPaintDeviceSP dev = new KisPaintDevice(cs);
+        dev->fill(QRect(-100, -100, 900, 900), background);
+
+        {
+            KisPainter gc(refDev);
+            doBigBlit(gc, type, dstPos, fixedSrc, src, selection, srcRect, pieceSize);
+        }
+
+        {
+            KisPainter gc(dev);
+            doBigBlit(gc, type, dstPos, fixedSrc, src, selection, srcRect, QSize());
+        }
+
+        QPoint errpoint;
+        if (!TestUtil::comparePaintDevices(errpoint, refDev, dev)) {
+            QFAIL(qPrintable(QString("Parallel blit of type %1 differs from the serial one at %2,%3")
+                             .arg(type).arg(errpoint.x()).arg(errpoint.y())));
+        }
+    }
+}
+
+void KisPainterTest::benchmarkBigBltFixed()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect srcRect(0, 0, 2048, 2048);
+
+    qsrand(1);
+    KisFixedPaintDeviceSP fixedSrc = createRandomFixedDevice(cs, srcRect);
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+
+    QBENCHMARK {
+        KisPainter gc(dst);
+        doBigBlit(gc, BltFixed, QPoint(), fixedSrc, 0, 0, srcRect, QSize());
+    }
+}
+
+void KisPainterTest::benchmarkBigBltFixedSerial()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect srcRect(0, 0, 2048, 2048);
+
+    qsrand(1);
+    KisFixedPaintDeviceSP fixedSrc = createRandomFixedDevice(cs, srcRect);
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+
+    // the same blit in pieces that are too small to be split
+    QBENCHMARK {
+        KisPainter gc(dst);
+        doBigBlit(gc, BltFixed, QPoint(), fixedSrc, 0, 0, srcRect, QSize(256, 256));
+    }
+}
+
 void KisPainterTest::benchmarkBitBlt()
 {
     quint8 p = 128;
@@ -51,8 +51,11 @@ private Q_SLOTS:
     void testSelectionBitBltEraseCompositeOp();
 
     void testBitBltOldData();
+    void testBigBlitInStripes();
     void benchmarkBitBlt();
     void benchmarkBitBltOldData();
+    void benchmarkBigBltFixed();
+    void benchmarkBigBltFixedSerial();
 
 };
 
@@ -30,6 +30,8 @@
 #include <KoColorSpaceRegistry.h>
 #include "kis_types.h"
 #include "kis_paint_device.h"
+#include "kis_painter.h"
+#include "kis_pixel_selection.h"
 
 
 void KisScanlineFillTest::testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
@@ -295,4 +297,64 @@ void KisScanlineFillTest::testExternalFill()
     QCOMPARE(c, QColor(Qt::blue));
 }
 
+void KisScanlineFillTest::testParallelFill()
+{
+    const QRect boundingRect(0, 0, 300, 250);
+    const QPoint startPoint(150, 120);
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    {
+        qsrand(1);
+
+        KisPainter gc(dev);
+        gc.setFillStyle(KisPainter::FillStyleForegroundColor);
+
+        for (int i = 0; i < 200; i++) {
+            gc.setPaintColor(KoColor(QColor(qrand() % 256, 0, 0, 255), cs));
+            gc.paintEllipse(qrand() % 300 - 20, qrand() % 250 - 20, 10 + qrand() % 40, 10 + qrand() % 40);
+        }
+    }
+
+    dev->fill(QRect(startPoint, QSize(3, 3)), KoColor(Qt::transparent, cs));
+
+    QPoint errorPoint;
+
+    // selection, the smooth opacity is calculated
+    {
+        KisPixelSelectionSP sequential = new KisPixelSelection();
+        KisPixelSelectionSP parallel = new KisPixelSelection();
+
+        KisScanlineFill sequentialFill(dev, startPoint, boundingRect);
+        sequentialFill.setThreshold(100);
+        sequentialFill.testingSetUseParallelFill(false);
+        sequentialFill.fillSelection(sequential);
+
+        KisScanlineFill parallelFill(dev, startPoint, boundingRect);
+        parallelFill.setThreshold(100);
+        parallelFill.fillSelection(parallel);
+
+        QVERIFY(!parallel->selectedExactRect().isEmpty());
+        QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequential, parallel));
+    }
+
+    // the source device itself is filled
+    {
+        KisPaintDeviceSP sequential = new KisPaintDevice(*dev);
+        KisPaintDeviceSP parallel = new KisPaintDevice(*dev);
+
+        KisScanlineFill sequentialFill(sequential, startPoint, boundingRect);
+        sequentialFill.setThreshold(30);
+        sequentialFill.testingSetUseParallelFill(false);
+        sequentialFill.fillColor(KoColor(Qt::blue, cs));
+
+        KisScanlineFill parallelFill(parallel, startPoint, boundingRect);
+        parallelFill.setThreshold(30);
+        parallelFill.fillColor(KoColor(Qt::blue, cs));
+
+        QVERIFY(TestUtil::comparePaintDevices(errorPoint, sequential, parallel));
+    }
+}
+
 QTEST_MAIN(KisScanlineFillTest)
@@ -38,6 +38,7 @@ private Q_SLOTS:
 
     void testClearNonZeroComponent();
     void testExternalFill();
+    void testParallelFill();
 
 private:
     void testFillGeneral(const QVector<KisFillInterval> &initialBackwardIntervals,
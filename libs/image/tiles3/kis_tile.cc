@@ -26,6 +26,8 @@
 #include "kis_debug.h"
 
 
+static QAtomicInt s_lastTileSerialNumber;
+
 void KisTile::init(qint32 col, qint32 row,
                    KisTileData *defaultTileData, KisMementoManager* mm)
 {
@@ -33,6 +35,8 @@ void KisTile::init(qint32 col, qint32 row,
     m_row = row;
     m_lockCounter = 0;
 
+    m_serialNumber = s_lastTileSerialNumber.fetchAndAddRelaxed(1) + 1;
+
     m_extent = QRect(m_col * KisTileData::WIDTH, m_row * KisTileData::HEIGHT,
                      KisTileData::WIDTH, KisTileData::HEIGHT);
 
@@ -199,6 +203,8 @@ void KisTile::lockForWrite()
         m_COWMutex.unlock();
     }
 
+    m_numWriteLocks.ref();
+
     DEBUG_LOG_ACTION("lock [W]");
 }
 
@@ -19,6 +19,7 @@
 #ifndef KIS_TILE_H_
 #define KIS_TILE_H_
 
+#include <QAtomicInt>
 #include <QReadWriteLock>
 
 #include <QMutex>
@@ -113,6 +114,18 @@ public:
         return m_tileData;
     }
 
+    /**
+     * The revision grows every time the tile is locked for writing.
+     * Every tile object gets a unique serial number in the higher
+     * bits, so the revisions of two different tiles never match (even
+     * when one of them replaces the other one in a data manager).
+     * It lets the caches detect the changed tiles without keeping a
+     * copy of the data.
+     */
+    inline quint64 revision() const {
+        return (quint64(m_serialNumber) << 32) | quint32(m_numWriteLocks.load());
+    }
+
 private:
     void init(qint32 col, qint32 row,
               KisTileData *defaultTileData, KisMementoManager* mm);
@@ -127,6 +140,9 @@ private:
     mutable QStack<KisTileData*> m_oldTileData;
     mutable volatile int m_lockCounter;
 
+    quint32 m_serialNumber;
+    QAtomicInt m_numWriteLocks;
+
     qint32 m_col;
     qint32 m_row;
 
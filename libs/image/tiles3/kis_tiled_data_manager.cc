@@ -107,6 +107,8 @@ void KisTiledDataManager::setDefaultPixel(const quint8 *defaultPixel)
 
 void KisTiledDataManager::setDefaultPixelImpl(const quint8 *defaultPixel)
 {
+    notifyModified();
+
     KisTileData *td = KisTileDataStore::instance()->createDefaultTileData(pixelSize(), defaultPixel);
     m_hashTable->setDefaultTileData(td);
     m_mementoManager->setDefaultTileData(td);
@@ -335,6 +337,8 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
     if (clearRect.isEmpty())
         return;
 
+    notifyModified();
+
     const qint32 pixelSize = this->pixelSize();
 
     bool pixelBytesAreDefault = !memcmp(clearPixel, m_defaultPixel, pixelSize);
@@ -448,6 +452,7 @@ void KisTiledDataManager::clear()
 {
     QWriteLocker locker(&m_lock);
 
+    notifyModified();
     m_hashTable->clear();
 
     m_extentMinX = qint32_MAX;
@@ -464,6 +469,8 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
 
     if (rect.isEmpty()) return;
 
+    notifyModified();
+
     const qint32 pixelSize = this->pixelSize();
     const quint32 rowStride = KisTileData::WIDTH * pixelSize;
 
@@ -529,6 +536,8 @@ void KisTiledDataManager::bitBltRoughImpl(KisTiledDataManager *srcDM, const QRec
 
     if (rect.isEmpty()) return;
 
+    notifyModified();
+
     qint32 firstColumn = xToCol(rect.left());
     qint32 lastColumn = xToCol(rect.right());
 
@@ -596,6 +605,7 @@ void KisTiledDataManager::setExtent(QRect newRect)
     if (newRect.contains(oldRect)) return;
 
     QWriteLocker locker(&m_lock);
+    notifyModified();
 
     KisTileSP tile;
     QRect tileRect;
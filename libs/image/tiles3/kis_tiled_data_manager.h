@@ -22,6 +22,7 @@
 #include <QtGlobal>
 #include <QVector>
 #include <QRegion>
+#include <QAtomicInt>
 
 #include <kis_shared.h>
 #include <kis_shared_ptr.h>
@@ -94,6 +95,7 @@ public:
             KisTileSP tile = m_hashTable->getTileLazy(col, row, newTile);
             if (newTile)
                 updateExtent(tile->col(), tile->row());
+            notifyModified();
             return tile;
 
         } else {
@@ -133,6 +135,7 @@ public:
 
         QWriteLocker locker(&m_lock);
         m_mementoManager->rollback(m_hashTable);
+        notifyModified();
         const quint8 *defaultPixel = memento->oldDefaultPixel();
         if(memcmp(m_defaultPixel, defaultPixel, m_pixelSize)) {
             setDefaultPixelImpl(defaultPixel);
@@ -144,6 +147,7 @@ public:
 
         QWriteLocker locker(&m_lock);
         m_mementoManager->rollforward(m_hashTable);
+        notifyModified();
         const quint8 *defaultPixel = memento->newDefaultPixel();
         if(memcmp(m_defaultPixel, defaultPixel, m_pixelSize)) {
             setDefaultPixelImpl(defaultPixel);
@@ -168,6 +172,30 @@ public:
 
     static void releaseInternalPools();
 
+    /**
+     * A counter that grows every time the pixel data of the data
+     * manager may have been modified: a tile was fetched for writing,
+     * tiles were added, removed or replaced, or the default pixel
+     * changed. The counter may grow without the data being actually
+     * changed, but it never stays the same when the data changes.
+     *
+     * Two values are comparable only for the same data manager
+     * object.
+     */
+    int modificationCount() const {
+        return m_modificationCount.load();
+    }
+
+    /**
+     * \return the revision of the tile at (\p col, \p row), see
+     * KisTile::revision(), or zero if the tile does not exist and
+     * the default pixel is used instead
+     */
+    quint64 tileRevision(qint32 col, qint32 row) const {
+        KisTileSP tile = m_hashTable->getExistedTile(col, row);
+        return tile ? tile->revision() : 0;
+    }
+
 protected:
     /**
      * Reads and writes the tiles 
@@ -313,6 +341,8 @@ private:
 
     mutable QReadWriteLock m_lock;
 
+    QAtomicInt m_modificationCount;
+
 private:
     // Allow compression routines to calculate (col,row) coordinates
     // and pixel size
@@ -324,6 +354,10 @@ private:
 private:
     void setDefaultPixelImpl(const quint8 *defPixel);
 
+    inline void notifyModified() {
+        m_modificationCount.ref();
+    }
+
     QRect extentImpl() const;
 
     bool writeTilesHeader(KisPaintDeviceWriter &store, quint32 numTiles);
@@ -22,6 +22,7 @@
 #include "kis_image_config.h"
 
 #include "kis_tile_compressor_2.h"
+#include "kis_trace.h"
 
 //#define COMPRESSOR_VERSION 2
 
@@ -57,6 +58,8 @@ quint64 KisSwappedDataStore::numTiles() const
 
 void KisSwappedDataStore::swapOutTileData(KisTileData *td)
 {
+    KIS_TRACE_SCOPE("swapOutTileData", "tiles");
+
     Q_ASSERT(td->data());
     QMutexLocker locker(&m_lock);
 
@@ -85,6 +88,8 @@ void KisSwappedDataStore::swapOutTileData(KisTileData *td)
 
 void KisSwappedDataStore::swapInTileData(KisTileData *td)
 {
+    KIS_TRACE_SCOPE("swapInTileData", "tiles");
+
     Q_ASSERT(!td->data());
     QMutexLocker locker(&m_lock);
 
@@ -17,6 +17,7 @@
  */
 
 #include <QSemaphore>
+#include <QElapsedTimer>
 
 #include "tiles3/swap/kis_tile_data_swapper.h"
 #include "tiles3/swap/kis_tile_data_swapper_p.h"
@@ -29,6 +30,7 @@
 
 const qint32 KisTileDataSwapper::TIMEOUT = -1;
 const qint32 KisTileDataSwapper::DELAY = 0.7 * SEC;
+const qint32 KisTileDataSwapper::HISTORICAL_METRIC_REFRESH_INTERVAL = 3 * SEC;
 
 //#define DEBUG_SWAPPER
 
@@ -52,6 +54,14 @@ public:
     KisTileDataStore *store;
     KisStoreLimits limits;
     QMutex cycleLock;
+
+    /**
+     * Counting the historical tiles needs a pass over the whole
+     * store, so the value is cached and refreshed by the swapper
+     * thread only
+     */
+    qint64 historicalMetric;
+    QElapsedTimer historicalMetricTimer;
 };
 
 KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
@@ -60,6 +70,7 @@ KisTileDataSwapper::KisTileDataSwapper(KisTileDataStore *store)
 {
     m_d->shouldExitFlag = 0;
     m_d->store = store;
+    m_d->historicalMetric = 0;
 }
 
 KisTileDataSwapper::~KisTileDataSwapper()
@@ -96,7 +107,11 @@ void KisTileDataSwapper::run()
 
         QThread::msleep(DELAY);
 
-        doJob();
+        const bool refreshHistoricalMetric =
+            !m_d->historicalMetricTimer.isValid() ||
+            m_d->historicalMetricTimer.elapsed() > HISTORICAL_METRIC_REFRESH_INTERVAL;
+
+        doJob(refreshHistoricalMetric);
     }
 }
 
@@ -104,10 +119,10 @@ void KisTileDataSwapper::checkFreeMemory()
 {
 //    dbgKrita <<"check memory: high limit -" << m_d->limits.emergencyThreshold() <<"in mem -" << m_d->store->numTilesInMemory();
     if(m_d->store->memoryMetric() > m_d->limits.emergencyThreshold())
-        doJob();
+        doJob(false);
 }
 
-void KisTileDataSwapper::doJob()
+void KisTileDataSwapper::doJob(bool refreshHistoricalMetric)
 {
     /**
      * In emergency case usual threads have access
@@ -115,32 +130,81 @@ void KisTileDataSwapper::doJob()
      */
     QMutexLocker locker(&m_d->cycleLock);
 
-    qint32 memoryMetric = m_d->store->memoryMetric();
+    if (refreshHistoricalMetric) {
+        m_d->historicalMetric = calculateHistoricalMemoryMetric();
+        m_d->historicalMetricTimer.start();
+    }
+
+    qint64 memoryMetric = m_d->store->memoryMetric();
+    qint64 historicalMetric = m_d->historicalMetric;
 
     DEBUG_ACTION("Started swap cycle");
     DEBUG_VALUE(m_d->store->numTiles());
     DEBUG_VALUE(m_d->store->numTilesInMemory());
     DEBUG_VALUE(memoryMetric);
+    DEBUG_VALUE(historicalMetric);
 
     DEBUG_VALUE(m_d->limits.softLimitThreshold());
     DEBUG_VALUE(m_d->limits.hardLimitThreshold());
 
-
-    if(memoryMetric > m_d->limits.softLimitThreshold()) {
-        qint32 softFree =  memoryMetric - m_d->limits.softLimit();
+    /**
+     * The undo information has a budget of its own. Old mementoed
+     * tiles over this budget go to the swap file even when there is
+     * plenty of memory for the working tiles
+     */
+    if(historicalMetric > m_d->limits.softLimitThreshold()) {
+        qint64 softFree =  historicalMetric - m_d->limits.softLimit();
         DEBUG_VALUE(softFree);
         DEBUG_ACTION("\t pass0");
-        memoryMetric -= pass<SoftSwapStrategy>(softFree);
+        qint64 freed = pass<SoftSwapStrategy>(softFree);
+        memoryMetric -= freed;
+        historicalMetric -= freed;
         DEBUG_VALUE(memoryMetric);
+    }
 
-        if(memoryMetric > m_d->limits.hardLimitThreshold()) {
-            qint32 hardFree =  memoryMetric - m_d->limits.hardLimit();
-            DEBUG_VALUE(hardFree);
+    if(memoryMetric > m_d->limits.hardLimitThreshold()) {
+        qint64 hardFree =  memoryMetric - m_d->limits.hardLimit();
+        DEBUG_VALUE(hardFree);
+
+        /**
+         * Undo information is evicted before the working tiles
+         */
+        if(historicalMetric > 0) {
             DEBUG_ACTION("\t pass1");
+            qint64 freed = pass<SoftSwapStrategy>(hardFree);
+            memoryMetric -= freed;
+            historicalMetric -= freed;
+            hardFree -= freed;
+            DEBUG_VALUE(memoryMetric);
+        }
+
+        if(hardFree > 0) {
+            DEBUG_ACTION("\t pass2");
             memoryMetric -= pass<AggressiveSwapStrategy>(hardFree);
             DEBUG_VALUE(memoryMetric);
         }
     }
+
+    m_d->historicalMetric = qMax(historicalMetric, qint64(0));
+}
+
+qint64 KisTileDataSwapper::calculateHistoricalMemoryMetric()
+{
+    qint64 historicalMetric = 0;
+
+    KisTileDataStoreIterator *iter = m_d->store->beginIteration();
+
+    while(iter->hasNext()) {
+        KisTileData *item = iter->next();
+
+        if(item->historical()) {
+            historicalMetric += item->pixelSize();
+        }
+    }
+
+    m_d->store->endIteration(iter);
+
+    return historicalMetric;
 }
 
 
@@ -46,12 +46,17 @@ private:
     void waitForWork();
     void run();
 
-    void doJob();
+    void doJob(bool refreshHistoricalMetric);
+    qint64 calculateHistoricalMemoryMetric();
     template<class strategy> qint64 pass(qint64 needToFreeMetric);
 
 private:
     static const qint32 TIMEOUT;
     static const qint32 DELAY;
+    static const qint32 HISTORICAL_METRIC_REFRESH_INTERVAL;
+
+private:
+    friend class KisTileDataStoreTest;
 
 private:
     struct Private;
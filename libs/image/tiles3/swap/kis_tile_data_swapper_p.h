@@ -32,9 +32,10 @@
   |                        |      until we free some memory
   |                        |
   |== hardLimitThreshold ==|  <-- the swapper thread starts
-  |........................|      swapping out working (actually
-  |........................|      needed) tiles until the level
-  |........................|      reaches hardLimit level.
+  |........................|      swapping out memento tiles and
+  |........................|      then working (actually needed)
+  |........................|      tiles until the level reaches
+  |........................|      hardLimit level.
   |........................|
   |=====  hardLimit  ======|  <-- the swapper stops swapping
   |                        |      out needed tiles
@@ -44,8 +45,9 @@
   |                        |
   |== softLimitThreshold ==|  <-- the swapper starts swapping
   |........................|      out memento tiles (those, which
-  |........................|      store undo information)
-  |........................|
+  |........................|      store undo information) when the
+  |........................|      undo information alone exceeds
+  |........................|      this level
   |=====  softLimit  ======|  <-- the swapper stops swapping
   |                        |      out memento tiles
   |                        |
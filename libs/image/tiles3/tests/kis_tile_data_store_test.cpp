@@ -28,6 +28,7 @@
 
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
+#include "tiles3/swap/kis_tile_data_swapper_p.h"
 
 
 void KisTileDataStoreTest::testClockIterator()
@@ -181,5 +182,104 @@ void KisTileDataStoreTest::testSwapping()
     }
 }
 
+static void countTilesInMemory(qint32 &numHistorical, qint32 &numCurrent)
+{
+    numHistorical = 0;
+    numCurrent = 0;
+
+    KisTileDataStoreIterator *iter = KisTileDataStore::instance()->beginIteration();
+
+    while(iter->hasNext()) {
+        KisTileData *item = iter->next();
+
+        if(item->historical()) {
+            numHistorical++;
+        } else {
+            numCurrent++;
+        }
+    }
+
+    KisTileDataStore::instance()->endIteration(iter);
+}
+
+void KisTileDataStoreTest::testHistoricalTilesSwappedFirst()
+{
+    KisImageConfig config;
+    config.setMemoryHardLimitPercent(8.5 * 100.0 / KisImageConfig::totalRAM());
+    config.setMemorySoftLimitPercent(100);
+    config.setMemoryPoolLimitPercent(0);
+
+    KisTileDataStore *store = KisTileDataStore::instance();
+    store->testingSuspendPooler();
+    store->testingRereadConfig();
+    store->debugClear();
+
+    KisStoreLimits limits;
+
+    /**
+     * The total amount of memory is between the hard limit threshold
+     * and the emergency threshold, and there is more undo information
+     * than the swapper needs to free
+     */
+    const qint32 numTotal = (limits.hardLimitThreshold() + limits.emergencyThreshold()) / 2;
+    const qint32 needToFree = numTotal - limits.hardLimit();
+    const qint32 numHistorical = needToFree + needToFree / 2;
+    const qint32 numCurrentOnly = numTotal - 2 * numHistorical;
+
+    QVERIFY(numCurrentOnly > 0);
+
+    const qint32 pixelSize = 1;
+    quint8 defaultPixel = 128;
+    KisTiledDataManager dm(pixelSize, &defaultPixel);
+
+    KisMementoSP memento1 = dm.getMemento();
+    for(qint32 col = 0; col < numHistorical + numCurrentOnly; col++) {
+        KisTileSP tile = dm.getTile(col, 0, true);
+        tile->lockForWrite();
+        memset(tile->data(), COLUMN2COLOR(col), TILESIZE);
+        tile->unlock();
+    }
+    dm.commit();
+
+    // overwrite some of the tiles so that their old data is kept by undo only
+    KisMementoSP memento2 = dm.getMemento();
+    for(qint32 col = 0; col < numHistorical; col++) {
+        KisTileSP tile = dm.getTile(col, 0, true);
+        tile->lockForWrite();
+        memset(tile->data(), COLUMN2COLOR(col + 1), TILESIZE);
+        tile->unlock();
+    }
+    dm.commit();
+
+    qint32 historicalBefore;
+    qint32 currentBefore;
+    countTilesInMemory(historicalBefore, currentBefore);
+
+    store->m_swapper.doJob(true);
+
+    qint32 historicalAfter;
+    qint32 currentAfter;
+    countTilesInMemory(historicalAfter, currentAfter);
+
+    // only the undo information has gone to the swap file
+    QCOMPARE(currentAfter, currentBefore);
+    QVERIFY(historicalAfter <= numHistorical - needToFree);
+
+    // and it can still be read back
+    dm.rollback(memento2);
+    for(qint32 col = 0; col < numHistorical; col++) {
+        KisTileSP tile = dm.getTile(col, 0, false);
+        tile->lockForRead();
+        QVERIFY(memoryIsFilled(COLUMN2COLOR(col), tile->data(), TILESIZE));
+        tile->unlock();
+    }
+
+    config.setMemoryHardLimitPercent(config.memoryHardLimitPercent(true));
+    config.setMemorySoftLimitPercent(config.memorySoftLimitPercent(true));
+    config.setMemoryPoolLimitPercent(config.memoryPoolLimitPercent(true));
+    store->testingRereadConfig();
+    store->testingResumePooler();
+}
+
 QTEST_MAIN(KisTileDataStoreTest)
 
@@ -24,14 +24,13 @@
 #include <QtEndian>
 
 // from gimp's psd-save.c
-static quint32 pack_pb_line (const QByteArray &src,
-                             QByteArray &dst)
+static quint32 pack_pb_line (const char *start,
+                             quint32 length,
+                             char *dst)
 {
-    quint32 length = src.size();
     quint32 remaining = length;
     quint8  i, j;
     quint32 dest_ptr = 0;
-    const char *start = src.constData();
 
     length = 0;
     while (remaining > 0)
@@ -89,7 +88,7 @@ static quint32 pack_pb_line (const QByteArray &src,
 
 
 // from gimp's psd-util.c
-quint32 decode_packbits(const char *src, char* dst, quint16 packed_len, quint32 unpacked_len)
+quint32 decode_packbits(const char *src, char* dst, quint32 packed_len, quint32 unpacked_len)
 {
     /*
      *  Decode a PackBits chunk.
@@ -170,7 +169,7 @@ quint32 decode_packbits(const char *src, char* dst, quint16 packed_len, quint32
     if (unpack_left > 0)
     {
         /* Pad with zeros to end of output buffer */
-        for (n = 0; n < pack_left; ++n)
+        for (n = 0; n < unpack_left; ++n)
         {
             *dst = 0;
             dst++;
@@ -247,10 +246,8 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
         return bytes;
     case RLE:
     {
-        QByteArray dst;
-        int packed_len = pack_pb_line(bytes, dst);
-        Q_ASSERT(packed_len == dst.size());
-        Q_UNUSED(packed_len);
+        QByteArray dst(maxRLECompressedLength(bytes.size()), Qt::Uninitialized);
+        dst.resize(compressRLE(bytes.constData(), bytes.size(), dst.data()));
         return dst;
     }
     case ZIP:
@@ -263,3 +260,23 @@ QByteArray Compression::compress(QByteArray bytes, Compression::CompressionType
     return QByteArray();
 }
 
+void Compression::uncompressRLE(const char *src, quint32 packedLength, char *dst, quint32 unpackedLength)
+{
+    decode_packbits(src, dst, packedLength, unpackedLength);
+}
+
+quint32 Compression::compressRLE(const char *src, quint32 length, char *dst)
+{
+    return pack_pb_line(src, length, dst);
+}
+
+quint32 Compression::maxRLECompressedLength(quint32 length)
+{
+    /**
+     * Every packet of literal bytes costs one extra header byte. The
+     * packer emits at most 128 literals per packet, but when exactly
+     * 128 bytes are left it emits 127 of them and then the last byte
+     * in a packet of its own, hence the extra byte.
+     */
+    return length + (length + 126) / 127 + 1;
+}
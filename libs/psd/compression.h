@@ -35,6 +35,27 @@ public:
 
     static QByteArray uncompress(quint32 unpacked_len, QByteArray bytes, CompressionType compressionType);
     static QByteArray compress(QByteArray bytes, CompressionType compressionType);
+
+    /**
+     * Decodes a PackBits-compressed row right into a preallocated
+     * buffer. Unlike uncompress() it has no limit on the row length
+     * and doesn't allocate anything, so it can be used for decoding
+     * the image data in several threads at once.
+     */
+    static void uncompressRLE(const char *src, quint32 packedLength, char *dst, quint32 unpackedLength);
+
+    /**
+     * Encodes a row with PackBits into a preallocated buffer, which
+     * should be at least maxRLECompressedLength(length) bytes long.
+     *
+     * @return the number of bytes written into \p dst
+     */
+    static quint32 compressRLE(const char *src, quint32 length, char *dst);
+
+    /**
+     * The worst case size of a PackBits-compressed row
+     */
+    static quint32 maxRLECompressedLength(quint32 length);
 };
 
 #endif // PSD_COMPRESSION_H
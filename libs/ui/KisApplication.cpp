@@ -615,7 +615,8 @@ void KisApplication::checkAutosaveFiles()
 #endif
 
     // all autosave files for our application
-    m_autosaveFiles = dir.entryList(filters, QDir::Files | QDir::Hidden);
+    // (incremental autosaves are directories)
+    m_autosaveFiles = dir.entryList(filters, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden);
 
     // Allow the user to make their selection
     if (m_autosaveFiles.size() > 0) {
@@ -630,7 +631,7 @@ void KisApplication::checkAutosaveFiles()
             QStringList filesToRecover = m_autosaveDialog->recoverableFiles();
             Q_FOREACH (const QString &autosaveFile, m_autosaveFiles) {
                 if (!filesToRecover.contains(autosaveFile)) {
-                    QFile::remove(dir.absolutePath() + "/" + autosaveFile);
+                    KisDocument::removeAutoSaveFile(dir.absolutePath() + "/" + autosaveFile);
                 }
             }
             m_autosaveFiles = filesToRecover;
@@ -226,7 +226,12 @@ KisAutoSaveRecoveryDialog::KisAutoSaveRecoveryDialog(const QStringList &filename
         }
 
         // get the date
-        QDateTime date = QFileInfo(path).lastModified();
+        QFileInfo info(path);
+        if (info.isDir()) {
+            // an incremental autosave, the directory itself is not touched by later saves
+            info = QFileInfo(path + "/maindoc.xml");
+        }
+        QDateTime date = info.lastModified();
         file->date = "(" + date.toString(Qt::LocalDate) + ")";
 
         fileItems.append(file);
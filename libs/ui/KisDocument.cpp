@@ -98,6 +98,7 @@
 #include "flake/kis_shape_controller.h"
 #include "kra/kis_kra_loader.h"
 #include "kra/kis_kra_saver.h"
+#include "kra/kis_kra_incremental_save_state.h"
 #include "kis_statusbar.h"
 #include "widgets/kis_progress_widget.h"
 #include "kis_canvas_resource_provider.h"
@@ -261,6 +262,7 @@ public:
         password(QString()),
         modifiedAfterAutosave(false),
         isAutosaving(false),
+        isIncrementalAutosave(false),
         autoErrorHandlingEnabled(true),
         backupFile(true),
         backupPath(QString()),
@@ -322,6 +324,8 @@ public:
     int autoSaveDelay; // in seconds, 0 to disable.
     bool modifiedAfterAutosave;
     bool isAutosaving;
+    bool isIncrementalAutosave;
+    KisKraIncrementalSaveState incrementalSaveState; // what the last incremental autosave has written
     bool autoErrorHandlingEnabled; // usually true
     bool backupFile;
     QString backupPath;
@@ -935,7 +939,28 @@ void KisDocument::slotAutoSave()
             connect(this, SIGNAL(sigProgress(int)), KisPart::instance()->currentMainwindow(), SLOT(slotProgress(int)));
             emit statusBarMessage(i18n("Autosaving..."));
             d->isAutosaving = true;
-            bool ret = saveNativeFormat(autoSaveFile(localFilePath()));
+
+            const QString autoSavePath = autoSaveFile(localFilePath());
+            d->isIncrementalAutosave = KisConfig().autoSaveIncremental();
+
+            // the incremental autosave is a directory, the normal one is a file
+            if (QFileInfo(autoSavePath).exists() &&
+                QFileInfo(autoSavePath).isDir() != d->isIncrementalAutosave) {
+
+                removeAutoSaveFile(autoSavePath);
+            }
+
+            if (d->isIncrementalAutosave) {
+                d->incrementalSaveState.beginSave(autoSavePath);
+            }
+
+            bool ret = saveNativeFormat(autoSavePath);
+
+            if (d->isIncrementalAutosave) {
+                d->incrementalSaveState.endSave(ret);
+                d->isIncrementalAutosave = false;
+            }
+
             setModified(true);
             if (ret) {
                 d->modifiedAfterAutosave = false;
@@ -1007,6 +1032,10 @@ bool KisDocument::saveNativeFormat(const QString & file)
         backend = KoStore::Directory;
         dbgUI << "Saving as uncompressed XML, using directory store.";
     }
+    else if (d->isAutosaving && d->isIncrementalAutosave) {
+        backend = KoStore::Directory;
+        dbgUI << "Incremental autosave, using directory store.";
+    }
     else if (d->specialOutputFlag == SaveAsFlatXML) {
         dbgUI << "Saving as a flat XML file.";
         QFile f(file);
@@ -1294,7 +1323,7 @@ bool KisDocument::openUrl(const QUrl &_url, KisDocument::OpenUrlFlags flags)
                 autosaveOpened = true;
                 break;
             case QMessageBox::No :
-                QFile::remove(asf);
+                removeAutoSaveFile(asf);
                 break;
             default: // Cancel
                 d->isLoading = false;
@@ -1520,7 +1549,12 @@ bool KisDocument::loadNativeFormat(const QString & file_)
         d->lastErrorMessage = i18n("The file %1 does not exist.", file);
         return false;
     }
-    if (!fileInfo.isFile()) {
+
+    // an incremental autosave is stored as a directory
+    const bool isDirectoryStore =
+        fileInfo.isDir() && QFileInfo(file + "/maindoc.xml").isFile();
+
+    if (!fileInfo.isFile() && !isDirectoryStore) {
         file += "/content.xml";
         QFileInfo fileInfo2(file);
         if (!fileInfo2.exists() || !fileInfo2.isFile()) {
@@ -1535,7 +1569,7 @@ bool KisDocument::loadNativeFormat(const QString & file_)
 
     QFile in;
     bool isRawXML = false;
-    if (d->specialOutputFlag != SaveAsDirectoryStore) { // Don't try to open a directory ;)
+    if (d->specialOutputFlag != SaveAsDirectoryStore && !isDirectoryStore) { // Don't try to open a directory ;)
         in.setFileName(file);
         if (!in.open(QIODevice::ReadOnly)) {
             QApplication::restoreOverrideCursor();
@@ -1592,7 +1626,7 @@ bool KisDocument::loadNativeFormat(const QString & file_)
     else { // It's a calligra store (tar.gz, zip, directory, etc.)
         in.close();
 
-        KoStore::Backend backend = (d->specialOutputFlag == SaveAsDirectoryStore) ? KoStore::Directory : KoStore::Auto;
+        KoStore::Backend backend = (d->specialOutputFlag == SaveAsDirectoryStore || isDirectoryStore) ? KoStore::Directory : KoStore::Auto;
         KoStore *store = KoStore::createStore(file, KoStore::Read, "", backend);
 
         if (store->bad()) {
@@ -1994,6 +2028,10 @@ QDomDocument KisDocument::saveXML()
     if (d->kraSaver) delete d->kraSaver;
     d->kraSaver = new KisKraSaver(this);
 
+    if (d->isAutosaving && d->isIncrementalAutosave) {
+        d->kraSaver->setIncrementalSaveState(&d->incrementalSaveState);
+    }
+
     root.appendChild(d->kraSaver->saveXML(doc, d->savingImage));
     if (!d->kraSaver->errorMessages().isEmpty()) {
         setErrorMessage(d->kraSaver->errorMessages().join(".\n"));
@@ -2044,10 +2082,24 @@ void KisDocument::removeAutoSaveFiles()
     // Eliminate any auto-save file
     QString asf = autoSaveFile(localFilePath());   // the one in the current dir
     if (QFile::exists(asf))
-        QFile::remove(asf);
+        removeAutoSaveFile(asf);
     asf = autoSaveFile(QString());   // and the one in $HOME
     if (QFile::exists(asf))
-        QFile::remove(asf);
+        removeAutoSaveFile(asf);
+
+    d->incrementalSaveState.reset();
+}
+
+bool KisDocument::removeAutoSaveFile(const QString &path)
+{
+    QFileInfo fi(path);
+
+    // incremental autosaves are directory stores
+    if (fi.isDir()) {
+        return QDir(path).removeRecursively();
+    }
+
+    return QFile::remove(path);
 }
 
 void KisDocument::setBackupFile(bool _b)
@@ -426,6 +426,12 @@ public:
      */
     void removeAutoSaveFiles();
 
+    /**
+     * Removes an autosave file, which may also be a directory if
+     * the incremental autosave was used
+     */
+    static bool removeAutoSaveFile(const QString &path);
+
     void setBackupFile(bool _b);
 
     bool backupFile()const;
@@ -18,6 +18,7 @@
 #include "kis_image_pyramid.h"
 
 #include <QBitArray>
+#include <QtConcurrentMap>
 #include <KoChannelInfo.h>
 #include <KoCompositeOp.h>
 #include <KoColorSpaceRegistry.h>
@@ -32,6 +33,7 @@
 #include "kis_debug.h"
 #include "kis_config.h"
 #include "kis_image_config.h"
+#include "krita_utils.h"
 
 //#define DEBUG_PYRAMID
 
@@ -181,33 +183,8 @@ void KisImagePyramid::setImage(KisImageWSP newImage)
 
         // Get the full image size
         QRect rc = m_originalImage->projection()->exactBounds();
+        retrieveImageData(rc);
 
-        KisImageConfig config;
-
-        int patchWidth = config.updatePatchWidth();
-        int patchHeight = config.updatePatchHeight();
-
-        if (rc.width() * rc.height() <= patchWidth * patchHeight) {
-            retrieveImageData(rc);
-        }
-        else {
-            qint32 firstCol = rc.x() / patchWidth;
-            qint32 firstRow = rc.y() / patchHeight;
-
-            qint32 lastCol = (rc.x() + rc.width()) / patchWidth;
-            qint32 lastRow = (rc.y() + rc.height()) / patchHeight;
-
-            for(qint32 i = firstRow; i <= lastRow; i++) {
-                for(qint32 j = firstCol; j <= lastCol; j++) {
-                    QRect maxPatchRect(j * patchWidth,
-                                       i * patchHeight,
-                                       patchWidth, patchHeight);
-                    QRect patchRect = rc & maxPatchRect;
-                    retrieveImageData(patchRect);
-                }
-            }
-
-        }
         //TODO: check whether there is needed recalculateCache()
     }
 }
@@ -225,6 +202,39 @@ void KisImagePyramid::updateCache(const QRect &dirtyImageRect)
 }
 
 void KisImagePyramid::retrieveImageData(const QRect &rect)
+{
+    if (rect.isEmpty()) return;
+
+    const KoColorSpace *projectionCs = m_originalImage->projection()->colorSpace();
+    if (m_channelFlags.size() != projectionCs->channels().size()) {
+        setChannelFlags(QBitArray());
+    }
+
+    KisConfig cfg;
+    const bool showSingleChannelAsColor = cfg.showSingleChannelAsColor();
+
+    KisImageConfig config;
+    const QSize patchSize(config.updatePatchWidth(), config.updatePatchHeight());
+
+    /**
+     * Big updates (loading of the image, filtering of the whole
+     * image, etc.) are split into patches converted on the worker
+     * threads. The patches never overlap, so the threads write into
+     * different pixels of the pyramid.
+     */
+    QVector<QRect> patches = KritaUtils::splitRectIntoPatches(rect, patchSize);
+
+    if (patches.size() == 1) {
+        retrievePatchData(rect, showSingleChannelAsColor);
+    } else {
+        QtConcurrent::blockingMap(patches,
+            [this, showSingleChannelAsColor] (const QRect &patch) {
+                retrievePatchData(patch, showSingleChannelAsColor);
+            });
+    }
+}
+
+void KisImagePyramid::retrievePatchData(const QRect &rect, bool showSingleChannelAsColor)
 {
     // XXX: use QThreadStorage to cache the two patches (512x512) of pixels. Note
     // that when we do that, we need to reset that cache when the projection's
@@ -277,18 +287,13 @@ void KisImagePyramid::retrieveImageData(const QRect &rect)
     }
     else {
         QList<KoChannelInfo*> channelInfo = projectionCs->channels();
-        if (m_channelFlags.size() != channelInfo.size()) {
-            setChannelFlags(QBitArray());
-        }
         if (!m_channelFlags.isEmpty() && !m_allChannelsSelected) {
             QScopedArrayPointer<quint8> dst(new quint8[projectionCs->pixelSize() * numPixels]);
 
             int channelSize = channelInfo[m_selectedChannelIndex]->size();
             int pixelSize = projectionCs->pixelSize();
 
-            KisConfig cfg;
-
-            if (m_onlyOneChannelSelected && !cfg.showSingleChannelAsColor()) {
+            if (m_onlyOneChannelSelected && !showSingleChannelAsColor) {
                 int selectedChannelPos = channelInfo[m_selectedChannelIndex]->pos();
                 for (uint pixelIndex = 0; pixelIndex < numPixels; ++pixelIndex) {
                     for (uint channelIndex = 0; channelIndex < projectionCs->channelCount(); ++channelIndex) {
@@ -412,26 +417,40 @@ void  KisImagePyramid::downsamplePixels(const quint8 *srcRow0,
                                         qint32 numSrcPixels)
 {
     /**
-     * FIXME (mandatory): Use SSE and friends here.
+     * The pixels are processed in SWAR manner: every 32-bit pixel
+     * is split into two words holding two 16-bit channel lanes each,
+     * so the sum of four pixels fits into the lanes without overflow
+     * and all the channels are averaged with a couple of integer
+     * operations. The result is exactly the same as averaging every
+     * channel separately, and the loop is simple enough to be
+     * vectorized by the compiler.
      */
 
-    qint16 b = 0;
-    qint16 g = 0;
-    qint16 r = 0;
-    qint16 a = 0;
-
     static const qint32 pixelSize = 4; // This is preview argb8 mode
+    static const quint32 laneMask = 0x00ff00ff;
+
+    const qint32 numDstPixels = numSrcPixels / 2;
+
+    for (qint32 i = 0; i < numDstPixels; i++) {
+        quint32 p00, p01, p10, p11;
+        memcpy(&p00, srcRow0, pixelSize);
+        memcpy(&p01, srcRow0 + pixelSize, pixelSize);
+        memcpy(&p10, srcRow1, pixelSize);
+        memcpy(&p11, srcRow1 + pixelSize, pixelSize);
+
+        const quint32 evenChannels =
+            (p00 & laneMask) + (p01 & laneMask) +
+            (p10 & laneMask) + (p11 & laneMask);
+
+        const quint32 oddChannels =
+            ((p00 >> 8) & laneMask) + ((p01 >> 8) & laneMask) +
+            ((p10 >> 8) & laneMask) + ((p11 >> 8) & laneMask);
 
-    for (qint32 i = 0; i < numSrcPixels / 2; i++) {
-        b = srcRow0[0] + srcRow1[0] + srcRow0[4] + srcRow1[4];
-        g = srcRow0[1] + srcRow1[1] + srcRow0[5] + srcRow1[5];
-        r = srcRow0[2] + srcRow1[2] + srcRow0[6] + srcRow1[6];
-        a = srcRow0[3] + srcRow1[3] + srcRow0[7] + srcRow1[7];
+        const quint32 result =
+            ((evenChannels >> 2) & laneMask) |
+            (((oddChannels >> 2) & laneMask) << 8);
 
-        dstRow[0] = b / 4;
-        dstRow[1] = g / 4;
-        dstRow[2] = r / 4;
-        dstRow[3] = a / 4;
+        memcpy(dstRow, &result, pixelSize);
 
         dstRow += pixelSize;
         srcRow0 += 2 * pixelSize;
@@ -76,6 +76,7 @@ public:
 private:
 
     void retrieveImageData(const QRect &rect);
+    void retrievePatchData(const QRect &rect, bool showSingleChannelAsColor);
     void rebuildPyramid();
     void clearPyramid();
 
@@ -27,6 +27,7 @@
 #include <QPoint>
 #include <QSize>
 #include <QPainter>
+#include <QtConcurrentMap>
 
 #include <KoColorProfile.h>
 #include <KoViewConverter.h>
@@ -40,7 +41,9 @@
 #include "kis_coordinates_converter.h"
 #include "kis_projection_backend.h"
 #include "kis_image_pyramid.h"
+#include "kis_image_patch.h"
 #include "kis_display_filter.h"
+#include "kis_trace.h"
 
 #define ceiledSize(sz) QSize(ceil((sz).width()), ceil((sz).height()))
 
@@ -169,7 +172,7 @@ void KisPrescaledProjection::viewportMoved(const QPointF &offset)
         updateRegion -= savedArea;
     }
 
-    QPainter gc(&newImage);
+    QVector<KisPPUpdateInfoSP> infos;
     QVector<QRect> rects = updateRegion.rects();
 
     Q_FOREACH (const QRect &rect, rects) {
@@ -184,10 +187,14 @@ void KisPrescaledProjection::viewportMoved(const QPointF &offset)
 
             KisPPUpdateInfoSP info = getInitialUpdateInformation(QRect());
             fillInUpdateInformation(viewportPatch, info);
-            drawUsingBackend(gc, info);
+            infos.append(info);
         }
     }
 
+    QPainter gc(&newImage);
+    drawUsingBackend(gc, infos);
+    gc.end();
+
     m_d->prescaledQImage = newImage;
 }
 
@@ -201,6 +208,8 @@ void KisPrescaledProjection::slotImageSizeChanged(qint32 w, qint32 h)
 
 KisUpdateInfoSP KisPrescaledProjection::updateCache(const QRect &dirtyImageRect)
 {
+    KIS_TRACE_SCOPE("KisPrescaledProjection::updateCache", "canvas");
+
     if (!m_d->image) {
         dbgRender << "Calling updateCache without an image: " << kisBacktrace() << endl;
         // return invalid info
@@ -222,6 +231,8 @@ KisUpdateInfoSP KisPrescaledProjection::updateCache(const QRect &dirtyImageRect)
 
 void KisPrescaledProjection::recalculateCache(KisUpdateInfoSP info)
 {
+    KIS_TRACE_SCOPE("KisPrescaledProjection::recalculateCache", "canvas");
+
     KisPPUpdateInfoSP ppInfo = dynamic_cast<KisPPUpdateInfo*>(info.data());
     if(!ppInfo) return;
 
@@ -250,15 +261,18 @@ void KisPrescaledProjection::preScale()
     QVector<QRect> patches =
         KritaUtils::splitRectIntoPatches(imageRect, m_d->updatePatchSize);
 
+    QVector<KisPPUpdateInfoSP> infos;
+
     Q_FOREACH (const QRect& rc, patches) {
         QRect viewportPatch = m_d->coordinatesConverter->imageToViewport(rc).toAlignedRect();
         KisPPUpdateInfoSP info = getInitialUpdateInformation(QRect());
         fillInUpdateInformation(viewportPatch, info);
-        QPainter gc(&m_d->prescaledQImage);
-        gc.setCompositionMode(QPainter::CompositionMode_Source);
-        drawUsingBackend(gc, info);
+        infos.append(info);
     }
 
+    QPainter gc(&m_d->prescaledQImage);
+    gc.setCompositionMode(QPainter::CompositionMode_Source);
+    drawUsingBackend(gc, infos);
 }
 
 void KisPrescaledProjection::setMonitorProfile(const KoColorProfile *monitorProfile, KoColorConversionTransformation::Intent renderingIntent, KoColorConversionTransformation::ConversionFlags conversionFlags)
@@ -398,3 +412,52 @@ void KisPrescaledProjection::drawUsingBackend(QPainter &gc, KisPPUpdateInfoSP in
     }
 }
 
+void KisPrescaledProjection::drawUsingBackend(QPainter &gc, const QVector<KisPPUpdateInfoSP> &infos)
+{
+    struct PatchJob {
+        KisPPUpdateInfoSP info;
+        KisImagePatch patch;
+    };
+
+    QVector<PatchJob> jobs;
+    jobs.reserve(infos.size());
+
+    Q_FOREACH (KisPPUpdateInfoSP info, infos) {
+        if (info->imageRect.isEmpty()) continue;
+
+        PatchJob job;
+        job.info = info;
+        jobs.append(job);
+    }
+
+    /**
+     * Reading the pixels from the backend and smooth scaling take
+     * most of the time, so do it for all the patches in parallel.
+     * QPainter cannot draw on the same image from several threads,
+     * so the patches are drawn in the calling thread afterwards.
+     *
+     * The direct transfers are left to the backend, it draws them
+     * itself in drawFromOriginalImage().
+     */
+    KisProjectionBackend *backend = m_d->projectionBackend;
+
+    QtConcurrent::blockingMap(jobs,
+        [backend] (PatchJob &job) {
+            if (job.info->transfer != KisPPUpdateInfo::PATCH) return;
+
+            job.patch = backend->getNearestPatch(job.info);
+            // prescale the patch because otherwise we'd scale using QPainter, which gives
+            // a crap result compared to QImage's smoothscale
+            job.patch.preScale(job.info->viewportRect);
+        });
+
+    for (int i = 0; i < jobs.size(); i++) {
+        PatchJob &job = jobs[i];
+
+        if (job.info->transfer == KisPPUpdateInfo::DIRECT) {
+            backend->drawFromOriginalImage(gc, job.info);
+        } else /* if info->transfer == KisPPUpdateInformation::PATCH */ {
+            job.patch.drawMe(gc, job.info->viewportRect, job.info->renderHints);
+        }
+    }
+}
@@ -19,6 +19,7 @@
 #define KIS_PRESCALED_PROJECTION_H
 
 #include <QObject>
+#include <QVector>
 
 #include <kritaui_export.h>
 #include <kis_shared.h>
@@ -173,6 +174,16 @@ private:
      */
     void drawUsingBackend(QPainter &gc, KisPPUpdateInfoSP info);
 
+    /**
+     * Draws a set of patches at once. Fetching and scaling of the
+     * patches is done on the worker threads, only the final drawing
+     * on \p gc happens in the calling thread.
+     *
+     * @param infos prepared information for every patch
+     * @param gc The painter we draw on
+     */
+    void drawUsingBackend(QPainter &gc, const QVector<KisPPUpdateInfoSP> &infos);
+
     struct Private;
     Private * const m_d;
 };
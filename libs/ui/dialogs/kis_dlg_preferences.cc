@@ -112,6 +112,7 @@ GeneralTab::GeneralTab(QWidget *_parent, const char *_name)
     //convert to minutes
     m_autosaveSpinBox->setValue(autosaveInterval / 60);
     m_autosaveCheckBox->setChecked(autosaveInterval > 0);
+    m_chkIncrementalAutosave->setChecked(cfg.autoSaveIncremental());
     m_undoStackSize->setValue(cfg.undoStackLimit());
     m_backupFileCheckBox->setChecked(cfg.backupFile());
     m_showOutlinePainting->setChecked(cfg.showOutlineWhilePainting());
@@ -149,6 +150,7 @@ void GeneralTab::setDefault()
     m_autosaveCheckBox->setChecked(cfg.autoSaveInterval(true) > 0);
     //convert to minutes
     m_autosaveSpinBox->setValue(cfg.autoSaveInterval(true) / 60);
+    m_chkIncrementalAutosave->setChecked(cfg.autoSaveIncremental(true));
     m_undoStackSize->setValue(cfg.undoStackLimit(true));
     m_backupFileCheckBox->setChecked(cfg.backupFile(true));
     m_showOutlinePainting->setChecked(cfg.showOutlineWhilePainting(true));
@@ -666,6 +668,7 @@ void PerformanceTab::load(bool requestDefault)
 
     chkPerformanceLogging->setChecked(cfg.enablePerfLog(requestDefault));
     chkProgressReporting->setChecked(cfg.enableProgressReporting(requestDefault));
+    chkRecursiveGaussianBlur->setChecked(cfg.useRecursiveGaussianBlur(requestDefault));
 
     sliderSwapSize->setValue(cfg.maxSwapSize(requestDefault) / 1024);
     lblSwapFileLocation->setText(cfg.swapDir(requestDefault));
@@ -687,6 +690,7 @@ void PerformanceTab::save()
 
     cfg.setEnablePerfLog(chkPerformanceLogging->isChecked());
     cfg.setEnableProgressReporting(chkProgressReporting->isChecked());
+    cfg.setUseRecursiveGaussianBlur(chkRecursiveGaussianBlur->isChecked());
 
     cfg.setMaxSwapSize(sliderSwapSize->value() * 1024);
 
@@ -1010,6 +1014,7 @@ bool KisDlgPreferences::editPreferences()
         cfg.setMDIBackgroundColor(dialog->m_general->m_mdiColor->color().toQColor());
         cfg.setMDIBackgroundImage(dialog->m_general->m_backgroundimage->text());
         cfg.setAutoSaveInterval(dialog->m_general->autoSaveInterval());
+        cfg.setAutoSaveIncremental(dialog->m_general->m_chkIncrementalAutosave->isChecked());
         cfg.setBackupFile(dialog->m_general->m_backupFileCheckBox->isChecked());
         cfg.setShowCanvasMessages(dialog->m_general->showCanvasMessages());
         cfg.setCompressKra(dialog->m_general->compressKra());
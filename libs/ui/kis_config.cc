@@ -939,6 +939,16 @@ void KisConfig::setAutoSaveInterval(int seconds)  const
     return m_cfg.writeEntry("AutoSaveInterval", seconds);
 }
 
+bool KisConfig::autoSaveIncremental(bool defaultValue) const
+{
+    return (defaultValue ? false : m_cfg.readEntry("AutoSaveIncremental", false));
+}
+
+void KisConfig::setAutoSaveIncremental(bool value) const
+{
+    m_cfg.writeEntry("AutoSaveIncremental", value);
+}
+
 bool KisConfig::backupFile(bool defaultValue) const
 {
     return (defaultValue ? true : m_cfg.readEntry("CreateBackupFile", true));
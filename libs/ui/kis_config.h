@@ -245,6 +245,9 @@ public:
     int autoSaveInterval(bool defaultValue = false) const;
     void setAutoSaveInterval(int seconds) const;
 
+    bool autoSaveIncremental(bool defaultValue = false) const;
+    void setAutoSaveIncremental(bool value) const;
+
     bool backupFile(bool defaultValue = false) const;
     void setBackupFile(bool backupFile) const;
 
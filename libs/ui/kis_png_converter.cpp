@@ -65,10 +65,25 @@
 #include <KoColorModelStandardIds.h>
 #include "dialogs/kis_dlg_png_import.h"
 #include "kis_clipboard.h"
+#include "kis_png_parallel_encoder.h"
 
 namespace
 {
 
+/**
+ * Closes the device when the export leaves buildFile(), whichever
+ * return path it takes
+ */
+struct CloseDeviceOnReturn {
+    CloseDeviceOnReturn(QIODevice *device) : m_device(device) {}
+    ~CloseDeviceOnReturn() {
+        if (m_device->isOpen()) {
+            m_device->close();
+        }
+    }
+
+    QIODevice *m_device;
+};
 
 int getColorTypeforColorSpace(const KoColorSpace * cs , bool alpha)
 {
@@ -900,6 +915,8 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
         return (KisImageBuilder_RESULT_FAILURE);
     }
 
+    CloseDeviceOnReturn deviceCloser(iodevice);
+
     if (!device)
         return KisImageBuilder_RESULT_INVALID_ARG;
 
@@ -1251,10 +1268,37 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
         }
     }
 
-    png_write_image(png_ptr, row_pointers);
+    if (!options.interlace) {
+        /**
+         * Filtering and deflating dominate the export time of large
+         * images, so we do them on all the cores ourselves and let
+         * libpng write only the header and the ancillary chunks.
+         */
+        const int channels = png_get_channels(png_ptr, info_ptr);
+
+        KisPNGParallelEncoder encoder(imageRect.width(), color_nb_bits, channels, options.compression);
+        encoder.setAdaptiveFiltering(color_type != PNG_COLOR_TYPE_PALETTE && color_nb_bits >= 8);
+#ifndef WORDS_BIGENDIAN
+        encoder.setSwapBytes(color_nb_bits > 8);
+#endif
+
+        if (!encoder.writeImageData(iodevice, row_pointers, imageRect.height())) {
+            png_destroy_write_struct(&png_ptr, &info_ptr);
+            for (int y = 0; y < imageRect.height(); y++) {
+                delete[] row_pointers[y];
+            }
+            delete[] row_pointers;
+            if (color_type == PNG_COLOR_TYPE_PALETTE) {
+                delete [] palette;
+            }
+            return KisImageBuilder_RESULT_FAILURE;
+        }
+    } else {
+        png_write_image(png_ptr, row_pointers);
 
-    // Writing is over
-    png_write_end(png_ptr, info_ptr);
+        // Writing is over
+        png_write_end(png_ptr, info_ptr);
+    }
 
     // Free memory
     png_destroy_write_struct(&png_ptr, &info_ptr);
@@ -1266,7 +1310,6 @@ KisImageBuilder_Result KisPNGConverter::buildFile(QIODevice* iodevice, const QRe
     if (color_type == PNG_COLOR_TYPE_PALETTE) {
         delete [] palette;
     }
-    iodevice->close();
     return KisImageBuilder_RESULT_OK;
 }
 
@@ -0,0 +1,397 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_png_parallel_encoder.h"
+
+#include <zlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include <QIODevice>
+#include <QVector>
+#include <QtEndian>
+#include <QtConcurrentMap>
+
+#include <kis_debug.h>
+
+
+namespace {
+
+const int groupTargetSize = 128 * 1024;
+const int dictionarySize = 32 * 1024;
+const int idatChunkSize = 256 * 1024;
+
+enum FilterType {
+    FilterNone = 0,
+    FilterSub,
+    FilterUp,
+    FilterAverage,
+    FilterPaeth,
+    NumFilters
+};
+
+inline quint8 paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = qAbs(p - a);
+    const int pb = qAbs(p - b);
+    const int pc = qAbs(p - c);
+
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+/**
+ * The same heuristic libpng uses: treat the filtered bytes as signed
+ * values and prefer the row with the smallest sum of their magnitudes.
+ */
+inline quint32 filteredRowCost(const quint8 *data, int size)
+{
+    quint32 cost = 0;
+    for (int i = 0; i < size; i++) {
+        const quint8 v = data[i];
+        cost += v < 128 ? v : 256 - v;
+    }
+    return cost;
+}
+
+struct RowGroup {
+    RowGroup() : firstRow(0), numRows(0), isLast(false), adler(0) {}
+
+    int firstRow;
+    int numRows;
+    bool isLast;
+
+    QByteArray filtered;
+    QByteArray compressed;
+    uLong adler;
+};
+
+struct EncoderContext {
+    const quint8* const *rows;
+    int rowBytes;
+    int bytesPerPixel;
+    int compressionLevel;
+    bool swapBytes;
+    bool adaptiveFiltering;
+    const QVector<RowGroup> *groups;
+};
+
+void copyRow(const EncoderContext &ctx, int row, quint8 *dst)
+{
+    const quint8 *src = ctx.rows[row];
+
+    if (!ctx.swapBytes) {
+        memcpy(dst, src, ctx.rowBytes);
+    } else {
+        for (int i = 0; i < ctx.rowBytes - 1; i += 2) {
+            dst[i] = src[i + 1];
+            dst[i + 1] = src[i];
+        }
+    }
+}
+
+void filterRow(const quint8 *row, const quint8 *prev, int size, int bpp, FilterType type, quint8 *dst)
+{
+    switch (type) {
+    case FilterNone:
+        memcpy(dst, row, size);
+        break;
+    case FilterSub:
+        for (int i = 0; i < size; i++) {
+            dst[i] = row[i] - (i >= bpp ? row[i - bpp] : 0);
+        }
+        break;
+    case FilterUp:
+        for (int i = 0; i < size; i++) {
+            dst[i] = row[i] - prev[i];
+        }
+        break;
+    case FilterAverage:
+        for (int i = 0; i < size; i++) {
+            const int left = i >= bpp ? row[i - bpp] : 0;
+            dst[i] = row[i] - ((left + prev[i]) >> 1);
+        }
+        break;
+    case FilterPaeth:
+        for (int i = 0; i < size; i++) {
+            const int left = i >= bpp ? row[i - bpp] : 0;
+            const int upperLeft = i >= bpp ? prev[i - bpp] : 0;
+            dst[i] = row[i] - paethPredictor(left, prev[i], upperLeft);
+        }
+        break;
+    case NumFilters:
+        break;
+    }
+}
+
+struct FilterGroup {
+    FilterGroup(const EncoderContext &ctx) : m_ctx(ctx) {}
+
+    void operator() (RowGroup &group) {
+        const int rowBytes = m_ctx.rowBytes;
+
+        group.filtered.resize(group.numRows * (rowBytes + 1));
+        quint8 *dst = reinterpret_cast<quint8*>(group.filtered.data());
+
+        QVector<quint8> buffer(rowBytes * (2 + NumFilters));
+        quint8 *currRow = buffer.data();
+        quint8 *prevRow = currRow + rowBytes;
+        quint8 *candidates = prevRow + rowBytes;
+
+        if (group.firstRow > 0) {
+            copyRow(m_ctx, group.firstRow - 1, prevRow);
+        } else {
+            memset(prevRow, 0, rowBytes);
+        }
+
+        for (int row = group.firstRow; row < group.firstRow + group.numRows; row++) {
+            copyRow(m_ctx, row, currRow);
+
+            FilterType bestType = FilterNone;
+            const quint8 *bestData = currRow;
+
+            if (m_ctx.adaptiveFiltering) {
+                quint32 bestCost = filteredRowCost(currRow, rowBytes);
+
+                for (int type = FilterSub; type < NumFilters; type++) {
+                    quint8 *candidate = candidates + type * rowBytes;
+                    filterRow(currRow, prevRow, rowBytes, m_ctx.bytesPerPixel, FilterType(type), candidate);
+
+                    const quint32 cost = filteredRowCost(candidate, rowBytes);
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestType = FilterType(type);
+                        bestData = candidate;
+                    }
+                }
+            }
+
+            *dst++ = bestType;
+            memcpy(dst, bestData, rowBytes);
+            dst += rowBytes;
+
+            std::swap(currRow, prevRow);
+        }
+
+        group.adler = adler32(0L, Z_NULL, 0);
+        group.adler = adler32(group.adler,
+                              reinterpret_cast<const Bytef*>(group.filtered.constData()),
+                              group.filtered.size());
+    }
+
+    const EncoderContext &m_ctx;
+};
+
+struct DeflateGroup {
+    DeflateGroup(const EncoderContext &ctx) : m_ctx(ctx) {}
+
+    void operator() (RowGroup &group) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(z_stream));
+
+        // negative window bits produce a raw deflate stream without a header
+        int result = deflateInit2(&stream, m_ctx.compressionLevel, Z_DEFLATED,
+                                  -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        if (result != Z_OK) {
+            warnFile << "KisPNGParallelEncoder: failed to initialize zlib" << result;
+            group.compressed.clear();
+            return;
+        }
+
+        const int groupIndex = &group - m_ctx.groups->constData();
+        if (groupIndex > 0) {
+            const QByteArray &prevData = m_ctx.groups->at(groupIndex - 1).filtered;
+            const int dictSize = qMin(dictionarySize, prevData.size());
+            deflateSetDictionary(&stream,
+                                 reinterpret_cast<const Bytef*>(prevData.constData() + prevData.size() - dictSize),
+                                 dictSize);
+        }
+
+        // a sync flush adds an empty stored block, leave some space for it
+        group.compressed.resize(deflateBound(&stream, group.filtered.size()) + 64);
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(group.filtered.constData()));
+        stream.avail_in = group.filtered.size();
+
+        const int flush = group.isLast ? Z_FINISH : Z_SYNC_FLUSH;
+
+        while (true) {
+            const int written = stream.total_out;
+            stream.next_out = reinterpret_cast<Bytef*>(group.compressed.data() + written);
+            stream.avail_out = group.compressed.size() - written;
+
+            result = deflate(&stream, flush);
+
+            if (result == Z_STREAM_END ||
+                (result == Z_OK && !group.isLast && stream.avail_in == 0 && stream.avail_out > 0)) {
+
+                break;
+            }
+
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                warnFile << "KisPNGParallelEncoder: failed to deflate a row group" << result;
+                deflateEnd(&stream);
+                group.compressed.clear();
+                return;
+            }
+
+            group.compressed.resize(2 * group.compressed.size());
+        }
+
+        group.compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        // the filtered data of this group is still used as a dictionary
+        // by the next one, so it is released only after all the jobs are done
+    }
+
+    const EncoderContext &m_ctx;
+};
+
+bool writeChunk(QIODevice *device, const char *type, const char *data, int size)
+{
+    uchar header[8];
+    qToBigEndian<quint32>(size, header);
+    memcpy(header + 4, type, 4);
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(data), size);
+
+    uchar footer[4];
+    qToBigEndian<quint32>(crc, footer);
+
+    return device->write(reinterpret_cast<const char*>(header), 8) == 8 &&
+        (!size || device->write(data, size) == size) &&
+        device->write(reinterpret_cast<const char*>(footer), 4) == 4;
+}
+
+}
+
+
+KisPNGParallelEncoder::KisPNGParallelEncoder(int width, int bitDepth, int channels, int compressionLevel)
+    : m_width(width),
+      m_bitDepth(bitDepth),
+      m_channels(channels),
+      m_compressionLevel(qBound(0, compressionLevel, 9)),
+      m_swapBytes(false),
+      m_adaptiveFiltering(bitDepth >= 8)
+{
+}
+
+void KisPNGParallelEncoder::setSwapBytes(bool value)
+{
+    m_swapBytes = value;
+}
+
+void KisPNGParallelEncoder::setAdaptiveFiltering(bool value)
+{
+    m_adaptiveFiltering = value;
+}
+
+int KisPNGParallelEncoder::rowBytes() const
+{
+    return (m_width * m_bitDepth * m_channels + 7) / 8;
+}
+
+QByteArray KisPNGParallelEncoder::compress(const quint8* const *rows, int numRows) const
+{
+    if (numRows <= 0) return QByteArray();
+
+    const int rowBytes = this->rowBytes();
+    const int rowsPerGroup = qMax(1, groupTargetSize / (rowBytes + 1));
+    const int numGroups = (numRows + rowsPerGroup - 1) / rowsPerGroup;
+
+    QVector<RowGroup> groups(numGroups);
+    for (int i = 0; i < numGroups; i++) {
+        RowGroup &group = groups[i];
+        group.firstRow = i * rowsPerGroup;
+        group.numRows = qMin(rowsPerGroup, numRows - group.firstRow);
+        group.isLast = i == numGroups - 1;
+    }
+
+    EncoderContext ctx;
+    ctx.rows = rows;
+    ctx.rowBytes = rowBytes;
+    ctx.bytesPerPixel = qMax(1, m_bitDepth * m_channels / 8);
+    ctx.compressionLevel = m_compressionLevel;
+    ctx.swapBytes = m_swapBytes && m_bitDepth == 16;
+    ctx.adaptiveFiltering = m_adaptiveFiltering;
+    ctx.groups = &groups;
+
+    /**
+     * Filtering and deflating are done in two passes, because every
+     * group needs the filtered tail of the previous one as a dictionary.
+     */
+    QtConcurrent::blockingMap(groups, FilterGroup(ctx));
+    QtConcurrent::blockingMap(groups, DeflateGroup(ctx));
+
+    /**
+     * Zlib header. The compression level hint is the same as the
+     * one zlib itself writes for the given level.
+     */
+    const int levelFlag =
+        m_compressionLevel < 2 ? 0 :
+        m_compressionLevel < 6 ? 1 :
+        m_compressionLevel == 6 ? 2 : 3;
+
+    const quint8 cmf = 0x78; // deflate, 32 KiB window
+    quint8 flg = levelFlag << 6;
+    flg += 31 - ((cmf << 8) + flg) % 31;
+
+    int totalSize = 2 + 4;
+    Q_FOREACH (const RowGroup &group, groups) {
+        if (group.compressed.isEmpty()) return QByteArray();
+        totalSize += group.compressed.size();
+    }
+
+    QByteArray result;
+    result.reserve(totalSize);
+    result.append(char(cmf));
+    result.append(char(flg));
+
+    uLong adler = adler32(0L, Z_NULL, 0);
+
+    Q_FOREACH (const RowGroup &group, groups) {
+        result.append(group.compressed);
+        adler = adler32_combine(adler, group.adler, group.filtered.size());
+    }
+
+    uchar adlerBytes[4];
+    qToBigEndian<quint32>(adler, adlerBytes);
+    result.append(reinterpret_cast<const char*>(adlerBytes), 4);
+
+    return result;
+}
+
+bool KisPNGParallelEncoder::writeImageData(QIODevice *device, const quint8* const *rows, int numRows) const
+{
+    const QByteArray data = compress(rows, numRows);
+    if (data.isEmpty()) return false;
+
+    for (int offset = 0; offset < data.size(); offset += idatChunkSize) {
+        const int size = qMin(idatChunkSize, data.size() - offset);
+        if (!writeChunk(device, "IDAT", data.constData() + offset, size)) {
+            return false;
+        }
+    }
+
+    return writeChunk(device, "IEND", 0, 0);
+}
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_PNG_PARALLEL_ENCODER_H
+#define __KIS_PNG_PARALLEL_ENCODER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include "kritaui_export.h"
+
+class QIODevice;
+
+/**
+ * Encodes the image data of a non-interlaced PNG file using all the
+ * available cores.
+ *
+ * The rows are split into groups of about 128 KiB. Every group is
+ * filtered and deflated on a separate worker thread and the resulting
+ * raw deflate streams are stitched into a single zlib stream, the way
+ * pigz does it. Every group is primed with the last 32 KiB of the
+ * preceding group, so the compression ratio is almost the same as
+ * the one of the serial libpng encoder.
+ *
+ * The rows passed to the encoder must already be in PNG layout
+ * (channel order and bit packing). Only the byte order of 16-bit
+ * samples can be swapped on the fly, see setSwapBytes().
+ */
+class KRITAUI_EXPORT KisPNGParallelEncoder
+{
+public:
+    /**
+     * @param width the width of the image in pixels
+     * @param bitDepth the number of bits per sample (1, 2, 4, 8 or 16)
+     * @param channels the number of samples per pixel
+     * @param compressionLevel zlib compression level (0...9)
+     */
+    KisPNGParallelEncoder(int width, int bitDepth, int channels, int compressionLevel);
+
+    /**
+     * Swap bytes of 16-bit samples while filtering. The equivalent of
+     * png_set_swap() for the libpng writer.
+     */
+    void setSwapBytes(bool value);
+
+    /**
+     * Select the adaptive filter per row (like libpng does for truecolor
+     * images). When disabled, all the rows use filter type None, which
+     * libpng uses for palette and low bit depth images.
+     */
+    void setAdaptiveFiltering(bool value);
+
+    /**
+     * The number of bytes in one unfiltered row
+     */
+    int rowBytes() const;
+
+    /**
+     * Filter and compress \p numRows rows into a zlib stream, which
+     * can be stored in IDAT chunks as it is.
+     */
+    QByteArray compress(const quint8* const *rows, int numRows) const;
+
+    /**
+     * Compress the rows and write IDAT and IEND chunks into \p device.
+     * The signature, IHDR and all the ancillary chunks are expected to
+     * be already written (e.g. by png_write_info()).
+     */
+    bool writeImageData(QIODevice *device, const quint8* const *rows, int numRows) const;
+
+private:
+    int m_width;
+    int m_bitDepth;
+    int m_channels;
+    int m_compressionLevel;
+    bool m_swapBytes;
+    bool m_adaptiveFiltering;
+};
+
+#endif /* __KIS_PNG_PARALLEL_ENCODER_H */
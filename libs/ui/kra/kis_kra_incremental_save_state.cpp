@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_kra_incremental_save_state.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include "kis_debug.h"
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+
+
+KisKraIncrementalSaveState::KisKraIncrementalSaveState()
+    : m_numKeptDevices(0),
+      m_numWrittenDevices(0)
+{
+}
+
+KisKraIncrementalSaveState::~KisKraIncrementalSaveState()
+{
+}
+
+void KisKraIncrementalSaveState::beginSave(const QString &storePath)
+{
+    if (storePath != m_storePath || !QFileInfo(storePath).isDir()) {
+        reset();
+        m_storePath = storePath;
+    }
+
+    m_pendingDevices.clear();
+    m_numKeptDevices = 0;
+    m_numWrittenDevices = 0;
+}
+
+void KisKraIncrementalSaveState::endSave(bool success)
+{
+    if (success) {
+        dbgFile << "Incremental save to" << m_storePath << "finished:"
+                << m_numWrittenDevices << "devices written,"
+                << m_numKeptDevices << "devices kept";
+
+        m_savedDevices = m_pendingDevices;
+        removeStaleLayerFiles();
+    } else {
+        reset();
+    }
+
+    m_pendingDevices.clear();
+    m_layersPath.clear();
+    m_nodeFileNames.clear();
+}
+
+void KisKraIncrementalSaveState::reset()
+{
+    m_storePath.clear();
+    m_savedDevices.clear();
+    m_pendingDevices.clear();
+    m_layersPath.clear();
+    m_nodeFileNames.clear();
+}
+
+bool KisKraIncrementalSaveState::tryKeepDevice(const QString &location, KisPaintDeviceSP device)
+{
+    QHash<QString, DeviceState>::const_iterator it = m_savedDevices.constFind(location);
+    if (it == m_savedDevices.constEnd()) return false;
+
+    const DeviceState &savedState = it.value();
+    const DeviceState currentState = stateForDevice(device);
+
+    if (!savedState.device.isValid() ||
+        savedState.device.data() != device.data() ||
+        !savedState.dataManager.isValid() ||
+        savedState.dataManager.data() != currentState.dataManager.data() ||
+        savedState.modificationCount != currentState.modificationCount ||
+        savedState.extent != currentState.extent ||
+        savedState.colorSpace != currentState.colorSpace ||
+        savedState.defaultPixel != currentState.defaultPixel) {
+
+        return false;
+    }
+
+    m_pendingDevices.insert(location, savedState);
+    m_numKeptDevices++;
+    return true;
+}
+
+void KisKraIncrementalSaveState::deviceSaved(const QString &location, KisPaintDeviceSP device)
+{
+    m_pendingDevices.insert(location, stateForDevice(device));
+    m_numWrittenDevices++;
+}
+
+void KisKraIncrementalSaveState::setLayerFiles(const QString &layersPath, const QStringList &nodeFileNames)
+{
+    m_layersPath = layersPath;
+    m_nodeFileNames = nodeFileNames;
+}
+
+void KisKraIncrementalSaveState::removeStaleLayerFiles()
+{
+    if (m_layersPath.isEmpty()) return;
+
+    QDir layersDir(m_storePath + '/' + m_layersPath);
+    if (!layersDir.exists()) return;
+
+    Q_FOREACH (const QString &fileName, layersDir.entryList(QDir::Files)) {
+        const QString nodeFileName = fileName.section('.', 0, 0);
+
+        if (!m_nodeFileNames.contains(nodeFileName)) {
+            dbgFile << "Removing the file of a deleted node" << fileName;
+            layersDir.remove(fileName);
+        }
+    }
+}
+
+KisKraIncrementalSaveState::DeviceState KisKraIncrementalSaveState::stateForDevice(KisPaintDeviceSP device)
+{
+    DeviceState state;
+    state.device = device;
+
+    KisDataManagerSP dataManager = device->dataManager();
+    state.dataManager = dataManager.data();
+    state.modificationCount = dataManager->modificationCount();
+
+    state.extent = device->extent();
+    state.colorSpace = device->colorSpace();
+
+    const KoColor defaultPixel = device->defaultPixel();
+    state.defaultPixel = QByteArray((const char*)defaultPixel.data(), device->colorSpace()->pixelSize());
+
+    return state;
+}
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_KRA_INCREMENTAL_SAVE_STATE_H
+#define __KIS_KRA_INCREMENTAL_SAVE_STATE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+
+#include "kis_types.h"
+#include "kritaui_export.h"
+
+class KoColorSpace;
+class KisDataManager;
+
+/**
+ * Remembers which paint devices have been written into a directory
+ * store during the previous save and in what state they were. When
+ * the document is saved into the same directory again (incremental
+ * autosave), the pixel data of the devices that haven't changed since
+ * then is not written again: the files of the previous save are kept
+ * as they are.
+ *
+ * A device is considered unchanged if it is the same object, it still
+ * uses the same data manager, the modification count of the data
+ * manager is the same and neither its extent, color space nor default
+ * pixel have changed.
+ *
+ * The layer files are named after the node UUIDs, so the files of the
+ * removed nodes are deleted from the directory after a successful save.
+ */
+class KRITAUI_EXPORT KisKraIncrementalSaveState
+{
+public:
+    KisKraIncrementalSaveState();
+    ~KisKraIncrementalSaveState();
+
+    /**
+     * Start saving into the directory store at \p storePath. If the
+     * directory differs from the one of the previous save or it
+     * doesn't exist anymore, everything is written from scratch.
+     */
+    void beginSave(const QString &storePath);
+
+    /**
+     * Finish the save. If the save failed, the state of the directory
+     * is unknown, so the next save will write everything again.
+     * Otherwise, the files in the layers directory that don't belong
+     * to any of the saved nodes are removed.
+     */
+    void endSave(bool success);
+
+    /**
+     * Forget everything about the previous saves
+     */
+    void reset();
+
+    /**
+     * @return true if \p device has been saved at \p location during the
+     * previous save and hasn't changed since then. The device is then
+     * recorded as being part of the current save as well.
+     */
+    bool tryKeepDevice(const QString &location, KisPaintDeviceSP device);
+
+    /**
+     * Record that \p device has been written at \p location
+     */
+    void deviceSaved(const QString &location, KisPaintDeviceSP device);
+
+    /**
+     * Set the directory of the layer files, relative to the store
+     * root, and the file names of the nodes saved into it. All the
+     * files of a node start with its file name.
+     */
+    void setLayerFiles(const QString &layersPath, const QStringList &nodeFileNames);
+
+private:
+    struct DeviceState {
+        KisPaintDeviceWSP device;
+        KisWeakSharedPtr<KisDataManager> dataManager;
+        int modificationCount;
+        QRect extent;
+        const KoColorSpace *colorSpace;
+        QByteArray defaultPixel;
+    };
+
+    static DeviceState stateForDevice(KisPaintDeviceSP device);
+
+    void removeStaleLayerFiles();
+
+private:
+    QString m_storePath;
+    QHash<QString, DeviceState> m_savedDevices;
+    QHash<QString, DeviceState> m_pendingDevices;
+    QString m_layersPath;
+    QStringList m_nodeFileNames;
+    int m_numKeptDevices;
+    int m_numWrittenDevices;
+};
+
+#endif /* __KIS_KRA_INCREMENTAL_SAVE_STATE_H */
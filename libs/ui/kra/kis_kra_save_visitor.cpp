@@ -20,6 +20,7 @@
 
 #include "kra/kis_kra_save_visitor.h"
 #include "kra/kis_kra_tags.h"
+#include "kra/kis_kra_incremental_save_state.h"
 
 #include <QBuffer>
 #include <QByteArray>
@@ -74,6 +75,7 @@ KisKraSaveVisitor::KisKraSaveVisitor(KoStore *store, const QString & name, QMap<
     , m_name(name)
     , m_nodeFileNames(nodeFileNames)
     , m_writer(new KisStorePaintDeviceWriter(store))
+    , m_incrementalSaveState(0)
 {
 }
 
@@ -89,6 +91,11 @@ void KisKraSaveVisitor::setExternalUri(const QString &uri)
     m_uri = uri;
 }
 
+void KisKraSaveVisitor::setIncrementalSaveState(KisKraIncrementalSaveState *state)
+{
+    m_incrementalSaveState = state;
+}
+
 bool KisKraSaveVisitor::visit(KisExternalLayer * layer)
 {
     bool result = false;
@@ -344,7 +351,19 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
     }
 
     if (!frameInterface || frames.count() <= 1) {
-        savePaintDeviceFrame(device, location, SimpleDevicePolicy());
+        // the animated devices are always written as a whole
+        const QString storeLocation = m_store->currentPath() + location;
+
+        if (m_incrementalSaveState &&
+            m_incrementalSaveState->tryKeepDevice(storeLocation, device)) {
+
+            dbgFile << "Keeping unchanged pixel data at" << storeLocation;
+
+        } else if (!savePaintDeviceFrame(device, location, SimpleDevicePolicy())) {
+            return false;
+        } else if (m_incrementalSaveState) {
+            m_incrementalSaveState->deviceSaved(storeLocation, device);
+        }
     } else {
         KisRasterKeyframeChannel *keyframeChannel = device->keyframeChannel();
 
@@ -368,20 +387,25 @@ bool KisKraSaveVisitor::savePaintDevice(KisPaintDeviceSP device,
 template<class DevicePolicy>
 bool KisKraSaveVisitor::savePaintDeviceFrame(KisPaintDeviceSP device, QString location, DevicePolicy policy)
 {
-    if (m_store->open(location)) {
-        if (!policy.write(device, *m_writer)) {
-            device->disconnect();
-            m_store->close();
-            return false;
-        }
+    if (!m_store->open(location)) {
+        return false;
+    }
 
+    if (!policy.write(device, *m_writer)) {
+        device->disconnect();
         m_store->close();
+        return false;
     }
-    if (m_store->open(location + ".defaultpixel")) {
-        m_store->write((char*)policy.defaultPixel(device).data(), device->colorSpace()->pixelSize());
-        m_store->close();
+
+    m_store->close();
+
+    if (!m_store->open(location + ".defaultpixel")) {
+        return false;
     }
 
+    m_store->write((char*)policy.defaultPixel(device).data(), device->colorSpace()->pixelSize());
+    m_store->close();
+
     return true;
 }
 
@@ -29,6 +29,7 @@
 
 
 class KisPaintDeviceWriter;
+class KisKraIncrementalSaveState;
 class KoStore;
 
 class KisKraSaveVisitor : public KisNodeVisitor
@@ -41,6 +42,12 @@ public:
 public:
     void setExternalUri(const QString &uri);
 
+    /**
+     * Skip writing the paint devices that haven't changed since the
+     * previous save into the same directory store
+     */
+    void setIncrementalSaveState(KisKraIncrementalSaveState *state);
+
     bool visit(KisNode*) {
         return true;
     }
@@ -92,6 +99,7 @@ private:
     QString m_name;
     QMap<const KisNode*, QString> m_nodeFileNames;
     KisPaintDeviceWriter *m_writer;
+    KisKraIncrementalSaveState *m_incrementalSaveState;
     QStringList m_errorMessages;
 };
 
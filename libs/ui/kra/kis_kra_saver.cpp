@@ -21,6 +21,7 @@
 #include "kis_kra_tags.h"
 #include "kis_kra_save_visitor.h"
 #include "kis_kra_savexml_visitor.h"
+#include "kis_kra_incremental_save_state.h"
 
 #include <QDomDocument>
 #include <QDomElement>
@@ -71,12 +72,14 @@ public:
     QMap<const KisNode*, QString> keyframeFilenames;
     QString imageName;
     QStringList errorMessages;
+    KisKraIncrementalSaveState *incrementalSaveState;
 };
 
 KisKraSaver::KisKraSaver(KisDocument* document)
         : m_d(new Private)
 {
     m_d->doc = document;
+    m_d->incrementalSaveState = 0;
 
     m_d->imageName = m_d->doc->documentInfo()->aboutInfo("title");
     if (m_d->imageName.isEmpty()) {
@@ -89,6 +92,11 @@ KisKraSaver::~KisKraSaver()
     delete m_d;
 }
 
+void KisKraSaver::setIncrementalSaveState(KisKraIncrementalSaveState *state)
+{
+    m_d->incrementalSaveState = state;
+}
+
 QDomElement KisKraSaver::saveXML(QDomDocument& doc,  KisImageWSP image)
 {
     QDomElement imageElement = doc.createElement("IMAGE"); // Legacy!
@@ -116,6 +124,7 @@ QDomElement KisKraSaver::saveXML(QDomDocument& doc,  KisImageWSP image)
     quint32 count = 1; // We don't save the root layer, but it does count
     KisSaveXmlVisitor visitor(doc, imageElement, count, m_d->doc->url().toLocalFile(), true);
     visitor.setSelectedNodes(m_d->doc->activeNodes());
+    visitor.setStableFileNames(m_d->incrementalSaveState != 0);
 
     image->rootLayer()->accept(visitor);
     m_d->errorMessages.append(visitor.errorMessages());
@@ -193,6 +202,13 @@ bool KisKraSaver::saveBinaryData(KoStore* store, KisImageWSP image, const QStrin
     if (external)
         visitor.setExternalUri(uri);
 
+    visitor.setIncrementalSaveState(m_d->incrementalSaveState);
+
+    if (m_d->incrementalSaveState && !external) {
+        m_d->incrementalSaveState->setLayerFiles(store->currentPath() + m_d->imageName + LAYER_PATH,
+                                                 m_d->nodeFileNames.values());
+    }
+
     image->rootLayer()->accept(visitor);
 
     m_d->errorMessages.append(visitor.errorMessages());
@@ -22,6 +22,7 @@
 #include <kis_types.h>
 
 class KisDocument;
+class KisKraIncrementalSaveState;
 class QDomElement;
 class QDomDocument;
 class KoStore;
@@ -36,6 +37,14 @@ public:
 
     ~KisKraSaver();
 
+    /**
+     * Save into a directory store incrementally: the layer files get
+     * names that don't change when other layers are added or removed,
+     * and the pixel data that hasn't changed since the previous save
+     * recorded in \p state is not written again.
+     */
+    void setIncrementalSaveState(KisKraIncrementalSaveState *state);
+
     QDomElement saveXML(QDomDocument& doc,  KisImageWSP image);
 
     bool saveKeyframes(KoStore *store, const QString &uri, bool external);
@@ -57,6 +57,7 @@ KisSaveXmlVisitor::KisSaveXmlVisitor(QDomDocument doc, const QDomElement & eleme
     , m_count(count)
     , m_url(url)
     , m_root(root)
+    , m_stableFileNames(false)
 {
     Q_ASSERT(!element.isNull());
     m_elem = element;
@@ -67,6 +68,11 @@ void KisSaveXmlVisitor::setSelectedNodes(vKisNodeSP selectedNodes)
     m_selectedNodes = selectedNodes;
 }
 
+void KisSaveXmlVisitor::setStableFileNames(bool value)
+{
+    m_stableFileNames = value;
+}
+
 QStringList KisSaveXmlVisitor::errorMessages() const
 {
     return m_errorMessages;
@@ -156,6 +162,7 @@ bool KisSaveXmlVisitor::visit(KisGroupLayer *layer)
     layerElement.appendChild(elem);
     KisSaveXmlVisitor visitor(m_doc, elem, m_count, m_url, false);
     visitor.setSelectedNodes(m_selectedNodes);
+    visitor.setStableFileNames(m_stableFileNames);
     m_count++;
     bool success = visitor.visitAllInverse(layer);
 
@@ -352,7 +359,7 @@ void KisSaveXmlVisitor::saveNodeKeyframes(const KisNode* node, QString nodeFilen
 
 void KisSaveXmlVisitor::saveLayer(QDomElement & el, const QString & layerType, const KisLayer * layer)
 {
-    QString filename = LAYER + QString::number(m_count);
+    QString filename = nodeFileName(LAYER, layer);
 
     el.setAttribute(CHANNEL_FLAGS, flagsToString(layer->channelFlags()));
     el.setAttribute(NAME, layer->name());
@@ -386,12 +393,12 @@ void KisSaveXmlVisitor::saveLayer(QDomElement & el, const QString & layerType, c
     dbgFile << "Saved layer "
             << layer->name()
             << " of type " << layerType
-            << " with filename " << LAYER + QString::number(m_count);
+            << " with filename " << filename;
 }
 
 void KisSaveXmlVisitor::saveMask(QDomElement & el, const QString & maskType, const KisMaskSP mask)
 {
-    QString filename = MASK + QString::number(m_count);
+    QString filename = nodeFileName(MASK, mask.data());
 
     el.setAttribute(NAME, mask->name());
     el.setAttribute(VISIBLE, mask->visible());
@@ -421,6 +428,15 @@ void KisSaveXmlVisitor::saveMask(QDomElement & el, const QString & maskType, con
             << " with filename " << filename;
 }
 
+QString KisSaveXmlVisitor::nodeFileName(const QString &prefix, const KisNode *node) const
+{
+    if (m_stableFileNames) {
+        return prefix + node->uuid().toString().remove('{').remove('}');
+    }
+
+    return prefix + QString::number(m_count);
+}
+
 bool KisSaveXmlVisitor::saveMasks(KisNode * node, QDomElement & layerElement)
 {
     if (node->childCount() > 0) {
@@ -429,6 +445,7 @@ bool KisSaveXmlVisitor::saveMasks(KisNode * node, QDomElement & layerElement)
         layerElement.appendChild(elem);
         KisSaveXmlVisitor visitor(m_doc, elem, m_count, m_url, false);
         visitor.setSelectedNodes(m_selectedNodes);
+        visitor.setStableFileNames(m_stableFileNames);
         bool success = visitor.visitAllInverse(node);
         m_errorMessages.append(visitor.errorMessages());
         if (!m_errorMessages.isEmpty()) {
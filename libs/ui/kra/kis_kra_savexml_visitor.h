@@ -34,6 +34,13 @@ public:
 
     void setSelectedNodes(vKisNodeSP selectedNodes);
 
+    /**
+     * Name the layer files after the UUIDs of the nodes instead of their
+     * position in the stack, so that the names survive adding or removing
+     * other layers. Used by the incremental autosave.
+     */
+    void setStableFileNames(bool value);
+
     using KisNodeVisitor::visit;
 
     QStringList errorMessages() const;
@@ -78,6 +85,7 @@ private:
     void saveMask(QDomElement & el, const QString & maskType, const KisMaskSP mask);
     bool saveMasks(KisNode * node, QDomElement & layerElement);
     void saveNodeKeyframes(const KisNode *node, QString filename, QDomElement& el);
+    QString nodeFileName(const QString &prefix, const KisNode *node) const;
 
     friend class KisKraSaveXmlVisitorTest;
 
@@ -89,6 +97,7 @@ private:
     quint32 &m_count;
     QString m_url;
     bool m_root;
+    bool m_stableFileNames;
     QStringList m_errorMessages;
 };
 
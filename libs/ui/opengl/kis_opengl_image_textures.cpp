@@ -17,6 +17,7 @@
  */
 
 #include "opengl/kis_opengl_image_textures.h"
+#include "opengl/kis_texture_tile_info_converter.h"
 
 #include <QOpenGLFunctions>
 #include <QOpenGLContext>
@@ -32,6 +33,7 @@
 #include "kis_image.h"
 #include "kis_config.h"
 #include "KisPart.h"
+#include "kis_trace.h"
 
 #ifdef HAVE_OPENEXR
 #include <half.h>
@@ -257,6 +259,8 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheNoConversion(const QRec
 
 KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect, bool convertColorSpace)
 {
+    KIS_TRACE_SCOPE("KisOpenGLImageTextures::updateCache", "canvas");
+
     const KoColorSpace *dstCS = m_tilesDestinationColorSpace;
 
     ConversionOptions options;
@@ -331,23 +335,6 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
                                                      m_infoChunksPool));
             // Don't update empty tiles
             if (tileInfo->valid()) {
-                tileInfo->retrieveData(m_image, channelFlags, m_onlyOneChannelSelected, m_selectedChannelIndex);
-
-                //create transform
-                if (m_createNewProofingTransform) {
-                    const KoColorSpace *proofingSpace = KoColorSpaceRegistry::instance()->colorSpace(m_proofingConfig->proofingModel,m_proofingConfig->proofingDepth,m_proofingConfig->proofingProfile);
-                    m_proofingTransform.reset(tileInfo->generateProofingTransform(dstCS, proofingSpace, m_renderingIntent, m_proofingConfig->intent, m_proofingConfig->conversionFlags, m_proofingConfig->warningColor, m_proofingConfig->adaptationState));
-                    m_createNewProofingTransform = false;
-                }
-
-                if (convertColorSpace) {
-                    if (m_proofingConfig && m_proofingTransform && m_proofingConfig->conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing)) {
-                        tileInfo->proofTo(dstCS, m_proofingConfig->conversionFlags, m_proofingTransform.data());
-                    } else {
-                        tileInfo->convertTo(dstCS, m_renderingIntent, m_conversionFlags);
-                    }
-                }
-
                 info->tileList.append(tileInfo);
             }
             else {
@@ -356,6 +343,37 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
         }
     }
 
+    if (info->tileList.isEmpty()) {
+        info->assignDirtyImageRect(rect);
+        info->assignLevelOfDetail(levelOfDetail);
+        return info;
+    }
+
+    //create transform
+    if (m_createNewProofingTransform) {
+        const KoColorSpace *proofingSpace = KoColorSpaceRegistry::instance()->colorSpace(m_proofingConfig->proofingModel,m_proofingConfig->proofingDepth,m_proofingConfig->proofingProfile);
+        const KoColorSpace *projectionCs = m_image->projection()->colorSpace();
+        m_proofingTransform.reset(projectionCs->createProofingTransform(dstCS, proofingSpace, m_renderingIntent, m_proofingConfig->intent, m_proofingConfig->conversionFlags, m_proofingConfig->warningColor.data(), m_proofingConfig->adaptationState));
+        m_createNewProofingTransform = false;
+    }
+
+    /**
+     * Reading and conversion of the tiles is the most expensive part
+     * of the update, so it is done for all the tiles in parallel
+     */
+    KisTextureTileInfoConverter converter;
+    converter.setChannelFlags(channelFlags, m_onlyOneChannelSelected, m_selectedChannelIndex);
+
+    if (convertColorSpace) {
+        if (m_proofingConfig && m_proofingTransform && m_proofingConfig->conversionFlags.testFlag(KoColorConversionTransformation::SoftProofing)) {
+            converter.setProofing(dstCS, m_proofingConfig->conversionFlags, m_proofingTransform.data());
+        } else {
+            converter.setConversion(dstCS, m_renderingIntent, m_conversionFlags);
+        }
+    }
+
+    converter.processTiles(m_image, info->tileList);
+
     info->assignDirtyImageRect(rect);
     info->assignLevelOfDetail(levelOfDetail);
     return info;
@@ -363,6 +381,8 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
 
 void KisOpenGLImageTextures::recalculateCache(KisUpdateInfoSP info)
 {
+    KIS_TRACE_SCOPE("KisOpenGLImageTextures::recalculateCache", "canvas");
+
     if (!m_initialized) {
         dbgUI << "OpenGL: Tried to edit image texture cache before it was initialized.";
         return;
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_texture_tile_info_converter.h"
+
+#include <QtConcurrentMap>
+
+#include <KoColorSpace.h>
+
+
+KisTextureTileInfoConverter::KisTextureTileInfoConverter()
+    : m_onlyOneChannelSelected(false),
+      m_selectedChannelIndex(0),
+      m_dstColorSpace(0),
+      m_renderingIntent(KoColorConversionTransformation::internalRenderingIntent()),
+      m_conversionFlags(KoColorConversionTransformation::internalConversionFlags()),
+      m_proofingTransform(0)
+{
+}
+
+void KisTextureTileInfoConverter::setChannelFlags(const QBitArray &channelFlags,
+                                                  bool onlyOneChannelSelected,
+                                                  int selectedChannelIndex)
+{
+    m_channelFlags = channelFlags;
+    m_onlyOneChannelSelected = onlyOneChannelSelected;
+    m_selectedChannelIndex = selectedChannelIndex;
+}
+
+void KisTextureTileInfoConverter::setConversion(const KoColorSpace *dstColorSpace,
+                                                KoColorConversionTransformation::Intent renderingIntent,
+                                                KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    m_dstColorSpace = dstColorSpace;
+    m_renderingIntent = renderingIntent;
+    m_conversionFlags = conversionFlags;
+    m_proofingTransform = 0;
+}
+
+void KisTextureTileInfoConverter::setProofing(const KoColorSpace *dstColorSpace,
+                                              KoColorConversionTransformation::ConversionFlags conversionFlags,
+                                              KoColorConversionTransformation *proofingTransform)
+{
+    m_dstColorSpace = dstColorSpace;
+    m_conversionFlags = conversionFlags;
+    m_proofingTransform = proofingTransform;
+}
+
+void KisTextureTileInfoConverter::processTile(KisImageSP image, KisTextureTileUpdateInfoSP tile) const
+{
+    tile->retrieveData(image, m_channelFlags, m_onlyOneChannelSelected, m_selectedChannelIndex);
+
+    if (!m_dstColorSpace) return;
+
+    if (m_proofingTransform) {
+        tile->proofTo(m_dstColorSpace, m_conversionFlags, m_proofingTransform);
+    } else {
+        tile->convertTo(m_dstColorSpace, m_renderingIntent, m_conversionFlags);
+    }
+}
+
+void KisTextureTileInfoConverter::processTiles(KisImageSP image, const KisTextureTileUpdateInfoSPList &tiles) const
+{
+    /**
+     * Small updates made while painting usually touch only one or
+     * two tiles, it is not worth waking up the other threads for them
+     */
+    if (tiles.size() <= 1) {
+        Q_FOREACH (KisTextureTileUpdateInfoSP tile, tiles) {
+            processTile(image, tile);
+        }
+        return;
+    }
+
+    // blockingMap() needs a mutable sequence, copying the pointers is cheap
+    KisTextureTileUpdateInfoSPList jobs = tiles;
+
+    QtConcurrent::blockingMap(jobs,
+        [this, image] (KisTextureTileUpdateInfoSP tile) {
+            processTile(image, tile);
+        });
+}
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TEXTURE_TILE_INFO_CONVERTER_H
+#define __KIS_TEXTURE_TILE_INFO_CONVERTER_H
+
+#include <QBitArray>
+
+#include <KoColorConversionTransformation.h>
+
+#include "kritaui_export.h"
+#include "kis_types.h"
+#include "opengl/kis_texture_tile_update_info.h"
+
+class KoColorSpace;
+
+
+/**
+ * KisTextureTileInfoConverter fills the update infos of the texture
+ * tiles with the data of the image projection: it reads the pixels,
+ * applies the channel flags and converts (or proofs) the pixels into
+ * the color space of the textures.
+ *
+ * That is pure CPU work not needing any openGL context, so the tiles
+ * are processed in parallel on the threads of the global thread pool.
+ * The buffers of the tiles are allocated from the shared chunks pool
+ * of the update infos.
+ */
+class KRITAUI_EXPORT KisTextureTileInfoConverter
+{
+public:
+    KisTextureTileInfoConverter();
+
+    /**
+     * Set the channel flags applied to the pixels. Empty \p
+     * channelFlags mean that all the channels are shown.
+     */
+    void setChannelFlags(const QBitArray &channelFlags,
+                         bool onlyOneChannelSelected,
+                         int selectedChannelIndex);
+
+    /**
+     * Convert the pixels into \p dstColorSpace
+     */
+    void setConversion(const KoColorSpace *dstColorSpace,
+                       KoColorConversionTransformation::Intent renderingIntent,
+                       KoColorConversionTransformation::ConversionFlags conversionFlags);
+
+    /**
+     * Proof the pixels into \p dstColorSpace using \p proofingTransform.
+     * The transform is not owned by the converter.
+     */
+    void setProofing(const KoColorSpace *dstColorSpace,
+                     KoColorConversionTransformation::ConversionFlags conversionFlags,
+                     KoColorConversionTransformation *proofingTransform);
+
+    /**
+     * Fill all the \p tiles with the data of the projection of \p
+     * image. Returns when all the tiles are ready.
+     */
+    void processTiles(KisImageSP image, const KisTextureTileUpdateInfoSPList &tiles) const;
+
+private:
+    void processTile(KisImageSP image, KisTextureTileUpdateInfoSP tile) const;
+
+private:
+    QBitArray m_channelFlags;
+    bool m_onlyOneChannelSelected;
+    int m_selectedChannelIndex;
+
+    const KoColorSpace *m_dstColorSpace;
+    KoColorConversionTransformation::Intent m_renderingIntent;
+    KoColorConversionTransformation::ConversionFlags m_conversionFlags;
+    KoColorConversionTransformation *m_proofingTransform;
+};
+
+#endif /* __KIS_TEXTURE_TILE_INFO_CONVERTER_H */
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_freehand_stroke_record_test.h"
+
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "kis_freehand_stroke_record.h"
+
+
+static void comparePaintInformation(const KisPaintInformation &pi1,
+                                    const KisPaintInformation &pi2)
+{
+    QCOMPARE(pi1.pos(), pi2.pos());
+    QCOMPARE(pi1.pressure(), pi2.pressure());
+    QCOMPARE(pi1.xTilt(), pi2.xTilt());
+    QCOMPARE(pi1.yTilt(), pi2.yTilt());
+    QCOMPARE(pi1.rotation(), pi2.rotation());
+    QCOMPARE(pi1.tangentialPressure(), pi2.tangentialPressure());
+    QCOMPARE(pi1.perspective(), pi2.perspective());
+    QCOMPARE(pi1.currentTime(), pi2.currentTime());
+    QCOMPARE(pi1.drawingSpeed(), pi2.drawingSpeed());
+}
+
+void KisFreehandStrokeRecordTest::testSaveLoad()
+{
+    KisPaintInformation pi1(QPointF(10.5, 20.25), 0.3, 12.0, -7.5, 45.0, 0.1, 1.0, 16.0, 0.75);
+    KisPaintInformation pi2(QPointF(30.125, 22.0), 0.85, -3.0, 15.0, 90.0, 0.0, 1.0, 32.0, 1.25);
+    KisPaintInformation pi3(QPointF(50.0, 40.0), 1.0, 0.0, 0.0, 0.0, 0.5, 1.0, 48.0, 0.5);
+
+    KisFreehandStrokeRecord record;
+    record.setImageSize(QSize(1024, 768));
+    record.setPresetName("Basic_tip_default");
+    record.addPoint(0, 0, pi1);
+    record.addLine(16, 1, pi1, pi2);
+    record.addCurve(32, 0, pi2, QPointF(35.5, 25.0), QPointF(45.0, 37.5), pi3);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.path() + "/stroke.xml";
+
+    QVERIFY(record.save(fileName));
+
+    KisFreehandStrokeRecord loaded;
+    QVERIFY(loaded.load(fileName));
+
+    QCOMPARE(loaded.imageSize(), record.imageSize());
+    QCOMPARE(loaded.presetName(), record.presetName());
+    QCOMPARE(loaded.numPainters(), 2);
+    QCOMPARE(loaded.jobs().size(), record.jobs().size());
+
+    for (int i = 0; i < record.jobs().size(); i++) {
+        const KisFreehandStrokeRecord::Job &expected = record.jobs()[i];
+        const KisFreehandStrokeRecord::Job &job = loaded.jobs()[i];
+
+        QCOMPARE(job.type, expected.type);
+        QCOMPARE(job.painterInfoId, expected.painterInfoId);
+        QCOMPARE(job.time, expected.time);
+
+        comparePaintInformation(job.pi1, expected.pi1);
+
+        if (job.type != KisFreehandStrokeRecord::POINT) {
+            comparePaintInformation(job.pi2, expected.pi2);
+        }
+
+        if (job.type == KisFreehandStrokeRecord::CURVE) {
+            QCOMPARE(job.control1, expected.control1);
+            QCOMPARE(job.control2, expected.control2);
+        }
+    }
+}
+
+void KisFreehandStrokeRecordTest::testLoadInvalidFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    KisFreehandStrokeRecord record;
+    QVERIFY(!record.load(dir.path() + "/nonexistent.xml"));
+
+    const QString fileName = dir.path() + "/invalid.xml";
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<someOtherDocument/>");
+    file.close();
+
+    QVERIFY(!record.load(fileName));
+}
+
+QTEST_MAIN(KisFreehandStrokeRecordTest)
@@ -56,6 +56,16 @@
 #include <generator/kis_generator_registry.h>
 
 #include <KoResourcePaths.h>
+#include <KoStore.h>
+
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "kis_painter.h"
+#include "kis_sequential_iterator.h"
+#include "kis_store_paintdevice_writer.h"
+#include "kra/kis_kra_incremental_save_state.h"
+#include "kra/kis_kra_save_visitor.h"
 
 void KisKraSaverTest::initTestCase()
 {
@@ -426,4 +436,197 @@ void KisKraSaverTest::testRoundTripColorizeMask()
     QCOMPARE(strokes[2].color.colorSpace(), weirdCS);
 }
 
+namespace {
+
+bool saveDevicesIncrementally(KisKraIncrementalSaveState &state,
+                              const QString &storePath,
+                              const QMap<QString, KisPaintDeviceSP> &devices,
+                              QStringList *writtenFiles)
+{
+    state.beginSave(storePath);
+
+    QScopedPointer<KoStore> store(KoStore::createStore(storePath, KoStore::Write, "", KoStore::Directory));
+    if (store->bad()) return false;
+
+    KisStorePaintDeviceWriter writer(store.data());
+    QStringList nodeFileNames;
+
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        const QString location = "layers/" + it.key();
+        nodeFileNames << it.key();
+
+        if (state.tryKeepDevice(location, it.value())) continue;
+
+        if (!store->open(location)) return false;
+        bool result = it.value()->write(writer);
+        store->close();
+        if (!result) return false;
+
+        state.deviceSaved(location, it.value());
+        *writtenFiles << it.key();
+    }
+
+    state.setLayerFiles("layers/", nodeFileNames);
+
+    const bool result = store->finalize();
+    state.endSave(result);
+    return result;
+}
+
+KisPaintDeviceSP loadDevice(const QString &storePath, const QString &fileName, const KoColorSpace *cs)
+{
+    QScopedPointer<KoStore> store(KoStore::createStore(storePath, KoStore::Read, "", KoStore::Directory));
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    if (store->bad() || !store->open("layers/" + fileName)) return 0;
+    bool result = dev->read(store->device());
+    store->close();
+
+    return result ? dev : 0;
+}
+
+}
+
+void KisKraSaverTest::testIncrementalSaveState()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisPaintDeviceSP dev1 = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev2 = new KisPaintDevice(cs);
+    dev1->fill(QRect(0,0,64,64), KoColor(Qt::red, cs));
+    dev2->fill(QRect(0,0,64,64), KoColor(Qt::blue, cs));
+
+    QTemporaryDir storeDir;
+    QVERIFY(storeDir.isValid());
+
+    const QString storePath = storeDir.path() + "/autosave";
+
+    KisKraIncrementalSaveState state;
+    QMap<QString, KisPaintDeviceSP> devices;
+    devices.insert("layer1", dev1);
+    devices.insert("layer2", dev2);
+
+    QStringList writtenFiles;
+
+    // the first save writes everything
+    QVERIFY(saveDevicesIncrementally(state, storePath, devices, &writtenFiles));
+    QCOMPARE(writtenFiles, QStringList() << "layer1" << "layer2");
+
+    // nothing has changed, nothing is written
+    writtenFiles.clear();
+    QVERIFY(saveDevicesIncrementally(state, storePath, devices, &writtenFiles));
+    QVERIFY(writtenFiles.isEmpty());
+
+    // painting doesn't change the sequence number of the device,
+    // but the device must still be written
+    {
+        KisPainter gc(dev2);
+        gc.fillRect(QRect(10,10,20,20), KoColor(Qt::green, cs));
+    }
+
+    writtenFiles.clear();
+    QVERIFY(saveDevicesIncrementally(state, storePath, devices, &writtenFiles));
+    QCOMPARE(writtenFiles, QStringList() << "layer2");
+
+    // the same happens when writing through an iterator
+    {
+        KisSequentialIterator it(dev1, QRect(0,0,8,8));
+        const KoColor color(Qt::white, cs);
+        do {
+            memcpy(it.rawData(), color.data(), cs->pixelSize());
+        } while (it.nextPixel());
+    }
+
+    writtenFiles.clear();
+    QVERIFY(saveDevicesIncrementally(state, storePath, devices, &writtenFiles));
+    QCOMPARE(writtenFiles, QStringList() << "layer1");
+
+    // the store contains the latest pixels of both devices
+    KisPaintDeviceSP loaded1 = loadDevice(storePath, "layer1", cs);
+    KisPaintDeviceSP loaded2 = loadDevice(storePath, "layer2", cs);
+    QVERIFY(loaded1);
+    QVERIFY(loaded2);
+
+    QPoint errpoint;
+    QVERIFY(TestUtil::comparePaintDevices(errpoint, dev1, loaded1));
+    QVERIFY(TestUtil::comparePaintDevices(errpoint, dev2, loaded2));
+
+    // the files of the removed nodes are deleted
+    devices.remove("layer1");
+    writtenFiles.clear();
+    QVERIFY(saveDevicesIncrementally(state, storePath, devices, &writtenFiles));
+    QVERIFY(writtenFiles.isEmpty());
+    QVERIFY(!QFileInfo(storePath + "/layers/layer1").exists());
+    QVERIFY(QFileInfo(storePath + "/layers/layer2").exists());
+
+    // another device at the same location must be written
+    state.beginSave(storePath);
+    QVERIFY(!state.tryKeepDevice("layers/layer2", dev1));
+    state.deviceSaved("layers/layer2", dev1);
+    state.endSave(true);
+
+    // a failed save makes the next one write everything
+    state.beginSave(storePath);
+    QVERIFY(state.tryKeepDevice("layers/layer2", dev1));
+    state.endSave(false);
+
+    state.beginSave(storePath);
+    QVERIFY(!state.tryKeepDevice("layers/layer2", dev1));
+    state.endSave(true);
+}
+
+void KisKraSaverTest::testIncrementalSaveFailedOpen()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, 64, 64, cs, "test image");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+    layer->paintDevice()->fill(QRect(0,0,64,64), KoColor(Qt::red, cs));
+
+    QMap<const KisNode*, QString> nodeFileNames;
+    nodeFileNames.insert(layer.data(), "layer1");
+
+    const QString location = "test/layers/layer1";
+
+    QStringList blockedFiles;
+    blockedFiles << location << location + ".defaultpixel";
+
+    Q_FOREACH (const QString &blockedFile, blockedFiles) {
+        QTemporaryDir storeDir;
+        QVERIFY(storeDir.isValid());
+
+        const QString storePath = storeDir.path() + "/autosave";
+
+        KisKraIncrementalSaveState state;
+        state.beginSave(storePath);
+
+        QString storeLocation;
+
+        {
+            QScopedPointer<KoStore> store(KoStore::createStore(storePath, KoStore::Write, "", KoStore::Directory));
+            QVERIFY(!store->bad());
+
+            storeLocation = store->currentPath() + location;
+
+            // the store refuses to open the same file twice
+            QVERIFY(store->open(blockedFile));
+            store->close();
+
+            KisKraSaveVisitor visitor(store.data(), "test", nodeFileNames);
+            visitor.setIncrementalSaveState(&state);
+
+            layer->accept(visitor);
+            QVERIFY(!visitor.errorMessages().isEmpty());
+        }
+
+        state.endSave(true);
+
+        // the device has not been saved, so it must be written next time
+        state.beginSave(storePath);
+        QVERIFY(!state.tryKeepDevice(storeLocation, layer->paintDevice()));
+        state.endSave(true);
+    }
+}
+
 QTEST_MAIN(KisKraSaverTest)
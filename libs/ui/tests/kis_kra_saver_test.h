@@ -43,6 +43,9 @@ private Q_SLOTS:
 
     void testRoundTripColorizeMask();
 
+    void testIncrementalSaveState();
+    void testIncrementalSaveFailedOpen();
+
 };
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_png_converter_test.h"
+
+#include <QTest>
+#include <QBuffer>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+
+#include "KisDocument.h"
+#include "KisPart.h"
+#include "kis_image.h"
+#include "kis_group_layer.h"
+#include "kis_paint_device.h"
+#include "kis_sequential_iterator.h"
+#include "kis_png_converter.h"
+#include "testutil.h"
+
+
+void KisPngConverterTest::testRoundTrip_data()
+{
+    QTest::addColumn<QString>("colorModel");
+    QTest::addColumn<QString>("colorDepth");
+    QTest::addColumn<int>("compression");
+    QTest::addColumn<bool>("interlace");
+
+    QTest::newRow("rgba8") << RGBAColorModelID.id() << Integer8BitsColorDepthID.id() << 9 << false;
+    QTest::newRow("rgba16") << RGBAColorModelID.id() << Integer16BitsColorDepthID.id() << 9 << false;
+    QTest::newRow("rgba16-stored") << RGBAColorModelID.id() << Integer16BitsColorDepthID.id() << 0 << false;
+    QTest::newRow("graya8") << GrayAColorModelID.id() << Integer8BitsColorDepthID.id() << 6 << false;
+    QTest::newRow("rgba8-interlaced") << RGBAColorModelID.id() << Integer8BitsColorDepthID.id() << 9 << true;
+}
+
+void KisPngConverterTest::testRoundTrip()
+{
+    QFETCH(QString, colorModel);
+    QFETCH(QString, colorDepth);
+    QFETCH(int, compression);
+    QFETCH(bool, interlace);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(colorModel, colorDepth, "");
+
+    // big enough to be split into several row groups by the encoder
+    const QRect rc(0, 0, 1031, 517);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rc, KoColor(Qt::white, cs));
+
+    qsrand(1);
+    KisSequentialIterator it(dev, rc);
+    do {
+        quint8 *data = it.rawData();
+        for (quint32 i = 0; i < cs->pixelSize(); i++) {
+            // mix smooth areas with noise to exercise all the row filters
+            data[i] = (it.x() + it.y()) % 64 < 32 ? quint8(it.x() * (i + 1)) : quint8(qrand());
+        }
+    } while (it.nextPixel());
+
+    KisPNGOptions options;
+    options.compression = compression;
+    options.interlace = interlace;
+    options.tryToSaveAsIndexed = false;
+
+    vKisAnnotationSP annotations;
+
+    QBuffer buffer;
+
+    KisDocument *doc = KisPart::instance()->createDocument();
+
+    KisPNGConverter saver(doc);
+    QCOMPARE(saver.buildFile(&buffer, rc, 1.0, 1.0, dev,
+                             annotations.begin(), annotations.end(),
+                             options, 0),
+             KisImageBuilder_RESULT_OK);
+
+    KisPNGConverter loader(doc);
+    QCOMPARE(loader.buildImage(&buffer), KisImageBuilder_RESULT_OK);
+
+    KisImageSP image = loader.image();
+    QVERIFY(image);
+    QCOMPARE(image->bounds(), rc);
+
+    KisPaintDeviceSP result = image->root()->firstChild()->paintDevice();
+    QCOMPARE(result->colorSpace()->pixelSize(), cs->pixelSize());
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, dev, result));
+
+    delete doc;
+}
+
+QTEST_MAIN(KisPngConverterTest)
@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_texture_tile_info_converter_test.h"
+
+#include <QTest>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include "kis_image.h"
+#include "kis_paint_layer.h"
+#include "kis_paint_device.h"
+#include "opengl/kis_texture_tile_info_converter.h"
+
+static const int tileSize = 64;
+static const QRect imageRect(0, 0, 300, 200);
+static const QRect updateRect(10, 20, 250, 170);
+
+
+static KisImageSP createImage()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "test image");
+
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+    image->addNode(layer, image->root());
+
+    qsrand(1);
+    QVector<quint8> bytes(imageRect.width() * imageRect.height() * cs->pixelSize());
+    for (int i = 0; i < bytes.size(); i++) {
+        bytes[i] = qrand() & 0xff;
+    }
+    layer->paintDevice()->writeBytes(bytes.constData(), imageRect);
+
+    image->initialRefreshGraph();
+
+    return image;
+}
+
+static KisTextureTileUpdateInfoSPList createTiles(KisTextureTileInfoPoolSP pool)
+{
+    KisTextureTileUpdateInfoSPList tiles;
+
+    for (int row = 0; row * tileSize < imageRect.height(); row++) {
+        for (int col = 0; col * tileSize < imageRect.width(); col++) {
+            const QRect tileRect(col * tileSize, row * tileSize, tileSize, tileSize);
+
+            KisTextureTileUpdateInfoSP tile(
+                new KisTextureTileUpdateInfo(col, row,
+                                             tileRect, updateRect, imageRect,
+                                             0, pool));
+            if (tile->valid()) {
+                tiles.append(tile);
+            }
+        }
+    }
+
+    return tiles;
+}
+
+static QRect patchRect(KisTextureTileUpdateInfoSP tile)
+{
+    const QPoint tileOffset(tile->tileCol() * tileSize, tile->tileRow() * tileSize);
+    return QRect(tileOffset + tile->realPatchOffset(), tile->realPatchSize());
+}
+
+static void compareWithProjection(KisImageSP image,
+                                  const KisTextureTileUpdateInfoSPList &tiles,
+                                  const KoColorSpace *dstCs)
+{
+    const KoColorSpace *srcCs = image->projection()->colorSpace();
+
+    Q_FOREACH (KisTextureTileUpdateInfoSP tile, tiles) {
+        const QRect rc = patchRect(tile);
+        const int numPixels = rc.width() * rc.height();
+
+        QCOMPARE(int(tile->pixelSize()), int(dstCs->pixelSize()));
+
+        QVector<quint8> srcBytes(numPixels * srcCs->pixelSize());
+        image->projection()->readBytes(srcBytes.data(), rc);
+
+        QVector<quint8> expectedBytes(numPixels * dstCs->pixelSize());
+        srcCs->convertPixelsTo(srcBytes.constData(), expectedBytes.data(), dstCs, numPixels,
+                               KoColorConversionTransformation::internalRenderingIntent(),
+                               KoColorConversionTransformation::internalConversionFlags());
+
+        QVERIFY(!memcmp(tile->data(), expectedBytes.constData(), expectedBytes.size()));
+    }
+}
+
+void KisTextureTileInfoConverterTest::testConversion()
+{
+    KisImageSP image = createImage();
+    KisTextureTileInfoPoolSP pool(new KisTextureTileInfoPool(tileSize, tileSize));
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisTextureTileUpdateInfoSPList tiles = createTiles(pool);
+    QVERIFY(tiles.size() > 1);
+
+    KisTextureTileInfoConverter converter;
+    converter.setConversion(dstCs,
+                            KoColorConversionTransformation::internalRenderingIntent(),
+                            KoColorConversionTransformation::internalConversionFlags());
+    converter.processTiles(image, tiles);
+
+    compareWithProjection(image, tiles, dstCs);
+}
+
+void KisTextureTileInfoConverterTest::testNoConversion()
+{
+    KisImageSP image = createImage();
+    KisTextureTileInfoPoolSP pool(new KisTextureTileInfoPool(tileSize, tileSize));
+
+    KisTextureTileUpdateInfoSPList tiles = createTiles(pool);
+
+    KisTextureTileInfoConverter converter;
+    converter.processTiles(image, tiles);
+
+    compareWithProjection(image, tiles, image->projection()->colorSpace());
+}
+
+void KisTextureTileInfoConverterTest::testChannelFlags()
+{
+    KisImageSP image = createImage();
+    KisTextureTileInfoPoolSP pool(new KisTextureTileInfoPool(tileSize, tileSize));
+    const KoColorSpace *dstCs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QBitArray channelFlags(image->projection()->colorSpace()->channelCount(), true);
+    channelFlags.clearBit(1);
+
+    KisTextureTileInfoConverter converter;
+    converter.setChannelFlags(channelFlags, false, 0);
+    converter.setConversion(dstCs,
+                            KoColorConversionTransformation::internalRenderingIntent(),
+                            KoColorConversionTransformation::internalConversionFlags());
+
+    // all the tiles at once are processed in parallel...
+    KisTextureTileUpdateInfoSPList tiles = createTiles(pool);
+    converter.processTiles(image, tiles);
+
+    // ... and one-by-one in the calling thread
+    KisTextureTileUpdateInfoSPList referenceTiles = createTiles(pool);
+    Q_FOREACH (KisTextureTileUpdateInfoSP tile, referenceTiles) {
+        converter.processTiles(image, KisTextureTileUpdateInfoSPList() << tile);
+    }
+
+    QCOMPARE(tiles.size(), referenceTiles.size());
+
+    for (int i = 0; i < tiles.size(); i++) {
+        const QRect rc = patchRect(tiles[i]);
+        QCOMPARE(patchRect(referenceTiles[i]), rc);
+
+        const int numBytes = rc.width() * rc.height() * dstCs->pixelSize();
+        QVERIFY(!memcmp(tiles[i]->data(), referenceTiles[i]->data(), numBytes));
+    }
+}
+
+QTEST_MAIN(KisTextureTileInfoConverterTest)
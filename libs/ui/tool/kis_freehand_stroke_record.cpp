@@ -0,0 +1,249 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_freehand_stroke_record.h"
+
+#include <QDomDocument>
+#include <QDomElement>
+#include <QFile>
+
+#include <kis_dom_utils.h>
+#include "kis_debug.h"
+
+
+static const QString STROKE_TAG = "freehandStroke";
+static const QString JOB_TAG = "job";
+static const int FORMAT_VERSION = 1;
+
+namespace {
+
+QString jobTypeToString(KisFreehandStrokeRecord::JobType type)
+{
+    switch (type) {
+    case KisFreehandStrokeRecord::POINT:
+        return "point";
+    case KisFreehandStrokeRecord::LINE:
+        return "line";
+    case KisFreehandStrokeRecord::CURVE:
+        return "curve";
+    }
+
+    return QString();
+}
+
+bool jobTypeFromString(const QString &str, KisFreehandStrokeRecord::JobType *type)
+{
+    if (str == "point") {
+        *type = KisFreehandStrokeRecord::POINT;
+    } else if (str == "line") {
+        *type = KisFreehandStrokeRecord::LINE;
+    } else if (str == "curve") {
+        *type = KisFreehandStrokeRecord::CURVE;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void savePaintInformation(QDomDocument &doc, QDomElement &parent,
+                          const QString &tag, const KisPaintInformation &pi)
+{
+    QDomElement e = doc.createElement(tag);
+    pi.toXML(doc, e);
+    parent.appendChild(e);
+}
+
+}
+
+KisFreehandStrokeRecord::KisFreehandStrokeRecord()
+{
+}
+
+void KisFreehandStrokeRecord::setImageSize(const QSize &size)
+{
+    m_imageSize = size;
+}
+
+QSize KisFreehandStrokeRecord::imageSize() const
+{
+    return m_imageSize;
+}
+
+void KisFreehandStrokeRecord::setPresetName(const QString &name)
+{
+    m_presetName = name;
+}
+
+QString KisFreehandStrokeRecord::presetName() const
+{
+    return m_presetName;
+}
+
+void KisFreehandStrokeRecord::addPoint(int time, int painterInfoId,
+                                       const KisPaintInformation &pi)
+{
+    Job job;
+    job.type = POINT;
+    job.painterInfoId = painterInfoId;
+    job.time = time;
+    job.pi1 = pi;
+    m_jobs.append(job);
+}
+
+void KisFreehandStrokeRecord::addLine(int time, int painterInfoId,
+                                      const KisPaintInformation &pi1,
+                                      const KisPaintInformation &pi2)
+{
+    Job job;
+    job.type = LINE;
+    job.painterInfoId = painterInfoId;
+    job.time = time;
+    job.pi1 = pi1;
+    job.pi2 = pi2;
+    m_jobs.append(job);
+}
+
+void KisFreehandStrokeRecord::addCurve(int time, int painterInfoId,
+                                       const KisPaintInformation &pi1,
+                                       const QPointF &control1,
+                                       const QPointF &control2,
+                                       const KisPaintInformation &pi2)
+{
+    Job job;
+    job.type = CURVE;
+    job.painterInfoId = painterInfoId;
+    job.time = time;
+    job.pi1 = pi1;
+    job.pi2 = pi2;
+    job.control1 = control1;
+    job.control2 = control2;
+    m_jobs.append(job);
+}
+
+const QVector<KisFreehandStrokeRecord::Job>& KisFreehandStrokeRecord::jobs() const
+{
+    return m_jobs;
+}
+
+int KisFreehandStrokeRecord::numPainters() const
+{
+    int maxId = -1;
+
+    Q_FOREACH (const Job &job, m_jobs) {
+        maxId = qMax(maxId, job.painterInfoId);
+    }
+
+    return maxId + 1;
+}
+
+bool KisFreehandStrokeRecord::save(const QString &fileName) const
+{
+    QDomDocument doc;
+    QDomElement root = doc.createElement(STROKE_TAG);
+    root.setAttribute("version", FORMAT_VERSION);
+    root.setAttribute("imageWidth", m_imageSize.width());
+    root.setAttribute("imageHeight", m_imageSize.height());
+    root.setAttribute("preset", m_presetName);
+    doc.appendChild(root);
+
+    Q_FOREACH (const Job &job, m_jobs) {
+        QDomElement e = doc.createElement(JOB_TAG);
+        e.setAttribute("type", jobTypeToString(job.type));
+        e.setAttribute("painter", job.painterInfoId);
+        e.setAttribute("time", job.time);
+
+        savePaintInformation(doc, e, "pi1", job.pi1);
+
+        if (job.type != POINT) {
+            savePaintInformation(doc, e, "pi2", job.pi2);
+        }
+
+        if (job.type == CURVE) {
+            KisDomUtils::saveValue(&e, "control1", job.control1);
+            KisDomUtils::saveValue(&e, "control2", job.control2);
+        }
+
+        root.appendChild(e);
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        warnKrita << "Failed to save the freehand stroke to" << fileName;
+        return false;
+    }
+
+    file.write(doc.toByteArray());
+    return true;
+}
+
+bool KisFreehandStrokeRecord::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        warnKrita << "Failed to open the freehand stroke file" << fileName;
+        return false;
+    }
+
+    QDomDocument doc;
+    if (!doc.setContent(&file)) {
+        warnKrita << "Failed to parse the freehand stroke file" << fileName;
+        return false;
+    }
+
+    QDomElement root = doc.documentElement();
+    if (root.tagName() != STROKE_TAG ||
+        root.attribute("version").toInt() > FORMAT_VERSION) {
+
+        warnKrita << "Unsupported freehand stroke file" << fileName;
+        return false;
+    }
+
+    m_imageSize = QSize(root.attribute("imageWidth").toInt(),
+                        root.attribute("imageHeight").toInt());
+    m_presetName = root.attribute("preset");
+    m_jobs.clear();
+
+    for (QDomElement e = root.firstChildElement(JOB_TAG);
+         !e.isNull();
+         e = e.nextSiblingElement(JOB_TAG)) {
+
+        Job job;
+        if (!jobTypeFromString(e.attribute("type"), &job.type)) {
+            warnKrita << "Unknown job type in the freehand stroke file" << e.attribute("type");
+            return false;
+        }
+
+        job.painterInfoId = e.attribute("painter").toInt();
+        job.time = e.attribute("time").toInt();
+        job.pi1 = KisPaintInformation::fromXML(e.firstChildElement("pi1"));
+
+        if (job.type != POINT) {
+            job.pi2 = KisPaintInformation::fromXML(e.firstChildElement("pi2"));
+        }
+
+        if (job.type == CURVE) {
+            KisDomUtils::loadValue(e, "control1", &job.control1);
+            KisDomUtils::loadValue(e, "control2", &job.control2);
+        }
+
+        m_jobs.append(job);
+    }
+
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FREEHAND_STROKE_RECORD_H
+#define __KIS_FREEHAND_STROKE_RECORD_H
+
+#include <QPointF>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include <brushengine/kis_paint_information.h>
+#include "kritaui_export.h"
+
+
+/**
+ * KisFreehandStrokeRecord keeps the paint information of a freehand
+ * stroke exactly in the form it was passed to FreehandStrokeStrategy,
+ * that is after all the smoothing and stabilization done by
+ * KisToolFreehandHelper. Every job is saved together with the time it
+ * was issued at, so the stroke can be replayed later (e.g. by
+ * KisStrokeReplayBenchmark) with the same pressure, tilt and speed
+ * values the artist produced.
+ *
+ * The stroke is saved as a small XML document, every paint information
+ * is serialized with KisPaintInformation::toXML().
+ */
+class KRITAUI_EXPORT KisFreehandStrokeRecord
+{
+public:
+    enum JobType {
+        POINT,
+        LINE,
+        CURVE
+    };
+
+    struct Job {
+        JobType type;
+        int painterInfoId;
+
+        /// the time the job was issued at, in msec since the start of the stroke
+        int time;
+
+        KisPaintInformation pi1;
+        KisPaintInformation pi2;
+        QPointF control1;
+        QPointF control2;
+    };
+
+public:
+    KisFreehandStrokeRecord();
+
+    void setImageSize(const QSize &size);
+    QSize imageSize() const;
+
+    void setPresetName(const QString &name);
+    QString presetName() const;
+
+    void addPoint(int time, int painterInfoId, const KisPaintInformation &pi);
+    void addLine(int time, int painterInfoId,
+                 const KisPaintInformation &pi1,
+                 const KisPaintInformation &pi2);
+    void addCurve(int time, int painterInfoId,
+                  const KisPaintInformation &pi1,
+                  const QPointF &control1,
+                  const QPointF &control2,
+                  const KisPaintInformation &pi2);
+
+    const QVector<Job>& jobs() const;
+
+    /**
+     * The number of painters (e.g. the number of the multihand
+     * tool's hands) used in the stroke
+     */
+    int numPainters() const;
+
+    bool save(const QString &fileName) const;
+    bool load(const QString &fileName);
+
+private:
+    QSize m_imageSize;
+    QString m_presetName;
+    QVector<Job> m_jobs;
+};
+
+#endif /* __KIS_FREEHAND_STROKE_RECORD_H */
@@ -20,6 +20,8 @@
 
 #include <QTimer>
 #include <QQueue>
+#include <QDir>
+#include <QDateTime>
 
 #include <klocalizedstring.h>
 
@@ -29,6 +31,7 @@
 #include <kis_distance_information.h>
 #include "kis_painting_information_builder.h"
 #include "kis_recording_adapter.h"
+#include "kis_freehand_stroke_record.h"
 #include "kis_image.h"
 #include "kis_painter.h"
 #include <brushengine/kis_paintop_preset.h>
@@ -85,6 +88,14 @@ struct KisToolFreehandHelper::Private
     int canvasRotation;
     bool canvasMirroredH;
 
+    /**
+     * When KRITA_FREEHAND_STROKE_RECORDING_DIR environment variable is
+     * set, every stroke is saved into this directory for replaying
+     * it in KisStrokeReplayBenchmark
+     */
+    QString strokeRecordingDir;
+    QScopedPointer<KisFreehandStrokeRecord> strokeRecord;
+
     KisPaintInformation
     getStabilizedPaintInfo(const QQueue<KisPaintInformation> &queue,
                            const KisPaintInformation &lastPaintInfo);
@@ -106,6 +117,9 @@ KisToolFreehandHelper::KisToolFreehandHelper(KisPaintingInformationBuilder *info
                 smoothingOptions ? smoothingOptions : new KisSmoothingOptions());
     m_d->canvasRotation = 0;
 
+    m_d->strokeRecordingDir =
+        QString::fromLocal8Bit(qgetenv("KRITA_FREEHAND_STROKE_RECORDING_DIR"));
+
     m_d->strokeTimeoutTimer.setSingleShot(true);
     connect(&m_d->strokeTimeoutTimer, SIGNAL(timeout()), SLOT(finishStroke()));
     connect(&m_d->airbrushingTimer, SIGNAL(timeout()), SLOT(doAirbrushing()));
@@ -265,6 +279,15 @@ void KisToolFreehandHelper::initPaintImpl(const KisPaintInformation &previousPai
         m_d->recordingAdapter->startStroke(image, m_d->resources);
     }
 
+    if (!m_d->strokeRecordingDir.isEmpty()) {
+        m_d->strokeRecord.reset(new KisFreehandStrokeRecord());
+        m_d->strokeRecord->setImageSize(image->size());
+
+        if (m_d->resources->currentPaintOpPreset()) {
+            m_d->strokeRecord->setPresetName(m_d->resources->currentPaintOpPreset()->name());
+        }
+    }
+
     KisStrokeStrategy *stroke =
         new FreehandStrokeStrategy(m_d->resources->needsIndirectPainting(),
                                    m_d->resources->indirectPaintingCompositeOp(),
@@ -573,6 +596,15 @@ void KisToolFreehandHelper::endPaint()
     if(m_d->recordingAdapter) {
         m_d->recordingAdapter->endStroke();
     }
+
+    if (m_d->strokeRecord) {
+        const QString fileName =
+            QString("stroke-%1.xml")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"));
+
+        m_d->strokeRecord->save(QDir(m_d->strokeRecordingDir).filePath(fileName));
+        m_d->strokeRecord.reset();
+    }
 }
 
 void KisToolFreehandHelper::cancelPaint()
@@ -603,6 +635,8 @@ void KisToolFreehandHelper::cancelPaint()
         //FIXME: not implemented
         //m_d->recordingAdapter->cancelStroke();
     }
+
+    m_d->strokeRecord.reset();
 }
 
 int KisToolFreehandHelper::elapsedStrokeTime() const
@@ -788,6 +822,10 @@ void KisToolFreehandHelper::paintAt(int painterInfoId,
     if(m_d->recordingAdapter) {
         m_d->recordingAdapter->addPoint(pi);
     }
+
+    if (m_d->strokeRecord) {
+        m_d->strokeRecord->addPoint(elapsedStrokeTime(), painterInfoId, pi);
+    }
 }
 
 void KisToolFreehandHelper::paintLine(int painterInfoId,
@@ -802,6 +840,10 @@ void KisToolFreehandHelper::paintLine(int painterInfoId,
     if(m_d->recordingAdapter) {
         m_d->recordingAdapter->addLine(pi1, pi2);
     }
+
+    if (m_d->strokeRecord) {
+        m_d->strokeRecord->addLine(elapsedStrokeTime(), painterInfoId, pi1, pi2);
+    }
 }
 
 void KisToolFreehandHelper::paintBezierCurve(int painterInfoId,
@@ -843,6 +885,11 @@ void KisToolFreehandHelper::paintBezierCurve(int painterInfoId,
     if(m_d->recordingAdapter) {
         m_d->recordingAdapter->addCurve(pi1, control1, control2, pi2);
     }
+
+    if (m_d->strokeRecord) {
+        m_d->strokeRecord->addCurve(elapsedStrokeTime(), painterInfoId,
+                                    pi1, control1, control2, pi2);
+    }
 }
 
 void KisToolFreehandHelper::createPainters(QVector<PainterInfo*> &painterInfos,
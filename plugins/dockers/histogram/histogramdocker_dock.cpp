@@ -65,7 +65,7 @@ void HistogramDockerDock::setCanvas(KoCanvasBase * canvas)
 
         m_imageIdleWatcher->setTrackedImage(m_canvas->image());
 
-        connect(m_canvas->image(), SIGNAL(sigImageUpdated(QRect)), this, SLOT(startUpdateCanvasProjection()), Qt::UniqueConnection);
+        connect(m_canvas->image(), SIGNAL(sigImageUpdated(QRect)), this, SLOT(startUpdateCanvasProjection(QRect)), Qt::UniqueConnection);
         connect(m_canvas->image(), SIGNAL(sigColorSpaceChanged(const KoColorSpace*)), this, SLOT(sigColorSpaceChanged(const KoColorSpace*)), Qt::UniqueConnection);
         m_imageIdleWatcher->startCountdown();
     }
@@ -79,8 +79,11 @@ void HistogramDockerDock::unsetCanvas()
     m_imageIdleWatcher->startCountdown();
 }
 
-void HistogramDockerDock::startUpdateCanvasProjection()
+void HistogramDockerDock::startUpdateCanvasProjection(const QRect &rc)
 {
+    // the histogram cache should know about the changes made while the docker is hidden
+    m_histogramWidget->setDirty(rc);
+
     if (isVisible()) {
         m_imageIdleWatcher->startCountdown();
     }
@@ -32,7 +32,8 @@
 #include "kis_canvas2.h"
 
 HistogramDockerWidget::HistogramDockerWidget(QWidget *parent, const char *name, Qt::WindowFlags f)
-    : QLabel(parent, f), m_paintDevice(nullptr), m_smoothHistogram(true)
+    : QLabel(parent, f), m_paintDevice(nullptr), m_smoothHistogram(true),
+      m_computationRunning(false), m_updatePending(false)
 {
     setObjectName(name);
 }
@@ -52,18 +53,49 @@ void HistogramDockerWidget::setPaintDevice(KisCanvas2* canvas)
         m_bounds = QRect();
         m_histogramData.clear();
     }
+
+    /**
+     * The computation thread of the previous image may still be
+     * running, so it keeps the old cache until it finishes
+     */
+    m_histogramCache.reset(new KisHistogramTileCache());
+    m_dirtyRegion = QRegion();
+}
+
+void HistogramDockerWidget::setDirty(const QRect &rc)
+{
+    m_dirtyRegion += rc;
 }
 
 void HistogramDockerWidget::updateHistogram()
 {
     if (!m_paintDevice.isNull()) {
+        /**
+         * The cache is updated by one thread at a time, the update
+         * requested meanwhile is started when the thread finishes
+         */
+        if (m_computationRunning) {
+            m_updatePending = true;
+            return;
+        }
+
         KisPaintDeviceSP m_devClone = new KisPaintDevice(m_paintDevice->colorSpace());
 
         m_devClone->makeCloneFrom(m_paintDevice, m_bounds);
 
-        HistogramComputationThread *workerThread = new HistogramComputationThread(m_devClone, m_bounds);
+        /**
+         * The dirty region is taken together with the clone, so the
+         * changes made after cloning are rescanned next time
+         */
+        HistogramComputationThread *workerThread =
+            new HistogramComputationThread(m_devClone, m_bounds, m_histogramCache, m_dirtyRegion);
+        m_dirtyRegion = QRegion();
+
         connect(workerThread, &HistogramComputationThread::resultReady, this, &HistogramDockerWidget::receiveNewHistogram);
+        connect(workerThread, &HistogramComputationThread::finished, this, &HistogramDockerWidget::slotComputationFinished);
         connect(workerThread, &HistogramComputationThread::finished, workerThread, &QObject::deleteLater);
+
+        m_computationRunning = true;
         workerThread->start();
     } else {
         m_histogramData.clear();
@@ -71,6 +103,16 @@ void HistogramDockerWidget::updateHistogram()
     }
 }
 
+void HistogramDockerWidget::slotComputationFinished()
+{
+    m_computationRunning = false;
+
+    if (m_updatePending) {
+        m_updatePending = false;
+        updateHistogram();
+    }
+}
+
 void HistogramDockerWidget::receiveNewHistogram(HistVector *histogramData)
 {
     m_histogramData = *histogramData;
@@ -156,40 +198,11 @@ void HistogramDockerWidget::paintEvent(QPaintEvent *event)
 
 void HistogramComputationThread::run()
 {
-    const KoColorSpace *cs = m_dev->colorSpace();
-    quint32 channelCount = m_dev->channelCount();
-    quint32 pixelSize = m_dev->pixelSize();
-
-    quint32 imageSize = m_bounds.width() * m_bounds.height();
-    quint32 nSkip = 1 + (imageSize >> 20); //for speed use about 1M pixels for computing histograms
-
-    //allocate space for the histogram data
-    bins.resize((int)channelCount);
-    for (auto &bin : bins) {
-        bin.resize(std::numeric_limits<quint8>::max() + 1);
+    Q_FOREACH (const QRect &rc, m_dirtyRegion.rects()) {
+        m_cache->setDirty(rc);
     }
 
-    QRect bounds = m_dev->exactBounds();
-    if (bounds.isEmpty())
-        return;
-
-    KisSequentialConstIterator it(m_dev, m_dev->exactBounds());
-    int i;
-    quint32 toSkip = nSkip;
-
-    do {
-        i = it.nConseqPixels();
-        const quint8* pixel = it.rawDataConst();
-        for (int k = 0; k < i; ++k) {
-            if (--toSkip == 0) {
-                for (int chan = 0; chan < (int)channelCount; ++chan) {
-                    bins[chan][cs->scaleToU8(pixel, chan)]++;
-                }
-                toSkip = nSkip;
-            }
-            pixel += pixelSize;
-        }
-    } while (it.nextPixels(i));
+    bins = m_cache->update(m_dev, m_bounds);
 
     emit resultReady(&bins);
 }
@@ -23,19 +23,23 @@
 #include <QWidget>
 #include <QLabel>
 #include <QThread>
+#include <QRegion>
+#include <QSharedPointer>
 #include "kis_types.h"
-#include <vector>
+#include "kis_histogram_tile_cache.h"
 
 class KisCanvas2;
 
-typedef std::vector<std::vector<quint32> > HistVector; //Don't use QVector here - it's too slow for this purpose
+typedef KisHistogramTileCache::Histogram HistVector; //Don't use QVector here - it's too slow for this purpose
 
 
 class HistogramComputationThread : public QThread
 {
     Q_OBJECT
 public:
-    HistogramComputationThread(KisPaintDeviceSP _dev, const QRect& _bounds) : m_dev(_dev), m_bounds(_bounds)
+    HistogramComputationThread(KisPaintDeviceSP _dev, const QRect& _bounds,
+                               QSharedPointer<KisHistogramTileCache> _cache, const QRegion &_dirtyRegion)
+        : m_dev(_dev), m_bounds(_bounds), m_cache(_cache), m_dirtyRegion(_dirtyRegion)
     {}
 
     void run() override;
@@ -46,6 +50,8 @@ Q_SIGNALS:
 private:
     KisPaintDeviceSP m_dev;
     QRect m_bounds;
+    QSharedPointer<KisHistogramTileCache> m_cache;
+    QRegion m_dirtyRegion;
     HistVector bins;
 };
 
@@ -58,17 +64,26 @@ public:
     HistogramDockerWidget(QWidget *parent = 0, const char *name = 0, Qt::WindowFlags f = 0);
     ~HistogramDockerWidget();
     void setPaintDevice(KisCanvas2* canvas);
+    void setDirty(const QRect &rc);
     void paintEvent(QPaintEvent *event);
 
 public Q_SLOTS:
     void updateHistogram();
     void receiveNewHistogram(HistVector*);
 
+private Q_SLOTS:
+    void slotComputationFinished();
+
 private:
     KisPaintDeviceSP m_paintDevice;
     HistVector m_histogramData;
     QRect m_bounds;
     bool m_smoothHistogram;
+
+    QSharedPointer<KisHistogramTileCache> m_histogramCache;
+    QRegion m_dirtyRegion;
+    bool m_computationRunning;
+    bool m_updatePending;
 };
 
 #endif // HISTOGRAMDOCKERWIDGET_H
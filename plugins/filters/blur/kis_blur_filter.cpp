@@ -111,8 +111,16 @@ void KisBlurFilter::processImpl(KisPaintDeviceSP device,
     KisConvolutionPainter painter(device);
     painter.setChannelFlags(channelFlags);
     painter.setProgress(progressUpdater);
-    painter.applyMatrix(kernel, device, srcTopLeft, srcTopLeft, rect.size(), BORDER_REPEAT);
 
+    // e.g. a box kernel is separable
+    KisConvolutionKernelSP horizontalKernel;
+    KisConvolutionKernelSP verticalKernel;
+
+    if (KisConvolutionKernel::separate(kernel, &horizontalKernel, &verticalKernel)) {
+        painter.applySeparableMatrix(horizontalKernel, verticalKernel, device, srcTopLeft, srcTopLeft, rect.size(), BORDER_REPEAT);
+    } else {
+        painter.applyMatrix(kernel, device, srcTopLeft, srcTopLeft, rect.size(), BORDER_REPEAT);
+    }
 }
 
 QRect KisBlurFilter::neededRect(const QRect & rect, const KisFilterConfigurationSP _config, int lod) const
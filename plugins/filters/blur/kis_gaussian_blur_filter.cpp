@@ -89,9 +89,19 @@ void KisGaussianBlurFilter::processImpl(KisPaintDeviceSP device,
         channelFlags = QBitArray(device->colorSpace()->channelCount(), true);
     }
 
-    KisGaussianKernel::applyGaussian(device, rect,
-                                     horizontalRadius, verticalRadius,
-                                     channelFlags, progressUpdater);
+    if (horizontalRadius > 0.0 && verticalRadius > 0.0) {
+        KisConvolutionPainter painter(device);
+        painter.setChannelFlags(channelFlags);
+        painter.setProgress(progressUpdater);
+        painter.applySeparableMatrix(KisGaussianKernel::createHorizontalKernel(horizontalRadius),
+                                     KisGaussianKernel::createVerticalKernel(verticalRadius),
+                                     device, rect.topLeft(), rect.topLeft(), rect.size(),
+                                     BORDER_REPEAT);
+    } else {
+        KisGaussianKernel::applyGaussian(device, rect,
+                                         horizontalRadius, verticalRadius,
+                                         channelFlags, progressUpdater);
+    }
 }
 
 QRect KisGaussianBlurFilter::neededRect(const QRect & rect, const KisFilterConfigurationSP _config, int lod) const
@@ -21,6 +21,7 @@
 #include <QtGlobal>
 #include <QMap>
 #include <QIODevice>
+#include <QtConcurrentMap>
 
 
 #include <KoColorSpace.h>
@@ -352,41 +353,347 @@ psd_status psd_unzip_with_prediction(psd_uchar *src_buf, psd_int src_len,
 /* End of third party block                                           */
 /**********************************************************************/
 
-QMap<quint16, QByteArray> fetchChannelsBytes(QIODevice *io, QVector<ChannelInfo*> channelInfoRecords,
-                                            int row, int width, int channelSize)
+typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
+
+/**
+ * The layers are decoded in horizontal bands aligned to the tiles of
+ * the paint device, so that the worker threads never fight for the
+ * same tile.
+ */
+const int decodingBandHeight = 64;
+
+/**
+ * The amount of compressed RLE/raw data read from the file at once.
+ * The file itself is read serially, the decoding of every portion is
+ * done by all the cores.
+ */
+const quint64 maxBytesPerPass = 64 * 1024 * 1024;
+
+struct DecodingBand {
+    int firstRow; // relative to the top of the layer
+    int numRows;
+};
+
+QVector<DecodingBand> splitIntoBands(const QRect &layerRect)
 {
-    const int uncompressedLength = width * channelSize;
+    QVector<DecodingBand> bands;
 
-    QMap<quint16, QByteArray> channelBytes;
+    int row = 0;
+    while (row < layerRect.height()) {
+        const int absoluteRow = layerRect.top() + row;
+
+        // round down to the band grid (layers may have negative offsets)
+        int bandStart = absoluteRow - absoluteRow % decodingBandHeight;
+        if (bandStart > absoluteRow) {
+            bandStart -= decodingBandHeight;
+        }
+        const int bandEnd = bandStart + decodingBandHeight;
+
+        DecodingBand band;
+        band.firstRow = row;
+        band.numRows = qMin(bandEnd - absoluteRow, layerRect.height() - row);
+        bands.append(band);
+
+        row += band.numRows;
+    }
+
+    return bands;
+}
+
+struct ChannelRows {
+    ChannelInfo *info;
+    quint16 channelId;
+    Compression::CompressionType compressionType;
+
+    // offsets of every row in the channel data, the last item is the
+    // end of the last row
+    QVector<quint64> rowOffsets;
+
+    // the rows of the current pass only
+    QByteArray data;
+    quint64 dataOffset;
+};
+
+struct RowsDecoder {
+    typedef void result_type;
+
+    RowsDecoder(KisPaintDeviceSP _dev, const QRect &_layerRect, int _channelSize,
+                PixelFunc _pixelFunc, const QVector<ChannelRows> &_channels)
+        : dev(_dev),
+          layerRect(_layerRect),
+          channelSize(_channelSize),
+          pixelFunc(_pixelFunc),
+          channels(_channels)
+    {
+    }
+
+    void operator()(const DecodingBand &band) const {
+        const int rowLength = layerRect.width() * channelSize;
+
+        // every band decodes the rows into its own set of buffers
+        QMap<quint16, QByteArray> channelBytes;
+        Q_FOREACH (const ChannelRows &channel, channels) {
+            channelBytes.insert(channel.channelId, QByteArray(rowLength, 0));
+        }
+
+        QVector<char*> rowBuffers;
+        Q_FOREACH (const ChannelRows &channel, channels) {
+            rowBuffers.append(channelBytes[channel.channelId].data());
+        }
+
+        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(),
+                                                           layerRect.top() + band.firstRow,
+                                                           layerRect.width());
 
-    Q_FOREACH (ChannelInfo *channelInfo, channelInfoRecords) {
+        for (int row = band.firstRow; row < band.firstRow + band.numRows; row++) {
+            for (int i = 0; i < channels.size(); i++) {
+                const ChannelRows &channel = channels[i];
+
+                const quint64 rowStart = channel.rowOffsets[row];
+                const quint64 packedLength = channel.rowOffsets[row + 1] - rowStart;
+                const char *src = channel.data.constData() + (rowStart - channel.dataOffset);
+
+                if (channel.compressionType == Compression::RLE) {
+                    Compression::uncompressRLE(src, packedLength, rowBuffers[i], rowLength);
+                } else {
+                    memcpy(rowBuffers[i], src, rowLength);
+                }
+            }
+
+            for (int col = 0; col < layerRect.width(); col++) {
+                pixelFunc(channelSize, channelBytes, col, it->rawData());
+                it->nextPixel();
+            }
+            it->nextRow();
+        }
+    }
+
+    KisPaintDeviceSP dev;
+    QRect layerRect;
+    int channelSize;
+    PixelFunc pixelFunc;
+    const QVector<ChannelRows> &channels;
+};
+
+void readRowsCommon(KisPaintDeviceSP dev,
+                    QIODevice *io,
+                    const QRect &layerRect,
+                    QVector<ChannelInfo*> infoRecords,
+                    int channelSize,
+                    PixelFunc pixelFunc)
+{
+    const int rowLength = layerRect.width() * channelSize;
+
+    QVector<ChannelRows> channels;
+
+    Q_FOREACH (ChannelInfo *channelInfo, infoRecords) {
         // user supplied masks are ignored here
         if (channelInfo->channelId < -1) continue;
 
-        io->seek(channelInfo->channelDataStart + channelInfo->channelOffset);
+        ChannelRows channel;
+        channel.info = channelInfo;
+        channel.channelId = channelInfo->channelId;
+        channel.compressionType = channelInfo->compressionType;
+        channel.dataOffset = 0;
+
+        if (channelInfo->compressionType == Compression::RLE) {
+            if (channelInfo->rleRowLengths.size() < layerRect.height()) {
+                QString error = QString("Not enough RLE row lengths: id = %1, rows = %2").arg(channelInfo->channelId).arg(channelInfo->rleRowLengths.size());
+                dbgFile << "ERROR: readRowsCommon:" << error;
+                throw KisAslReaderUtils::ASLParseException(error);
+            }
 
-        if (channelInfo->compressionType == Compression::Uncompressed) {
-            channelBytes[channelInfo->channelId] = io->read(uncompressedLength);
-            channelInfo->channelOffset += uncompressedLength;
+            quint64 offset = 0;
+            channel.rowOffsets.append(offset);
+            for (int row = 0; row < layerRect.height(); row++) {
+                offset += channelInfo->rleRowLengths[row];
+                channel.rowOffsets.append(offset);
+            }
         }
-        else if (channelInfo->compressionType == Compression::RLE) {
-            int rleLength = channelInfo->rleRowLengths[row];
-            QByteArray compressedBytes = io->read(rleLength);
-            QByteArray uncompressedBytes = Compression::uncompress(uncompressedLength, compressedBytes, channelInfo->compressionType);
-            channelBytes.insert(channelInfo->channelId, uncompressedBytes);
-            channelInfo->channelOffset += rleLength;
+        else if (channelInfo->compressionType == Compression::Uncompressed) {
+            for (int row = 0; row <= layerRect.height(); row++) {
+                channel.rowOffsets.append(quint64(row) * rowLength);
+            }
         }
         else {
             QString error = QString("Unsupported Compression mode: %1").arg(channelInfo->compressionType);
-            dbgFile << "ERROR: fetchChannelsBytes:" << error;
+            dbgFile << "ERROR: readRowsCommon:" << error;
             throw KisAslReaderUtils::ASLParseException(error);
         }
+
+        channels.append(channel);
     }
 
-    return channelBytes;
+    QVector<DecodingBand> bands = splitIntoBands(layerRect);
+    RowsDecoder decoder(dev, layerRect, channelSize, pixelFunc, channels);
+
+    int firstBand = 0;
+    while (firstBand < bands.size()) {
+
+        // collect as many bands as fit into the pass
+        int lastBand = firstBand;
+        quint64 passBytes = 0;
+
+        while (lastBand < bands.size()) {
+            const int startRow = bands[firstBand].firstRow;
+            const int endRow = bands[lastBand].firstRow + bands[lastBand].numRows;
+
+            quint64 bytes = 0;
+            Q_FOREACH (const ChannelRows &channel, channels) {
+                bytes += channel.rowOffsets[endRow] - channel.rowOffsets[startRow];
+            }
+
+            if (lastBand > firstBand && bytes > maxBytesPerPass) break;
+
+            passBytes = bytes;
+            lastBand++;
+        }
+
+        const int startRow = bands[firstBand].firstRow;
+        const int endRow = bands[lastBand - 1].firstRow + bands[lastBand - 1].numRows;
+
+        dbgFile << "Decoding rows" << startRow << "-" << endRow << "of" << layerRect.height() << ppVar(passBytes);
+
+        for (int i = 0; i < channels.size(); i++) {
+            ChannelRows &channel = channels[i];
+            const quint64 length = channel.rowOffsets[endRow] - channel.rowOffsets[startRow];
+
+            channel.dataOffset = channel.rowOffsets[startRow];
+            io->seek(channel.info->channelDataStart + channel.dataOffset);
+            channel.data = io->read(length);
+
+            if (quint64(channel.data.size()) < length) {
+                warnKrita << "WARNING: the channel data is truncated:" << ppVar(channel.channelId) << ppVar(length) << ppVar(channel.data.size());
+                channel.data.append(QByteArray(length - channel.data.size(), 0));
+            }
+        }
+
+        QtConcurrent::blockingMap(bands.constBegin() + firstBand, bands.constBegin() + lastBand, decoder);
+
+        firstBand = lastBand;
+    }
 }
 
-typedef boost::function<void(int, const QMap<quint16, QByteArray>&, int, quint8*)> PixelFunc;
+struct ZipChannelJob {
+    ChannelInfo *info;
+    QByteArray compressedBytes;
+    QByteArray uncompressedBytes;
+    bool status;
+};
+
+struct ZipChannelDecoder {
+    typedef void result_type;
+
+    ZipChannelDecoder(int _width, int _channelSize)
+        : width(_width),
+          channelSize(_channelSize)
+    {
+    }
+
+    void operator()(ZipChannelJob &job) const {
+        if (job.info->compressionType == Compression::ZIP) {
+            job.status = psd_unzip_without_prediction((quint8*)job.compressedBytes.data(), job.compressedBytes.size(),
+                                                      (quint8*)job.uncompressedBytes.data(), job.uncompressedBytes.size());
+        } else {
+            job.status = psd_unzip_with_prediction((quint8*)job.compressedBytes.data(), job.compressedBytes.size(),
+                                                   (quint8*)job.uncompressedBytes.data(), job.uncompressedBytes.size(),
+                                                   width, channelSize * 8);
+        }
+
+        // release the memory as soon as possible
+        job.compressedBytes = QByteArray();
+    }
+
+    int width;
+    int channelSize;
+};
+
+struct ZipRowsAssembler {
+    typedef void result_type;
+
+    ZipRowsAssembler(KisPaintDeviceSP _dev, const QRect &_layerRect, int _channelSize,
+                     PixelFunc _pixelFunc, const QMap<quint16, QByteArray> &_channelBytes)
+        : dev(_dev),
+          layerRect(_layerRect),
+          channelSize(_channelSize),
+          pixelFunc(_pixelFunc),
+          channelBytes(_channelBytes)
+    {
+    }
+
+    void operator()(const DecodingBand &band) const {
+        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(),
+                                                           layerRect.top() + band.firstRow,
+                                                           layerRect.width());
+
+        for (int row = band.firstRow; row < band.firstRow + band.numRows; row++) {
+            const int rowStart = row * layerRect.width();
+
+            for (int col = 0; col < layerRect.width(); col++) {
+                pixelFunc(channelSize, channelBytes, rowStart + col, it->rawData());
+                it->nextPixel();
+            }
+            it->nextRow();
+        }
+    }
+
+    KisPaintDeviceSP dev;
+    QRect layerRect;
+    int channelSize;
+    PixelFunc pixelFunc;
+    const QMap<quint16, QByteArray> &channelBytes;
+};
+
+void readZipCommon(KisPaintDeviceSP dev,
+                   QIODevice *io,
+                   const QRect &layerRect,
+                   QVector<ChannelInfo*> infoRecords,
+                   int channelSize,
+                   PixelFunc pixelFunc)
+{
+    const int numPixels = channelSize * layerRect.width() * layerRect.height();
+
+    QVector<ZipChannelJob> jobs;
+
+    Q_FOREACH (ChannelInfo *info, infoRecords) {
+        // user supplied masks are ignored here
+        if (info->channelId < -1) continue;
+
+        ZipChannelJob job;
+        job.info = info;
+        job.status = false;
+
+        io->seek(info->channelDataStart);
+        job.compressedBytes = io->read(info->channelDataLength);
+        job.uncompressedBytes = QByteArray(numPixels, 0);
+
+        jobs.append(job);
+    }
+
+    QtConcurrent::blockingMap(jobs, ZipChannelDecoder(layerRect.width(), channelSize));
+
+    QMap<quint16, QByteArray> channelBytes;
+
+    Q_FOREACH (const ZipChannelJob &job, jobs) {
+        ChannelInfo *info = job.info;
+
+        if (!job.status) {
+            QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
+            dbgFile << "ERROR:" << error;
+            dbgFile << "      " << ppVar(info->channelId);
+            dbgFile << "      " << ppVar(info->channelDataStart);
+            dbgFile << "      " << ppVar(info->channelDataLength);
+            dbgFile << "      " << ppVar(info->compressionType);
+            throw KisAslReaderUtils::ASLParseException(error);
+        }
+
+        channelBytes.insert(info->channelId, job.uncompressedBytes);
+    }
+    jobs.clear();
+
+    QVector<DecodingBand> bands = splitIntoBands(layerRect);
+    QtConcurrent::blockingMap(bands, ZipRowsAssembler(dev, layerRect, channelSize, pixelFunc, channelBytes));
+}
 
 void readCommon(KisPaintDeviceSP dev,
                 QIODevice *io,
@@ -405,59 +712,9 @@ void readCommon(KisPaintDeviceSP dev,
     if (infoRecords.first()->compressionType == Compression::ZIP ||
         infoRecords.first()->compressionType == Compression::ZIPWithPrediction) {
 
-        const int numPixels = channelSize * layerRect.width() * layerRect.height();
-
-        QMap<quint16, QByteArray> channelBytes;
-
-        Q_FOREACH (ChannelInfo *info, infoRecords) {
-            io->seek(info->channelDataStart);
-            QByteArray compressedBytes = io->read(info->channelDataLength);
-            QByteArray uncompressedBytes(numPixels, 0);
-
-            bool status = false;
-            if (infoRecords.first()->compressionType == Compression::ZIP) {
-                status = psd_unzip_without_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                      (quint8*)uncompressedBytes.data(), uncompressedBytes.size());
-            } else {
-                status = psd_unzip_with_prediction((quint8*)compressedBytes.data(), compressedBytes.size(),
-                                                   (quint8*)uncompressedBytes.data(), uncompressedBytes.size(),
-                                                   layerRect.width(), channelSize * 8);
-            }
-
-            if (!status) {
-                QString error = QString("Failed to unzip channel data: id = %1, compression = %2").arg(info->channelId).arg(info->compressionType);
-                dbgFile << "ERROR:" << error;
-                dbgFile << "      " << ppVar(info->channelId);
-                dbgFile << "      " << ppVar(info->channelDataStart);
-                dbgFile << "      " << ppVar(info->channelDataLength);
-                dbgFile << "      " << ppVar(info->compressionType);
-                throw KisAslReaderUtils::ASLParseException(error);
-            }
-
-            channelBytes.insert(info->channelId, uncompressedBytes);
-        }
-
-        KisSequentialIterator it(dev, layerRect);
-        int col = 0;
-        do {
-            pixelFunc(channelSize, channelBytes, col, it.rawData());
-            col++;
-        } while(it.nextPixel());
-
+        readZipCommon(dev, io, layerRect, infoRecords, channelSize, pixelFunc);
     } else {
-        KisHLineIteratorSP it = dev->createHLineIteratorNG(layerRect.left(), layerRect.top(), layerRect.width());
-        for (int i = 0 ; i < layerRect.height(); i++) {
-            QMap<quint16, QByteArray> channelBytes;
-
-            channelBytes = fetchChannelsBytes(io, infoRecords,
-                                              i, layerRect.width(), channelSize);
-
-            for (qint64 col = 0; col < layerRect.width(); col++){
-                pixelFunc(channelSize, channelBytes, col, it->rawData());
-                it->nextPixel();
-            }
-            it->nextRow();
-        }
+        readRowsCommon(dev, io, layerRect, infoRecords, channelSize, pixelFunc);
     }
 }
 
@@ -492,53 +749,6 @@ void readChannels(QIODevice *io,
     }
 }
 
-void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
-{
-    typedef KisAslWriterUtils::OffsetStreamPusher<quint32> Pusher;
-    QScopedPointer<Pusher> channelBlockSizeExternalTag;
-    if (sizeFieldOffset >= 0) {
-        channelBlockSizeExternalTag.reset(new Pusher(io, 0, sizeFieldOffset));
-    }
-
-    if (writeCompressionType) {
-        SAFE_WRITE_EX(io, (quint16)Compression::RLE);
-    }
-
-    const bool externalRleBlock = rleBlockOffset >= 0;
-
-    // the start of RLE sizes block
-    const qint64 channelRLESizePos = externalRleBlock ? rleBlockOffset : io->pos();
-
-    {
-        QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
-
-        if (externalRleBlock) {
-            rleOffsetKeeper.reset(new KisOffsetKeeper(io));
-            io->seek(rleBlockOffset);
-        }
-
-        // write zero's for the channel lengths block
-        for(int i = 0; i < rc.height(); ++i) {
-            // XXX: choose size for PSB!
-            const quint16 fakeRLEBLockSize = 0;
-            SAFE_WRITE_EX(io, fakeRLEBLockSize);
-        }
-    }
-
-    quint32 stride = channelSize * rc.width();
-    for (qint32 row = 0; row < rc.height(); ++row) {
-
-        QByteArray uncompressed = QByteArray::fromRawData((const char*)plane + row * stride, stride);
-        QByteArray compressed = Compression::compress(uncompressed, Compression::RLE);
-
-        KisAslWriterUtils::OffsetStreamPusher<quint16> rleExternalTag(io, 0, channelRLESizePos + row * sizeof(quint16));
-
-        if (io->write(compressed) != compressed.size()) {
-            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
-        }
-    }
-}
-
 inline void preparePixelForWrite(quint8 *dataPlane,
                                  int numPixels,
                                  int channelSize,
@@ -582,6 +792,129 @@ inline void preparePixelForWrite(quint8 *dataPlane,
     }
 }
 
+/**
+ * A band of rows of a single channel compressed with RLE
+ */
+struct RLECompressionJob {
+    quint8 *plane;
+    int firstRow;
+    int numRows;
+
+    // if set, the pixels are converted into PSD format before compression
+    bool preparePixels;
+    int channelId;
+
+    QByteArray compressedData;
+    QVector<quint32> rowLengths;
+};
+
+struct RLECompressor {
+    typedef void result_type;
+
+    RLECompressor(int _width, int _channelSize, psd_color_mode _colorMode)
+        : width(_width),
+          channelSize(_channelSize),
+          colorMode(_colorMode)
+    {
+    }
+
+    void operator()(RLECompressionJob &job) const {
+        const quint32 stride = channelSize * width;
+        quint8 *src = job.plane + job.firstRow * stride;
+
+        if (job.preparePixels) {
+            preparePixelForWrite(src, job.numRows * width, channelSize, job.channelId, colorMode);
+        }
+
+        job.compressedData.resize(Compression::maxRLECompressedLength(stride) * job.numRows);
+        job.rowLengths.reserve(job.numRows);
+
+        char *dst = job.compressedData.data();
+        quint32 totalLength = 0;
+
+        for (int row = 0; row < job.numRows; row++) {
+            const quint32 length = Compression::compressRLE((const char*)src + row * stride, stride, dst + totalLength);
+            job.rowLengths.append(length);
+            totalLength += length;
+        }
+
+        job.compressedData.resize(totalLength);
+    }
+
+    int width;
+    int channelSize;
+    psd_color_mode colorMode;
+};
+
+void addRLECompressionJobs(QVector<RLECompressionJob> &jobs, quint8 *plane, const QRect &rc, bool preparePixels, int channelId)
+{
+    for (int row = 0; row < rc.height(); row += decodingBandHeight) {
+        RLECompressionJob job;
+        job.plane = plane;
+        job.firstRow = row;
+        job.numRows = qMin(decodingBandHeight, rc.height() - row);
+        job.preparePixels = preparePixels;
+        job.channelId = channelId;
+
+        jobs.append(job);
+    }
+}
+
+void writeCompressedChannelRLE(QIODevice *io,
+                               QVector<RLECompressionJob>::const_iterator begin,
+                               QVector<RLECompressionJob>::const_iterator end,
+                               const qint64 sizeFieldOffset,
+                               const qint64 rleBlockOffset,
+                               const bool writeCompressionType)
+{
+    typedef KisAslWriterUtils::OffsetStreamPusher<quint32> Pusher;
+    QScopedPointer<Pusher> channelBlockSizeExternalTag;
+    if (sizeFieldOffset >= 0) {
+        channelBlockSizeExternalTag.reset(new Pusher(io, 0, sizeFieldOffset));
+    }
+
+    if (writeCompressionType) {
+        SAFE_WRITE_EX(io, (quint16)Compression::RLE);
+    }
+
+    const bool externalRleBlock = rleBlockOffset >= 0;
+
+    {
+        // the row lengths are already known, so the sizes block is
+        // written in one go
+        QScopedPointer<KisOffsetKeeper> rleOffsetKeeper;
+
+        if (externalRleBlock) {
+            rleOffsetKeeper.reset(new KisOffsetKeeper(io));
+            io->seek(rleBlockOffset);
+        }
+
+        for (QVector<RLECompressionJob>::const_iterator it = begin; it != end; ++it) {
+            Q_FOREACH (quint32 length, it->rowLengths) {
+                // XXX: choose size for PSB!
+                const quint16 rleBlockSize = length;
+                SAFE_WRITE_EX(io, rleBlockSize);
+            }
+        }
+    }
+
+    for (QVector<RLECompressionJob>::const_iterator it = begin; it != end; ++it) {
+        if (io->write(it->compressedData) != it->compressedData.size()) {
+            throw KisAslWriterUtils::ASLWriteException("Failed to write image data");
+        }
+    }
+}
+
+void writeChannelDataRLE(QIODevice *io, const quint8 *plane, const int channelSize, const QRect &rc, const qint64 sizeFieldOffset, const qint64 rleBlockOffset, const bool writeCompressionType)
+{
+    QVector<RLECompressionJob> jobs;
+    addRLECompressionJobs(jobs, const_cast<quint8*>(plane), rc, false, 0);
+
+    QtConcurrent::blockingMap(jobs, RLECompressor(rc.width(), channelSize, COLORMODE_UNKNOWN));
+
+    writeCompressedChannelRLE(io, jobs.constBegin(), jobs.constEnd(), sizeFieldOffset, rleBlockOffset, writeCompressionType);
+}
+
 void writePixelDataCommon(QIODevice *io,
                           KisPaintDeviceSP dev,
                           const QRect &rc,
@@ -635,21 +968,31 @@ void writePixelDataCommon(QIODevice *io,
 
     KIS_ASSERT_RECOVER_RETURN(planes.size() >= writingInfoList.size());
 
-    const int numPixels = rc.width() * rc.height();
+    // convert and compress all the channels on all the cores...
+    QVector<RLECompressionJob> jobs;
+    QVector<int> channelFirstJob;
+
+    for (int i = 0; i < writingInfoList.size(); i++) {
+        channelFirstJob.append(jobs.size());
+        addRLECompressionJobs(jobs, planes[i], rc, true, writingInfoList[i].channelId);
+    }
+    channelFirstJob.append(jobs.size());
+
+    QtConcurrent::blockingMap(jobs, RLECompressor(rc.width(), channelSize, colorMode));
 
-    // write down the planes
+    // ... and write them down in the original order
 
     try {
         for (int i = 0; i < writingInfoList.size(); i++) {
             const ChannelWritingInfo &info = writingInfoList[i];
 
             dbgFile << "\tWriting channel" << i << "psd channel id" << info.channelId;
-
-            preparePixelForWrite(planes[i], numPixels, channelSize, info.channelId, colorMode);
-
             dbgFile << "\t\tchannel start" << ppVar(io->pos());
 
-            writeChannelDataRLE(io, planes[i], channelSize, rc, info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
+            writeCompressedChannelRLE(io,
+                                      jobs.constBegin() + channelFirstJob[i],
+                                      jobs.constBegin() + channelFirstJob[i + 1],
+                                      info.sizeFieldOffset, info.rleBlockOffset, writeCompressionType);
         }
 
     } catch (KisAslWriterUtils::ASLWriteException &e) {
@@ -53,6 +53,63 @@ void CompressionTest::testCompressionRLE()
 
 }
 
+void CompressionTest::testCompressionRLEWideRow()
+{
+    // a row of a wide 16-bit image is longer than uncompress() accepts
+    QByteArray ba;
+    for (int i = 0; i < 40000; ++i) {
+        ba.append(char((i / 7) % 3 ? i % 251 : 42));
+    }
+
+    QByteArray compressed(Compression::maxRLECompressedLength(ba.size()), 0);
+    quint32 compressedLength = Compression::compressRLE(ba.constData(), ba.size(), compressed.data());
+    QVERIFY(compressedLength <= Compression::maxRLECompressedLength(ba.size()));
+    compressed.resize(compressedLength);
+
+    QCOMPARE(compressed, Compression::compress(ba, Compression::RLE));
+
+    QByteArray uncompressed(ba.size(), 0);
+    Compression::uncompressRLE(compressed.constData(), compressed.size(), uncompressed.data(), uncompressed.size());
+    QCOMPARE(uncompressed, ba);
+}
+
+void CompressionTest::testCompressionRLEWorstCase()
+{
+    const int widths[] = {1, 2, 3, 127, 128, 129, 255, 256, 257, 4096};
+    const int guardSize = 16;
+    const char guardByte = char(0xcd);
+
+    for (int width : widths) {
+        // random bytes without any two equal neighbours, so no runs at all
+        QByteArray ba;
+        char prev = 0;
+        for (int i = 0; i < width; ++i) {
+            char value = char(rand() % 256);
+            if (i > 0 && value == prev) {
+                value++;
+            }
+            ba.append(value);
+            prev = value;
+        }
+
+        const quint32 bound = Compression::maxRLECompressedLength(width);
+
+        QByteArray compressed(bound + guardSize, guardByte);
+        const quint32 compressedLength = Compression::compressRLE(ba.constData(), ba.size(), compressed.data());
+
+        QVERIFY2(compressedLength <= bound,
+                 QString("width %1: %2 bytes, bound %3")
+                 .arg(width).arg(compressedLength).arg(bound).toLatin1());
+
+        QCOMPARE(compressed.right(guardSize), QByteArray(guardSize, guardByte));
+
+        compressed.resize(compressedLength);
+
+        QByteArray uncompressed(ba.size(), 0);
+        Compression::uncompressRLE(compressed.constData(), compressed.size(), uncompressed.data(), uncompressed.size());
+        QCOMPARE(uncompressed, ba);
+    }
+}
 
 void CompressionTest::testCompressionZIP()
 {
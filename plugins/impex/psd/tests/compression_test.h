@@ -27,6 +27,8 @@ class CompressionTest : public QObject
 private Q_SLOTS:
 
     void testCompressionRLE();
+    void testCompressionRLEWideRow();
+    void testCompressionRLEWorstCase();
     void testCompressionZIP();
     void testCompressionUncompressed();
 
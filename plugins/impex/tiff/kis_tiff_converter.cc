@@ -25,6 +25,8 @@
 #include <QApplication>
 
 #include <QFileInfo>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include <KoDocumentInfo.h>
 #include <KoUnit.h>
@@ -163,12 +165,231 @@ QPair<QString, QString> getColorSpaceForColorType(uint16 sampletype, uint16 colo
     }
     return QPair<QString, QString>();
 }
+
+/**
+ * Parameters shared by all the decoders of a single TIFF directory
+ */
+struct TIFFDecodeParams {
+    uint32 width;
+    uint32 height;
+    uint16 depth;
+    uint16 nbchannels;
+    uint16 planarconfig;
+    uint16 vsubsampling;
+    const uint16 *lineSizeCoeffs;
+    KisTIFFReaderBase *tiffReader;
+};
+
+/**
+ * Decodes strips or tiles (blocks) of a TIFF directory into the paint
+ * device of the reader. Owns the decoding buffers, so every thread
+ * should have its own decoder and its own TIFF handle.
+ */
+class TIFFBlockDecoder
+{
+public:
+    TIFFBlockDecoder(TIFF *image, const TIFFDecodeParams &params)
+        : m_image(image),
+          m_params(params),
+          m_buf(0),
+          m_planes(0),
+          m_stream(0),
+          m_tileWidth(0),
+          m_tileHeight(0),
+          m_rowsPerStrip(0)
+    {
+        const bool isContig = m_params.planarconfig == PLANARCONFIG_CONTIG;
+        const uint16 nbchannels = m_params.nbchannels;
+        uint32 lineWidth = 0;
+        tmsize_t planeSize = 0;
+        QVector<uint32> lineSizes(nbchannels);
+
+        if (TIFFIsTiled(m_image)) {
+            TIFFGetField(m_image, TIFFTAG_TILEWIDTH, &m_tileWidth);
+            TIFFGetField(m_image, TIFFTAG_TILELENGTH, &m_tileHeight);
+
+            const tmsize_t tileSize = TIFFTileSize(m_image);
+
+            if (isContig) {
+                m_buf = _TIFFmalloc(tileSize);
+                lineWidth = (m_tileWidth * m_params.depth * nbchannels) / 8;
+            } else {
+                planeSize = tileSize / nbchannels;
+                for (uint i = 0; i < nbchannels; i++) {
+                    lineSizes[i] = m_tileWidth; // baseSize / lineSizeCoeffs[i];
+                }
+            }
+        } else {
+            const tsize_t stripSize = TIFFStripSize(m_image);
+
+            TIFFGetFieldDefaulted(m_image, TIFFTAG_ROWSPERSTRIP, &m_rowsPerStrip);
+            m_rowsPerStrip = qMin(m_rowsPerStrip, m_params.height); // when TIFFNumberOfStrips(image) == 1 it might happen that rowsPerStrip is incorrectly set
+
+            if (isContig) {
+                m_buf = _TIFFmalloc(stripSize);
+                lineWidth = stripSize / m_rowsPerStrip;
+            } else {
+                planeSize = stripSize;
+                const uint32 scanLineSize = stripSize / m_rowsPerStrip;
+                for (uint i = 0; i < nbchannels; i++) {
+                    lineSizes[i] = scanLineSize / m_params.lineSizeCoeffs[i];
+                }
+            }
+        }
+
+        if (isContig) {
+            if (m_params.depth < 16) {
+                m_stream = new KisBufferStreamContigBelow16((uint8*)m_buf, m_params.depth, lineWidth);
+            }
+            else if (m_params.depth < 32) {
+                m_stream = new KisBufferStreamContigBelow32((uint8*)m_buf, m_params.depth, lineWidth);
+            }
+            else {
+                m_stream = new KisBufferStreamContigAbove32((uint8*)m_buf, m_params.depth, lineWidth);
+            }
+        } else {
+            m_planes = new tdata_t[nbchannels];
+            for (uint i = 0; i < nbchannels; i++) {
+                m_planes[i] = _TIFFmalloc(planeSize);
+            }
+            m_stream = new KisBufferStreamSeperate((uint8**) m_planes, nbchannels, m_params.depth, lineSizes.data());
+        }
+    }
+
+    ~TIFFBlockDecoder() {
+        delete m_stream;
+
+        if (m_planes) {
+            for (uint i = 0; i < m_params.nbchannels; i++) {
+                _TIFFfree(m_planes[i]);
+            }
+            delete[] m_planes;
+        } else {
+            _TIFFfree(m_buf);
+        }
+    }
+
+    static int numBlocks(TIFF *image, const TIFFDecodeParams &params) {
+        if (TIFFIsTiled(image)) {
+            uint32 tileWidth, tileHeight;
+            TIFFGetField(image, TIFFTAG_TILEWIDTH, &tileWidth);
+            TIFFGetField(image, TIFFTAG_TILELENGTH, &tileHeight);
+
+            return ((params.width + tileWidth - 1) / tileWidth) *
+                ((params.height + tileHeight - 1) / tileHeight);
+        } else {
+            uint32 rowsPerStrip;
+            TIFFGetFieldDefaulted(image, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+            rowsPerStrip = qMin(rowsPerStrip, params.height);
+
+            return (params.height + rowsPerStrip - 1) / rowsPerStrip;
+        }
+    }
+
+    void decodeBlock(int index) {
+        if (m_tileWidth) {
+            const uint32 tilesAcross = (m_params.width + m_tileWidth - 1) / m_tileWidth;
+            decodeTile((index % tilesAcross) * m_tileWidth, (index / tilesAcross) * m_tileHeight);
+        } else {
+            decodeStrip(index * m_rowsPerStrip);
+        }
+    }
+
+private:
+    void decodeTile(uint32 x, uint32 y) {
+        dbgFile << "Reading tile x =" << x << " y =" << y;
+        if (m_params.planarconfig == PLANARCONFIG_CONTIG) {
+            TIFFReadTile(m_image, m_buf, x, y, 0, (tsample_t) - 1);
+        }
+        else {
+            for (uint i = 0; i < m_params.nbchannels; i++) {
+                TIFFReadTile(m_image, m_planes[i], x, y, 0, i);
+            }
+        }
+        uint32 realTileWidth = (x + m_tileWidth) < m_params.width ? m_tileWidth : m_params.width - x;
+        for (uint yintile = 0; y + yintile < m_params.height && yintile < m_tileHeight / m_params.vsubsampling;) {
+            m_params.tiffReader->copyDataToChannels(x, y + yintile , realTileWidth, m_stream);
+            yintile += 1;
+            m_stream->moveToLine(yintile);
+        }
+        m_stream->restart();
+    }
+
+    void decodeStrip(uint32 y) {
+        if (m_params.planarconfig == PLANARCONFIG_CONTIG) {
+            TIFFReadEncodedStrip(m_image, TIFFComputeStrip(m_image, y, 0) , m_buf, (tsize_t) - 1);
+        }
+        else {
+            for (uint i = 0; i < m_params.nbchannels; i++) {
+                TIFFReadEncodedStrip(m_image, TIFFComputeStrip(m_image, y, i), m_planes[i], (tsize_t) - 1);
+            }
+        }
+        for (uint32 yinstrip = 0 ; yinstrip < m_rowsPerStrip && y < m_params.height ;) {
+            uint linesread = m_params.tiffReader->copyDataToChannels(0, y, m_params.width, m_stream);
+            y += linesread;
+            yinstrip += linesread;
+            m_stream->moveToLine(yinstrip);
+        }
+        m_stream->restart();
+    }
+
+private:
+    TIFF *m_image;
+    TIFFDecodeParams m_params;
+    tdata_t m_buf;
+    tdata_t *m_planes; // used only for planar configuration separated
+    KisBufferStreamBase *m_stream;
+    uint32 m_tileWidth;
+    uint32 m_tileHeight;
+    uint32 m_rowsPerStrip;
+};
+
+struct TIFFDecodeJob {
+    TIFFDecodeJob() : firstBlock(0), lastBlock(0), done(false) {}
+
+    int firstBlock;
+    int lastBlock;
+    bool done;
+};
+
+/**
+ * Decodes a range of blocks through a separate TIFF handle, so that
+ * the decompression of independent strips/tiles can happen concurrently
+ */
+struct ParallelTIFFDecoder {
+    ParallelTIFFDecoder(const QString &filename, tdir_t directory, const TIFFDecodeParams &params)
+        : m_filename(filename),
+          m_directory(directory),
+          m_params(params)
+    {
+    }
+
+    void operator() (TIFFDecodeJob &job) {
+        TIFF *image = TIFFOpen(QFile::encodeName(m_filename), "r");
+        if (!image) return;
+
+        if (TIFFSetDirectory(image, m_directory)) {
+            TIFFBlockDecoder decoder(image, m_params);
+            for (int i = job.firstBlock; i < job.lastBlock; i++) {
+                decoder.decodeBlock(i);
+            }
+            job.done = true;
+        }
+
+        TIFFClose(image);
+    }
+
+    QString m_filename;
+    tdir_t m_directory;
+    TIFFDecodeParams m_params;
+};
 }
 
 KisTIFFConverter::KisTIFFConverter(KisDocument *doc)
 {
     m_doc = doc;
     m_stop = false;
+    m_parallelDecoding = true;
 
     TIFFSetWarningHandler(0);
     TIFFSetErrorHandler(0);
@@ -189,7 +410,7 @@ KisImageBuilder_Result KisTIFFConverter::decode(const QString &filename)
     }
     do {
         dbgFile << "Read new sub-image";
-        KisImageBuilder_Result result = readTIFFDirectory(image);
+        KisImageBuilder_Result result = readTIFFDirectory(image, filename);
         if (result != KisImageBuilder_RESULT_OK) {
             return result;
         }
@@ -199,7 +420,7 @@ KisImageBuilder_Result KisTIFFConverter::decode(const QString &filename)
     return KisImageBuilder_RESULT_OK;
 }
 
-KisImageBuilder_Result KisTIFFConverter::readTIFFDirectory(TIFF* image)
+KisImageBuilder_Result KisTIFFConverter::readTIFFDirectory(TIFF* image, const QString &filename)
 {
     // Read information about the tiff
     uint32 width, height;
@@ -378,10 +599,6 @@ KisImageBuilder_Result KisTIFFConverter::readTIFFDirectory(TIFF* image)
         }
     }
     KisPaintLayer* layer = new KisPaintLayer(m_image.data(), m_image -> nextLayerName(), quint8_MAX);
-    tdata_t buf = 0;
-    tdata_t* ps_buf = 0; // used only for planar configuration separated
-    KisBufferStreamBase* tiffstream;
-
     KisTIFFReaderBase* tiffReader = 0;
 
     quint8 poses[5];
@@ -497,123 +714,64 @@ KisImageBuilder_Result KisTIFFConverter::readTIFFDirectory(TIFF* image)
         return KisImageBuilder_RESULT_INVALID_ARG;
     }
 
-    if (TIFFIsTiled(image)) {
-        dbgFile << "tiled image";
-        uint32 tileWidth, tileHeight;
-        uint32 x, y;
-        TIFFGetField(image, TIFFTAG_TILEWIDTH, &tileWidth);
-        TIFFGetField(image, TIFFTAG_TILELENGTH, &tileHeight);
-        uint32 linewidth = (tileWidth * depth * nbchannels) / 8;
-        if (planarconfig == PLANARCONFIG_CONTIG) {
-            buf = _TIFFmalloc(TIFFTileSize(image));
-            if (depth < 16) {
-                tiffstream = new KisBufferStreamContigBelow16((uint8*)buf, depth, linewidth);
-            }
-            else if (depth < 32) {
-                tiffstream = new KisBufferStreamContigBelow32((uint8*)buf, depth, linewidth);
-            }
-            else {
-                tiffstream = new KisBufferStreamContigAbove32((uint8*)buf, depth, linewidth);
-            }
-        }
-        else {
-            ps_buf = new tdata_t[nbchannels];
-            uint32 * lineSizes = new uint32[nbchannels];
-            tmsize_t baseSize = TIFFTileSize(image) / nbchannels;
-            for (uint i = 0; i < nbchannels; i++) {
-                ps_buf[i] = _TIFFmalloc(baseSize);
-                lineSizes[i] = tileWidth; // baseSize / lineSizeCoeffs[i];
-            }
-            tiffstream = new KisBufferStreamSeperate((uint8**) ps_buf, nbchannels, depth, lineSizes);
-            delete [] lineSizes;
-        }
-        dbgFile << linewidth << "" << nbchannels << "" << layer->paintDevice()->colorSpace()->colorChannelCount();
-        for (y = 0; y < height; y += tileHeight) {
-            for (x = 0; x < width; x += tileWidth) {
-                dbgFile << "Reading tile x =" << x << " y =" << y;
-                if (planarconfig == PLANARCONFIG_CONTIG) {
-                    TIFFReadTile(image, buf, x, y, 0, (tsample_t) - 1);
-                }
-                else {
-                    for (uint i = 0; i < nbchannels; i++) {
-                        TIFFReadTile(image, ps_buf[i], x, y, 0, i);
-                    }
-                }
-                uint32 realTileWidth = (x + tileWidth) < width ? tileWidth : width - x;
-                for (uint yintile = 0; y + yintile < height && yintile < tileHeight / vsubsampling;) {
-                    tiffReader->copyDataToChannels(x, y + yintile , realTileWidth, tiffstream);
-                    yintile += 1;
-                    tiffstream->moveToLine(yintile);
-                }
-                tiffstream->restart();
-            }
+    TIFFDecodeParams params;
+    params.width = width;
+    params.height = height;
+    params.depth = depth;
+    params.nbchannels = nbchannels;
+    params.planarconfig = planarconfig;
+    params.vsubsampling = vsubsampling;
+    params.lineSizeCoeffs = lineSizeCoeffs;
+    params.tiffReader = tiffReader;
+
+    const int numBlocks = TIFFBlockDecoder::numBlocks(image, params);
+
+    /**
+     * YCbCr readers accumulate the data internally and the lcms
+     * transformations are not reentrant, so such images are decoded
+     * on a single thread. Everything else is split into contiguous
+     * ranges of strips/tiles, each decoded through its own TIFF handle.
+     */
+    const bool canDecodeInParallel =
+        m_parallelDecoding &&
+        color_type != PHOTOMETRIC_YCBCR && !transform &&
+        numBlocks > 1 && QThread::idealThreadCount() > 1;
+
+    QVector<TIFFDecodeJob> jobs;
+
+    if (canDecodeInParallel) {
+        const int numJobs = qMin(numBlocks, QThread::idealThreadCount());
+        for (int i = 0; i < numJobs; i++) {
+            TIFFDecodeJob job;
+            job.firstBlock = i * numBlocks / numJobs;
+            job.lastBlock = (i + 1) * numBlocks / numJobs;
+            jobs.append(job);
         }
+
+        ParallelTIFFDecoder decoder(filename, TIFFCurrentDirectory(image), params);
+        QtConcurrent::blockingMap(jobs, decoder);
+    } else {
+        TIFFDecodeJob job;
+        job.firstBlock = 0;
+        job.lastBlock = numBlocks;
+        jobs.append(job);
     }
-    else {
-        dbgFile << "striped image";
-        tsize_t stripsize = TIFFStripSize(image);
-        uint32 rowsPerStrip;
-        TIFFGetFieldDefaulted(image, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
-        dbgFile << rowsPerStrip << "" << height;
-        rowsPerStrip = qMin(rowsPerStrip, height); // when TIFFNumberOfStrips(image) == 1 it might happen that rowsPerStrip is incorrectly set
-        if (planarconfig == PLANARCONFIG_CONTIG) {
-            buf = _TIFFmalloc(stripsize);
-            if (depth < 16) {
-                tiffstream = new KisBufferStreamContigBelow16((uint8*)buf, depth, stripsize / rowsPerStrip);
-            }
-            else if (depth < 32) {
-                tiffstream = new KisBufferStreamContigBelow32((uint8*)buf, depth, stripsize / rowsPerStrip);
-            }
-            else {
-                tiffstream = new KisBufferStreamContigAbove32((uint8*)buf, depth, stripsize / rowsPerStrip);
-            }
-        }
-        else {
-            ps_buf = new tdata_t[nbchannels];
-            uint32 scanLineSize = stripsize / rowsPerStrip;
-            dbgFile << " scanLineSize for each plan =" << scanLineSize;
-            uint32 * lineSizes = new uint32[nbchannels];
-            for (uint i = 0; i < nbchannels; i++) {
-                ps_buf[i] = _TIFFmalloc(stripsize);
-                lineSizes[i] = scanLineSize / lineSizeCoeffs[i];
-            }
-            tiffstream = new KisBufferStreamSeperate((uint8**) ps_buf, nbchannels, depth, lineSizes);
-            delete [] lineSizes;
-        }
 
-        dbgFile << "Scanline size =" << TIFFRasterScanlineSize(image) << " / strip size =" << TIFFStripSize(image) << " / rowsPerStrip =" << rowsPerStrip << " stripsize/rowsPerStrip =" << stripsize / rowsPerStrip;
-        uint32 y = 0;
-        dbgFile << " NbOfStrips =" << TIFFNumberOfStrips(image) << " rowsPerStrip =" << rowsPerStrip << " stripsize =" << stripsize;
-        for (uint32 strip = 0; y < height; strip++) {
-            if (planarconfig == PLANARCONFIG_CONTIG) {
-                TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, 0) , buf, (tsize_t) - 1);
-            }
-            else {
-                for (uint i = 0; i < nbchannels; i++) {
-                    TIFFReadEncodedStrip(image, TIFFComputeStrip(image, y, i), ps_buf[i], (tsize_t) - 1);
-                }
-            }
-            for (uint32 yinstrip = 0 ; yinstrip < rowsPerStrip && y < height ;) {
-                uint linesread = tiffReader->copyDataToChannels(0, y, width, tiffstream);
-                y += linesread;
-                yinstrip += linesread;
-                tiffstream->moveToLine(yinstrip);
+    {
+        // everything the workers failed to decode goes through the main handle
+        TIFFBlockDecoder decoder(image, params);
+        Q_FOREACH (const TIFFDecodeJob &job, jobs) {
+            if (job.done) continue;
+
+            for (int i = job.firstBlock; i < job.lastBlock; i++) {
+                decoder.decodeBlock(i);
             }
-            tiffstream->restart();
         }
     }
+
     tiffReader->finalize();
     delete[] lineSizeCoeffs;
     delete tiffReader;
-    delete tiffstream;
-    if (planarconfig == PLANARCONFIG_CONTIG) {
-        _TIFFfree(buf);
-    } else {
-        for (uint i = 0; i < nbchannels; i++) {
-            _TIFFfree(ps_buf[i]);
-        }
-        delete[] ps_buf;
-    }
 
     m_image->addNode(KisNodeSP(layer), m_image->rootLayer().data());
     return KisImageBuilder_RESULT_OK;
@@ -630,6 +788,11 @@ KisImageSP KisTIFFConverter::image()
     return m_image;
 }
 
+void KisTIFFConverter::setParallelDecoding(bool value)
+{
+    m_parallelDecoding = value;
+}
+
 
 KisImageBuilder_Result KisTIFFConverter::buildFile(const QString &filename, KisImageSP kisimage, KisTIFFOptions options)
 {
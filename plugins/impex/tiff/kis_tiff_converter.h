@@ -41,6 +41,7 @@ struct KisTIFFOptions {
     quint16 faxMode;
     quint16 pixarLogCompress;
     bool saveProfile;
+    bool tiled;
 };
 
 class KisTIFFConverter : public QObject
@@ -55,15 +56,23 @@ public:
     /** Retrieve the constructed image
     */
     KisImageSP image();
+
+    /**
+     * Allow decoding the strips/tiles on several threads (on by
+     * default). Only the unit tests are supposed to turn it off.
+     */
+    void setParallelDecoding(bool value);
+
 public Q_SLOTS:
     virtual void cancel();
 private:
     KisImageBuilder_Result decode(const QString &filename);
-    KisImageBuilder_Result readTIFFDirectory(TIFF* image);
+    KisImageBuilder_Result readTIFFDirectory(TIFF* image, const QString &filename);
 private:
     KisImageSP m_image;
     KisDocument *m_doc;
     bool m_stop;
+    bool m_parallelDecoding;
 };
 
 #endif
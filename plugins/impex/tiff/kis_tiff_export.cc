@@ -144,6 +144,7 @@ KisPropertiesConfigurationSP KisTIFFExport::defaultConfiguration(const QByteArra
     cfg->setProperty("faxmode", 0);
     cfg->setProperty("pixarlog", 6);
     cfg->setProperty("saveProfile", true);
+    cfg->setProperty("tiled", false);
 
     return cfg;
 }
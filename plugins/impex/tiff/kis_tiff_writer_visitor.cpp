@@ -37,6 +37,10 @@
 #include <kis_iterator_ng.h>
 #include <kis_shape_layer.h>
 
+#include <QVector>
+#include <QtConcurrentMap>
+#include <zlib.h>
+
 #include <KoConfig.h>
 #ifdef HAVE_OPENEXR
 #include <half.h>
@@ -74,6 +78,35 @@ namespace
         return false;
 
     }
+
+    bool getColorPoses(uint16 color_type, uint16 sample_format, quint8 *poses, uint8 &nbcolorssamples)
+    {
+        switch (color_type) {
+        case PHOTOMETRIC_MINISBLACK:
+            poses[0] = 0; poses[1] = 1;
+            nbcolorssamples = 1;
+            return true;
+        case PHOTOMETRIC_RGB:
+            if (sample_format == SAMPLEFORMAT_IEEEFP) {
+                poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
+            } else {
+                poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
+            }
+            nbcolorssamples = 3;
+            return true;
+        case PHOTOMETRIC_SEPARATED:
+            poses[0] = 0; poses[1] = 1; poses[2] = 2; poses[3] = 3; poses[4] = 4;
+            nbcolorssamples = 4;
+            return true;
+        case PHOTOMETRIC_ICCLAB:
+            poses[0] = 0; poses[1] = 1; poses[2] = 2; poses[3] = 3;
+            nbcolorssamples = 3;
+            return true;
+        }
+        return false;
+    }
+
+    const int tiffTileSize = 256;
 }
 
 KisTIFFWriterVisitor::KisTIFFWriterVisitor(TIFF*image, KisTIFFOptions* options)
@@ -213,8 +246,14 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer * layer)
 
     // Use contiguous configuration
     TIFFSetField(image(), TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-    // Use 8 rows per strip
-    TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, 8);
+
+    if (m_options->tiled) {
+        TIFFSetField(image(), TIFFTAG_TILEWIDTH, tiffTileSize);
+        TIFFSetField(image(), TIFFTAG_TILELENGTH, tiffTileSize);
+    } else {
+        // Use 8 rows per strip
+        TIFFSetField(image(), TIFFTAG_ROWSPERSTRIP, 8);
+    }
 
     // Save profile
     if (m_options->saveProfile) {
@@ -224,45 +263,184 @@ bool KisTIFFWriterVisitor::saveLayerProjection(KisLayer * layer)
             TIFFSetField(image(), TIFFTAG_ICCPROFILE, ba.size(), ba.constData());
         }
     }
-    tsize_t stripsize = TIFFStripSize(image());
-    tdata_t buff = _TIFFmalloc(stripsize);
+
+    quint8 poses[5];
+    uint8 nbcolorssamples = 0;
+    if (!getColorPoses(color_type, sample_format, poses, nbcolorssamples)) {
+        return false;
+    }
+
     qint32 height = layer->image()->height();
     qint32 width = layer->image()->width();
+
+    if (m_options->tiled) {
+        if (!saveTiles(pd, QRect(0, 0, width, height), depth, sample_format, nbcolorssamples, poses)) {
+            return false;
+        }
+        TIFFWriteDirectory(image());
+        return true;
+    }
+
+    tsize_t stripsize = TIFFStripSize(image());
+    tdata_t buff = _TIFFmalloc(stripsize);
     bool r = true;
     for (int y = 0; y < height; y++) {
         KisHLineConstIteratorSP it = pd->createHLineConstIteratorNG(0, y, width);
-        switch (color_type) {
-        case PHOTOMETRIC_MINISBLACK: {
-                quint8 poses[] = { 0, 1 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 1, poses);
-            }
-            break;
-        case PHOTOMETRIC_RGB: {
-                quint8 poses[4];
-                if (sample_format == SAMPLEFORMAT_IEEEFP) {
-                    poses[2] = 2; poses[1] = 1; poses[0] = 0; poses[3] = 3;
-                } else {
-                    poses[0] = 2; poses[1] = 1; poses[2] = 0; poses[3] = 3;
-                }
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
-            }
-            break;
-        case PHOTOMETRIC_SEPARATED: {
-                quint8 poses[] = { 0, 1, 2, 3, 4 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 4, poses);
-            }
-            break;
-        case PHOTOMETRIC_ICCLAB: {
-                quint8 poses[] = { 0, 1, 2, 3 };
-                r = copyDataToStrips(it, buff, depth, sample_format, 3, poses);
-            }
-            break;
+        r = copyDataToStrips(it, buff, depth, sample_format, nbcolorssamples, poses);
+        if (!r) {
+            _TIFFfree(buff);
             return false;
         }
-        if (!r) return false;
         TIFFWriteScanline(image(), buff, y, (tsample_t) - 1);
     }
     _TIFFfree(buff);
     TIFFWriteDirectory(image());
     return true;
 }
+
+struct KisTIFFWriterVisitor::TileJob {
+    TileJob() : result(false), compressed(false) {}
+
+    QRect rect;
+    QByteArray data;
+    bool result;
+    bool compressed;
+};
+
+/**
+ * Fills the tiles with the pixel data and, when the compression
+ * scheme is deflate, applies the predictor and compresses the tiles
+ * ourselves, so that the most expensive part of the export runs on
+ * all the cores. Other schemes are encoded by libtiff when the tiles
+ * are written.
+ */
+struct KisTIFFWriterVisitor::TileEncoder {
+    TileEncoder(KisTIFFWriterVisitor *visitor, KisPaintDeviceSP pd,
+                uint8 depth, uint16 sample_format, uint8 nbcolorssamples, quint8* poses,
+                int tileSize, int tileRowSize, int samplesPerPixel, bool ownDeflate)
+        : m_visitor(visitor), m_pd(pd),
+          m_depth(depth), m_sample_format(sample_format),
+          m_nbcolorssamples(nbcolorssamples), m_poses(poses),
+          m_tileSize(tileSize), m_tileRowSize(tileRowSize),
+          m_samplesPerPixel(samplesPerPixel), m_ownDeflate(ownDeflate)
+    {
+    }
+
+    void operator() (TileJob &job) {
+        QByteArray buffer(m_tileSize, 0);
+
+        for (int row = 0; row < job.rect.height(); row++) {
+            KisHLineConstIteratorSP it = m_pd->createHLineConstIteratorNG(job.rect.x(), job.rect.y() + row, job.rect.width());
+            quint8 *dst = reinterpret_cast<quint8*>(buffer.data()) + row * m_tileRowSize;
+
+            if (!m_visitor->copyDataToStrips(it, dst, m_depth, m_sample_format, m_nbcolorssamples, m_poses)) {
+                job.result = false;
+                return;
+            }
+        }
+
+        if (m_ownDeflate) {
+            if (m_visitor->m_options->predictor == PREDICTOR_HORIZONTAL) {
+                applyHorizontalPredictor(reinterpret_cast<quint8*>(buffer.data()));
+            }
+
+            uLongf compressedSize = compressBound(buffer.size());
+            job.data.resize(compressedSize);
+
+            const int level = qBound(0, int(m_visitor->m_options->deflateCompress), 9);
+            if (compress2(reinterpret_cast<Bytef*>(job.data.data()), &compressedSize,
+                          reinterpret_cast<const Bytef*>(buffer.constData()), buffer.size(),
+                          level) != Z_OK) {
+
+                job.result = false;
+                return;
+            }
+
+            job.data.resize(compressedSize);
+            job.compressed = true;
+        } else {
+            job.data = buffer;
+            job.compressed = false;
+        }
+
+        job.result = true;
+    }
+
+    void applyHorizontalPredictor(quint8 *data) {
+        const int rowSamples = m_tileRowSize * 8 / m_depth;
+
+        for (int offset = 0; offset < m_tileSize; offset += m_tileRowSize) {
+            if (m_depth == 8) {
+                quint8 *row = data + offset;
+                for (int i = rowSamples - 1; i >= m_samplesPerPixel; i--) {
+                    row[i] -= row[i - m_samplesPerPixel];
+                }
+            } else if (m_depth == 16) {
+                quint16 *row = reinterpret_cast<quint16*>(data + offset);
+                for (int i = rowSamples - 1; i >= m_samplesPerPixel; i--) {
+                    row[i] -= row[i - m_samplesPerPixel];
+                }
+            }
+        }
+    }
+
+    KisTIFFWriterVisitor *m_visitor;
+    KisPaintDeviceSP m_pd;
+    uint8 m_depth;
+    uint16 m_sample_format;
+    uint8 m_nbcolorssamples;
+    quint8* m_poses;
+    int m_tileSize;
+    int m_tileRowSize;
+    int m_samplesPerPixel;
+    bool m_ownDeflate;
+};
+
+bool KisTIFFWriterVisitor::saveTiles(KisPaintDeviceSP pd, const QRect &imageRect, uint8 depth, uint16 sample_format, uint8 nbcolorssamples, quint8* poses)
+{
+    uint16 samplesPerPixel = 0;
+    TIFFGetField(image(), TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+
+    /**
+     * Our own deflate encoder supports only the horizontal predictor
+     * for integer samples, the floating point one is left to libtiff.
+     */
+    const bool ownDeflate =
+        (m_options->compressionType == COMPRESSION_DEFLATE ||
+         m_options->compressionType == COMPRESSION_ADOBE_DEFLATE) &&
+        (m_options->predictor == PREDICTOR_NONE ||
+         (m_options->predictor == PREDICTOR_HORIZONTAL && sample_format != SAMPLEFORMAT_IEEEFP));
+
+    TileEncoder encoder(this, pd, depth, sample_format, nbcolorssamples, poses,
+                        TIFFTileSize(image()), TIFFTileRowSize(image()), samplesPerPixel,
+                        ownDeflate);
+
+    for (int y = imageRect.y(); y < imageRect.bottom() + 1; y += tiffTileSize) {
+
+        // encode one row of tiles at a time to keep the memory usage bounded
+        QVector<TileJob> jobs;
+        for (int x = imageRect.x(); x < imageRect.right() + 1; x += tiffTileSize) {
+            TileJob job;
+            job.rect = QRect(x, y, tiffTileSize, tiffTileSize) & imageRect;
+            jobs.append(job);
+        }
+
+        QtConcurrent::blockingMap(jobs, encoder);
+
+        Q_FOREACH (const TileJob &job, jobs) {
+            if (!job.result) return false;
+
+            const ttile_t tile = TIFFComputeTile(image(), job.rect.x(), job.rect.y(), 0, 0);
+            const tsize_t size = job.data.size();
+            tdata_t data = const_cast<char*>(job.data.constData());
+
+            const tsize_t written = job.compressed ?
+                TIFFWriteRawTile(image(), tile, data, size) :
+                TIFFWriteEncodedTile(image(), tile, data, size);
+
+            if (written < 0) return false;
+        }
+    }
+
+    return true;
+}
@@ -25,6 +25,7 @@
 
 #include <tiffio.h>
 
+class QRect;
 struct KisTIFFOptions;
 
 /**
@@ -78,6 +79,10 @@ private:
     }
     bool copyDataToStrips(KisHLineConstIteratorSP it, tdata_t buff, uint8 depth, uint16 sample_format, uint8 nbcolorssamples, quint8* poses);
     bool saveLayerProjection(KisLayer *);
+    bool saveTiles(KisPaintDeviceSP pd, const QRect &imageRect, uint8 depth, uint16 sample_format, uint8 nbcolorssamples, quint8* poses);
+private:
+    struct TileJob;
+    struct TileEncoder;
 private:
     TIFF* m_image;
     KisTIFFOptions* m_options;
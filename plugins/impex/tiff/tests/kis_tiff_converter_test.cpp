@@ -0,0 +1,141 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tiff_converter_test.h"
+
+#include <QTest>
+#include <QDir>
+#include <QTemporaryFile>
+
+#include "testutil.h"
+
+#include <KoColorSpaceRegistry.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_group_layer.h>
+#include <kis_sequential_iterator.h>
+
+#include "../kis_tiff_converter.h"
+
+
+static KisImageSP createPatternImage(const QSize &size)
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisImageSP image = new KisImage(0, size.width(), size.height(), cs, "tiff test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "layer", OPACITY_OPAQUE_U8);
+    image->addNode(layer, image->rootLayer());
+
+    // a pattern with no large uniform areas, so every tile is different
+    KisSequentialIterator it(layer->paintDevice(), image->bounds());
+    do {
+        quint8 *pixel = it.rawData();
+        const int x = it.x();
+        const int y = it.y();
+
+        pixel[0] = quint8(x * 7 + y);
+        pixel[1] = quint8(x ^ y);
+        pixel[2] = quint8(y * 3);
+        pixel[3] = quint8(255 - ((x + y) & 0x1f));
+    } while (it.nextPixel());
+
+    return image;
+}
+
+static KisTIFFOptions createOptions(bool tiled)
+{
+    KisTIFFOptions options;
+    options.compressionType = COMPRESSION_ADOBE_DEFLATE;
+    options.predictor = 2;
+    options.alpha = true;
+    options.flatten = false;
+    options.jpegQuality = 80;
+    options.deflateCompress = 6;
+    options.faxMode = 1;
+    options.pixarLogCompress = 6;
+    options.saveProfile = false;
+    options.tiled = tiled;
+    return options;
+}
+
+static KisPaintDeviceSP loadFirstLayer(KisDocument *doc, const QString &fileName, bool parallel)
+{
+    KisTIFFConverter converter(doc);
+    converter.setParallelDecoding(parallel);
+
+    if (converter.buildImage(fileName) != KisImageBuilder_RESULT_OK) {
+        return 0;
+    }
+
+    KisImageSP image = converter.image();
+    KisNodeSP layer = image ? image->rootLayer()->firstChild() : 0;
+
+    return layer ? layer->paintDevice() : 0;
+}
+
+void KisTiffConverterTest::testRoundTripTiled()
+{
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+    // not a multiple of the tile size in either direction
+    KisImageSP image = createPatternImage(QSize(600, 301));
+    KisNodeSP layer = image->rootLayer()->firstChild();
+
+    QTemporaryFile tmpFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".tiff"));
+    QVERIFY(tmpFile.open());
+
+    KisTIFFConverter writer(doc.data());
+    QCOMPARE(writer.buildFile(tmpFile.fileName(), image, createOptions(true)), KisImageBuilder_RESULT_OK);
+
+    KisPaintDeviceSP loaded = loadFirstLayer(doc.data(), tmpFile.fileName(), true);
+    QVERIFY(loaded);
+
+    QCOMPARE(loaded->exactBounds(), image->bounds());
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, layer->paintDevice(), loaded));
+}
+
+void KisTiffConverterTest::testParallelStripDecoding()
+{
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+    // the writer puts 8 rows into a strip, so there are 38 strips
+    KisImageSP image = createPatternImage(QSize(333, 301));
+    KisNodeSP layer = image->rootLayer()->firstChild();
+
+    QTemporaryFile tmpFile(QDir::tempPath() + QLatin1String("/krita_XXXXXX") + QLatin1String(".tiff"));
+    QVERIFY(tmpFile.open());
+
+    KisTIFFConverter writer(doc.data());
+    QCOMPARE(writer.buildFile(tmpFile.fileName(), image, createOptions(false)), KisImageBuilder_RESULT_OK);
+
+    KisPaintDeviceSP serial = loadFirstLayer(doc.data(), tmpFile.fileName(), false);
+    KisPaintDeviceSP parallel = loadFirstLayer(doc.data(), tmpFile.fileName(), true);
+    QVERIFY(serial);
+    QVERIFY(parallel);
+
+    QPoint errorPoint;
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, serial, parallel));
+    QVERIFY(TestUtil::comparePaintDevices(errorPoint, layer->paintDevice(), parallel));
+}
+
+QTEST_MAIN(KisTiffConverterTest)
@@ -25,6 +25,7 @@
 #include <KoColorSpaceRegistry.h>
 #include <KoColor.h>
 #include <KoColorProfile.h>
+#include <KoCompositeOp.h>
 #include <KoCompositeOpRegistry.h>
 
 #include <kis_brush.h>
@@ -43,10 +44,7 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     : KisBrushBasedPaintOp(settings, painter)
     , m_firstRun(true)
     , m_image(image)
-    , m_tempDev(painter->device()->createCompositionSourceDevice())
-    , m_backgroundPainter(new KisPainter(m_tempDev))
-    , m_smudgePainter(new KisPainter(m_tempDev))
-    , m_colorRatePainter(new KisPainter(m_tempDev))
+    , m_tempDev(new KisFixedPaintDevice(painter->device()->compositionSourceColorSpace()))
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
     , m_smudgeRadiusOption()
@@ -79,18 +77,13 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
 
     m_gradient = painter->gradient();
 
-    m_backgroundPainter->setCompositeOp(COMPOSITE_COPY);
-    // Smudge Painter works in default COMPOSITE_OVER mode
-    m_colorRatePainter->setCompositeOp(painter->compositeOp()->id());
+    m_colorRateOp = m_tempDev->colorSpace()->compositeOp(painter->compositeOp()->id());
 
     m_rotationOption.applyFanCornersInfo(this);
 }
 
 KisColorSmudgeOp::~KisColorSmudgeOp()
 {
-    delete m_backgroundPainter;
-    delete m_colorRatePainter;
-    delete m_smudgePainter;
 }
 
 void KisColorSmudgeOp::updateMask(const KisPaintInformation& info, double scale, double rotation, const QPointF &cursorPoint)
@@ -119,6 +112,61 @@ inline void KisColorSmudgeOp::getTopLeftAligned(const QPointF &pos, const QPoint
     splitCoordinate(topLeft.y(), y, &yFraction);
 }
 
+void KisColorSmudgeOp::compositeFromDevice(KisPaintDeviceSP src, const QRect &srcRect, const KoCompositeOp *op)
+{
+    const KoColorSpace *srcCs = src->colorSpace();
+    const KoColorSpace *dstCs = m_tempDev->colorSpace();
+
+    if (op->id() == COMPOSITE_COPY && *srcCs == *dstCs) {
+        src->readBytes(m_tempDev->data(), srcRect);
+        return;
+    }
+
+    m_srcBuffer.resize(srcRect.width() * srcRect.height() * srcCs->pixelSize());
+    src->readBytes(m_srcBuffer.data(), srcRect);
+
+    KoCompositeOp::ParameterInfo params;
+    params.dstRowStart   = m_tempDev->data();
+    params.dstRowStride  = srcRect.width() * dstCs->pixelSize();
+    params.srcRowStart   = m_srcBuffer.constData();
+    params.srcRowStride  = srcRect.width() * srcCs->pixelSize();
+    params.maskRowStart  = 0;
+    params.maskRowStride = 0;
+    params.rows          = srcRect.height();
+    params.cols          = srcRect.width();
+
+    dstCs->bitBlt(srcCs, params, op,
+                  KoColorConversionTransformation::internalRenderingIntent(),
+                  KoColorConversionTransformation::internalConversionFlags());
+}
+
+void KisColorSmudgeOp::compositeColor(const KoColor &color, const KoCompositeOp *op, quint8 opacity)
+{
+    const KoColorSpace *cs = m_tempDev->colorSpace();
+    const QRect rc = m_tempDev->bounds();
+
+    KoColor srcColor(color);
+    srcColor.convertTo(cs);
+
+    if (op->id() == COMPOSITE_COPY && opacity == OPACITY_OPAQUE_U8) {
+        m_tempDev->fill(rc.x(), rc.y(), rc.width(), rc.height(), srcColor.data());
+        return;
+    }
+
+    KoCompositeOp::ParameterInfo params;
+    params.dstRowStart   = m_tempDev->data();
+    params.dstRowStride  = rc.width() * cs->pixelSize();
+    params.srcRowStart   = srcColor.data();
+    params.srcRowStride  = 0; // srcRowStride is set to zero to use the compositeOp with only a single color pixel
+    params.maskRowStart  = 0;
+    params.maskRowStride = 0;
+    params.rows          = rc.height();
+    params.cols          = rc.width();
+    params.opacity       = float(opacity) / 255.0f;
+
+    op->composite(params);
+}
+
 KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 {
     KisBrushSP brush = m_brush;
@@ -203,49 +251,61 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
     QString oldCompositeOpId = painter()->compositeOp()->id();
     qreal   fpOpacity  = (qreal(oldOpacity) / 255.0) * m_opacityOption.getOpacityf(info);
 
-    if (m_image && m_overlayModeOption.isChecked()) {
+    const KoColorSpace *tempCs = m_tempDev->colorSpace();
+
+    /**
+     * The temporary device covers the dab only, so it is kept in
+     * a plain array of pixels. It avoids all the tile lookups,
+     * locking and copy-on-write overhead of a KisPaintDevice.
+     *
+     * IMPORTANT: initialize() clears the device to color black
+     *            with zero opacity
+     */
+    m_tempDev->setRect(QRect(QPoint(), m_dstDabRect.size()));
+    m_tempDev->initialize();
+
+    const bool useOverlay = m_image && m_overlayModeOption.isChecked();
+
+    if (useOverlay) {
         m_image->blockUpdates();
-        m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), srcDabRect);
+        compositeFromDevice(m_image->projection(), srcDabRect, tempCs->compositeOp(COMPOSITE_COPY));
         m_image->unblockUpdates();
     }
-    else {
-        // IMPORTANT: clear the temporary painting device to color black with zero opacity:
-        //            it will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
-    }
+
+    /**
+     * Compositing over a transparent device with the full opacity
+     * is equivalent to a plain copy, which is much cheaper
+     */
+    const KoCompositeOp *smudgeOp =
+        tempCs->compositeOp(useOverlay ? COMPOSITE_OVER : COMPOSITE_COPY);
 
     if (m_smudgeRateOption.getMode() == KisSmudgeOption::SMEARING_MODE) {
-        m_smudgePainter->bitBlt(QPoint(), painter()->device(), srcDabRect);
+        compositeFromDevice(painter()->device(), srcDabRect, smudgeOp);
     } else {
         QPoint pt = (srcDabRect.topLeft() + hotSpot).toPoint();
+        KoColor color = painter()->paintColor();
 
         if (m_smudgeRadiusOption.isChecked()) {
             qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
-            m_smudgeRadiusOption.apply(*m_smudgePainter, info, effectiveSize, pt.x(), pt.y(), painter()->device());
-
-            KoColor color2 = m_smudgePainter->paintColor();
-            m_smudgePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color2);
-
+            m_smudgeRadiusOption.apply(&color, info, effectiveSize, pt.x(), pt.y(), painter()->device());
         } else {
-            KoColor color = painter()->paintColor();
-
             // get the pixel on the canvas that lies beneath the hot spot
             // of the dab and fill  the temporary paint device with that color
 
             KisCrossDeviceColorPickerInt colorPicker(painter()->device(), color);
             colorPicker.pickColor(pt.x(), pt.y(), color.data());
-
-            m_smudgePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
         }
+
+        compositeColor(color, smudgeOp, OPACITY_OPAQUE_U8);
     }
 
     // if the user selected the color smudge option,
     // we will mix some color into the temporary painting device (m_tempDev)
     if (m_colorRateOption.isChecked()) {
-        // this will apply the opacity (selected by the user) to copyPainter
+        // this will calculate the opacity (selected by the user)
         // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
         qreal maxColorRate = qMax<qreal>(1.0 - m_smudgeRateOption.getRate(), 0.2);
-        m_colorRateOption.apply(*m_colorRatePainter, info, 0.0, maxColorRate, fpOpacity);
+        quint8 colorRateOpacity = m_colorRateOption.calculateOpacity(info, 0.0, maxColorRate, fpOpacity);
 
         // paint a rectangle with the current color (foreground color)
         // or a gradient color (if enabled)
@@ -253,7 +313,7 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
         // composite mode
         KoColor color = painter()->paintColor();
         m_gradientOption.apply(color, m_gradient, info);
-        m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+        compositeColor(color, m_colorRateOp, colorRateOpacity);
     }
 
     // if color is disabled (only smudge) and "overlay mode" is enabled
@@ -276,8 +336,8 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
     // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
 
     painter()->setCompositeOp(COMPOSITE_COPY);
-    painter()->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    painter()->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    painter()->bltFixedWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
+    painter()->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, m_maskDab, !m_dabCache->needSeparateOriginal());
 
     // restore orginal opacy and composite mode values
     painter()->setOpacity(oldOpacity);
@@ -20,6 +20,7 @@
 #define _KIS_COLORSMUDGEOP_H_
 
 #include <QRect>
+#include <QVector>
 
 #include <kis_brush_based_paintop.h>
 #include <kis_types.h>
@@ -39,6 +40,7 @@ class QPointF;
 class KoAbstractGradient;
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
+class KoCompositeOp;
 
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
@@ -54,13 +56,22 @@ private:
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
+    /**
+     * Composite the \p srcRect area of \p src into m_tempDev
+     */
+    void compositeFromDevice(KisPaintDeviceSP src, const QRect &srcRect, const KoCompositeOp *op);
+
+    /**
+     * Composite a rectangle of \p color over the whole m_tempDev
+     */
+    void compositeColor(const KoColor &color, const KoCompositeOp *op, quint8 opacity);
+
 private:
     bool                      m_firstRun;
     KisImageWSP               m_image;
-    KisPaintDeviceSP          m_tempDev;
-    KisPainter*               m_backgroundPainter;
-    KisPainter*               m_smudgePainter;
-    KisPainter*               m_colorRatePainter;
+    KisFixedPaintDeviceSP     m_tempDev;
+    QVector<quint8>           m_srcBuffer;
+    const KoCompositeOp*      m_colorRateOp;
     const KoAbstractGradient* m_gradient;
     KisPressureSizeOption     m_sizeOption;
     KisPressureOpacityOption  m_opacityOption;
@@ -38,6 +38,12 @@ public:
      */
     void apply(KisPainter& painter, const KisPaintInformation& info, qreal scaleMin = 0.0, qreal scaleMax = 1.0, qreal multiplicator = 1.0) const;
 
+    /**
+     * Calculate the opacity based on the rate and the curve
+     * (if checked) without applying it to a painter
+     */
+    quint8 calculateOpacity(const KisPaintInformation& info, qreal scaleMin = 0.0, qreal scaleMax = 1.0, qreal multiplicator = 1.0) const;
+
     void setRate(qreal rate) {
         KisCurveOption::setValue(rate);
     }
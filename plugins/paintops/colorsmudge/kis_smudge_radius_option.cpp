@@ -34,7 +34,6 @@
 #include <resources/KoColorSet.h>
 #include <KoChannelInfo.h>
 #include <KoMixColorsOp.h>
-#include <kis_cross_device_color_picker.h>
 
 #include <KoColor.h>
 
@@ -48,7 +47,7 @@ KisSmudgeRadiusOption::KisSmudgeRadiusOption():
     setValueRange(0.0,300.0);
 }
 
-void KisSmudgeRadiusOption::apply(KisPainter& painter,
+void KisSmudgeRadiusOption::apply(KoColor *color,
                                   const KisPaintInformation& info,
                                   qreal diameter,
                                   qreal posx,
@@ -62,10 +61,8 @@ void KisSmudgeRadiusOption::apply(KisPainter& painter,
     int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
 
 
-    KoColor color = painter.paintColor();
     if (smudgeRadius == 1) {
-        dev->pixel(posx, posy, &color);
-        painter.setPaintColor(color);
+        dev->pixel(posx, posy, color);
     } else {
 
         const KoColorSpace* cs = dev->colorSpace();
@@ -87,8 +84,6 @@ void KisSmudgeRadiusOption::apply(KisPainter& painter,
         int k = 0;
         int j = 0;
         KisRandomConstAccessorSP accessor = dev->createRandomConstAccessorNG(0, 0);
-        KisCrossDeviceColorPickerInt colorPicker(painter.device(), color);
-        colorPicker.pickColor(posx, posy, color.data());
 
         for (int y = 0; y <= smudgeRadius; y = y + loop_increment) {
             for (int x = 0; x <= smudgeRadius; x = x + loop_increment) {
@@ -139,8 +134,7 @@ void KisSmudgeRadiusOption::apply(KisPainter& painter,
 
         }
 
-        KoColor color = KoColor(pixels[0],cs);
-        painter.setPaintColor(color);
+        *color = KoColor(pixels[0],cs);
 
         for (int l = 0; l < 2; l++){
             delete[] pixels[l];
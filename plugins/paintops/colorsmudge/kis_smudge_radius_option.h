@@ -23,6 +23,7 @@
 
 class KisPropertiesConfiguration;
 class KisPainter;
+class KoColor;
 
 class KisSmudgeRadiusOption: public KisRateOption
 {
@@ -30,10 +31,10 @@ public:
     KisSmudgeRadiusOption();
 
     /**
-     * Set the opacity of the painter based on the rate
-     * and the curve (if checked)
+     * Mix the colors of \p dev in the smudge radius around
+     * (\p posx, \p posy) and store the result in \p color
      */
-    void apply(KisPainter& painter,
+    void apply(KoColor *color,
                const KisPaintInformation& info,
                qreal diameter,
                qreal posx,
@@ -24,6 +24,7 @@
 #include "kis_brushop.h"
 
 #include <QRect>
+#include <QThread>
 
 #include <kis_image.h>
 #include <kis_vec.h>
@@ -41,12 +42,16 @@
 #include <kis_pressure_sharpness_option.h>
 #include <kis_fixed_paint_device.h>
 #include <kis_lod_transform.h>
+#include <kis_dab_rendering_queue.h>
 
 
 KisBrushOp::KisBrushOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
     , m_opacityOption(node)
     , m_hsvTransformation(0)
+    , m_dabQueue(0)
+    , m_maxPendingDabs(2 * QThread::idealThreadCount())
+    , m_batchDabs(false)
 {
     Q_UNUSED(image);
     Q_ASSERT(settings);
@@ -91,10 +96,21 @@ KisBrushOp::KisBrushOp(const KisPaintOpSettingsSP settings, KisPainter *painter,
 
     m_dabCache->setSharpnessPostprocessing(&m_sharpnessOption);
     m_rotationOption.applyFanCornersInfo(this);
+
+    /**
+     * The dabs can be rendered on the worker threads only when
+     * their rendering doesn't depend on the state of the paintop
+     */
+    if (m_colorSource->isUniformColor() &&
+        KisDabRenderingQueue::canRenderBrush(m_brush)) {
+
+        m_dabQueue = new KisDabRenderingQueue(m_dabCache, m_brush);
+    }
 }
 
 KisBrushOp::~KisBrushOp()
 {
+    delete m_dabQueue;
     qDeleteAll(m_hsvOptions);
     delete m_colorSource;
     delete m_hsvTransformation;
@@ -131,7 +147,15 @@ KisSpacingInformation KisBrushOp::paintAt(const KisPaintInformation& info)
     quint8 origOpacity = painter()->opacity();
 
     m_opacityOption.setFlow(m_flowOption.apply(info));
-    m_opacityOption.apply(painter(), info);
+
+    PendingDab pendingDab;
+    if (m_dabQueue) {
+        pendingDab.opacity = m_opacityOption.calculateOpacity(info);
+        pendingDab.flow = quint8(m_opacityOption.getFlow() * 255.0);
+    } else {
+        m_opacityOption.apply(painter(), info);
+    }
+
     m_colorSource->selectColor(m_mixOption.apply(info), info);
     m_darkenOption.apply(m_colorSource, info);
 
@@ -142,6 +166,31 @@ KisSpacingInformation KisBrushOp::paintAt(const KisPaintInformation& info)
         m_colorSource->applyColorTransformation(m_hsvTransformation);
     }
 
+    if (m_dabQueue) {
+        KisDabCache::DabRequest request;
+        m_dabCache->prepareDab(device->compositionSourceColorSpace(),
+                               m_colorSource->uniformColor(),
+                               cursorPos,
+                               shape,
+                               info,
+                               m_softnessOption.apply(info),
+                               &request);
+
+        m_dabQueue->addDab(request);
+        m_pendingDabs.enqueue(pendingDab);
+
+        if (!m_batchDabs) {
+            blitAllDabs();
+        } else {
+            while (m_dabQueue->size() > m_maxPendingDabs) {
+                blitFirstDab();
+            }
+        }
+
+        return effectiveSpacing(scale, rotation,
+                                m_spacingOption, info);
+    }
+
     QRect dabRect;
     KisFixedPaintDeviceSP dab = m_dabCache->fetchDab(device->compositionSourceColorSpace(),
                                 m_colorSource,
@@ -188,6 +237,58 @@ void KisBrushOp::paintLine(const KisPaintInformation& pi1, const KisPaintInforma
     painter()->renderMirrorMask(rc, m_lineCacheDevice);
     }
     else {
+        m_batchDabs = true;
         KisPaintOp::paintLine(pi1, pi2, currentDistance);
+        m_batchDabs = false;
+
+        blitAllDabs();
+    }
+}
+
+void KisBrushOp::paintBezierCurve(const KisPaintInformation &pi1,
+                                  const QPointF &control1,
+                                  const QPointF &control2,
+                                  const KisPaintInformation &pi2,
+                                  KisDistanceInformation *currentDistance)
+{
+    m_batchDabs = true;
+    KisPaintOp::paintBezierCurve(pi1, control1, control2, pi2, currentDistance);
+    m_batchDabs = false;
+
+    blitAllDabs();
+}
+
+void KisBrushOp::blitFirstDab()
+{
+    QRect dabRect;
+    KisFixedPaintDeviceSP dab = m_dabQueue->takeFirstDab(&dabRect);
+    PendingDab pendingDab = m_pendingDabs.dequeue();
+
+    if (!dab) return;
+
+    // sanity check for the size calculation code
+    if (dab->bounds().size() != dabRect.size()) {
+        warnKrita << "KisBrushOp: dab bounds is not dab rect. See bug 327156" << dab->bounds().size() << dabRect.size();
+    }
+
+    quint8 origOpacity = painter()->opacity();
+
+    painter()->setOpacityUpdateAverage(pendingDab.opacity);
+    painter()->setFlow(pendingDab.flow);
+
+    painter()->bltFixed(dabRect.topLeft(), dab, dab->bounds());
+
+    painter()->renderMirrorMaskSafe(dabRect,
+                                    dab,
+                                    !m_dabCache->needSeparateOriginal());
+    painter()->setOpacity(origOpacity);
+}
+
+void KisBrushOp::blitAllDabs()
+{
+    if (!m_dabQueue) return;
+
+    while (m_dabQueue->size() > 0) {
+        blitFirstDab();
     }
 }
@@ -39,8 +39,11 @@
 #include <kis_pressure_spacing_option.h>
 #include <kis_brush_based_paintop_settings.h>
 
+#include <QQueue>
+
 class KisPainter;
 class KisColorSource;
+class KisDabRenderingQueue;
 
 
 class KisBrushOp : public KisBrushBasedPaintOp
@@ -53,6 +56,15 @@ public:
 
     KisSpacingInformation paintAt(const KisPaintInformation& info);
     void paintLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2, KisDistanceInformation *currentDistance);
+    void paintBezierCurve(const KisPaintInformation &pi1,
+                          const QPointF &control1,
+                          const QPointF &control2,
+                          const KisPaintInformation &pi2,
+                          KisDistanceInformation *currentDistance);
+
+private:
+    void blitFirstDab();
+    void blitAllDabs();
 
 private:
     KisColorSource *m_colorSource;
@@ -72,6 +84,22 @@ private:
     KoColorTransformation *m_hsvTransformation;
     KisPaintDeviceSP m_lineCacheDevice;
     KisPaintDeviceSP m_colorSourceDevice;
+
+    /**
+     * The dabs are rendered by m_dabQueue on the worker threads, while
+     * the paintop is walking along the line. The opacity and flow of
+     * every dab are calculated in the order of painting and stored
+     * until the dab is blitted.
+     */
+    struct PendingDab {
+        quint8 opacity;
+        quint8 flow;
+    };
+
+    KisDabRenderingQueue *m_dabQueue;
+    QQueue<PendingDab> m_pendingDabs;
+    int m_maxPendingDabs;
+    bool m_batchDabs;
 };
 
 #endif // KIS_BRUSHOP_H_
@@ -28,7 +28,6 @@
 #include <QVector>
 
 #include <kis_types.h>
-#include <kis_random_accessor_ng.h>
 #include <kis_cross_device_color_picker.h>
 #include <kis_fixed_paint_device.h>
 
@@ -59,6 +58,7 @@ void HairyBrush::initAndCache()
 {
     m_compositeOp = m_dab->colorSpace()->compositeOp(COMPOSITE_OVER);
     m_pixelSize = m_dab->colorSpace()->pixelSize();
+    m_splatter.reset(new KisPointSplatter(m_dab->colorSpace(), m_compositeOp));
 
     if (m_properties->useSaturation) {
         m_transfo = m_dab->colorSpace()->createColorTransformation("hsv_adjustment", m_params);
@@ -136,8 +136,6 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     Bristle *bristle = 0;
     KoColor bristleColor(dab->colorSpace());
 
-    m_dabAccessor = dab->createRandomAccessorNG((int)x1, (int)y1);
-
     m_dab = dab;
 
     // initialization block
@@ -237,8 +235,9 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
         }
 
     }
+
+    m_splatter->flush(dab);
     m_dab = 0;
-    m_dabAccessor = 0;
 }
 
 
@@ -337,27 +336,10 @@ void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
     quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
     quint8 bbr = qRound((fx)  * (fy)  * opacity);
 
-    const KoColorSpace * cs = m_dab->colorSpace();
-
-    m_dabAccessor->moveTo(ipx  , ipy);
-    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy);
-    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btr, 1);
-
-    m_dabAccessor->moveTo(ipx, ipy + 1);
-    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy + 1);
-    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbr, 1);
+    m_splatter->addOpacityPixel(ipx    , ipy    , color.data(), btl);
+    m_splatter->addOpacityPixel(ipx + 1, ipy    , color.data(), btr);
+    m_splatter->addOpacityPixel(ipx    , ipy + 1, color.data(), bbl);
+    m_splatter->addOpacityPixel(ipx + 1, ipy + 1, color.data(), bbr);
 }
 
 void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
@@ -392,16 +374,12 @@ void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
 
 inline void HairyBrush::plotPixel(int wx, int wy, const KoColor &color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    m_compositeOp->composite(m_dabAccessor->rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+    m_splatter->compositePixel(wx, wy, color.data());
 }
 
 inline void HairyBrush::darkenPixel(int wx, int wy, const KoColor &color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    if (m_dab->colorSpace()->opacityU8(m_dabAccessor->rawData()) < color.opacityU8()) {
-        memcpy(m_dabAccessor->rawData(), color.data(), m_pixelSize);
-    }
+    m_splatter->maxOpacityPixel(wx, wy, color.data());
 }
 
 double HairyBrush::computeMousePressure(double distance)
@@ -22,6 +22,7 @@
 #include <QVector>
 #include <QList>
 #include <QTransform>
+#include <QScopedPointer>
 
 #include <KoColor.h>
 
@@ -30,7 +31,7 @@
 
 #include <kis_paint_device.h>
 #include <brushengine/kis_paint_information.h>
-#include <kis_random_accessor_ng.h>
+#include <kis_point_splatter.h>
 
 class KoCompositeOp;
 
@@ -123,7 +124,7 @@ private:
     QHash<QString, QVariant> m_params;
     // temporary device
     KisPaintDeviceSP m_dab;
-    KisRandomAccessorSP m_dabAccessor;
+    QScopedPointer<KisPointSplatter> m_splatter;
     const KoCompositeOp * m_compositeOp;
     quint32 m_pixelSize;
 
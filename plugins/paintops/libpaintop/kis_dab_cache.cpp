@@ -83,7 +83,8 @@ struct KisDabCache::Private {
           textureOption(0),
           precisionOption(0),
           subPixelPrecisionDisabled(false),
-          cachedDabParameters(new SavedDabParameters)
+          cachedDabParameters(new SavedDabParameters),
+          lastDabColorSpace(0)
     {}
     KisFixedPaintDeviceSP dab;
     KisFixedPaintDeviceSP dabOriginal;
@@ -98,8 +99,19 @@ struct KisDabCache::Private {
     bool subPixelPrecisionDisabled;
 
     SavedDabParameters *cachedDabParameters;
+    const KoColorSpace *lastDabColorSpace;
 };
 
+KisDabCache::DabRequest::DabRequest()
+    : colorSpace(0),
+      softnessFactor(1.0),
+      horizontalMirror(false),
+      verticalMirror(false),
+      textureStrength(0.0),
+      fromCache(false)
+{
+}
+
 
 
 KisDabCache::KisDabCache(KisBrushSP brush)
@@ -213,7 +225,6 @@ struct KisDabCache::DabPosition {
     qreal realAngle;
 };
 
-inline
 QRect KisDabCache::correctDabRectWhenFetchedFromCache(const QRect &dabRect,
         const QSize &realDabSize)
 {
@@ -224,30 +235,6 @@ QRect KisDabCache::correctDabRectWhenFetchedFromCache(const QRect &dabRect,
                  realDabSize.width() , realDabSize.height());
 }
 
-inline
-KisFixedPaintDeviceSP KisDabCache::tryFetchFromCache(const SavedDabParameters &params,
-        const KisPaintInformation& info,
-        QRect *dstDabRect)
-{
-    int precisionLevel = m_d->precisionOption ? m_d->precisionOption->precisionLevel() - 1 : 3;
-
-    if (!params.compare(*m_d->cachedDabParameters, precisionLevel)) {
-        return 0;
-    }
-
-    if (needSeparateOriginal()) {
-        *m_d->dab = *m_d->dabOriginal;
-        *dstDabRect = correctDabRectWhenFetchedFromCache(*dstDabRect, m_d->dab->bounds().size());
-        postProcessDab(m_d->dab, dstDabRect->topLeft(), info);
-    }
-    else {
-        *dstDabRect = correctDabRectWhenFetchedFromCache(*dstDabRect, m_d->dab->bounds().size());
-    }
-
-    m_d->brush->notifyCachedDabPainted(info);
-    return m_d->dab;
-}
-
 qreal positiveFraction(qreal x) {
     qint32 unused = 0;
     qreal fraction = 0.0;
@@ -315,17 +302,15 @@ KisDabCache::calculateDabRect(const QPointF &cursorPoint,
 }
 
 inline
-KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
+bool KisDabCache::prepareDabCommon(const KoColorSpace *cs,
         const KisColorSource *colorSource,
         const KoColor& color,
         const QPointF &cursorPoint,
         KisDabShape shape,
         const KisPaintInformation& info,
         qreal softnessFactor,
-        QRect *dstDabRect)
+        DabRequest *request)
 {
-    Q_ASSERT(dstDabRect);
-
     MirrorProperties mirrorProperties;
     if (m_d->mirrorOption) {
         mirrorProperties = m_d->mirrorOption->apply(info);
@@ -336,12 +321,33 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
                                             info,
                                             mirrorProperties);
     shape = KisDabShape(shape.scale(), shape.ratio(), position.realAngle);
-    *dstDabRect = position.rect;
 
     bool cachingIsPossible = !colorSource || colorSource->isUniformColor();
     KoColor paintColor = colorSource && colorSource->isUniformColor() ?
                          colorSource->uniformColor() : color;
 
+    request->colorSpace = cs;
+    request->color = paintColor;
+    request->shape = shape;
+    request->info = info;
+
+    {
+        /**
+         * The request may outlive the paintAt() call, so its copy
+         * of the paint information must not refer to the distance
+         * information of the stroke
+         */
+        KisPaintInformation::DistanceInformationRegistrar r(&request->info, 0);
+    }
+
+    request->dabRect = position.rect;
+    request->subPixel = position.subPixel;
+    request->softnessFactor = softnessFactor;
+    request->horizontalMirror = mirrorProperties.horizontalMirror;
+    request->verticalMirror = mirrorProperties.verticalMirror;
+    request->textureStrength = 0.0;
+    request->fromCache = false;
+
     SavedDabParameters newParams = getDabParameters(paintColor,
                                    shape, info,
                                    position.subPixel.x(),
@@ -349,26 +355,121 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
                                    softnessFactor,
                                    mirrorProperties);
 
+    const bool hasPreviousDab =
+        m_d->lastDabColorSpace && *m_d->lastDabColorSpace == *cs;
+    m_d->lastDabColorSpace = cs;
+
+    if (hasPreviousDab && cachingIsPossible) {
+        int precisionLevel = m_d->precisionOption ? m_d->precisionOption->precisionLevel() - 1 : 3;
+        request->fromCache = newParams.compare(*m_d->cachedDabParameters, precisionLevel);
+    }
+
+    if (!request->fromCache &&
+        cachingIsPossible &&
+        m_d->brush->brushType() != IMAGE &&
+        m_d->brush->brushType() != PIPE_IMAGE) {
+
+        *m_d->cachedDabParameters = newParams;
+    }
+
+    return cachingIsPossible;
+}
+
+void KisDabCache::prepareDab(const KoColorSpace *cs,
+        const KoColor& color,
+        const QPointF &cursorPoint,
+        KisDabShape const& shape,
+        const KisPaintInformation& info,
+        qreal softnessFactor,
+        DabRequest *request)
+{
+    prepareDabCommon(cs, 0, color,
+                     cursorPoint,
+                     shape,
+                     info,
+                     softnessFactor,
+                     request);
+
+    if (m_d->textureOption && (!request->fromCache || needSeparateOriginal())) {
+        request->textureStrength = m_d->textureOption->calculateStrength(info);
+    }
+
+    if (request->fromCache) {
+        m_d->brush->notifyCachedDabPainted(info);
+    }
+}
+
+KisFixedPaintDeviceSP KisDabCache::renderDab(const DabRequest &request, KisBrushSP brush) const
+{
+    KisFixedPaintDeviceSP dab;
+
+    if (brush->brushType() == IMAGE || brush->brushType() == PIPE_IMAGE) {
+        dab = brush->paintDevice(request.colorSpace, request.shape, request.info,
+                                 request.subPixel.x(),
+                                 request.subPixel.y());
+    }
+    else {
+        dab = new KisFixedPaintDevice(request.colorSpace);
+        brush->mask(dab, request.color, request.shape,
+                    request.info,
+                    request.subPixel.x(), request.subPixel.y(),
+                    request.softnessFactor);
+    }
+
+    if (request.horizontalMirror || request.verticalMirror) {
+        dab->mirror(request.horizontalMirror, request.verticalMirror);
+    }
+
+    return dab;
+}
+
+inline
+KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
+        const KisColorSource *colorSource,
+        const KoColor& color,
+        const QPointF &cursorPoint,
+        KisDabShape shape,
+        const KisPaintInformation& info,
+        qreal softnessFactor,
+        QRect *dstDabRect)
+{
+    Q_ASSERT(dstDabRect);
+
+    DabRequest request;
+    bool cachingIsPossible = prepareDabCommon(cs, colorSource, color,
+                                              cursorPoint,
+                                              shape,
+                                              info,
+                                              softnessFactor,
+                                              &request);
+    *dstDabRect = request.dabRect;
+
     if (!m_d->dab || *m_d->dab->colorSpace() != *cs) {
         m_d->dab = new KisFixedPaintDevice(cs);
     }
-    else if (cachingIsPossible) {
-        KisFixedPaintDeviceSP cachedDab =
-            tryFetchFromCache(newParams, info, dstDabRect);
+    else if (request.fromCache) {
+        if (needSeparateOriginal()) {
+            *m_d->dab = *m_d->dabOriginal;
+            *dstDabRect = correctDabRectWhenFetchedFromCache(*dstDabRect, m_d->dab->bounds().size());
+            postProcessDab(m_d->dab, dstDabRect->topLeft(), info);
+        }
+        else {
+            *dstDabRect = correctDabRectWhenFetchedFromCache(*dstDabRect, m_d->dab->bounds().size());
+        }
 
-        if (cachedDab) return cachedDab;
+        m_d->brush->notifyCachedDabPainted(info);
+        return m_d->dab;
     }
 
     if (m_d->brush->brushType() == IMAGE || m_d->brush->brushType() == PIPE_IMAGE) {
-        m_d->dab = m_d->brush->paintDevice(cs, shape, info,
-                                           position.subPixel.x(),
-                                           position.subPixel.y());
+        m_d->dab = m_d->brush->paintDevice(cs, request.shape, info,
+                                           request.subPixel.x(),
+                                           request.subPixel.y());
     }
     else if (cachingIsPossible) {
-        *m_d->cachedDabParameters = newParams;
-        m_d->brush->mask(m_d->dab, paintColor, shape,
+        m_d->brush->mask(m_d->dab, request.color, request.shape,
                          info,
-                         position.subPixel.x(), position.subPixel.y(),
+                         request.subPixel.x(), request.subPixel.y(),
                          softnessFactor);
     }
     else {
@@ -379,19 +480,19 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
             m_d->colorSourceDevice->clear();
         }
 
-        QRect maskRect(QPoint(), position.rect.size());
+        QRect maskRect(QPoint(), request.dabRect.size());
         colorSource->colorize(m_d->colorSourceDevice, maskRect, info.pos().toPoint());
         delete m_d->colorSourceDevice->convertTo(cs);
 
-        m_d->brush->mask(m_d->dab, m_d->colorSourceDevice, shape,
+        m_d->brush->mask(m_d->dab, m_d->colorSourceDevice, request.shape,
                          info,
-                         position.subPixel.x(), position.subPixel.y(),
+                         request.subPixel.x(), request.subPixel.y(),
                          softnessFactor);
     }
 
-    if (!mirrorProperties.isEmpty()) {
-        m_d->dab->mirror(mirrorProperties.horizontalMirror,
-                         mirrorProperties.verticalMirror);
+    if (request.horizontalMirror || request.verticalMirror) {
+        m_d->dab->mirror(request.horizontalMirror,
+                         request.verticalMirror);
     }
 
     if (needSeparateOriginal()) {
@@ -402,7 +503,7 @@ KisFixedPaintDeviceSP KisDabCache::fetchDabCommon(const KoColorSpace *cs,
         *m_d->dabOriginal = *m_d->dab;
     }
 
-    postProcessDab(m_d->dab, position.rect.topLeft(), info);
+    postProcessDab(m_d->dab, request.dabRect.topLeft(), info);
 
     return m_d->dab;
 }
@@ -419,3 +520,16 @@ void KisDabCache::postProcessDab(KisFixedPaintDeviceSP dab,
         m_d->textureOption->apply(dab, dabTopLeft, info);
     }
 }
+
+void KisDabCache::postProcessDab(KisFixedPaintDeviceSP dab,
+                                 const QPoint &dabTopLeft,
+                                 const DabRequest &request) const
+{
+    if (m_d->sharpnessOption) {
+        m_d->sharpnessOption->applyThreshold(dab);
+    }
+
+    if (m_d->textureOption) {
+        m_d->textureOption->applyWithStrength(dab, dabTopLeft, request.textureStrength);
+    }
+}
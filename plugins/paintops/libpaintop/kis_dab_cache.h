@@ -21,6 +21,8 @@
 
 #include "kritapaintop_export.h"
 #include "kis_brush.h"
+#include <KoColor.h>
+#include <brushengine/kis_paint_information.h>
 
 class KisColorSource;
 class KisPressureSharpnessOption;
@@ -51,6 +53,36 @@ struct MirrorProperties;
  */
 class PAINTOP_EXPORT KisDabCache
 {
+public:
+    /**
+     * All the parameters of a dab that are calculated in the order
+     * of painting: the sensors, the position and the decision whether
+     * the previously rendered dab can be reused. Rendering of the
+     * request doesn't depend on the state of the cache, so it can be
+     * done on any thread (see KisDabRenderingQueue).
+     */
+    struct DabRequest {
+        DabRequest();
+
+        const KoColorSpace *colorSpace;
+        KoColor color;
+        KisDabShape shape;
+        KisPaintInformation info;
+        QRect dabRect;
+        QPointF subPixel;
+        qreal softnessFactor;
+        bool horizontalMirror;
+        bool verticalMirror;
+        qreal textureStrength;
+
+        /**
+         * The dab is a copy of the previously rendered one. Only
+         * the postprocessing should be applied to it and its rect
+         * should be corrected with correctDabRectWhenFetchedFromCache()
+         */
+        bool fromCache;
+    };
+
 public:
     KisDabCache(KisBrushSP brush);
     ~KisDabCache();
@@ -86,6 +118,46 @@ public:
                                    qreal softnessFactor,
                                    QRect *dstDabRect);
 
+    /**
+     * Make all the decisions fetchDab() would make for the dab, but
+     * don't render it. The requests must be prepared in the order of
+     * painting and rendered with renderDab() and postProcessDab().
+     * Don't mix prepareDab() and fetchDab() calls for one cache.
+     */
+    void prepareDab(const KoColorSpace *cs,
+                    const KoColor& color,
+                    const QPointF &cursorPoint,
+                    KisDabShape const&,
+                    const KisPaintInformation& info,
+                    qreal softnessFactor,
+                    DabRequest *request);
+
+    /**
+     * Render a new dab for \p request using \p brush. The result is
+     * not postprocessed yet. \p brush should be a clone of the cache's
+     * brush, owned by the calling thread.
+     */
+    KisFixedPaintDeviceSP renderDab(const DabRequest &request, KisBrushSP brush) const;
+
+    /**
+     * Apply sharpness and texture to the dab. Can be called from any thread.
+     */
+    void postProcessDab(KisFixedPaintDeviceSP dab,
+                        const QPoint &dabTopLeft,
+                        const DabRequest &request) const;
+
+    /**
+     * The rect of a dab fetched from cache, when the real size
+     * of the cached dab is \p realDabSize
+     */
+    static QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
+                                                    const QSize &realDabSize);
+
+
+private:
+    void postProcessDab(KisFixedPaintDeviceSP dab,
+                        const QPoint &dabTopLeft,
+                        const KisPaintInformation& info);
 
 private:
     struct SavedDabParameters;
@@ -103,13 +175,14 @@ private:
                      const KisPaintInformation& info,
                      const MirrorProperties &mirrorProperties);
 
-    inline
-    QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
-            const QSize &realDabSize);
-
-    inline KisFixedPaintDeviceSP tryFetchFromCache(const SavedDabParameters &params,
-            const KisPaintInformation& info,
-            QRect *dstDabRect);
+    inline bool prepareDabCommon(const KoColorSpace *cs,
+                                 const KisColorSource *colorSource,
+                                 const KoColor& color,
+                                 const QPointF &cursorPoint,
+                                 KisDabShape shape,
+                                 const KisPaintInformation& info,
+                                 qreal softnessFactor,
+                                 DabRequest *request);
 
     inline KisFixedPaintDeviceSP fetchDabCommon(const KoColorSpace *cs,
             const KisColorSource *colorSource,
@@ -120,10 +193,6 @@ private:
             qreal softnessFactor,
             QRect *dstDabRect);
 
-    void postProcessDab(KisFixedPaintDeviceSP dab,
-                        const QPoint &dabTopLeft,
-                        const KisPaintInformation& info);
-
 private:
 
     struct Private;
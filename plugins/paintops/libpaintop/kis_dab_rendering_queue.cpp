@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_dab_rendering_queue.h"
+
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+#include <QFuture>
+#include <QtConcurrentRun>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_auto_brush.h>
+#include "kis_assert.h"
+
+
+struct KisDabRenderingQueue::Private
+{
+    struct Job;
+    typedef QSharedPointer<Job> JobSP;
+
+    struct Job {
+        Job() : started(false) {}
+
+        KisDabCache::DabRequest request;
+
+        /**
+         * The job whose dab is reused by this one (only for
+         * the requests fetched from cache)
+         */
+        JobSP source;
+
+        bool started;
+        QFuture<void> future;
+
+        KisFixedPaintDeviceSP original;
+        KisFixedPaintDeviceSP dab;
+        QRect dabRect;
+    };
+
+    Private(KisDabCache *_cache, KisBrushSP _brush)
+        : cache(_cache),
+          brush(_brush),
+          needSeparateOriginal(_cache->needSeparateOriginal())
+    {
+    }
+
+    KisDabCache *cache;
+    KisBrushSP brush;
+    bool needSeparateOriginal;
+
+    QList<JobSP> jobs;
+    JobSP lastRenderedJob;
+
+    QMutex brushesLock;
+    QVector<KisBrushSP> freeBrushes;
+
+    KisBrushSP acquireBrush();
+    void releaseBrush(KisBrushSP brush);
+
+    void renderDab(JobSP job);
+    void copyCachedDab(JobSP job);
+    void startReadyJobs();
+};
+
+KisDabRenderingQueue::KisDabRenderingQueue(KisDabCache *cache, KisBrushSP brush)
+    : m_d(new Private(cache, brush))
+{
+}
+
+KisDabRenderingQueue::~KisDabRenderingQueue()
+{
+    Q_FOREACH (Private::JobSP job, m_d->jobs) {
+        job->future.waitForFinished();
+    }
+
+    delete m_d;
+}
+
+bool KisDabRenderingQueue::canRenderBrush(KisBrushSP brush)
+{
+    if (!brush ||
+        brush->brushType() == PIPE_MASK ||
+        brush->brushType() == PIPE_IMAGE) {
+
+        return false;
+    }
+
+    /**
+     * The mask applicators of the auto brush use the global rand()
+     * generator for the randomness and density, which is not
+     * thread-safe
+     */
+    KisAutoBrush *autoBrush = dynamic_cast<KisAutoBrush*>(brush.data());
+    if (autoBrush &&
+        (autoBrush->randomness() != 0.0 || autoBrush->density() != 1.0)) {
+
+        return false;
+    }
+
+    return true;
+}
+
+void KisDabRenderingQueue::addDab(const KisDabCache::DabRequest &request)
+{
+    Private::JobSP job(new Private::Job());
+    job->request = request;
+
+    if (request.fromCache) {
+        KIS_ASSERT_RECOVER(m_d->lastRenderedJob) {
+            job->request.fromCache = false;
+        }
+    }
+
+    if (job->request.fromCache) {
+        job->source = m_d->lastRenderedJob;
+    } else {
+        job->started = true;
+        job->future = QtConcurrent::run(m_d, &Private::renderDab, job);
+        m_d->lastRenderedJob = job;
+    }
+
+    m_d->jobs.append(job);
+    m_d->startReadyJobs();
+}
+
+KisFixedPaintDeviceSP KisDabRenderingQueue::takeFirstDab(QRect *dabRect)
+{
+    KIS_ASSERT_RECOVER_RETURN_VALUE(!m_d->jobs.isEmpty(), 0);
+
+    Private::JobSP job = m_d->jobs.first();
+
+    if (!job->started) {
+        job->source->future.waitForFinished();
+        m_d->startReadyJobs();
+    }
+
+    job->future.waitForFinished();
+
+    m_d->jobs.removeFirst();
+    m_d->startReadyJobs();
+
+    *dabRect = job->dabRect;
+    return job->dab;
+}
+
+int KisDabRenderingQueue::size() const
+{
+    return m_d->jobs.size();
+}
+
+KisBrushSP KisDabRenderingQueue::Private::acquireBrush()
+{
+    QMutexLocker l(&brushesLock);
+
+    if (!freeBrushes.isEmpty()) {
+        return freeBrushes.takeLast();
+    }
+
+    return KisBrushSP(brush->clone());
+}
+
+void KisDabRenderingQueue::Private::releaseBrush(KisBrushSP brush)
+{
+    QMutexLocker l(&brushesLock);
+    freeBrushes.append(brush);
+}
+
+void KisDabRenderingQueue::Private::renderDab(JobSP job)
+{
+    KisBrushSP threadBrush = acquireBrush();
+    job->original = cache->renderDab(job->request, threadBrush);
+    releaseBrush(threadBrush);
+
+    if (needSeparateOriginal) {
+        job->dab = new KisFixedPaintDevice(*job->original);
+        cache->postProcessDab(job->dab, job->request.dabRect.topLeft(), job->request);
+    } else {
+        job->dab = job->original;
+    }
+
+    job->dabRect = job->request.dabRect;
+}
+
+void KisDabRenderingQueue::Private::copyCachedDab(JobSP job)
+{
+    job->dabRect =
+        KisDabCache::correctDabRectWhenFetchedFromCache(job->request.dabRect,
+                                                        job->source->dab->bounds().size());
+
+    if (needSeparateOriginal) {
+        job->dab = new KisFixedPaintDevice(*job->source->original);
+        cache->postProcessDab(job->dab, job->dabRect.topLeft(), job->request);
+    } else {
+        job->dab = job->source->dab;
+    }
+}
+
+void KisDabRenderingQueue::Private::startReadyJobs()
+{
+    Q_FOREACH (JobSP job, jobs) {
+        if (job->started || !job->source->future.isFinished()) continue;
+
+        job->started = true;
+
+        /**
+         * Copying of a cached dab is cheap if it doesn't need
+         * any postprocessing, so do it right here
+         */
+        if (needSeparateOriginal) {
+            job->future = QtConcurrent::run(this, &Private::copyCachedDab, job);
+        } else {
+            copyCachedDab(job);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_DAB_RENDERING_QUEUE_H
+#define __KIS_DAB_RENDERING_QUEUE_H
+
+#include "kritapaintop_export.h"
+#include "kis_dab_cache.h"
+
+
+/**
+ * KisDabRenderingQueue renders the dabs prepared by KisDabCache on the
+ * worker threads of the global thread pool, while the paintop keeps
+ * preparing the following dabs and blitting the ready ones.
+ *
+ * The paintop adds the requests with addDab() in the order of painting
+ * and takes the rendered dabs with takeFirstDab() in exactly the same
+ * order, so the result is identical to the one of the serial painting.
+ *
+ * Every worker uses its own clone of the brush, because the brushes
+ * keep some state while generating the mask. The dabs reused from the
+ * cache are postprocessed (sharpness, texture) as soon as the dab they
+ * are copied from is ready.
+ */
+class PAINTOP_EXPORT KisDabRenderingQueue
+{
+public:
+    KisDabRenderingQueue(KisDabCache *cache, KisBrushSP brush);
+    ~KisDabRenderingQueue();
+
+    /**
+     * Returns true if the dabs of \p brush can be rendered by the
+     * queue. Pipe brushes change their state on every dab and auto
+     * brushes with randomness or density use a shared random
+     * generator, so they should be painted serially.
+     */
+    static bool canRenderBrush(KisBrushSP brush);
+
+    /**
+     * Start rendering of the dab described by \p request
+     */
+    void addDab(const KisDabCache::DabRequest &request);
+
+    /**
+     * Wait until the oldest dab in the queue is ready and take it
+     * out of the queue. \p dabRect is set to the rect on the image
+     * the dab should be painted at.
+     */
+    KisFixedPaintDeviceSP takeFirstDab(QRect *dabRect);
+
+    /**
+     * The number of dabs added but not taken yet
+     */
+    int size() const;
+
+private:
+    struct Private;
+    Private * const m_d;
+};
+
+#endif /* __KIS_DAB_RENDERING_QUEUE_H */
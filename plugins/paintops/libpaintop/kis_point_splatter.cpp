@@ -0,0 +1,210 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_point_splatter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QRect>
+
+#include <KoColorSpace.h>
+#include <KoCompositeOp.h>
+
+#include <kis_paint_device.h>
+#include "kis_assert.h"
+
+/**
+ * The size of the bins the points are sorted into. It is equal to
+ * the size of the tiles of the paint device, so every bin is read
+ * and written with a single tile lookup.
+ */
+static const int BIN_SIZE = 64;
+static const int BIN_SHIFT = 6;
+
+
+KisPointSplatter::KisPointSplatter(const KoColorSpace *colorSpace, const KoCompositeOp *compositeOp)
+    : m_colorSpace(colorSpace),
+      m_compositeOp(compositeOp),
+      m_pixelSize(colorSpace->pixelSize())
+{
+}
+
+void KisPointSplatter::copyPixel(qint32 x, qint32 y, const quint8 *pixel)
+{
+    addPoint(x, y, pixel, COPY, 0);
+}
+
+void KisPointSplatter::compositePixel(qint32 x, qint32 y, const quint8 *pixel)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_compositeOp);
+    addPoint(x, y, pixel, COMPOSITE, 0);
+}
+
+void KisPointSplatter::addOpacityPixel(qint32 x, qint32 y, const quint8 *pixel, quint8 opacity)
+{
+    addPoint(x, y, pixel, ADD_OPACITY, opacity);
+}
+
+void KisPointSplatter::maxOpacityPixel(qint32 x, qint32 y, const quint8 *pixel)
+{
+    addPoint(x, y, pixel, MAX_OPACITY, 0);
+}
+
+bool KisPointSplatter::isEmpty() const
+{
+    return m_points.isEmpty();
+}
+
+inline void KisPointSplatter::addPoint(qint32 x, qint32 y, const quint8 *pixel, Mode mode, quint8 opacity)
+{
+    /**
+     * The particles of one dab usually share the color, so store
+     * a new color only when it differs from the previous one
+     */
+    const int lastOffset = m_colors.size() - m_pixelSize;
+
+    if (lastOffset < 0 ||
+        memcmp(m_colors.constData() + lastOffset, pixel, m_pixelSize) != 0) {
+
+        m_colors.resize(m_colors.size() + m_pixelSize);
+        memcpy(m_colors.data() + m_colors.size() - m_pixelSize, pixel, m_pixelSize);
+    }
+
+    Point pt;
+    pt.x = x;
+    pt.y = y;
+    pt.colorOffset = m_colors.size() - m_pixelSize;
+    pt.mode = mode;
+    pt.opacity = opacity;
+
+    m_points.append(pt);
+}
+
+inline void KisPointSplatter::applyPoint(const Point &pt, quint8 *dst) const
+{
+    const quint8 *src = m_colors.constData() + pt.colorOffset;
+
+    switch (pt.mode) {
+    case COPY:
+        memcpy(dst, src, m_pixelSize);
+        break;
+    case COMPOSITE:
+        m_compositeOp->composite(dst, m_pixelSize, src, m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+        break;
+    case ADD_OPACITY: {
+        const quint8 opacity =
+            quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8,
+                                   pt.opacity + m_colorSpace->opacityU8(dst),
+                                   OPACITY_OPAQUE_U8));
+        memcpy(dst, src, m_pixelSize);
+        m_colorSpace->setOpacity(dst, opacity, 1);
+        break;
+    }
+    case MAX_OPACITY:
+        if (m_colorSpace->opacityU8(dst) < m_colorSpace->opacityU8(src)) {
+            memcpy(dst, src, m_pixelSize);
+        }
+        break;
+    }
+}
+
+void KisPointSplatter::flush(KisPaintDeviceSP dev)
+{
+    const int numPoints = m_points.size();
+    if (!numPoints) return;
+
+    KIS_SAFE_ASSERT_RECOVER_NOOP(*dev->colorSpace() == *m_colorSpace);
+
+    /**
+     * Calculate the bin of every point. The bins are ordered
+     * row-by-row, the same way the tiles are. The coordinates are
+     * packed as unsigned values, so the negative rows and columns go
+     * after the positive ones.
+     */
+    m_keys.resize(numPoints);
+    m_order.resize(numPoints);
+
+    const Point *points = m_points.constData();
+    quint64 *keys = m_keys.data();
+    int *order = m_order.data();
+
+    for (int i = 0; i < numPoints; i++) {
+        const qint32 binX = points[i].x >> BIN_SHIFT;
+        const qint32 binY = points[i].y >> BIN_SHIFT;
+        keys[i] = quint64(quint32(binY)) << 32 | quint32(binX);
+        order[i] = i;
+    }
+
+    /**
+     * The sort must be stable to keep the order of the writes
+     * falling into the same pixel
+     */
+    std::stable_sort(order, order + numPoints,
+                     [keys] (int a, int b) { return keys[a] < keys[b]; });
+
+    m_buffer.resize(BIN_SIZE * BIN_SIZE * m_pixelSize);
+    quint8 *buffer = m_buffer.data();
+
+    int binStart = 0;
+    while (binStart < numPoints) {
+        const quint64 key = keys[order[binStart]];
+
+        /**
+         * Sparse particles touch only a few pixels of a tile, so
+         * read and write back only the area actually painted
+         */
+        const Point &first = points[order[binStart]];
+        qint32 left = first.x;
+        qint32 right = first.x;
+        qint32 top = first.y;
+        qint32 bottom = first.y;
+
+        int binEnd = binStart + 1;
+        while (binEnd < numPoints && keys[order[binEnd]] == key) {
+            const Point &pt = points[order[binEnd]];
+            left = qMin(left, pt.x);
+            right = qMax(right, pt.x);
+            top = qMin(top, pt.y);
+            bottom = qMax(bottom, pt.y);
+            binEnd++;
+        }
+
+        const QRect binRect(QPoint(left, top), QPoint(right, bottom));
+        const int rowStride = binRect.width() * m_pixelSize;
+
+        dev->readBytes(buffer, binRect);
+
+        for (int i = binStart; i < binEnd; i++) {
+            const Point &pt = points[order[i]];
+            quint8 *dst = buffer +
+                (pt.y - binRect.y()) * rowStride +
+                (pt.x - binRect.x()) * m_pixelSize;
+
+            applyPoint(pt, dst);
+        }
+
+        dev->writeBytes(buffer, binRect);
+
+        binStart = binEnd;
+    }
+
+    // resize() keeps the allocated memory for the next dab
+    m_points.resize(0);
+    m_colors.resize(0);
+}
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_POINT_SPLATTER_H
+#define __KIS_POINT_SPLATTER_H
+
+#include <QVector>
+
+#include <kis_types.h>
+#include "kritapaintop_export.h"
+
+class KoColorSpace;
+class KoCompositeOp;
+
+
+/**
+ * KisPointSplatter collects single pixel writes of the paintops
+ * painting thousands of tiny particles per dab (hairy, spray,
+ * particle), and applies all of them to the device at once in
+ * flush().
+ *
+ * Painting every pixel with a random accessor means a tile lookup
+ * and a lock for every single write. The splatter instead bins the
+ * writes by tile, reads the painted area of every tile into a plain
+ * buffer once, applies all the writes falling into it and writes the
+ * buffer back.
+ *
+ * The writes falling into the same pixel are applied in the order
+ * they were added, so the result is exactly the same as the one of
+ * the direct painting.
+ */
+class PAINTOP_EXPORT KisPointSplatter
+{
+public:
+    /**
+     * @param colorSpace the color space of the device the pixels
+     *        will be written to
+     * @param compositeOp the composite op used by compositePixel()
+     */
+    KisPointSplatter(const KoColorSpace *colorSpace, const KoCompositeOp *compositeOp = 0);
+
+    /**
+     * Overwrite the pixel with \p pixel
+     */
+    void copyPixel(qint32 x, qint32 y, const quint8 *pixel);
+
+    /**
+     * Composite \p pixel over the pixel using the composite op
+     * passed to the constructor
+     */
+    void compositePixel(qint32 x, qint32 y, const quint8 *pixel);
+
+    /**
+     * Overwrite the pixel with \p pixel, but set its opacity to the
+     * sum of \p opacity and the opacity of the old pixel
+     */
+    void addOpacityPixel(qint32 x, qint32 y, const quint8 *pixel, quint8 opacity);
+
+    /**
+     * Overwrite the pixel with \p pixel only if the old pixel is
+     * more transparent than \p pixel
+     */
+    void maxOpacityPixel(qint32 x, qint32 y, const quint8 *pixel);
+
+    bool isEmpty() const;
+
+    /**
+     * Apply all the collected writes to \p dev and reset the splatter
+     */
+    void flush(KisPaintDeviceSP dev);
+
+private:
+    enum Mode {
+        COPY,
+        COMPOSITE,
+        ADD_OPACITY,
+        MAX_OPACITY
+    };
+
+    struct Point {
+        qint32 x;
+        qint32 y;
+        qint32 colorOffset;
+        quint8 mode;
+        quint8 opacity;
+    };
+
+    inline void addPoint(qint32 x, qint32 y, const quint8 *pixel, Mode mode, quint8 opacity);
+    inline void applyPoint(const Point &pt, quint8 *dst) const;
+
+private:
+    const KoColorSpace *m_colorSpace;
+    const KoCompositeOp *m_compositeOp;
+    int m_pixelSize;
+
+    QVector<Point> m_points;
+    QVector<quint8> m_colors;
+
+    QVector<quint64> m_keys;
+    QVector<int> m_order;
+    QVector<quint8> m_buffer;
+};
+
+#endif /* __KIS_POINT_SPLATTER_H */
@@ -81,11 +81,15 @@ void KisFlowOpacityOption::setOpacity(qreal opacity)
 }
 
 void KisFlowOpacityOption::apply(KisPainter* painter, const KisPaintInformation& info)
+{
+    painter->setOpacityUpdateAverage(calculateOpacity(info));
+    painter->setFlow(quint8(getFlow() * 255.0));
+}
+
+quint8 KisFlowOpacityOption::calculateOpacity(const KisPaintInformation& info) const
 {
     if (m_paintActionType == WASH && m_nodeHasIndirectPaintingSupport)
-        painter->setOpacityUpdateAverage(quint8(getDynamicOpacity(info) * 255.0));
+        return quint8(getDynamicOpacity(info) * 255.0);
     else
-        painter->setOpacityUpdateAverage(quint8(getStaticOpacity() * getDynamicOpacity(info) * 255.0));
-
-    painter->setFlow(quint8(getFlow() * 255.0));
+        return quint8(getStaticOpacity() * getDynamicOpacity(info) * 255.0);
 }
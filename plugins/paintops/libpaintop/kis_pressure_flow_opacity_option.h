@@ -41,6 +41,11 @@ public:
     void setOpacity(qreal opacity);
     void apply(KisPainter* painter, const KisPaintInformation& info);
 
+    /**
+     * The opacity apply() would pass to the painter
+     */
+    quint8 calculateOpacity(const KisPaintInformation& info) const;
+
     qreal getFlow() const;
     qreal getStaticOpacity() const;
     qreal getDynamicOpacity(const KisPaintInformation& info) const;
@@ -376,6 +376,18 @@ void KisTextureProperties::apply(KisFixedPaintDeviceSP dab, const QPoint &offset
 {
     if (!m_enabled) return;
 
+    applyWithStrength(dab, offset, calculateStrength(info));
+}
+
+qreal KisTextureProperties::calculateStrength(const KisPaintInformation & info)
+{
+    return m_enabled ? m_strengthOption.apply(info) : 0.0;
+}
+
+void KisTextureProperties::applyWithStrength(KisFixedPaintDeviceSP dab, const QPoint &offset, qreal strength) const
+{
+    if (!m_enabled) return;
+
     KisPaintDeviceSP fillDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
     QRect rect = dab->bounds();
 
@@ -386,7 +398,7 @@ void KisTextureProperties::apply(KisFixedPaintDeviceSP dab, const QPoint &offset
     fillPainter.fillRect(x - 1, y - 1, rect.width() + 2, rect.height() + 2, m_mask, m_maskBounds);
     fillPainter.end();
 
-    qreal pressure = m_strengthOption.apply(info);
+    const qreal pressure = strength;
     quint8 *dabData = dab->data();
 
     KisHLineIteratorSP iter = fillDevice->createHLineIteratorNG(x, y, rect.width());
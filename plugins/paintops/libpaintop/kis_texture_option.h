@@ -77,6 +77,20 @@ public:
      * @param offset the position of the dab on the image. used to calculate the position of the mask pattern
      */
     void apply(KisFixedPaintDeviceSP dab, const QPoint& offset, const KisPaintInformation & info);
+
+    /**
+     * The strength of the texture for the dab painted with \p info.
+     * Calculating it reads the sensors, so it must be done in the order
+     * of painting, while applyWithStrength() can be called from any thread.
+     */
+    qreal calculateStrength(const KisPaintInformation & info);
+
+    /**
+     * Same as apply(), but with the strength already calculated
+     * by calculateStrength()
+     */
+    void applyWithStrength(KisFixedPaintDeviceSP dab, const QPoint& offset, qreal strength) const;
+
     void fillProperties(const KisPropertiesConfigurationSP setting);
 
 private:
@@ -0,0 +1,171 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_dab_rendering_queue_test.h"
+
+#include <QTest>
+#include <QtMath>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_auto_brush.h>
+#include <kis_circle_mask_generator.h>
+#include <kis_fixed_paint_device.h>
+#include <kis_paint_device.h>
+#include <kis_painter.h>
+#include <brushengine/kis_paint_information.h>
+
+#include "kis_dab_cache.h"
+#include "kis_dab_rendering_queue.h"
+
+
+namespace {
+
+struct StrokeDab {
+    QPointF pos;
+    KisDabShape shape;
+    KisPaintInformation info;
+};
+
+QVector<StrokeDab> generateStroke()
+{
+    QVector<StrokeDab> stroke;
+
+    for (int i = 0; i < 300; i++) {
+        StrokeDab dab;
+
+        dab.pos = QPointF(20.0 + 1.3 * i, 150.0 + 60.0 * qSin(i / 15.0));
+
+        /**
+         * The shape changes every few dabs, so some of the dabs are
+         * rendered from scratch and the others are taken from the cache
+         */
+        const qreal scale = 1.0 + 0.5 * ((i / 7) % 3);
+        const qreal rotation = 0.3 * ((i / 11) % 4);
+        dab.shape = KisDabShape(scale, 1.0, rotation);
+
+        dab.info = KisPaintInformation(dab.pos, 0.5 + 0.5 * ((i / 5) % 2));
+
+        stroke << dab;
+    }
+
+    return stroke;
+}
+
+KisBrushSP createBrush()
+{
+    KisCircleMaskGenerator *circle = new KisCircleMaskGenerator(30, 0.8, 0.5, 0.5, 2, true);
+    KisBrushSP brush = new KisAutoBrush(circle, 0.0, 0.0);
+    brush->setSpacing(0.1);
+    return brush;
+}
+
+}
+
+void KisDabRenderingQueueTest::testSameAsSerialRendering()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoColor color(Qt::red, cs);
+    const QVector<StrokeDab> stroke = generateStroke();
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    {
+        KisBrushSP brush = createBrush();
+        KisDabCache cache(brush);
+        KisPainter gc(refDev);
+
+        Q_FOREACH (const StrokeDab &dab, stroke) {
+            QRect dabRect;
+            KisFixedPaintDeviceSP fixedDab =
+                cache.fetchDab(cs, color, dab.pos, dab.shape, dab.info, 1.0, &dabRect);
+
+            gc.bltFixed(dabRect.topLeft(), fixedDab, fixedDab->bounds());
+        }
+    }
+
+    {
+        KisBrushSP brush = createBrush();
+        KisDabCache cache(brush);
+        KisDabRenderingQueue queue(&cache, brush);
+        KisPainter gc(dev);
+
+        int numRendered = 0;
+
+        // keep a few dabs in flight, like the brush paintop does
+        Q_FOREACH (const StrokeDab &dab, stroke) {
+            KisDabCache::DabRequest request;
+            cache.prepareDab(cs, color, dab.pos, dab.shape, dab.info, 1.0, &request);
+            queue.addDab(request);
+
+            while (queue.size() > 8) {
+                QRect dabRect;
+                KisFixedPaintDeviceSP fixedDab = queue.takeFirstDab(&dabRect);
+                QVERIFY(fixedDab);
+
+                gc.bltFixed(dabRect.topLeft(), fixedDab, fixedDab->bounds());
+                numRendered++;
+            }
+        }
+
+        while (queue.size() > 0) {
+            QRect dabRect;
+            KisFixedPaintDeviceSP fixedDab = queue.takeFirstDab(&dabRect);
+            QVERIFY(fixedDab);
+
+            gc.bltFixed(dabRect.topLeft(), fixedDab, fixedDab->bounds());
+            numRendered++;
+        }
+
+        QCOMPARE(numRendered, stroke.size());
+    }
+
+    const QRect rc = refDev->exactBounds();
+    QVERIFY(!rc.isEmpty());
+    QCOMPARE(dev->exactBounds(), rc);
+
+    QByteArray refBytes(rc.width() * rc.height() * cs->pixelSize(), 0);
+    QByteArray bytes(rc.width() * rc.height() * cs->pixelSize(), 0);
+
+    refDev->readBytes((quint8*)refBytes.data(), rc);
+    dev->readBytes((quint8*)bytes.data(), rc);
+
+    QVERIFY(refBytes == bytes);
+}
+
+void KisDabRenderingQueueTest::testRandomizedBrushesRenderedSerially()
+{
+    QVERIFY(KisDabRenderingQueue::canRenderBrush(createBrush()));
+
+    {
+        KisCircleMaskGenerator *circle = new KisCircleMaskGenerator(30, 0.8, 0.5, 0.5, 2, true);
+        KisBrushSP brush = new KisAutoBrush(circle, 0.0, 0.5);
+        QVERIFY(!KisDabRenderingQueue::canRenderBrush(brush));
+    }
+
+    {
+        KisCircleMaskGenerator *circle = new KisCircleMaskGenerator(30, 0.8, 0.5, 0.5, 2, true);
+        KisBrushSP brush = new KisAutoBrush(circle, 0.0, 0.0, 0.7);
+        QVERIFY(!KisDabRenderingQueue::canRenderBrush(brush));
+    }
+}
+
+QTEST_MAIN(KisDabRenderingQueueTest)
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2017 Dmitry Kazakov <dimula73@gmail.com>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_point_splatter_test.h"
+
+#include <QTest>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+
+#include <kis_paint_device.h>
+#include <kis_random_accessor_ng.h>
+#include "kis_point_splatter.h"
+
+
+void KisPointSplatterTest::testSameAsDirectPainting()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const KoCompositeOp *op = cs->compositeOp(COMPOSITE_OVER);
+    const int pixelSize = cs->pixelSize();
+
+    KisPaintDeviceSP refDev = new KisPaintDevice(cs);
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    KisRandomAccessorSP it = refDev->createRandomAccessorNG(0, 0);
+    KisPointSplatter splatter(cs, op);
+
+    KoColor color(cs);
+    qsrand(1);
+
+    // the points are concentrated in a small area to make them overlap
+    for (int i = 0; i < 20000; i++) {
+        const int x = qrand() % 300 - 150;
+        const int y = qrand() % 300 - 150;
+        const quint8 opacity = qrand() % 256;
+
+        color.fromQColor(QColor(qrand() % 4 * 80, 100, 200, qrand() % 256));
+
+        it->moveTo(x, y);
+        quint8 *dst = it->rawData();
+
+        switch (i % 4) {
+        case 0:
+            memcpy(dst, color.data(), pixelSize);
+            splatter.copyPixel(x, y, color.data());
+            break;
+        case 1:
+            op->composite(dst, pixelSize, color.data(), pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+            splatter.compositePixel(x, y, color.data());
+            break;
+        case 2: {
+            const quint8 newOpacity =
+                quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8,
+                                       opacity + cs->opacityU8(dst),
+                                       OPACITY_OPAQUE_U8));
+            memcpy(dst, color.data(), pixelSize);
+            cs->setOpacity(dst, newOpacity, 1);
+            splatter.addOpacityPixel(x, y, color.data(), opacity);
+            break;
+        }
+        case 3:
+            if (cs->opacityU8(dst) < color.opacityU8()) {
+                memcpy(dst, color.data(), pixelSize);
+            }
+            splatter.maxOpacityPixel(x, y, color.data());
+            break;
+        }
+    }
+
+    QVERIFY(!splatter.isEmpty());
+    splatter.flush(dev);
+    QVERIFY(splatter.isEmpty());
+
+    const QRect rc = refDev->exactBounds();
+    QCOMPARE(dev->exactBounds(), rc);
+
+    QByteArray refBytes(rc.width() * rc.height() * pixelSize, 0);
+    QByteArray bytes(rc.width() * rc.height() * pixelSize, 0);
+
+    refDev->readBytes((quint8*)refBytes.data(), rc);
+    dev->readBytes((quint8*)bytes.data(), rc);
+
+    QVERIFY(refBytes == bytes);
+}
+
+QTEST_MAIN(KisPointSplatterTest)
@@ -19,7 +19,7 @@
 #include "particle_brush.h"
 
 #include "kis_paint_device.h"
-#include "kis_random_accessor_ng.h"
+#include "kis_point_splatter.h"
 
 #include <KoColorSpace.h>
 #include <KoColor.h>
@@ -55,11 +55,10 @@ void ParticleBrush::setInitialPosition(const QPointF &pos)
 }
 
 
-void ParticleBrush::paintParticle(KisRandomAccessorSP accWrite, const KoColorSpace * cs, const QPointF &pos, const KoColor& color, qreal weight, bool respectOpacity)
+void ParticleBrush::paintParticle(KisPointSplatter &splatter, const QPointF &pos, const KoColor& color, qreal weight, bool respectOpacity)
 {
     // opacity top left, right, bottom left, right
-    KoColor myColor(color);
-    quint8 opacity = respectOpacity ? myColor.opacityU8() : OPACITY_OPAQUE_U8;
+    quint8 opacity = respectOpacity ? color.opacityU8() : OPACITY_OPAQUE_U8;
 
     int ipx = floor(pos.x());
     int ipy = floor(pos.y());
@@ -71,21 +70,10 @@ void ParticleBrush::paintParticle(KisRandomAccessorSP accWrite, const KoColorSpa
     quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity * weight);
     quint8 bbr = qRound((fx)  * (fy)  * opacity * weight);
 
-    accWrite->moveTo(ipx  , ipy);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
-
-    accWrite->moveTo(ipx + 1, ipy);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
-
-    accWrite->moveTo(ipx, ipy + 1);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
-
-    accWrite->moveTo(ipx + 1, ipy + 1);
-    myColor.setOpacity(quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(accWrite->rawData()), OPACITY_OPAQUE_U8)));
-    memcpy(accWrite->rawData(), myColor.data(), cs->pixelSize());
+    splatter.addOpacityPixel(ipx    , ipy    , color.data(), btl);
+    splatter.addOpacityPixel(ipx + 1, ipy    , color.data(), btr);
+    splatter.addOpacityPixel(ipx    , ipy + 1, color.data(), bbl);
+    splatter.addOpacityPixel(ipx + 1, ipy + 1, color.data(), bbr);
 }
 
 
@@ -93,8 +81,7 @@ void ParticleBrush::paintParticle(KisRandomAccessorSP accWrite, const KoColorSpa
 
 void ParticleBrush::draw(KisPaintDeviceSP dab, const KoColor& color, const QPointF &pos)
 {
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG(qRound(pos.x()), qRound(pos.y()));
-    const KoColorSpace * cs = dab->colorSpace();
+    KisPointSplatter splatter(dab->colorSpace());
 
     QRect boundingRect;
 
@@ -141,11 +128,13 @@ void ParticleBrush::draw(KisPaintDeviceSP dab, const KoColor& color, const QPoin
             if (boundingRect.isEmpty() ||
                     boundingRect.contains(m_particlePos[j].toPoint())) {
 
-                paintParticle(accessor, cs, m_particlePos[j], color, m_properties->weight, true);
+                paintParticle(splatter, m_particlePos[j], color, m_properties->weight, true);
             }
 
         }//for j
     }//for i
+
+    splatter.flush(dab);
 }
 
 
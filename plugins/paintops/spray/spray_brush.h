@@ -35,6 +35,7 @@
 #include <kis_brush.h>
 
 class KisPaintInformation;
+class KisPointSplatter;
 
 class SprayBrush
 {
@@ -59,6 +60,7 @@ private:
     quint8 m_dabPixelSize;
 
     KisPainter * m_painter;
+    KisPointSplatter * m_splatter;
     KisPaintDeviceSP m_imageDevice;
     QImage m_brushQImage;
     QImage m_transformed;
@@ -77,7 +79,7 @@ private:
     /// rotation in radians according the settings (gauss distribution, uniform distribution or fixed angle)
     qreal rotationAngle(KisRandomSourceSP randomSource);
     /// Paints Wu Particle
-    void paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry);
+    void paintParticle(const KoColor &color, qreal rx, qreal ry);
     void paintCircle(KisPainter * painter, qreal x, qreal y, qreal radius);
     void paintEllipse(KisPainter * painter, qreal x, qreal y, qreal a, qreal b, qreal angle);
     void paintRectangle(KisPainter * painter, qreal x, qreal y, qreal width, qreal height, qreal angle);